@@ -0,0 +1,79 @@
+/********************************************//**
+* @file SentryBreadcrumbsBenchmark.cpp
+* @brief Benchmarks for SentryBreadcrumbs.h
+* @details Record cost on one thread, on many threads at once, and while
+* another thread keeps merging the rings.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryBreadcrumbs.h"
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief A breadcrumb without arguments
+*/
+static void BM_Breadcrumbs_Record(benchmark::State &state) {
+  for (auto _ : state) {
+    Breadcrumbs::Record("bench", "request finished");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Breadcrumbs_Record)->ThreadRange(1, 8)->UseRealTime();
+
+/*! @brief A breadcrumb with arguments, which are stored and not formatted
+*/
+static void BM_Breadcrumbs_RecordArgs(benchmark::State &state) {
+  int status = 200;
+  for (auto _ : state) {
+    Breadcrumbs::Record("http", attributes::Level::LEVEL_INFO, "GET {} returned {} in {}s", "/api", status, 0.25);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Breadcrumbs_RecordArgs)->ThreadRange(1, 8)->UseRealTime();
+
+/*! @brief Recording while another thread merges the rings for events
+*/
+static void BM_Breadcrumbs_RecordWhileCapturing(benchmark::State &state) {
+  std::atomic<bool> is_running(true);
+  std::atomic<size_t> captures(0);
+  std::thread capturer([&]() {
+    while (is_running.load(std::memory_order_relaxed)) {
+      benchmark::DoNotOptimize(Breadcrumbs::GetInstance().Collect());
+      captures.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+
+  for (auto _ : state) {
+    Breadcrumbs::Record("bench", "request finished");
+  }
+
+  is_running.store(false);
+  capturer.join();
+  state.SetItemsProcessed(state.iterations());
+  state.counters["captures"] = static_cast<double>(captures.load());
+}
+BENCHMARK(BM_Breadcrumbs_RecordWhileCapturing)->UseRealTime();
+
+/*! @brief Merging and serializing the most recent breadcrumbs
+*/
+static void BM_Breadcrumbs_AddToJson(benchmark::State &state) {
+  for (int i = 0; i < 1000; ++i) {
+    Breadcrumbs::Record("http", attributes::Level::LEVEL_INFO, "GET {} returned {}", "/api", i);
+  }
+
+  for (auto _ : state) {
+    rapidjson::Document json;
+    json.SetObject();
+    Breadcrumbs::GetInstance().AddToJson(json);
+    benchmark::DoNotOptimize(json);
+  }
+}
+BENCHMARK(BM_Breadcrumbs_AddToJson)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
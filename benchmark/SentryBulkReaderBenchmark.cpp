@@ -0,0 +1,137 @@
+/********************************************//**
+* @file SentryBulkReaderBenchmark.cpp
+* @brief Benchmarks for SentryBulkReader.h
+* @details Set SENTRY_BENCHMARK_BULK to the path of a large NDJSON or
+* envelope file. Otherwise the replay corpus is repeated into a temporary
+* file of about 64MB.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryBulkReader.h"
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#ifndef SENTRY_REPLAY_CORPUS_DEFAULT
+#define SENTRY_REPLAY_CORPUS_DEFAULT "benchmark/corpus"
+#endif
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief The generated file, removed when the benchmarks exit
+*/
+static std::string& GetGeneratedPath() {
+  static std::string path;
+  return path;
+}
+
+static void RemoveGenerated() {
+  remove(GetGeneratedPath().c_str());
+}
+
+/*! @brief A new, empty temporary file for the generated events
+*/
+static FILE* CreateGenerated(std::string &path) {
+#if !defined(_WIN32)
+  const char *directory = getenv("TMPDIR");
+  path = std::string((directory != NULL && directory[0] != '\0') ? directory : "/tmp") + "/sentry_bulk_reader_XXXXXX";
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) { return NULL; }
+  FILE *file = fdopen(fd, "wb");
+  if (file == NULL) {
+    close(fd);
+    remove(path.c_str());
+  }
+  return file;
+#else
+  char name[L_tmpnam];
+  if (tmpnam(name) == NULL) { return NULL; }
+  path = name;
+  return fopen(path.c_str(), "wb");
+#endif
+}
+
+/*! @brief The file to read, written on first use unless one was given
+*/
+static std::string BenchmarkBulkPath() {
+  const char *path = getenv("SENTRY_BENCHMARK_BULK");
+  if (path != NULL) { return path; }
+
+  static const std::string generated = []() {
+    std::ifstream corpus(std::string(SENTRY_REPLAY_CORPUS_DEFAULT) + "/events.ndjson", std::ios::in | std::ios::binary);
+    std::ostringstream contents;
+    contents << corpus.rdbuf();
+    std::string events = contents.str();
+    if (events.empty()) {
+      events = "{\"exception\":{\"values\":[{\"type\":\"std::runtime_error\",\"value\":\"failure\"}]},\"message\":\"failure\"}\n";
+    }
+
+    std::string file_path;
+    FILE *file = CreateGenerated(file_path);
+    if (file == NULL) { return std::string(); }
+    GetGeneratedPath() = file_path;
+    atexit(RemoveGenerated);
+    for (size_t written = 0; written < (64u << 20); written += events.size()) {
+      fwrite(events.data(), 1, events.size(), file);
+    }
+    fclose(file);
+    return file_path;
+  }();
+  return generated;
+}
+
+/*! @brief Time to map a file and index its records
+*/
+static void BM_BulkReader_Index(benchmark::State &state) {
+  const std::string path = BenchmarkBulkPath();
+  size_t bytes = 0;
+  size_t records = 0;
+
+  for (auto _ : state) {
+    BulkReader reader(path);
+    bytes = reader.GetMappedSize();
+    records = reader.GetRecordCount();
+    benchmark::DoNotOptimize(records);
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+  state.counters["records"] = static_cast<double>(records);
+}
+BENCHMARK(BM_BulkReader_Index)->Unit(benchmark::kMillisecond);
+
+/*! @brief Parse throughput in GB/s by the number of workers
+*/
+static void BM_BulkReader_Read(benchmark::State &state) {
+  BulkReader reader(BenchmarkBulkPath());
+  if (!reader.IsValid() || reader.GetRecordCount() == 0) {
+    state.SkipWithError("no records to read");
+    return;
+  }
+
+  std::atomic<uint64_t> exceptions(0);
+  double seconds = 0.0;
+  for (auto _ : state) {
+    BulkReadStats stats = reader.Read([&exceptions](BulkEvent &event) {
+      exceptions.fetch_add(event.exceptions.size(), std::memory_order_relaxed);
+    }, static_cast<size_t>(state.range(0)));
+    seconds += stats.seconds;
+  }
+
+  const double bytes = static_cast<double>(state.iterations()) * static_cast<double>(reader.GetMappedSize());
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * reader.GetRecordCount()));
+  state.counters["GB/s"] = (seconds > 0.0) ? bytes / seconds / 1e9 : 0.0;
+  state.counters["exceptions"] = static_cast<double>(exceptions.load());
+}
+BENCHMARK(BM_BulkReader_Read)->ArgName("workers")->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
\ No newline at end of file
@@ -0,0 +1,76 @@
+/********************************************//**
+* @file SentryElfBenchmark.cpp
+* @brief Benchmarks for SentryElf.h
+* @details Set SENTRY_BENCHMARK_ELF to the path of a large binary, the
+* running executable is used otherwise.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryElf.h"
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+static std::string BenchmarkElfPath() {
+  const char *path = getenv("SENTRY_BENCHMARK_ELF");
+  return (path != NULL) ? path : "/proc/self/exe";
+}
+
+/*! @brief Time to map an image and build both indexes
+*/
+static void BM_ElfImage_IndexBuild(benchmark::State &state) {
+  const std::string path = BenchmarkElfPath();
+  size_t symbols = 0;
+  size_t rows = 0;
+
+  for (auto _ : state) {
+    ElfImage image(path);
+    symbols = image.GetSymbolCount();
+    rows = image.GetLineRowCount();
+    benchmark::DoNotOptimize(symbols);
+    benchmark::DoNotOptimize(rows);
+  }
+
+  state.counters["symbols"] = static_cast<double>(symbols);
+  state.counters["line_rows"] = static_cast<double>(rows);
+}
+BENCHMARK(BM_ElfImage_IndexBuild)->Unit(benchmark::kMillisecond);
+
+/*! @brief Lookup latency for addresses spread over the symbol range
+*/
+static void BM_ElfImage_Lookup(benchmark::State &state) {
+  ElfImage image(BenchmarkElfPath());
+  if (!image.IsValid() || image.GetSymbolCount() == 0) {
+    state.SkipWithError("no symbols in image");
+    return;
+  }
+  image.GetLineRowCount();
+
+  // Sample addresses from the image itself by resolving a stride of offsets
+  std::vector<uint64_t> addresses;
+  ElfLocation location;
+  for (uint64_t offset = 0; addresses.size() < 4096 && offset < (16ull << 20); offset += 0x40) {
+    uint64_t address = image.GetBaseAddress() + offset;
+    if (image.Lookup(address, location)) {
+      addresses.push_back(address);
+    }
+  }
+  if (addresses.empty()) {
+    state.SkipWithError("no resolvable addresses");
+    return;
+  }
+
+  size_t index = 0;
+  for (auto _ : state) {
+    bool found = image.Lookup(addresses[index], location);
+    benchmark::DoNotOptimize(found);
+    index = (index + 1) % addresses.size();
+  }
+}
+BENCHMARK(BM_ElfImage_Lookup);
\ No newline at end of file
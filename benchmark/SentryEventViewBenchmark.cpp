@@ -0,0 +1,104 @@
+/********************************************//**
+* @file SentryEventViewBenchmark.cpp
+* @brief Benchmarks for SentryEventView.h
+* @details Filters the replay corpus the way a relay does, reading the level
+* and the first exception type of every event, once through the owning
+* interfaces and once through views of the event parsed in place.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEventView.h"
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef SENTRY_REPLAY_CORPUS_DEFAULT
+#define SENTRY_REPLAY_CORPUS_DEFAULT "benchmark/corpus"
+#endif
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+static const std::vector<std::string>& GetFilterEvents() {
+  static const std::vector<std::string> events = []() {
+    std::vector<std::string> lines;
+    std::ifstream corpus(std::string(SENTRY_REPLAY_CORPUS_DEFAULT) + "/events.ndjson", std::ios::in | std::ios::binary);
+    std::string line;
+    while (std::getline(corpus, line)) {
+      if (!line.empty() && line[0] == '{') {
+        lines.push_back(line);
+      }
+    }
+    return lines;
+  }();
+  return events;
+}
+
+/*! @brief Keep fatal events and events whose first exception is a std::bad_alloc
+*/
+static bool IsKept(const StringView &level, const StringView &type) {
+  return (level == StringView("fatal")) || (type == StringView("std::bad_alloc"));
+}
+
+/*! @brief Parse each event and build its exceptions to read two fields
+*/
+static void BM_EventFilter_Owning(benchmark::State &state) {
+  const std::vector<std::string> &events = GetFilterEvents();
+  size_t kept = 0;
+  size_t bytes = 0;
+
+  for (auto _ : state) {
+    for (auto payload = events.cbegin(); payload != events.cend(); ++payload) {
+      rapidjson::Document json;
+      json.Parse(payload->c_str());
+      if (json.HasParseError() || !json.IsObject()) { continue; }
+
+      std::string level;
+      if (json.HasMember(JSON_ELEM_LEVEL) && json[JSON_ELEM_LEVEL].IsString()) {
+        level = json[JSON_ELEM_LEVEL].GetString();
+      }
+      Exception exception;
+      if (json.HasMember(JSON_ELEM_EXCEPTION) && json[JSON_ELEM_EXCEPTION].IsObject() &&
+          json[JSON_ELEM_EXCEPTION].HasMember(JSON_ELEM_EXCEPTION_VALUES) && json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES].Size() > 0) {
+        exception = Exception(json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES][0]);
+      }
+      kept += IsKept(StringView(level), StringView(exception.GetType())) ? 1 : 0;
+      bytes += payload->size();
+    }
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+  state.counters["kept"] = static_cast<double>(kept) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_EventFilter_Owning)->Unit(benchmark::kMicrosecond);
+
+/*! @brief Parse each event in place and read two fields through views
+*/
+static void BM_EventFilter_View(benchmark::State &state) {
+  const std::vector<std::string> &events = GetFilterEvents();
+  std::vector<char> buffer;
+  size_t kept = 0;
+  size_t bytes = 0;
+
+  for (auto _ : state) {
+    for (auto payload = events.cbegin(); payload != events.cend(); ++payload) {
+      buffer.assign(payload->c_str(), payload->c_str() + payload->size() + 1);
+      const EventView event(&buffer[0]);
+      if (!event.IsValid()) { continue; }
+
+      kept += IsKept(event.GetLevel(), event.GetException(0).GetType()) ? 1 : 0;
+      bytes += payload->size();
+    }
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+  state.counters["kept"] = static_cast<double>(kept) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_EventFilter_View)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
@@ -0,0 +1,443 @@
+/********************************************//**
+* @file SentryInterfacesBenchmark.cpp
+* @brief Benchmarks for the interfaces' JSON conversion
+* @details Construction, ToJson, FromJson and IsValid of every interface, and
+* serialization of a whole event, over the sizes that drive their cost:
+* string lengths, vars per frame, frames per stack, threads per dump and
+* additional fields.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEvent.h"
+#include "SentryFrame.h"
+#include "SentryStacktrace.h"
+#include "SentryThreads.h"
+#include "SentryException.h"
+#include "SentryMessage.h"
+#include "SentryUser.h"
+#include "SentryContext.h"
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief A frame as the symbolizer would produce it
+*   @param length of each string member
+*   @param vars in the frame's vars map
+*/
+static Frame MakeFrame(const size_t &index, const size_t &length, const size_t &vars) {
+  const std::string padding(length, 'x');
+  rapidjson::Document json;
+  {
+    Frame frame("src/module_" + std::to_string(index) + ".cpp", "Function" + std::to_string(index) + padding, "module" + padding);
+    frame.SetLineNumber(static_cast<int>(index + 1));
+    frame.SetAbsPath("/home/build/src/module_" + std::to_string(index) + padding + ".cpp");
+    frame.SetInstructionAddr("0x7f3a12c4" + std::to_string(index));
+    frame.SetIsInApp(true);
+    frame.ToJson(json);
+  }
+  if (vars > 0) {
+    rapidjson::Value values(rapidjson::kObjectType);
+    for (size_t i = 0; i < vars; ++i) {
+      const std::string key = "local_" + std::to_string(i);
+      const std::string value = padding + std::to_string(i);
+      rapidjson::Value name(rapidjson::kStringType);
+      name.SetString(key.data(), static_cast<rapidjson::SizeType>(key.size()), json.GetAllocator());
+      rapidjson::Value var(rapidjson::kStringType);
+      var.SetString(value.data(), static_cast<rapidjson::SizeType>(value.size()), json.GetAllocator());
+      values.AddMember(name, var, json.GetAllocator());
+    }
+    json.AddMember(rapidjson::StringRef(JSON_ELEM_VARS), values, json.GetAllocator());
+  }
+  return Frame(json);
+}
+
+static Stacktrace MakeStacktrace(const size_t &frames, const size_t &length = 16, const size_t &vars = 0) {
+  std::vector<Frame> list;
+  for (size_t i = 0; i < frames; ++i) {
+    list.push_back(MakeFrame(i, length, vars));
+  }
+  return Stacktrace(list);
+}
+
+static StringMap MakeFields(const size_t &count) {
+  StringMap fields;
+  for (size_t i = 0; i < count; ++i) {
+    fields["field_" + std::to_string(i)] = "value " + std::to_string(i);
+  }
+  return fields;
+}
+
+/*! @brief A frame with state.range(0) long strings and state.range(1) vars
+*/
+class FrameFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    frame = MakeFrame(1, static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    json.SetNull();
+    frame.ToJson(json);
+  }
+
+  Frame frame;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(FrameFixture, Construct)(benchmark::State &state) {
+  const std::string padding(static_cast<size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    Frame frame("src/module.cpp", "Function" + padding, "module" + padding);
+    frame.SetLineNumber(42);
+    frame.SetAbsPath("/home/build/src/module" + padding + ".cpp");
+    benchmark::DoNotOptimize(frame);
+  }
+}
+BENCHMARK_REGISTER_F(FrameFixture, Construct)->ArgNames({ "length", "vars" })->Args({ 16, 0 })->Args({ 256, 0 });
+
+BENCHMARK_DEFINE_F(FrameFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    frame.ToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(FrameFixture, ToJson)->ArgNames({ "length", "vars" })->ArgsProduct({ { 16, 256 }, { 0, 8, 64 } });
+
+BENCHMARK_DEFINE_F(FrameFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    Frame parsed(json);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(FrameFixture, FromJson)->ArgNames({ "length", "vars" })->ArgsProduct({ { 16, 256 }, { 0, 8, 64 } });
+
+BENCHMARK_DEFINE_F(FrameFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(frame.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(FrameFixture, IsValid)->ArgNames({ "length", "vars" })->Args({ 16, 0 });
+
+/*! @brief A stacktrace of state.range(0) frames
+*/
+class StacktraceFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    stacktrace = MakeStacktrace(static_cast<size_t>(state.range(0)));
+    json.SetNull();
+    stacktrace.ToJson(json);
+  }
+
+  Stacktrace stacktrace;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(StacktraceFixture, Construct)(benchmark::State &state) {
+  const std::vector<Frame> &frames = stacktrace.GetFrames();
+  for (auto _ : state) {
+    Stacktrace copy(frames);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK_REGISTER_F(StacktraceFixture, Construct)->ArgName("frames")->Arg(8)->Arg(64)->Arg(256);
+
+BENCHMARK_DEFINE_F(StacktraceFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    stacktrace.ToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(StacktraceFixture, ToJson)->ArgName("frames")->Arg(8)->Arg(64)->Arg(256);
+
+BENCHMARK_DEFINE_F(StacktraceFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    Stacktrace parsed(json);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(StacktraceFixture, FromJson)->ArgName("frames")->Arg(8)->Arg(64)->Arg(256);
+
+BENCHMARK_DEFINE_F(StacktraceFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(stacktrace.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(StacktraceFixture, IsValid)->ArgName("frames")->Arg(8)->Arg(256);
+
+/*! @brief A dump of state.range(0) threads, each state.range(1) frames deep
+*/
+class ThreadsFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    std::vector<Thread> list;
+    const Stacktrace stacktrace = MakeStacktrace(static_cast<size_t>(state.range(1)));
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      list.push_back(Thread(static_cast<int>(1000 + i), i == 0, i == 0, stacktrace, "worker " + std::to_string(i)));
+    }
+    threads = sentry::Threads(list);
+    json.SetObject();
+    threads.AddToJson(json);
+  }
+
+  sentry::Threads threads;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(ThreadsFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    threads.AddToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(ThreadsFixture, ToJson)->ArgNames({ "threads", "frames" })->ArgsProduct({ { 1, 8, 64 }, { 16, 64 } });
+
+BENCHMARK_DEFINE_F(ThreadsFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    sentry::Threads parsed(json[JSON_ELEM_THREADS]);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(ThreadsFixture, FromJson)->ArgNames({ "threads", "frames" })->ArgsProduct({ { 1, 8, 64 }, { 16, 64 } });
+
+BENCHMARK_DEFINE_F(ThreadsFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(threads.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(ThreadsFixture, IsValid)->ArgNames({ "threads", "frames" })->Args({ 64, 16 });
+
+/*! @brief An exception with state.range(0) long type and value
+*/
+class ExceptionFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    const std::string padding(static_cast<size_t>(state.range(0)), 'x');
+    exception = Exception("std::runtime_error" + padding, "failed " + padding, "app", MakeStacktrace(16));
+    json.SetNull();
+    exception.ToJson(json);
+  }
+
+  Exception exception;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(ExceptionFixture, Construct)(benchmark::State &state) {
+  const std::string padding(static_cast<size_t>(state.range(0)), 'x');
+  const Stacktrace &stacktrace = exception.GetStacktrace();
+  for (auto _ : state) {
+    Exception built("std::runtime_error" + padding, "failed " + padding, "app", stacktrace);
+    benchmark::DoNotOptimize(built);
+  }
+}
+BENCHMARK_REGISTER_F(ExceptionFixture, Construct)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ExceptionFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    exception.ToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(ExceptionFixture, ToJson)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ExceptionFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    Exception parsed(json);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(ExceptionFixture, FromJson)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ExceptionFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(exception.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(ExceptionFixture, IsValid)->ArgName("length")->Arg(16);
+
+/*! @brief A message of state.range(0) characters with state.range(1) additional fields
+*/
+class MessageFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    message = Message(std::string(static_cast<size_t>(state.range(0)), 'm') + " %s", "param");
+    message.SetAdditionalFields(MakeFields(static_cast<size_t>(state.range(1))));
+    json.SetObject();
+    message.AddToJson(json);
+  }
+
+  Message message;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(MessageFixture, Construct)(benchmark::State &state) {
+  const std::string text(static_cast<size_t>(state.range(0)), 'm');
+  const StringMap fields = MakeFields(static_cast<size_t>(state.range(1)));
+  for (auto _ : state) {
+    Message built(text, "param");
+    built.SetAdditionalFields(fields);
+    benchmark::DoNotOptimize(built);
+  }
+}
+BENCHMARK_REGISTER_F(MessageFixture, Construct)->ArgNames({ "length", "fields" })->ArgsProduct({ { 16, 1024 }, { 0, 16 } });
+
+BENCHMARK_DEFINE_F(MessageFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    message.AddToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(MessageFixture, ToJson)->ArgNames({ "length", "fields" })->ArgsProduct({ { 16, 1024 }, { 0, 16 } });
+
+BENCHMARK_DEFINE_F(MessageFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    Message parsed(json[JSON_ELEM_MESSAGE]);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(MessageFixture, FromJson)->ArgNames({ "length", "fields" })->ArgsProduct({ { 16, 1024 }, { 0, 16 } });
+
+BENCHMARK_DEFINE_F(MessageFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(message.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(MessageFixture, IsValid)->ArgNames({ "length", "fields" })->Args({ 16, 0 });
+
+/*! @brief A user with state.range(0) additional fields
+*/
+class UserFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    user = User("42", "user@example.com", "user", "127.0.0.1", MakeFields(static_cast<size_t>(state.range(0))));
+    json.SetObject();
+    user.AddToJson(json);
+  }
+
+  User user;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(UserFixture, Construct)(benchmark::State &state) {
+  const StringMap fields = MakeFields(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    User built("42", "user@example.com", "user", "127.0.0.1", fields);
+    benchmark::DoNotOptimize(built);
+  }
+}
+BENCHMARK_REGISTER_F(UserFixture, Construct)->ArgName("fields")->Arg(0)->Arg(16)->Arg(64);
+
+BENCHMARK_DEFINE_F(UserFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    user.AddToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(UserFixture, ToJson)->ArgName("fields")->Arg(0)->Arg(16)->Arg(64);
+
+BENCHMARK_DEFINE_F(UserFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    User parsed(json[JSON_ELEM_USER]);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(UserFixture, FromJson)->ArgName("fields")->Arg(0)->Arg(16)->Arg(64);
+
+BENCHMARK_DEFINE_F(UserFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(user.IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(UserFixture, IsValid)->ArgName("fields")->Arg(0);
+
+/*! @brief An OS context with state.range(0) long strings
+*/
+class ContextFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &state) {
+    const std::string padding(static_cast<size_t>(state.range(0)), 'x');
+    context.reset(new ContextOS("Linux" + padding, "6.1" + padding, "build " + padding, "6.1.0-13-amd64" + padding));
+    json.SetNull();
+    context->ToJson(json);
+  }
+
+  void TearDown(const benchmark::State &) {
+    context.reset();
+  }
+
+  std::unique_ptr<ContextOS> context;
+  rapidjson::Document json;
+};
+
+BENCHMARK_DEFINE_F(ContextFixture, Construct)(benchmark::State &state) {
+  const std::string padding(static_cast<size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    ContextOS built("Linux" + padding, "6.1" + padding, "build " + padding, "6.1.0-13-amd64" + padding);
+    benchmark::DoNotOptimize(built);
+  }
+}
+BENCHMARK_REGISTER_F(ContextFixture, Construct)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ContextFixture, ToJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    rapidjson::Document doc;
+    context->ToJson(doc);
+    benchmark::DoNotOptimize(doc);
+  }
+}
+BENCHMARK_REGISTER_F(ContextFixture, ToJson)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ContextFixture, FromJson)(benchmark::State &state) {
+  for (auto _ : state) {
+    ContextOS parsed(json);
+    benchmark::DoNotOptimize(parsed);
+  }
+}
+BENCHMARK_REGISTER_F(ContextFixture, FromJson)->ArgName("length")->Arg(16)->Arg(1024);
+
+BENCHMARK_DEFINE_F(ContextFixture, IsValid)(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(context->IsValid());
+  }
+}
+BENCHMARK_REGISTER_F(ContextFixture, IsValid)->ArgName("length")->Arg(16);
+
+/*! @brief A whole crash event: an exception, a thread dump, a message and a user
+*   @details state.range(0) threads, each state.range(1) frames deep.
+*/
+static void BM_Event_Serialize(benchmark::State &state) {
+  const size_t frames = static_cast<size_t>(state.range(1));
+  const Stacktrace stacktrace = MakeStacktrace(frames, 32, 4);
+  std::vector<Thread> list;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    list.push_back(Thread(static_cast<int>(1000 + i), i == 0, i == 0, stacktrace, "worker " + std::to_string(i)));
+  }
+  const Threads threads(list);
+  const Exception exception("SIGSEGV", "Segmentation fault", "app", stacktrace, 1000);
+  const Message message("Crashed while saving %s", "document.dwg");
+  const User user("42", "user@example.com", "user", "127.0.0.1", MakeFields(8));
+
+  size_t bytes = 0;
+  for (auto _ : state) {
+    Event event;
+    event.AddException(exception).Add(threads).Add(message).Add(user);
+    std::string payload = event.ToString();
+    bytes += payload.size();
+    benchmark::DoNotOptimize(payload);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_Event_Serialize)->ArgNames({ "threads", "frames" })->ArgsProduct({ { 1, 8, 64 }, { 16, 64 } });
\ No newline at end of file
@@ -0,0 +1,46 @@
+/********************************************//**
+* @file SentryMessageAggregatorBenchmark.cpp
+* @brief Benchmarks for SentryMessageAggregator.h
+* @details Cost of recording a repeated message against building an event for it
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryMessageAggregator.h"
+#include <benchmark/benchmark.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+static MessageAggregator& GetAggregator() {
+  static MessageAggregator aggregator([](Event &&event) { benchmark::DoNotOptimize(event); });
+  return aggregator;
+}
+
+/*! @brief A repeated warning, counted in place
+*/
+static void BM_MessageAggregator_Record(benchmark::State &state) {
+  const Message message("Slow request to %s", "/api/v1/items");
+  const attributes::Level level(attributes::Level::LEVEL_WARNING);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetAggregator().Record(message, level));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageAggregator_Record)->ThreadRange(1, 8)->UseRealTime();
+
+/*! @brief The same warning as its own event, for comparison
+*/
+static void BM_MessageAggregator_EventPerMessage(benchmark::State &state) {
+  const Message message("Slow request to %s", "/api/v1/items");
+  const attributes::Level level(attributes::Level::LEVEL_WARNING);
+  for (auto _ : state) {
+    Event event(level);
+    event.Add(message);
+    benchmark::DoNotOptimize(event);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MessageAggregator_EventPerMessage)->ThreadRange(1, 8)->UseRealTime();
\ No newline at end of file
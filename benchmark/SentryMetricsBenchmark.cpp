@@ -0,0 +1,54 @@
+/********************************************//**
+* @file SentryMetricsBenchmark.cpp
+* @brief Benchmarks for SentryMetrics.h
+* @details Cost of recording each metric type into an existing series
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryMetrics.h"
+#include <benchmark/benchmark.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+static MetricsAggregator& GetMetrics() {
+  static MetricsAggregator metrics([](const std::string &envelope) { benchmark::DoNotOptimize(envelope); });
+  return metrics;
+}
+
+/*! @brief A counter with two tags
+*/
+static void BM_Metrics_Increment(benchmark::State &state) {
+  const StringMap tags = { { "route", "/api/v1/items" }, { "status", "200" } };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetMetrics().Increment("requests", 1.0, "none", tags));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Increment)->ThreadRange(1, 8)->UseRealTime();
+
+/*! @brief A distribution value added to the sketch
+*/
+static void BM_Metrics_Distribution(benchmark::State &state) {
+  double value = 1.0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetMetrics().Distribution("latency", value, "millisecond"));
+    value = (value < 1000.0) ? value * 1.1 : 1.0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Distribution)->ThreadRange(1, 8)->UseRealTime();
+
+/*! @brief A set member added to the HyperLogLog registers
+*/
+static void BM_Metrics_Set(benchmark::State &state) {
+  const std::string member = "user-1234";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetMetrics().Set("users", member));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Set)->ThreadRange(1, 8)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,119 @@
+/********************************************//**
+* @file SentryProfilerBenchmark.cpp
+* @brief Benchmarks for SentryProfiler.h
+* @details CPU overhead of sampling at 100Hz on a busy thread, reported as
+* the ratio of the process CPU time the sampled work takes, the collector
+* thread included, to the same work's CPU time unsampled. A ratio above
+* PROFILER_CPU_BUDGET fails the run.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryProfiler.h"
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <time.h>
+
+using namespace sentry;
+
+static const double PROFILER_CPU_BUDGET = 1.01;     // At most 1% more CPU with the profiler on
+static const int PROFILER_CHUNK = 20;               // Runs of the work per measured chunk, a few samples
+static const int PROFILER_PAIRS = 31;               // Unsampled and sampled chunks compared
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief A fixed amount of work, a few milliseconds long
+*/
+static double Work() {
+  double total = 0.0;
+  for (int i = 1; i < 2000000; ++i) {
+    total += 1.0 / i;
+  }
+  return total;
+}
+
+/*! @brief CPU seconds used by every thread of the process so far
+*/
+static double GetProcessCPU() {
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+/*! @brief CPU seconds that PROFILER_CHUNK runs of the work take
+*/
+static double RunChunk() {
+  const double start = GetProcessCPU();
+  for (int i = 0; i < PROFILER_CHUNK; ++i) {
+    benchmark::DoNotOptimize(Work());
+  }
+  return GetProcessCPU() - start;
+}
+
+/*! @brief The median of some ratios
+*/
+static double GetMedian(std::vector<double> ratios) {
+  std::nth_element(ratios.begin(), ratios.begin() + ratios.size() / 2, ratios.end());
+  return ratios[ratios.size() / 2];
+}
+
+/*! @brief The work with no profiler running
+*/
+static void BM_Profiler_Off(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Work());
+  }
+}
+BENCHMARK(BM_Profiler_Off)->Unit(benchmark::kMillisecond);
+
+/*! @brief The same work sampled at the default frequency
+*   @details Each pair runs a chunk of the work unsampled and the same chunk
+*   with a profiler on, back to back, so both halves see the same machine. Process CPU
+*   time counts the signal handler and the collector's drains, deduplication
+*   and symbolization as they happen during the sampled chunk; the median of
+*   the pairs keeps a noisy neighbour from deciding the result. The one-time
+*   cost of Start() and Stop(), final drain included, is reported separately.
+*/
+static void BM_Profiler_On(benchmark::State &state) {
+  std::vector<double> ratios;
+  double start_stop = 0.0;
+  size_t samples = 0;
+  size_t dropped = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < PROFILER_PAIRS; ++i) {
+      // Alternate which half goes first, so warming up favours neither
+      double off = (i % 2 == 0) ? RunChunk() : 0.0;
+
+      Profiler profiler([](const std::string &) {});
+      double start = GetProcessCPU();
+      if (!profiler.Start()) {
+        state.SkipWithError("the profiler could not start");
+        return;
+      }
+      start_stop += GetProcessCPU() - start;
+      const double on = RunChunk();
+      start = GetProcessCPU();
+      profiler.Stop();
+      start_stop += GetProcessCPU() - start;
+      if (i % 2 != 0) { off = RunChunk(); }
+
+      ratios.push_back(on / off);
+      samples += profiler.GetSampleCount();
+      dropped += profiler.GetDroppedCount();
+    }
+  }
+
+  const double ratio = GetMedian(ratios);
+  state.counters["cpu_overhead_ratio"] = ratio;
+  state.counters["start_stop_ms"] = benchmark::Counter(start_stop * 1000.0 / PROFILER_PAIRS, benchmark::Counter::kAvgIterations);
+  state.counters["samples"] = benchmark::Counter(static_cast<double>(samples), benchmark::Counter::kAvgIterations);
+  state.counters["dropped"] = static_cast<double>(dropped);
+  if (ratio > PROFILER_CPU_BUDGET) {
+    state.SkipWithError(("CPU overhead ratio " + std::to_string(ratio) + " is over the 1% budget").c_str());
+  }
+}
+BENCHMARK(BM_Profiler_On)->Unit(benchmark::kMillisecond)->Iterations(1);
\ No newline at end of file
@@ -0,0 +1,267 @@
+/********************************************//**
+* @file SentryReplayBenchmark.cpp
+* @brief Replays recorded events through the interfaces
+* @details Reads the NDJSON files (one event per line) and JSON files (one
+* event each) in $SENTRY_REPLAY_CORPUS, or benchmark/corpus by default. Each
+* event is parsed, rebuilt through the FromJson constructors and serialized
+* again. Results are reported per kind of event with latency percentiles and
+* the peak resident set size of the run, reset before each kind so one kind's
+* peak does not hide the next one's. The default corpus is
+* synthetic: generated events in the shape of the crash reports the SDK sends.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEvent.h"
+#include "SentryThreads.h"
+#include "SentryException.h"
+#include "SentryMessage.h"
+#include "SentryUser.h"
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#ifndef SENTRY_REPLAY_CORPUS_DEFAULT
+#define SENTRY_REPLAY_CORPUS_DEFAULT "benchmark/corpus"
+#endif
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+static bool EndsWith(const std::string &text, const std::string &suffix) {
+  return (text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+/*! @brief Add the events of one file: every line of NDJSON, or the whole file
+*/
+static void ReadCorpusFile(const std::string &path, std::vector<std::string> &events) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if (!file) { return; }
+
+  if (EndsWith(path, ".json")) {
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    events.push_back(contents.str());
+    return;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[0] == '{') {
+      events.push_back(line);
+    }
+  }
+}
+
+/*! @brief Every event under a path, which may be a file or a directory
+*/
+static std::vector<std::string> ReadCorpus(const std::string &path) {
+  std::vector<std::string> events;
+#if !defined(_WIN32)
+  DIR *directory = opendir(path.c_str());
+  if (directory != NULL) {
+    std::vector<std::string> names;
+    for (struct dirent *entry = readdir(directory); entry != NULL; entry = readdir(directory)) {
+      const std::string name = entry->d_name;
+      if (EndsWith(name, ".ndjson") || EndsWith(name, ".json")) {
+        names.push_back(name);
+      }
+    }
+    closedir(directory);
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); ++i) {
+      ReadCorpusFile(path + "/" + names[i], events);
+    }
+    return events;
+  }
+#endif
+  ReadCorpusFile(path, events);
+  return events;
+}
+
+/*! @brief The kind of event, by the interfaces it carries
+*/
+static std::string GetEventKind(const std::string &payload) {
+  rapidjson::Document json;
+  json.Parse(payload.c_str());
+  if (json.HasParseError() || !json.IsObject()) { return "invalid"; }
+  if (json.HasMember(JSON_ELEM_EXCEPTION)) {
+    return json.HasMember(JSON_ELEM_THREADS) ? "crash" : "exception";
+  }
+  if (json.HasMember(JSON_ELEM_MESSAGE)) { return "message"; }
+  return "other";
+}
+
+/*! @brief Parse an event, rebuild its interfaces and serialize it again
+*   @return the size of the new payload
+*/
+static size_t ReplayEvent(const std::string &payload) {
+  rapidjson::Document json;
+  json.Parse(payload.c_str());
+  if (json.HasParseError() || !json.IsObject()) { return 0; }
+
+  Event event;
+  if (json.HasMember(JSON_ELEM_EXCEPTION) && json[JSON_ELEM_EXCEPTION].IsObject() &&
+      json[JSON_ELEM_EXCEPTION].HasMember(JSON_ELEM_EXCEPTION_VALUES)) {
+    const rapidjson::Value &values = json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES];
+    for (rapidjson::Value::ConstValueIterator value = values.Begin(); value != values.End(); ++value) {
+      event.AddException(Exception(*value));
+    }
+  }
+  if (json.HasMember(JSON_ELEM_THREADS)) {
+    event.Add(Threads(json[JSON_ELEM_THREADS]));
+  }
+  if (json.HasMember(JSON_ELEM_MESSAGE)) {
+    event.Add(Message(json[JSON_ELEM_MESSAGE]));
+  }
+  if (json.HasMember(JSON_ELEM_USER)) {
+    event.Add(User(json[JSON_ELEM_USER]));
+  }
+  return event.ToString().size();
+}
+
+/*! @brief A field of /proc/self/status in kilobytes, such as VmRSS or VmHWM
+*/
+static double GetStatusMemory(const std::string &field) {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size() + 1, field + ":") == 0) {
+      return std::strtod(line.c_str() + field.size() + 1, NULL);
+    }
+  }
+#else
+  (void)field;
+#endif
+  return 0.0;
+}
+
+/*! @brief Start a new peak resident set size from the current one
+*   @return false if the kernel refused, so VmHWM still covers the whole process
+*/
+static bool ResetPeakMemory() {
+#if defined(__linux__)
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.flush();
+  return clear_refs.good();
+#else
+  return false;
+#endif
+}
+
+/*! @brief Latencies in a fixed set of buckets, so recording never allocates
+*   @details Each power of two is split into 16 linear buckets, which keeps
+*   every percentile within about 6% of the true value.
+*/
+class LatencyHistogram {
+public:
+  LatencyHistogram() : _count(0), _max(0), _buckets(64 * 16, 0) {}
+
+  void Record(const uint64_t &nanoseconds) {
+    ++_buckets[GetBucket(nanoseconds)];
+    ++_count;
+    _max = std::max(_max, nanoseconds);
+  }
+
+  /*! @brief The upper bound of the bucket holding a percentile
+  */
+  double GetPercentile(const double &percentile) const {
+    const uint64_t target = static_cast<uint64_t>(static_cast<double>(_count) * percentile / 100.0);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _buckets.size(); ++i) {
+      seen += _buckets[i];
+      if (seen > target) {
+        return std::min(static_cast<double>(GetUpperBound(i)), static_cast<double>(_max));
+      }
+    }
+    return static_cast<double>(_max);
+  }
+
+  const uint64_t& GetCount() const { return _count; }
+  const uint64_t& GetMax() const { return _max; }
+
+private:
+  static size_t GetBucket(const uint64_t &value) {
+    if (value < 16) { return static_cast<size_t>(value); }
+    size_t shift = 0;
+    while ((value >> shift) >= 32) { ++shift; }
+    return (shift + 1) * 16 + static_cast<size_t>((value >> shift) - 16);
+  }
+
+  static uint64_t GetUpperBound(const size_t &bucket) {
+    if (bucket < 16) { return bucket; }
+    const size_t shift = bucket / 16 - 1;
+    return (((bucket % 16) + 17) << shift) - 1;
+  }
+
+  uint64_t _count;
+  uint64_t _max;
+  std::vector<uint64_t> _buckets;
+};
+
+/*! @brief Replay every event of one kind per iteration
+*/
+static void BM_Replay(benchmark::State &state, const std::vector<std::string> &events) {
+  LatencyHistogram latencies;
+  size_t bytes = 0;
+  const bool is_peak_reset = ResetPeakMemory();
+  const double resident = GetStatusMemory("VmRSS");
+  for (auto _ : state) {
+    for (size_t i = 0; i < events.size(); ++i) {
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(ReplayEvent(events[i]));
+      latencies.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+      bytes += events[i].size();
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+
+  if (latencies.GetCount() != 0) {
+    state.counters["p50_ns"] = latencies.GetPercentile(50.0);
+    state.counters["p90_ns"] = latencies.GetPercentile(90.0);
+    state.counters["p99_ns"] = latencies.GetPercentile(99.0);
+    state.counters["max_ns"] = static_cast<double>(latencies.GetMax());
+  }
+  state.counters["events"] = static_cast<double>(events.size());
+  const double peak = GetStatusMemory("VmHWM");
+  state.counters["peak_rss_kb"] = peak;
+  if (is_peak_reset) {
+    state.counters["peak_growth_kb"] = peak - resident;
+  }
+}
+
+/*! @brief Load the corpus and register a benchmark per kind of event
+*/
+static bool RegisterReplay() {
+  const char *path = std::getenv("SENTRY_REPLAY_CORPUS");
+  const std::vector<std::string> events = ReadCorpus((path != NULL) ? path : SENTRY_REPLAY_CORPUS_DEFAULT);
+  if (events.empty()) { return false; }
+
+  std::map<std::string, std::vector<std::string> > kinds;
+  for (size_t i = 0; i < events.size(); ++i) {
+    kinds[GetEventKind(events[i])].push_back(events[i]);
+  }
+  for (std::map<std::string, std::vector<std::string> >::const_iterator kind = kinds.begin(); kind != kinds.end(); ++kind) {
+    benchmark::RegisterBenchmark(("BM_Replay/" + kind->first).c_str(), BM_Replay, kind->second)->Unit(benchmark::kMicrosecond);
+  }
+  benchmark::RegisterBenchmark("BM_Replay/all", BM_Replay, events)->Unit(benchmark::kMicrosecond);
+  return true;
+}
+
+static const bool is_replay_registered = RegisterReplay();
\ No newline at end of file
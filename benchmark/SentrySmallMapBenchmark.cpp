@@ -0,0 +1,133 @@
+/********************************************//**
+* @file SentrySmallMapBenchmark.cpp
+* @brief Benchmarks for SentrySmallMap.h
+* @details Building, parsing and serializing the string maps in User,
+* Message and Frame at the sizes they usually have.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryUser.h"
+#include "SentryMessage.h"
+#include "SentryFrame.h"
+#include <benchmark/benchmark.h>
+
+#include <map>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief Keys and values as an application would set them
+*/
+static std::vector<std::pair<std::string, std::string> > MakeFields(const size_t &count) {
+  std::vector<std::pair<std::string, std::string> > fields;
+  for (size_t i = 0; i < count; ++i) {
+    fields.push_back(std::make_pair("field_" + std::to_string((i * 7) % count), "value " + std::to_string(i)));
+  }
+  return fields;
+}
+
+/*! @brief Building a map one field at a time
+*/
+template <typename Map>
+static void BM_Map_Construct(benchmark::State &state) {
+  std::vector<std::pair<std::string, std::string> > fields = MakeFields(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    Map map;
+    for (auto field = fields.cbegin(); field != fields.cend(); ++field) {
+      map[field->first] = field->second;
+    }
+    benchmark::DoNotOptimize(map);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Map_Construct, std::map<std::string, std::string>)->Arg(2)->Arg(8)->Arg(16)->Arg(64);
+BENCHMARK_TEMPLATE(BM_Map_Construct, StringMap)->Arg(2)->Arg(8)->Arg(16)->Arg(64);
+
+/*! @brief A user with additional fields
+*/
+static void MakeUserJson(rapidjson::Document &json, const size_t &count) {
+  StringMap fields;
+  std::vector<std::pair<std::string, std::string> > values = MakeFields(count);
+  for (auto field = values.cbegin(); field != values.cend(); ++field) {
+    fields[field->first] = field->second;
+  }
+  User user("42", "user@example.com", "user", "127.0.0.1", fields);
+  user.AddToJson(json);
+}
+
+static void BM_User_FromJson(benchmark::State &state) {
+  rapidjson::Document json;
+  json.SetObject();
+  MakeUserJson(json, static_cast<size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    User user(json[JSON_ELEM_USER]);
+    benchmark::DoNotOptimize(user);
+  }
+}
+BENCHMARK(BM_User_FromJson)->Arg(2)->Arg(8)->Arg(16);
+
+static void BM_User_ToJson(benchmark::State &state) {
+  rapidjson::Document source;
+  source.SetObject();
+  MakeUserJson(source, static_cast<size_t>(state.range(0)));
+  User user(source[JSON_ELEM_USER]);
+
+  for (auto _ : state) {
+    rapidjson::Document json;
+    json.SetObject();
+    user.AddToJson(json);
+    benchmark::DoNotOptimize(json);
+  }
+}
+BENCHMARK(BM_User_ToJson)->Arg(2)->Arg(8)->Arg(16);
+
+/*! @brief A message with additional fields
+*/
+static void BM_Message_FromJson(benchmark::State &state) {
+  rapidjson::Document json;
+  json.SetObject();
+  rapidjson::Document::AllocatorType &allocator = json.GetAllocator();
+  json.AddMember(rapidjson::StringRef(JSON_ELEM_MESSAGE), rapidjson::StringRef("Request failed"), allocator);
+
+  std::vector<std::pair<std::string, std::string> > fields = MakeFields(static_cast<size_t>(state.range(0)));
+  for (auto field = fields.cbegin(); field != fields.cend(); ++field) {
+    rapidjson::Value key(field->first.data(), static_cast<rapidjson::SizeType>(field->first.size()), allocator);
+    rapidjson::Value value(field->second.data(), static_cast<rapidjson::SizeType>(field->second.size()), allocator);
+    json.AddMember(key, value, allocator);
+  }
+
+  for (auto _ : state) {
+    Message message(json);
+    benchmark::DoNotOptimize(message);
+  }
+}
+BENCHMARK(BM_Message_FromJson)->Arg(2)->Arg(8)->Arg(16);
+
+/*! @brief A frame with local variables, parsed and written back
+*/
+static void BM_Frame_Vars(benchmark::State &state) {
+  rapidjson::Document json;
+  json.SetObject();
+  rapidjson::Document::AllocatorType &allocator = json.GetAllocator();
+  json.AddMember(rapidjson::StringRef(JSON_ELEM_FUNCTION), rapidjson::StringRef("main"), allocator);
+
+  rapidjson::Value vars(rapidjson::kObjectType);
+  std::vector<std::pair<std::string, std::string> > fields = MakeFields(static_cast<size_t>(state.range(0)));
+  for (auto field = fields.cbegin(); field != fields.cend(); ++field) {
+    rapidjson::Value key(field->first.data(), static_cast<rapidjson::SizeType>(field->first.size()), allocator);
+    rapidjson::Value value(field->second.data(), static_cast<rapidjson::SizeType>(field->second.size()), allocator);
+    vars.AddMember(key, value, allocator);
+  }
+  json.AddMember(rapidjson::StringRef(JSON_ELEM_VARS), vars, allocator);
+
+  for (auto _ : state) {
+    Frame frame(json);
+    rapidjson::Document out;
+    frame.ToJson(out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_Frame_Vars)->Arg(0)->Arg(4)->Arg(16);
\ No newline at end of file
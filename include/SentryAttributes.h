@@ -11,8 +11,8 @@
 #include <string>
 #include <ctime>
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -25,6 +25,7 @@ namespace sentry {
   const char * const JSON_ELEM_PLATFORM = "platform";
   const char * const JSON_ELEM_ENVIRONMENT = "environment";
   const char * const JSON_ELEM_SERVER_NAME = "server_name";
+  const char * const JSON_ELEM_RELEASE = "release";
   const char * const JSON_ELEM_LEVEL = "level";
 
   namespace attributes {
@@ -145,6 +146,23 @@ namespace sentry {
 
     }; // class ServerName
 
+    /*! @brief A Release in Sentry
+    */
+    class Release {
+    public:
+      Release(const std::string &release);
+
+      bool IsValid() const;
+
+      const std::string& GetRelease() const;
+
+      void AddToJson(rapidjson::Document &doc) const;
+
+    private:
+      std::string _release;
+
+    }; // class Release
+
     /*! @brief A class describing the type of message
     */
     class Level {
@@ -354,6 +372,31 @@ namespace sentry {
       doc.AddMember(rapidjson::StringRef(JSON_ELEM_SERVER_NAME), server_name, doc.GetAllocator());
     }
 
+    /*!
+    */
+    inline Release::Release(const std::string &release) : _release(release) {}
+
+    inline const std::string & Release::GetRelease() const {
+      return _release;
+    }
+
+    inline bool Release::IsValid() const {
+      if (_release.empty()) {
+        return false;
+      }
+      return true;
+    }
+
+    inline void Release::AddToJson(rapidjson::Document & doc) const {
+      if (!IsValid()) {
+        return;
+      }
+
+      rapidjson::Value release(rapidjson::kStringType);
+      release.SetString(_release.data(), static_cast<rapidjson::SizeType>(_release.size()), doc.GetAllocator());
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_RELEASE), release, doc.GetAllocator());
+    }
+
     /*!
     */
     inline Level::Level(const LevelEnum & level) :
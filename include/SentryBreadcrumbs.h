@@ -0,0 +1,490 @@
+/********************************************//**
+* @file SentryBreadcrumbs.h
+* @brief Interface for Sentry Breadcrumbs
+* @details https://docs.sentry.io/clientdev/interfaces/breadcrumbs/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_BREADCRUMBS_H_
+#define SENTRY_BREADCRUMBS_H_
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "SentryAttributes.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const JSON_ELEM_BREADCRUMBS = "breadcrumbs";
+  const char * const JSON_ELEM_BREADCRUMBS_VALUES = "values";
+
+  const char * const JSON_ELEM_BREADCRUMB_TIMESTAMP = "timestamp";
+  const char * const JSON_ELEM_BREADCRUMB_CATEGORY = "category";
+  const char * const JSON_ELEM_BREADCRUMB_MESSAGE = "message";
+
+  const size_t BREADCRUMB_RING_CAPACITY = 256;  // Per thread, power of two
+  const size_t BREADCRUMB_MAX_ARGS = 4;
+  const size_t BREADCRUMB_ARG_LENGTH = 32;      // String arguments, including the terminator
+  const size_t BREADCRUMB_MAX_SENT = 100;
+  const size_t BREADCRUMB_RETIRED_RINGS = 16;   // Rings kept after their thread exits
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A breadcrumb message argument, formatted only when sent
+  *   @details Strings are copied into the argument, cut to fit
+  *   BREADCRUMB_ARG_LENGTH, so they may be freed as soon as Record returns.
+  */
+  struct BreadcrumbArg {
+    enum ArgType { kArgInt, kArgUint, kArgDouble, kArgString };
+
+    ArgType type;
+    union {
+      int64_t int_value;
+      uint64_t uint_value;
+      double double_value;
+      char string_value[BREADCRUMB_ARG_LENGTH];
+    };
+
+    static BreadcrumbArg Make(const int &value);
+    static BreadcrumbArg Make(const long &value);
+    static BreadcrumbArg Make(const long long &value);
+    static BreadcrumbArg Make(const unsigned &value);
+    static BreadcrumbArg Make(const unsigned long &value);
+    static BreadcrumbArg Make(const unsigned long long &value);
+    static BreadcrumbArg Make(const double &value);
+    static BreadcrumbArg Make(const char *value);
+    static BreadcrumbArg Make(const std::string &value);
+
+  protected:
+    static BreadcrumbArg MakeString(const char *value, const size_t &size);
+  };
+
+  /*! @brief A fixed-size breadcrumb copied out of a ring
+  */
+  struct Breadcrumb {
+    uint64_t timestamp_ms;
+    uint64_t sequence;        // Orders breadcrumbs of one thread with equal timestamps
+    const char *category;
+    const char *message;      // "{}" is replaced by the next argument
+    int level;
+    uint32_t arg_count;
+    BreadcrumbArg args[BREADCRUMB_MAX_ARGS];
+
+    std::string FormatMessage() const;
+    void ToJson(rapidjson::Document &doc) const;
+  };
+
+  /*! @brief A single-producer ring of the most recent breadcrumbs of one thread
+  *   @details Only the owning thread writes. Each record carries a sequence
+  *   number that is odd while it is being written, so readers on other
+  *   threads skip records that are torn or overwritten while they copy.
+  */
+  class BreadcrumbRing {
+  public:
+    BreadcrumbRing();
+
+    void Write(const Breadcrumb &breadcrumb);
+    void Read(std::vector<Breadcrumb> &breadcrumbs) const;
+
+    bool IsRetired() const;
+    void Retire();
+
+  private:
+    BreadcrumbRing(const BreadcrumbRing &other);
+    BreadcrumbRing& operator = (const BreadcrumbRing &other);
+
+    struct Slot {
+      std::atomic<uint64_t> sequence;
+      Breadcrumb breadcrumb;
+    };
+
+    std::atomic<uint64_t> _head;
+    std::atomic<bool> _is_retired;
+    Slot _slots[BREADCRUMB_RING_CAPACITY];
+
+  }; // class BreadcrumbRing
+
+  /*! @brief Records breadcrumbs into per-thread rings and merges them for events
+  *   @details Recording takes a coarse timestamp and copies a fixed-size record
+  *   into the calling thread's ring: no locks, no allocation, no formatting.
+  *   AddToJson merges every ring by timestamp and formats only the breadcrumbs
+  *   that are sent.
+  */
+  class Breadcrumbs {
+  public:
+    static Breadcrumbs& GetInstance();
+
+    static void Record(const char *category, const char *message,
+      const attributes::Level::LevelEnum &level = attributes::Level::LEVEL_INFO);
+
+    template <typename... Args>
+    static void Record(const char *category, const attributes::Level::LevelEnum &level, const char *message, const Args&... args);
+
+    std::vector<Breadcrumb> Collect(const size_t &max_breadcrumbs = BREADCRUMB_MAX_SENT) const;
+    void AddToJson(rapidjson::Document &doc, const size_t &max_breadcrumbs = BREADCRUMB_MAX_SENT) const;
+
+    size_t GetRingCount() const;
+
+    static uint64_t CoarseNow();
+
+  protected:
+    Breadcrumbs();
+
+    static BreadcrumbRing& ThreadRing();
+    std::shared_ptr<BreadcrumbRing> Register();
+
+  private:
+    Breadcrumbs(const Breadcrumbs &other);
+    Breadcrumbs& operator = (const Breadcrumbs &other);
+
+    mutable std::mutex _mutex;
+    std::vector<std::shared_ptr<BreadcrumbRing> > _rings;
+
+  }; // class Breadcrumbs
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const int &value) {
+    return Make(static_cast<long long>(value));
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const long &value) {
+    return Make(static_cast<long long>(value));
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const long long &value) {
+    BreadcrumbArg arg;
+    arg.type = kArgInt;
+    arg.int_value = value;
+    return arg;
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const unsigned &value) {
+    return Make(static_cast<unsigned long long>(value));
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const unsigned long &value) {
+    return Make(static_cast<unsigned long long>(value));
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const unsigned long long &value) {
+    BreadcrumbArg arg;
+    arg.type = kArgUint;
+    arg.uint_value = value;
+    return arg;
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const double &value) {
+    BreadcrumbArg arg;
+    arg.type = kArgDouble;
+    arg.double_value = value;
+    return arg;
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const char *value) {
+    return (value != NULL) ? MakeString(value, strlen(value)) : MakeString("", 0);
+  }
+
+  inline BreadcrumbArg BreadcrumbArg::Make(const std::string &value) {
+    return MakeString(value.data(), value.size());
+  }
+
+  /*! @brief Copy a string, cut at a UTF-8 character boundary if it does not fit
+  */
+  inline BreadcrumbArg BreadcrumbArg::MakeString(const char *value, const size_t &size) {
+    BreadcrumbArg arg;
+    arg.type = kArgString;
+
+    size_t length = std::min(size, BREADCRUMB_ARG_LENGTH - 1);
+    if (length < size) {
+      while (length > 0 && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80) {
+        --length;
+      }
+    }
+    memcpy(arg.string_value, value, length);
+    arg.string_value[length] = '\0';
+    return arg;
+  }
+
+  /*! @brief Replace each "{}" in the message with the next argument
+  */
+  inline std::string Breadcrumb::FormatMessage() const {
+    std::string formatted;
+    if (message == NULL) { return formatted; }
+
+    uint32_t next = 0;
+    for (const char *cursor = message; *cursor != '\0'; ++cursor) {
+      if (cursor[0] != '{' || cursor[1] != '}' || next >= arg_count) {
+        formatted += *cursor;
+        continue;
+      }
+
+      const BreadcrumbArg &arg = args[next++];
+      switch (arg.type) {
+      case BreadcrumbArg::kArgInt:
+        formatted += std::to_string(arg.int_value);
+        break;
+      case BreadcrumbArg::kArgUint:
+        formatted += std::to_string(arg.uint_value);
+        break;
+      case BreadcrumbArg::kArgDouble: {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%g", arg.double_value);
+        formatted += buffer;
+        break;
+      }
+      case BreadcrumbArg::kArgString:
+        formatted += arg.string_value;
+        break;
+      }
+      ++cursor;
+    }
+    return formatted;
+  }
+
+  /*! @brief Convert to a JSON object
+  */
+  inline void Breadcrumb::ToJson(rapidjson::Document &doc) const {
+    doc.SetObject();
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_BREADCRUMB_TIMESTAMP), static_cast<double>(timestamp_ms) / 1000.0, allocator);
+
+    if (category != NULL && category[0] != '\0') {
+      rapidjson::Value category_value(rapidjson::kStringType);
+      category_value.SetString(category, static_cast<rapidjson::SizeType>(strlen(category)), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_BREADCRUMB_CATEGORY), category_value, allocator);
+    }
+
+    std::string formatted = FormatMessage();
+    if (!formatted.empty()) {
+      rapidjson::Value message_value(rapidjson::kStringType);
+      message_value.SetString(formatted.data(), static_cast<rapidjson::SizeType>(formatted.size()), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_BREADCRUMB_MESSAGE), message_value, allocator);
+    }
+
+    attributes::Level(static_cast<attributes::Level::LevelEnum>(level)).AddToJson(doc);
+  }
+
+  /*!
+  */
+  inline BreadcrumbRing::BreadcrumbRing() :
+    _head(0), _is_retired(false) {
+    for (size_t i = 0; i < BREADCRUMB_RING_CAPACITY; ++i) {
+      _slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline bool BreadcrumbRing::IsRetired() const {
+    return _is_retired.load(std::memory_order_acquire);
+  }
+
+  inline void BreadcrumbRing::Retire() {
+    _is_retired.store(true, std::memory_order_release);
+  }
+
+  /*! @brief Append a breadcrumb, overwriting the oldest one; owning thread only
+  */
+  inline void BreadcrumbRing::Write(const Breadcrumb &breadcrumb) {
+    const uint64_t index = _head.load(std::memory_order_relaxed);
+    Slot &slot = _slots[index & (BREADCRUMB_RING_CAPACITY - 1)];
+
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.breadcrumb = breadcrumb;
+    slot.breadcrumb.sequence = index;
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+
+    _head.store(index + 1, std::memory_order_release);
+  }
+
+  /*! @brief Copy out every breadcrumb still in the ring
+  */
+  inline void BreadcrumbRing::Read(std::vector<Breadcrumb> &breadcrumbs) const {
+    const uint64_t head = _head.load(std::memory_order_acquire);
+    const uint64_t begin = (head > BREADCRUMB_RING_CAPACITY) ? head - BREADCRUMB_RING_CAPACITY : 0;
+
+    for (uint64_t index = begin; index < head; ++index) {
+      const Slot &slot = _slots[index & (BREADCRUMB_RING_CAPACITY - 1)];
+      const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+      if (before != index * 2 + 2) { continue; }
+
+      Breadcrumb copy = slot.breadcrumb;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != before) { continue; }
+
+      breadcrumbs.push_back(copy);
+    }
+  }
+
+  /*!
+  */
+  inline Breadcrumbs::Breadcrumbs() {
+  }
+
+  /*! @brief The breadcrumbs shared by the whole process
+  */
+  inline Breadcrumbs& Breadcrumbs::GetInstance() {
+    static Breadcrumbs breadcrumbs;
+    return breadcrumbs;
+  }
+
+  /*! @brief Milliseconds since the epoch from a cheap, coarse clock
+  */
+  inline uint64_t Breadcrumbs::CoarseNow() {
+#if defined(__linux__)
+    struct timespec now;
+    if (clock_gettime(CLOCK_REALTIME_COARSE, &now) == 0) {
+      return static_cast<uint64_t>(now.tv_sec) * 1000 + static_cast<uint64_t>(now.tv_nsec) / 1000000;
+    }
+#endif
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+
+  /*! @brief Add a ring for the calling thread, dropping the oldest rings of exited threads
+  */
+  inline std::shared_ptr<BreadcrumbRing> Breadcrumbs::Register() {
+    std::shared_ptr<BreadcrumbRing> ring = std::make_shared<BreadcrumbRing>();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t retired = 0;
+    for (auto it = _rings.rbegin(); it != _rings.rend(); ++it) {
+      if ((*it)->IsRetired()) {
+        ++retired;
+      }
+    }
+    for (auto it = _rings.begin(); it != _rings.end() && retired > BREADCRUMB_RETIRED_RINGS;) {
+      if ((*it)->IsRetired()) {
+        it = _rings.erase(it);
+        --retired;
+      } else {
+        ++it;
+      }
+    }
+    _rings.push_back(ring);
+    return ring;
+  }
+
+  /*! @brief The calling thread's ring, registered on first use and retired at thread exit
+  */
+  inline BreadcrumbRing& Breadcrumbs::ThreadRing() {
+    struct Holder {
+      Holder() : ring(GetInstance().Register()) {}
+      ~Holder() { ring->Retire(); }
+      std::shared_ptr<BreadcrumbRing> ring;
+    };
+    static thread_local Holder holder;
+    return *holder.ring;
+  }
+
+  inline size_t Breadcrumbs::GetRingCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rings.size();
+  }
+
+  /*! @brief Record a breadcrumb; the strings must outlive the process
+  */
+  inline void Breadcrumbs::Record(const char *category, const char *message, const attributes::Level::LevelEnum &level) {
+    Breadcrumb breadcrumb;
+    breadcrumb.timestamp_ms = CoarseNow();
+    breadcrumb.sequence = 0;
+    breadcrumb.category = category;
+    breadcrumb.message = message;
+    breadcrumb.level = level;
+    breadcrumb.arg_count = 0;
+    ThreadRing().Write(breadcrumb);
+  }
+
+  /*! @brief Record a breadcrumb whose message is formatted when it is sent
+  *   @details Up to BREADCRUMB_MAX_ARGS arguments replace the "{}" markers in order.
+  */
+  template <typename... Args>
+  inline void Breadcrumbs::Record(const char *category, const attributes::Level::LevelEnum &level, const char *message, const Args&... args) {
+    static_assert(sizeof...(Args) <= BREADCRUMB_MAX_ARGS, "too many breadcrumb arguments");
+
+    Breadcrumb breadcrumb;
+    breadcrumb.timestamp_ms = CoarseNow();
+    breadcrumb.sequence = 0;
+    breadcrumb.category = category;
+    breadcrumb.message = message;
+    breadcrumb.level = level;
+    breadcrumb.arg_count = static_cast<uint32_t>(sizeof...(Args));
+
+    const BreadcrumbArg converted[] = { BreadcrumbArg::Make(args)..., BreadcrumbArg::Make(0) };
+    for (uint32_t i = 0; i < breadcrumb.arg_count; ++i) {
+      breadcrumb.args[i] = converted[i];
+    }
+    ThreadRing().Write(breadcrumb);
+  }
+
+  /*! @brief Merge every ring, oldest first, keeping the most recent breadcrumbs
+  */
+  inline std::vector<Breadcrumb> Breadcrumbs::Collect(const size_t &max_breadcrumbs) const {
+    std::vector<std::shared_ptr<BreadcrumbRing> > rings;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      rings = _rings;
+    }
+
+    std::vector<Breadcrumb> breadcrumbs;
+    for (auto ring = rings.cbegin(); ring != rings.cend(); ++ring) {
+      (*ring)->Read(breadcrumbs);
+    }
+
+    std::stable_sort(breadcrumbs.begin(), breadcrumbs.end(), [](const Breadcrumb &left, const Breadcrumb &right) {
+      return left.timestamp_ms < right.timestamp_ms;
+    });
+    if (breadcrumbs.size() > max_breadcrumbs) {
+      breadcrumbs.erase(breadcrumbs.begin(), breadcrumbs.end() - max_breadcrumbs);
+    }
+    return breadcrumbs;
+  }
+
+  /*! @brief Add the merged breadcrumbs to an event
+  */
+  inline void Breadcrumbs::AddToJson(rapidjson::Document &doc, const size_t &max_breadcrumbs) const {
+    std::vector<Breadcrumb> breadcrumbs = Collect(max_breadcrumbs);
+    if (breadcrumbs.empty()) { return; }
+
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+    rapidjson::Value values(rapidjson::kArrayType);
+    for (auto breadcrumb = breadcrumbs.cbegin(); breadcrumb != breadcrumbs.cend(); ++breadcrumb) {
+      rapidjson::Document breadcrumb_doc(&allocator);
+      breadcrumb->ToJson(breadcrumb_doc);
+      values.PushBack(breadcrumb_doc, allocator);
+    }
+
+    rapidjson::Value object(rapidjson::kObjectType);
+    object.AddMember(rapidjson::StringRef(JSON_ELEM_BREADCRUMBS_VALUES), values, allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_BREADCRUMBS), object, allocator);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_BREADCRUMBS_H_
\ No newline at end of file
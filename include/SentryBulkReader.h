@@ -0,0 +1,519 @@
+/********************************************//**
+* @file SentryBulkReader.h
+* @brief Parallel parsing of stored events from NDJSON and envelope files
+* @details https://develop.sentry.dev/sdk/data-model/envelopes/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_BULK_READER_H_
+#define SENTRY_BULK_READER_H_
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+#include "SentryAttributes.h"
+#include "SentryStringView.h"
+#include "SentryException.h"
+#include "SentryThreads.h"
+#include "SentryMessage.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t BULK_READER_BATCH_RECORDS = 64;    // Records a worker takes or steals at a time
+  const size_t BULK_READER_CACHE_LINE = 64;       // Bytes each worker's range is padded and aligned to
+
+  const char * const EVENT_ITEM_TYPE = "event";
+
+  const char * const JSON_ELEM_ITEM_TYPE = "type";
+  const char * const JSON_ELEM_ITEM_LENGTH = "length";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief How the records of a file are laid out
+  */
+  enum BulkFormat {
+    BULK_FORMAT_AUTO,
+    BULK_FORMAT_NDJSON,       // One event per line
+    BULK_FORMAT_ENVELOPE      // One or more envelopes; event items are the records
+  };
+
+  /*! @brief The interfaces parsed from one record
+  */
+  struct BulkEvent {
+    size_t index;                       // Position of the record in the file
+    std::vector<Exception> exceptions;
+    Threads threads;
+    Message message;
+  };
+
+  /*! @brief What one Read() did
+  */
+  struct BulkReadStats {
+    uint64_t bytes;       // Size of the mapped file
+    uint64_t records;     // Records parsed into events
+    uint64_t invalid;     // Records that were not JSON objects
+    size_t workers;
+    double seconds;
+
+    double GetThroughput() const;
+  };
+
+  /*! @brief Maps a file of stored events and parses them on every core
+  *   @details The file is indexed once when it is opened. Read() splits the
+  *   records into batches and gives each worker an equal range of them; a
+  *   worker that runs out steals half of what is left in another's range, so
+  *   a few large crash events do not leave the other cores idle. The callback
+  *   runs on the workers, concurrently, in no particular order.
+  */
+  class BulkReader {
+  public:
+    typedef std::function<void(BulkEvent &event)> Callback;
+
+    BulkReader(const std::string &path, const BulkFormat &format = BULK_FORMAT_AUTO);
+    ~BulkReader();
+
+    bool IsValid() const;
+
+    const std::string& GetPath() const;
+    BulkFormat GetFormat() const;
+    size_t GetMappedSize() const;
+    size_t GetRecordCount() const;
+    StringView GetRecord(const size_t &index) const;
+
+    BulkReadStats Read(const Callback &callback, const size_t &workers = 0) const;
+
+    static const char* FindNewline(const char *begin, const char *end);
+    static bool ParseRecord(const StringView &record, BulkEvent &event);
+
+  protected:
+    /*! @brief A worker's remaining batches as [begin, end), packed to be swapped at once
+    *   @details Padded to a cache line so the owner and thieves of one range
+    *   do not slow down the others.
+    */
+    struct alignas(BULK_READER_CACHE_LINE) BatchRange {
+      std::atomic<uint64_t> range;
+      char padding[BULK_READER_CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+    };
+
+    void Map(const std::string &path);
+    void IndexLines();
+    void IndexEnvelopes();
+    void Run(BatchRange *ranges, const size_t &count, const size_t &self, const Callback &callback, std::atomic<uint64_t> *invalid) const;
+
+    static uint64_t PackRange(const uint64_t &begin, const uint64_t &end);
+    static bool TakeBatch(BatchRange &ranges, size_t &batch);
+    static bool StealBatch(BatchRange *ranges, const size_t &count, const size_t &self, size_t &batch);
+    static BulkFormat DetectFormat(const char *data, const size_t &size);
+    static StringView TrimLine(const char *begin, const char *end);
+
+  private:
+    BulkReader(const BulkReader &other);
+    BulkReader& operator = (const BulkReader &other);
+
+    std::string _path;
+    BulkFormat _format;
+    const char *_data;
+    size_t _size;
+    bool _is_valid;
+    std::vector<StringView> _records;
+
+  }; // class BulkReader
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*! @brief Gigabytes (10^9 bytes) of the file parsed per second
+  */
+  inline double BulkReadStats::GetThroughput() const {
+    if (seconds <= 0.0) { return 0.0; }
+    return static_cast<double>(bytes) / seconds / 1e9;
+  }
+
+  /*!
+  */
+  inline BulkReader::BulkReader(const std::string &path, const BulkFormat &format) :
+    _path(path), _format(format), _data(NULL), _size(0), _is_valid(false) {
+    Map(path);
+    if (!_is_valid) { return; }
+
+    if (_format == BULK_FORMAT_AUTO) {
+      _format = DetectFormat(_data, _size);
+    }
+    if (_format == BULK_FORMAT_ENVELOPE) {
+      IndexEnvelopes();
+    } else {
+      IndexLines();
+    }
+  }
+
+  inline BulkReader::~BulkReader() {
+#if defined(__linux__)
+    if (_data != NULL) {
+      munmap(const_cast<char *>(_data), _size);
+    }
+#elif defined(_WIN32)
+    if (_data != NULL) {
+      UnmapViewOfFile(_data);
+    }
+#endif
+  }
+
+  inline bool BulkReader::IsValid() const {
+    return _is_valid;
+  }
+
+  inline const std::string& BulkReader::GetPath() const {
+    return _path;
+  }
+
+  inline BulkFormat BulkReader::GetFormat() const {
+    return _format;
+  }
+
+  inline size_t BulkReader::GetMappedSize() const {
+    return _size;
+  }
+
+  inline size_t BulkReader::GetRecordCount() const {
+    return _records.size();
+  }
+
+  inline StringView BulkReader::GetRecord(const size_t &index) const {
+    if (index >= _records.size()) { return StringView(); }
+    return _records[index];
+  }
+
+  inline void BulkReader::Map(const std::string &path) {
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+      close(fd);
+      return;
+    }
+
+    if (info.st_size > 0) {
+      void *data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        close(fd);
+        return;
+      }
+      // Records are read front to back, once
+      madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+      _data = static_cast<const char *>(data);
+      _size = static_cast<size_t>(info.st_size);
+    }
+    close(fd);
+    _is_valid = true;
+#elif defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return; }
+
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size)) {
+      CloseHandle(file);
+      return;
+    }
+
+    if (size.QuadPart > 0) {
+      HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping == NULL) {
+        CloseHandle(file);
+        return;
+      }
+      const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      // The view keeps the mapping open until it is unmapped
+      CloseHandle(mapping);
+      if (data == NULL) {
+        CloseHandle(file);
+        return;
+      }
+      _data = static_cast<const char *>(data);
+      _size = static_cast<size_t>(size.QuadPart);
+    }
+    CloseHandle(file);
+    _is_valid = true;
+#else
+    (void)path;
+#endif
+  }
+
+  /*! @brief The first newline in [begin, end), or end
+  *   @details Compares 16 bytes at a time where SSE2 is available and falls
+  *   back to memchr elsewhere.
+  */
+  inline const char* BulkReader::FindNewline(const char *begin, const char *end) {
+    const char *cursor = begin;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - cursor >= 16; cursor += 16) {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cursor));
+      const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+      if (mask != 0) {
+        return cursor + __builtin_ctz(static_cast<unsigned int>(mask));
+      }
+    }
+#endif
+    const char *found = static_cast<const char *>(memchr(cursor, '\n', end - cursor));
+    return (found != NULL) ? found : end;
+  }
+
+  /*! @brief A line without its line ending or surrounding blanks
+  */
+  inline StringView BulkReader::TrimLine(const char *begin, const char *end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) { ++begin; }
+    while (end > begin && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) { --end; }
+    return StringView(begin, end - begin);
+  }
+
+  /*! @brief An envelope if an envelope header is followed by an item header, otherwise NDJSON
+  *   @details The envelope header carries the event_id or dsn but never a
+  *   type. The item header carries a type but never an event_id, and its
+  *   length is optional. A file of stored transactions has a type on its
+  *   first line, so it stays NDJSON.
+  */
+  inline BulkFormat BulkReader::DetectFormat(const char *data, const size_t &size) {
+    const char *end = data + size;
+    const char *first = FindNewline(data, end);
+    if (first == end) { return BULK_FORMAT_NDJSON; }
+
+    const StringView envelope_line = TrimLine(data, first);
+    rapidjson::Document envelope;
+    envelope.Parse(envelope_line.data(), envelope_line.size());
+    if (envelope.HasParseError() || !envelope.IsObject() || envelope.HasMember(JSON_ELEM_ITEM_TYPE)) {
+      return BULK_FORMAT_NDJSON;
+    }
+
+    const StringView item_line = TrimLine(first + 1, FindNewline(first + 1, end));
+    rapidjson::Document item;
+    item.Parse(item_line.data(), item_line.size());
+    if (item.HasParseError() || !item.IsObject() || item.HasMember(JSON_ELEM_EVENT_ID)) {
+      return BULK_FORMAT_NDJSON;
+    }
+    if (item.HasMember(JSON_ELEM_ITEM_TYPE) && item[JSON_ELEM_ITEM_TYPE].IsString()) {
+      return BULK_FORMAT_ENVELOPE;
+    }
+    return BULK_FORMAT_NDJSON;
+  }
+
+  /*! @brief Every line that is not blank is a record
+  */
+  inline void BulkReader::IndexLines() {
+    const char *cursor = _data;
+    const char *end = _data + _size;
+    while (cursor < end) {
+      const char *newline = FindNewline(cursor, end);
+      const StringView line = TrimLine(cursor, newline);
+      if (!line.empty()) {
+        _records.push_back(line);
+      }
+      cursor = (newline < end) ? newline + 1 : end;
+    }
+  }
+
+  /*! @brief The payload of every event item is a record
+  *   @details A line without a type is the header of the next envelope.
+  *   Payloads with a length are skipped over whole; the rest end at a newline.
+  */
+  inline void BulkReader::IndexEnvelopes() {
+    const char *cursor = _data;
+    const char *end = _data + _size;
+    while (cursor < end) {
+      const char *newline = FindNewline(cursor, end);
+      const StringView line = TrimLine(cursor, newline);
+      cursor = (newline < end) ? newline + 1 : end;
+      if (line.empty()) { continue; }
+
+      rapidjson::Document header;
+      header.Parse(line.data(), line.size());
+      if (header.HasParseError() || !header.IsObject()) { continue; }
+      if (!header.HasMember(JSON_ELEM_ITEM_TYPE) || !header[JSON_ELEM_ITEM_TYPE].IsString()) { continue; }
+
+      StringView payload;
+      if (header.HasMember(JSON_ELEM_ITEM_LENGTH) && header[JSON_ELEM_ITEM_LENGTH].IsUint64()) {
+        const uint64_t length = header[JSON_ELEM_ITEM_LENGTH].GetUint64();
+        if (length > static_cast<uint64_t>(end - cursor)) { break; }    // Truncated
+        payload = StringView(cursor, static_cast<size_t>(length));
+        cursor += length;
+        if (cursor < end && *cursor == '\r') { ++cursor; }
+        if (cursor < end && *cursor == '\n') { ++cursor; }
+      } else {
+        const char *payload_end = FindNewline(cursor, end);
+        payload = TrimLine(cursor, payload_end);
+        cursor = (payload_end < end) ? payload_end + 1 : end;
+      }
+
+      if (strcmp(header[JSON_ELEM_ITEM_TYPE].GetString(), EVENT_ITEM_TYPE) == 0 && !payload.empty()) {
+        _records.push_back(payload);
+      }
+    }
+  }
+
+  /*! @brief Parse every record and pass each event to the callback
+  *   @param workers threads to parse on, including the caller; 0 for one per core
+  */
+  inline BulkReadStats BulkReader::Read(const Callback &callback, const size_t &workers) const {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const size_t batches = (_records.size() + BULK_READER_BATCH_RECORDS - 1) / BULK_READER_BATCH_RECORDS;
+    size_t count = (workers > 0) ? workers : static_cast<size_t>(std::thread::hardware_concurrency());
+    count = (std::max<size_t>)(1, (std::min)(count, batches));
+
+    // new[] only promises the alignment of max_align_t, so take one line more and round up
+    std::unique_ptr<char[]> storage(new char[(count + 1) * sizeof(BatchRange)]);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+    BatchRange *ranges = reinterpret_cast<BatchRange *>((address + BULK_READER_CACHE_LINE - 1) & ~static_cast<uintptr_t>(BULK_READER_CACHE_LINE - 1));
+    for (size_t i = 0; i < count; ++i) {
+      new (&ranges[i]) BatchRange();
+      ranges[i].range.store(PackRange(batches * i / count, batches * (i + 1) / count), std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> invalid(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < count; ++i) {
+      threads.push_back(std::thread(&BulkReader::Run, this, ranges, count, i, std::cref(callback), &invalid));
+    }
+    Run(ranges, count, 0, callback, &invalid);
+    for (auto thread = threads.begin(); thread != threads.end(); ++thread) {
+      thread->join();
+    }
+
+    BulkReadStats stats;
+    stats.bytes = _size;
+    stats.invalid = invalid.load();
+    stats.records = _records.size() - stats.invalid;
+    stats.workers = count;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+  }
+
+  /*! @brief Worker loop: parse our own batches, then steal until none are left
+  */
+  inline void BulkReader::Run(BatchRange *ranges, const size_t &count, const size_t &self, const Callback &callback, std::atomic<uint64_t> *invalid) const {
+    size_t batch = 0;
+    while (TakeBatch(ranges[self], batch) || StealBatch(ranges, count, self, batch)) {
+      const size_t first = batch * BULK_READER_BATCH_RECORDS;
+      const size_t last = (std::min)(first + BULK_READER_BATCH_RECORDS, _records.size());
+      for (size_t index = first; index < last; ++index) {
+        BulkEvent event;
+        event.index = index;
+        if (!ParseRecord(_records[index], event)) {
+          invalid->fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        if (callback) {
+          callback(event);
+        }
+      }
+    }
+  }
+
+  inline uint64_t BulkReader::PackRange(const uint64_t &begin, const uint64_t &end) {
+    return (begin << 32) | (end & 0xFFFFFFFFULL);
+  }
+
+  /*! @brief Take the first batch of a worker's own range
+  */
+  inline bool BulkReader::TakeBatch(BatchRange &ranges, size_t &batch) {
+    uint64_t range = ranges.range.load(std::memory_order_acquire);
+    for (;;) {
+      const uint64_t begin = range >> 32;
+      const uint64_t end = range & 0xFFFFFFFFULL;
+      if (begin >= end) { return false; }
+      if (ranges.range.compare_exchange_weak(range, PackRange(begin + 1, end), std::memory_order_acq_rel)) {
+        batch = static_cast<size_t>(begin);
+        return true;
+      }
+    }
+  }
+
+  /*! @brief Take the back half of another worker's range
+  *   @details The first stolen batch is returned and the rest become our own
+  *   range, which was empty, so only we could have been writing to it.
+  */
+  inline bool BulkReader::StealBatch(BatchRange *ranges, const size_t &count, const size_t &self, size_t &batch) {
+    for (size_t offset = 1; offset < count; ++offset) {
+      BatchRange &victim = ranges[(self + offset) % count];
+      uint64_t range = victim.range.load(std::memory_order_acquire);
+      for (;;) {
+        const uint64_t begin = range >> 32;
+        const uint64_t end = range & 0xFFFFFFFFULL;
+        if (begin >= end) { break; }
+        const uint64_t stolen = (end - begin + 1) / 2;
+        if (victim.range.compare_exchange_weak(range, PackRange(begin, end - stolen), std::memory_order_acq_rel)) {
+          batch = static_cast<size_t>(end - stolen);
+          ranges[self].range.store(PackRange(end - stolen + 1, end), std::memory_order_release);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  /*! @brief Parse one stored event into its interfaces
+  *   @return false if the record is not a JSON object
+  */
+  inline bool BulkReader::ParseRecord(const StringView &record, BulkEvent &event) {
+    rapidjson::Document json;
+    json.Parse(record.data(), record.size());
+    if (json.HasParseError() || !json.IsObject()) { return false; }
+
+    if (json.HasMember(JSON_ELEM_EXCEPTION) && json[JSON_ELEM_EXCEPTION].IsObject() &&
+        json[JSON_ELEM_EXCEPTION].HasMember(JSON_ELEM_EXCEPTION_VALUES) && json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES].IsArray()) {
+      const rapidjson::Value &values = json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES];
+      event.exceptions.reserve(values.Size());
+      for (rapidjson::Value::ConstValueIterator value = values.Begin(); value != values.End(); ++value) {
+        event.exceptions.push_back(Exception(*value));
+      }
+    }
+    if (json.HasMember(JSON_ELEM_THREADS)) {
+      event.threads = Threads(json[JSON_ELEM_THREADS]);
+    }
+    if (json.HasMember(JSON_ELEM_MESSAGE)) {
+      event.message = Message(json[JSON_ELEM_MESSAGE]);
+    }
+    return true;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_BULK_READER_H_
\ No newline at end of file
@@ -10,9 +10,21 @@
 #define SENTRY_CLIENT_H_
 #include <ctime>
 #include <string>
-
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include <memory>
+#include <map>
+#include <chrono>
+#include <mutex>
+#include <functional>
+
+#include "SentryEvent.h"
+#include "SentryPipeline.h"
+#include "SentryClientStats.h"
+#include "SentrySourceContext.h"
+#include "SentryEnvelope.h"
+#include "SentryFlusher.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -68,12 +80,55 @@ namespace sentry {
     const std::string GenerateAuthentication() const;
     static const std::string GenerateTimestampString(const std::time_t &time);
 
+    ProcessorPipeline& GetPipeline();
+    void AddProcessor(const std::string &name, const EventProcessor::Function &processor);
+    void AddSourceContext(const std::shared_ptr<SourceContextCache> &cache = std::make_shared<SourceContextCache>());
+    bool Capture(Event &&event);
+
+    ClientCounters& GetCounters();
+    ClientStats GetStats() const;
+
   private:
     DSN _dsn;
     int _timeout;
+    std::shared_ptr<ProcessorPipeline> _pipeline;   // Shared by copies of the client
+    std::shared_ptr<ClientCounters> _counters;      // Shared by copies of the client
 
   }; // class Client
 
+  /*! @brief Sends what the client discarded as client_report envelope items
+  *   @details Each report covers the discards since the previous one, so
+  *   nothing is sent for an interval in which nothing was lost.
+  */
+  class ClientReporter {
+  public:
+    typedef std::function<void(const std::string &envelope)> Sink;
+
+    ClientReporter(const Client &client, const Sink &sink, const std::chrono::milliseconds &interval = std::chrono::milliseconds(60000));
+    ~ClientReporter();
+
+    bool Flush();
+
+    void Start();
+    void Stop();
+
+    static const char* GetReasonName(const DiscardReason &reason);
+    static const char* GetCategoryName(const DataCategory &category);
+    static std::string MakeEnvelope(const ClientStats &current, const ClientStats &previous);
+
+  private:
+    ClientReporter(const ClientReporter &other);
+    ClientReporter& operator = (const ClientReporter &other);
+
+    Client _client;
+    Sink _sink;
+    ClientStats _previous;
+
+    std::mutex _flush_mutex;
+    PeriodicFlusher _flusher;
+
+  }; // class ClientReporter
+
 } // namespace sentry
 
 /***********************************************
@@ -167,7 +222,9 @@ namespace sentry {
   /*!
   */
   inline Client::Client(const DSN &dsn, const int &timeout) :
-    _dsn(dsn), _timeout(timeout) {
+    _dsn(dsn), _timeout(timeout), _pipeline(std::make_shared<ProcessorPipeline>()),
+    _counters(std::make_shared<ClientCounters>()) {
+    _pipeline->SetCounters(_counters);
   }
 
   inline bool Client::IsEnabled() const {
@@ -178,6 +235,65 @@ namespace sentry {
     return _dsn;
   }
 
+  /*! @brief The before-send processors and the workers that run them
+  */
+  inline ProcessorPipeline& Client::GetPipeline() {
+    return *_pipeline;
+  }
+
+  /*! @brief Add a before-send processor; processors run in the order added
+  */
+  inline void Client::AddProcessor(const std::string &name, const EventProcessor::Function &processor) {
+    _pipeline->AddProcessor(name, processor);
+  }
+
+  /*! @brief Add the source context lines of exception and thread frames on the workers
+  *   @details The files are read by the processor workers, never on the
+  *   thread that captured the event.
+  */
+  inline void Client::AddSourceContext(const std::shared_ptr<SourceContextCache> &cache) {
+    _pipeline->AddProcessor("source_context", [cache](Event &event) {
+      cache->Apply(event);
+      return true;
+    });
+  }
+
+  /*! @brief Hand an event to the processor workers and return immediately
+  */
+  inline bool Client::Capture(Event &&event) {
+    if (!IsEnabled()) { return false; }
+    ScopedCaptureThread capture;
+    _counters->AddCaptured();
+    return _pipeline->Submit(std::move(event));
+  }
+
+  /*! @brief The counters shared with the tracer and the transport
+  */
+  inline ClientCounters& Client::GetCounters() {
+    return *_counters;
+  }
+
+  /*! @brief The client's counters together with the pipeline's
+  *   @details Events that passed the processors but that no sink accepted
+  *   are send errors.
+  */
+  inline ClientStats Client::GetStats() const {
+    ClientStats stats = _counters->GetSnapshot();
+    stats.queued = _pipeline->GetQueueDepth();
+    stats.sent = _pipeline->GetSentCount();
+
+    std::vector<ProcessorStats> processors = _pipeline->GetStats();
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      const DataCategory data_category = static_cast<DataCategory>(category);
+      stats.discarded[DISCARD_QUEUE_OVERFLOW][category] += _pipeline->GetQueueDropCount(data_category);
+      stats.discarded[DISCARD_SEND_ERROR][category] += _pipeline->GetUnsentCount(data_category);
+      for (size_t i = 0; i < processors.size(); ++i) {
+        stats.discarded[DISCARD_EVENT_PROCESSOR][category] += processors[i].category_dropped[category];
+      }
+    }
+    return stats;
+  }
+
   inline const std::string Client::GetClientInfo() {
     std::string client_info;
     client_info += CLIENT_NAME;
@@ -219,12 +335,115 @@ namespace sentry {
 
   inline const std::string Client::GenerateTimestampString(const std::time_t &time) {
     struct tm buf;
-    localtime_s(&buf, &time);
     char timestamp[500];
+#if defined(_WIN32)
+    localtime_s(&buf, &time);
     asctime_s(timestamp, &buf);
+#else
+    localtime_r(&time, &buf);
+    asctime_r(&buf, timestamp);
+#endif
     return timestamp;
   }
 
+  /*!
+  */
+  inline ClientReporter::ClientReporter(const Client &client, const Sink &sink, const std::chrono::milliseconds &interval) :
+    _client(client), _sink(sink), _previous(client.GetStats()),
+    _flusher([this]() { Flush(); }, interval) {
+  }
+
+  /*! @brief Stop the interval thread and report what is left
+  */
+  inline ClientReporter::~ClientReporter() {
+    Stop();
+    Flush();
+  }
+
+  /*! @brief Report the discards since the last report
+  *   @return false if there were none
+  */
+  inline bool ClientReporter::Flush() {
+    std::lock_guard<std::mutex> lock(_flush_mutex);
+    ClientStats current = _client.GetStats();
+    std::string envelope = MakeEnvelope(current, _previous);
+    _previous = current;
+
+    if (envelope.empty()) { return false; }
+    if (_sink) {
+      _sink(envelope);
+    }
+    return true;
+  }
+
+  inline void ClientReporter::Start() {
+    _flusher.Start();
+  }
+
+  inline void ClientReporter::Stop() {
+    _flusher.Stop();
+  }
+
+  /*! @brief The reason Sentry expects; deduplication is an event processor there
+  */
+  inline const char* ClientReporter::GetReasonName(const DiscardReason &reason) {
+    switch (reason) {
+    case DISCARD_QUEUE_OVERFLOW: return "queue_overflow";
+    case DISCARD_EVENT_PROCESSOR: return "event_processor";
+    case DISCARD_SAMPLE_RATE: return "sample_rate";
+    case DISCARD_DUPLICATE: return "event_processor";
+    case DISCARD_SEND_ERROR: return "send_error";
+    default: return "internal_sdk_error";
+    }
+  }
+
+  inline const char* ClientReporter::GetCategoryName(const DataCategory &category) {
+    switch (category) {
+    case CATEGORY_TRANSACTION: return "transaction";
+    default: return "error";
+    }
+  }
+
+  /*! @brief A client_report envelope for the discards between two snapshots
+  *   @return an empty string if nothing was discarded
+  */
+  inline std::string ClientReporter::MakeEnvelope(const ClientStats &current, const ClientStats &previous) {
+    std::map<std::pair<std::string, std::string>, uint64_t> quantities;
+    for (size_t reason = 0; reason < DISCARD_REASON_COUNT; ++reason) {
+      for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+        const uint64_t quantity = current.discarded[reason][category] - previous.discarded[reason][category];
+        if (quantity == 0) { continue; }
+        quantities[std::make_pair(std::string(GetReasonName(static_cast<DiscardReason>(reason))),
+          std::string(GetCategoryName(static_cast<DataCategory>(category))))] += quantity;
+      }
+    }
+    if (quantities.empty()) { return std::string(); }
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
+
+    const double timestamp = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count()) / 1000.0;
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_TIMESTAMP), timestamp, allocator);
+
+    rapidjson::Value discarded(rapidjson::kArrayType);
+    for (std::map<std::pair<std::string, std::string>, uint64_t>::const_iterator it = quantities.begin(); it != quantities.end(); ++it) {
+      rapidjson::Value entry(rapidjson::kObjectType);
+      rapidjson::Value reason(rapidjson::kStringType);
+      reason.SetString(it->first.first.data(), static_cast<rapidjson::SizeType>(it->first.first.size()), allocator);
+      entry.AddMember(rapidjson::StringRef(JSON_ELEM_DISCARD_REASON), reason, allocator);
+      rapidjson::Value category(rapidjson::kStringType);
+      category.SetString(it->first.second.data(), static_cast<rapidjson::SizeType>(it->first.second.size()), allocator);
+      entry.AddMember(rapidjson::StringRef(JSON_ELEM_DISCARD_CATEGORY), category, allocator);
+      entry.AddMember(rapidjson::StringRef(JSON_ELEM_DISCARD_QUANTITY), it->second, allocator);
+      discarded.PushBack(entry, allocator);
+    }
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_DISCARDED_EVENTS), discarded, allocator);
+
+    return EnvelopeWriter::MakeEnvelope(CLIENT_REPORT_ITEM_TYPE, doc);
+  }
+
 } // namespace sentry
 
 #endif // SENTRY_CLIENT_H_
\ No newline at end of file
@@ -0,0 +1,319 @@
+/********************************************//**
+* @file SentryClientStats.h
+* @brief Counters the SDK keeps about itself, and client reports built from them
+* @details https://develop.sentry.dev/sdk/telemetry/client-reports/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_CLIENT_STATS_H_
+#define SENTRY_CLIENT_STATS_H_
+#include <string>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdint.h>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t STATS_HISTOGRAM_BUCKETS = 65;    // One per bit length of a 64-bit value
+
+  const char * const CLIENT_REPORT_ITEM_TYPE = "client_report";
+
+  const char * const JSON_ELEM_DISCARDED_EVENTS = "discarded_events";
+  const char * const JSON_ELEM_DISCARD_REASON = "reason";
+  const char * const JSON_ELEM_DISCARD_CATEGORY = "category";
+  const char * const JSON_ELEM_DISCARD_QUANTITY = "quantity";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Why an event was not sent
+  */
+  enum DiscardReason {
+    DISCARD_QUEUE_OVERFLOW,
+    DISCARD_EVENT_PROCESSOR,
+    DISCARD_SAMPLE_RATE,
+    DISCARD_DUPLICATE,
+    DISCARD_SEND_ERROR,
+    DISCARD_REASON_COUNT
+  };
+
+  /*! @brief What kind of item was discarded
+  */
+  enum DataCategory {
+    CATEGORY_ERROR,
+    CATEGORY_TRANSACTION,
+    CATEGORY_COUNT
+  };
+
+  /*! @brief A copy of a histogram's buckets
+  *   @details Bucket i holds the values whose bit length is i, so bucket 0 is
+  *   zero and bucket i otherwise covers [2^(i-1), 2^i).
+  */
+  struct HistogramSnapshot {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS];
+
+    double GetMean() const;
+    uint64_t GetPercentile(const double &percentile) const;
+  };
+
+  /*! @brief A power-of-two histogram that any thread can record into
+  */
+  class StatsHistogram {
+  public:
+    StatsHistogram();
+
+    void Record(const uint64_t &value);
+    HistogramSnapshot GetSnapshot() const;
+
+    static size_t GetBucket(const uint64_t &value);
+
+  private:
+    StatsHistogram(const StatsHistogram &other);
+    StatsHistogram& operator = (const StatsHistogram &other);
+
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum;
+    std::atomic<uint64_t> _buckets[STATS_HISTOGRAM_BUCKETS];
+
+  }; // class StatsHistogram
+
+  /*! @brief Everything the client has counted, read at one moment
+  *   @details Counters only grow, so the difference of two snapshots is the
+  *   activity between them. queued is a current level.
+  */
+  struct ClientStats {
+    uint64_t captured;            // Events handed to Capture()
+    uint64_t queued;              // Events waiting for or inside the processors
+    uint64_t sent;                // Events the pipeline's sink accepted
+    uint64_t sampled_out;
+    uint64_t deduplicated;
+    uint64_t discarded[DISCARD_REASON_COUNT][CATEGORY_COUNT];
+    HistogramSnapshot serialized_bytes;   // Events and envelope items written inside the sink
+    HistogramSnapshot serialization_ns;
+    HistogramSnapshot send_latency_ns;    // Each call of the pipeline's sink
+
+    uint64_t GetDiscardedCount(const DiscardReason &reason) const;
+  };
+
+  /*! @brief The live counters behind a client and its copies
+  *   @details Every update is a relaxed atomic add, so recording from the
+  *   capture path costs no more than the queue it already takes. The client
+  *   counts captures; the tracer and deduplication record what only they can
+  *   see. The pipeline times each call of its sink, and while the sink runs,
+  *   Event::ToString and EnvelopeWriter::AddItem record what they write into
+  *   the counters of the client being sent for.
+  */
+  class ClientCounters {
+  public:
+    ClientCounters();
+
+    void AddCaptured();
+    void AddDiscarded(const DiscardReason &reason, const DataCategory &category, const uint64_t &quantity = 1);
+    void RecordSerialization(const uint64_t &bytes, const uint64_t &nanoseconds);
+    void RecordSend(const uint64_t &nanoseconds);
+
+    ClientStats GetSnapshot() const;
+
+    static ClientCounters* GetRecording();
+
+  private:
+    ClientCounters(const ClientCounters &other);
+    ClientCounters& operator = (const ClientCounters &other);
+
+    friend class ScopedStatsRecording;
+    static ClientCounters*& RecordingCounters();
+
+    std::atomic<uint64_t> _captured;
+    std::atomic<uint64_t> _discarded[DISCARD_REASON_COUNT][CATEGORY_COUNT];
+    StatsHistogram _serialized_bytes;
+    StatsHistogram _serialization_ns;
+    StatsHistogram _send_latency_ns;
+
+  }; // class ClientCounters
+
+  /*! @brief Sends the serialization done on the current thread to a client's counters while in scope
+  */
+  class ScopedStatsRecording {
+  public:
+    ScopedStatsRecording(ClientCounters *counters);
+    ~ScopedStatsRecording();
+
+  private:
+    ScopedStatsRecording(const ScopedStatsRecording &other);
+    ScopedStatsRecording& operator = (const ScopedStatsRecording &other);
+
+    ClientCounters *_previous;
+
+  }; // class ScopedStatsRecording
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  inline double HistogramSnapshot::GetMean() const {
+    if (count == 0) { return 0.0; }
+    return static_cast<double>(sum) / static_cast<double>(count);
+  }
+
+  /*! @brief An upper bound on the value below which a share of the values fall
+  *   @param percentile between 0 and 100
+  */
+  inline uint64_t HistogramSnapshot::GetPercentile(const double &percentile) const {
+    if (count == 0) { return 0; }
+    const double target = static_cast<double>(count) * percentile / 100.0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+      seen += buckets[i];
+      if (buckets[i] > 0 && static_cast<double>(seen) >= target) {
+        return (i == 0) ? 0 : (i == 64 ? UINT64_MAX : (1ULL << i) - 1);
+      }
+    }
+    return UINT64_MAX;
+  }
+
+  /*!
+  */
+  inline StatsHistogram::StatsHistogram() :
+    _count(0), _sum(0) {
+    for (size_t i = 0; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+      _buckets[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline void StatsHistogram::Record(const uint64_t &value) {
+    _buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /*! @brief Copy the buckets; concurrent records may land in the copy partly
+  */
+  inline HistogramSnapshot StatsHistogram::GetSnapshot() const {
+    HistogramSnapshot snapshot;
+    snapshot.count = _count.load(std::memory_order_relaxed);
+    snapshot.sum = _sum.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+      snapshot.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  /*! @brief The bit length of a value
+  */
+  inline size_t StatsHistogram::GetBucket(const uint64_t &value) {
+    size_t bucket = 0;
+    for (uint64_t rest = value; rest != 0; rest >>= 1) {
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  /*! @brief Discards for a reason across every category
+  */
+  inline uint64_t ClientStats::GetDiscardedCount(const DiscardReason &reason) const {
+    uint64_t total = 0;
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      total += discarded[reason][category];
+    }
+    return total;
+  }
+
+  /*!
+  */
+  inline ClientCounters::ClientCounters() :
+    _captured(0) {
+    for (size_t reason = 0; reason < DISCARD_REASON_COUNT; ++reason) {
+      for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+        _discarded[reason][category].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  inline void ClientCounters::AddCaptured() {
+    _captured.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline void ClientCounters::AddDiscarded(const DiscardReason &reason, const DataCategory &category, const uint64_t &quantity) {
+    if (reason >= DISCARD_REASON_COUNT || category >= CATEGORY_COUNT) { return; }
+    _discarded[reason][category].fetch_add(quantity, std::memory_order_relaxed);
+  }
+
+  /*! @brief The size of one serialized payload and the time taken to write it
+  */
+  inline void ClientCounters::RecordSerialization(const uint64_t &bytes, const uint64_t &nanoseconds) {
+    _serialized_bytes.Record(bytes);
+    _serialization_ns.Record(nanoseconds);
+  }
+
+  /*! @brief The time one call of the pipeline's sink took
+  */
+  inline void ClientCounters::RecordSend(const uint64_t &nanoseconds) {
+    _send_latency_ns.Record(nanoseconds);
+  }
+
+  inline ClientStats ClientCounters::GetSnapshot() const {
+    ClientStats stats;
+    stats.captured = _captured.load(std::memory_order_relaxed);
+    stats.queued = 0;
+    stats.sent = 0;
+    for (size_t reason = 0; reason < DISCARD_REASON_COUNT; ++reason) {
+      for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+        stats.discarded[reason][category] = _discarded[reason][category].load(std::memory_order_relaxed);
+      }
+    }
+    stats.sampled_out = stats.GetDiscardedCount(DISCARD_SAMPLE_RATE);
+    stats.deduplicated = stats.GetDiscardedCount(DISCARD_DUPLICATE);
+    stats.serialized_bytes = _serialized_bytes.GetSnapshot();
+    stats.serialization_ns = _serialization_ns.GetSnapshot();
+    stats.send_latency_ns = _send_latency_ns.GetSnapshot();
+    return stats;
+  }
+
+  inline ClientCounters*& ClientCounters::RecordingCounters() {
+    static thread_local ClientCounters *counters = NULL;
+    return counters;
+  }
+
+  /*! @brief The counters serialization on this thread is recorded into, or NULL
+  */
+  inline ClientCounters* ClientCounters::GetRecording() {
+    return RecordingCounters();
+  }
+
+  /*!
+  */
+  inline ScopedStatsRecording::ScopedStatsRecording(ClientCounters *counters) :
+    _previous(ClientCounters::RecordingCounters()) {
+    ClientCounters::RecordingCounters() = counters;
+  }
+
+  inline ScopedStatsRecording::~ScopedStatsRecording() {
+    ClientCounters::RecordingCounters() = _previous;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_CLIENT_STATS_H_
\ No newline at end of file
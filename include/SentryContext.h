@@ -10,8 +10,8 @@
 #define SENTRY_CONTEXT_H_
 #include <string>
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -46,13 +46,14 @@ namespace sentry {
     ContextGeneral();
     ContextGeneral(const std::string &type, const std::string &name);
     ContextGeneral(const rapidjson::Value &json);
+    virtual ~ContextGeneral();
 
     bool IsValid() const;
 
     const std::string& GetType() const;
     const std::string& GetName() const;
 
-    void ToJson(rapidjson::Document &doc) const;
+    virtual void ToJson(rapidjson::Document &doc) const;
 
   protected:
     void FromJson(const rapidjson::Value &json);
@@ -116,6 +117,8 @@ namespace sentry {
   */
   inline ContextGeneral::ContextGeneral() {}
 
+  inline ContextGeneral::~ContextGeneral() {}
+
   inline ContextGeneral::ContextGeneral(const std::string &type, const std::string &name) :
    _type(type), _name(name) {
   
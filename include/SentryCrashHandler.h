@@ -0,0 +1,586 @@
+/********************************************//**
+* @file SentryCrashHandler.h
+* @brief Fatal signal handler and crash reports for Sentry
+* @details https://docs.sentry.io/clientdev/interfaces/exception/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_CRASH_HANDLER_H_
+#define SENTRY_CRASH_HANDLER_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <ctime>
+#include <algorithm>
+#include <thread>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#endif
+
+#include "SentryException.h"
+#include "SentryThreads.h"
+#include "SentryThreadCapture.h"
+#include "SentryDebugMeta.h"
+#include "SentrySymbolizer.h"
+#include "SentrySessions.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const uint32_t CRASH_RECORD_MAGIC = 0x48435253; // "SRCH"
+  const uint32_t CRASH_RECORD_VERSION = 1;
+  const uint32_t CRASH_NO_MODULE = 0xffffffff;
+
+  const size_t CRASH_MAX_FRAMES = 128;
+  const size_t CRASH_MAX_MODULES = 64;
+  const size_t CRASH_PATH_LENGTH = 256;
+  const size_t CRASH_ALT_STACK_SIZE = 64 * 1024;
+  const int CRASH_PREPARE_WAIT_MS = 1000;    // How long a crash waits for Install()'s background preparation
+
+  const char * const CRASH_PENDING_SUFFIX = ".pending";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A module referenced by a crash record
+  */
+  struct CrashRecordModule {
+    uint64_t image_addr;
+    uint64_t image_size;
+    char code_file[CRASH_PATH_LENGTH];
+    char code_id[72];
+  };
+
+  /*! @brief A frame as an offset into a module, or an absolute address for CRASH_NO_MODULE
+  */
+  struct CrashRecordFrame {
+    uint32_t module;
+    uint32_t reserved;
+    uint64_t offset;
+  };
+
+  /*! @brief The fixed-size record written by the signal handler
+  *   @details Frames are ordered newest call first, the faulting instruction at index 0
+  */
+  struct CrashRecord {
+    uint32_t magic;
+    uint32_t version;
+    int32_t signal;
+    int32_t code;
+    uint64_t fault_addr;
+    int64_t thread_id;
+    int64_t timestamp;
+    char thread_name[16];
+    uint32_t frame_count;
+    uint32_t module_count;
+    CrashRecordFrame frames[CRASH_MAX_FRAMES];
+    CrashRecordModule modules[CRASH_MAX_MODULES];
+  };
+
+  /*! @brief Installs handlers for fatal signals that write a CrashRecord to disk
+  *   @details Install() only does file work on the calling thread: the output
+  *   file is opened and the record allocated. A background thread then builds
+  *   the ModuleRegistry and loads the unwinder, so startup never walks the
+  *   module list; a crash before it finishes waits up to CRASH_PREPARE_WAIT_MS
+  *   for it. The handler itself only fills the record and writes it with
+  *   write(2). Modules are looked up in the ModuleRegistry snapshot current at
+  *   the time of the crash and stored as offsets, which
+  *   CrashReport::LoadPending() symbolizes on the next run. Handlers run on an
+  *   alternate stack so stack overflows are caught; threads other than the
+  *   installing one call PrepareThread() to get theirs.
+  */
+  class CrashHandler {
+  public:
+    static CrashHandler& GetInstance();
+
+    bool Install(const std::string &path);
+    void Uninstall();
+    bool IsInstalled() const;
+
+    const std::string& GetPath() const;
+
+    static bool PrepareThread();
+
+  protected:
+    CrashHandler();
+    ~CrashHandler();
+
+    void Prepare();
+
+#if defined(__linux__)
+    static void HandleSignal(int signal, siginfo_t *info, void *context);
+    void WriteRecord(const int &signal, const siginfo_t *info, const void *context);
+    void AddFrame(const ModuleSnapshot *snapshot, const uint64_t &address);
+#endif
+
+  private:
+    CrashHandler(const CrashHandler &other);
+    CrashHandler& operator = (const CrashHandler &other);
+
+    std::string _path;
+    int _fd;
+    std::atomic<bool> _handling;
+    std::atomic<ModuleRegistry *> _registry;
+    std::atomic<bool> _is_prepared;    // The registry is built and the unwinder loaded
+    std::thread _preparer;
+    std::unique_ptr<CrashRecord> _record;
+    const DebugImage *_record_images[CRASH_MAX_MODULES];  // Images already copied into the record
+#if defined(__linux__)
+    std::vector<struct sigaction> _previous;
+#endif
+
+  }; // class CrashHandler
+
+  /*! @brief A crash from a previous run, rebuilt from its CrashRecord
+  *   @details Loading maps the recorded modules and symbolizes every frame,
+  *   so it belongs on a worker thread rather than in startup code.
+  */
+  class CrashReport {
+  public:
+    CrashReport();
+
+    bool IsValid() const;
+
+    const int& GetSignal() const;
+    const std::time_t& GetTimestamp() const;
+    const Exception& GetException() const;
+    const Threads& GetThreads() const;
+    const std::vector<DebugImage>& GetImages() const;
+
+    void AddToJson(rapidjson::Document &doc) const;
+    void AddToSessions(SessionTracker &tracker, const std::string &did = std::string()) const;
+
+    static bool LoadPending(const std::string &path, CrashReport &report);
+    static std::string GetSignalName(const int &signal);
+
+  protected:
+    void FromRecord(const CrashRecord &record);
+
+  private:
+    int _signal;
+    std::time_t _timestamp;
+    Exception _exception;
+    Threads _threads;
+    std::vector<DebugImage> _images;
+
+  }; // class CrashReport
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+#if defined(__linux__)
+  const int CRASH_SIGNALS[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+  const size_t CRASH_SIGNAL_COUNT = sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]);
+#endif
+
+  /*!
+  */
+  inline CrashHandler::CrashHandler() :
+    _fd(-1), _handling(false), _registry(NULL), _is_prepared(false) {
+  }
+
+  /*!
+  */
+  inline CrashHandler::~CrashHandler() {
+    if (_preparer.joinable()) {
+      _preparer.join();
+    }
+  }
+
+  /*! @brief The handler shared by the whole process
+  */
+  inline CrashHandler& CrashHandler::GetInstance() {
+    static CrashHandler handler;
+    return handler;
+  }
+
+  inline bool CrashHandler::IsInstalled() const {
+    return (_fd >= 0);
+  }
+
+  inline const std::string & CrashHandler::GetPath() const {
+    return _path;
+  }
+
+  /*! @brief Give the calling thread an alternate signal stack if it has none
+  */
+  inline bool CrashHandler::PrepareThread() {
+#if defined(__linux__)
+    stack_t current;
+    if (sigaltstack(NULL, &current) == 0 && !(current.ss_flags & SS_DISABLE) && current.ss_size >= CRASH_ALT_STACK_SIZE) {
+      return true;
+    }
+
+    static thread_local std::unique_ptr<char[]> stack;
+    if (!stack) {
+      stack.reset(new char[CRASH_ALT_STACK_SIZE]);
+    }
+
+    stack_t alternate;
+    alternate.ss_sp = stack.get();
+    alternate.ss_size = CRASH_ALT_STACK_SIZE;
+    alternate.ss_flags = 0;
+    return (sigaltstack(&alternate, NULL) == 0);
+#else
+    return false;
+#endif
+  }
+
+  /*! @brief Open the record file and install the signal handlers
+  *   @details A record left by the previous run is first moved aside to
+  *   path + CRASH_PENDING_SUFFIX, which is the only file work done here.
+  *   Read it later with CrashReport::LoadPending(). The module registry and
+  *   the unwinder are prepared by a background thread.
+  */
+  inline bool CrashHandler::Install(const std::string &path) {
+#if defined(__linux__)
+    if (IsInstalled()) { return false; }
+
+    std::string pending = path + CRASH_PENDING_SUFFIX;
+    rename(path.c_str(), pending.c_str());
+
+    _fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (_fd < 0) { return false; }
+    _path = path;
+
+    if (!_record) {
+      _record.reset(new CrashRecord());
+    }
+    if (!_is_prepared.load() && !_preparer.joinable()) {
+      _preparer = std::thread(&CrashHandler::Prepare, this);
+    }
+
+    PrepareThread();
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &CrashHandler::HandleSignal;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    _previous.resize(CRASH_SIGNAL_COUNT);
+    for (size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i) {
+      sigaction(CRASH_SIGNALS[i], &action, &_previous[i]);
+    }
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+  }
+
+  /*! @brief Build the module registry and load the unwinder, off the installing thread
+  */
+  inline void CrashHandler::Prepare() {
+    _registry.store(&ModuleRegistry::GetInstance());
+
+    // backtrace() loads the unwinder on first use, which must not happen in the handler
+    uint64_t warm_up[4];
+    ThreadCapture::CaptureStack(NULL, warm_up, 4);
+    _is_prepared.store(true);
+  }
+
+  /*! @brief Restore the previous signal handlers and close the record file
+  */
+  inline void CrashHandler::Uninstall() {
+#if defined(__linux__)
+    if (!IsInstalled()) { return; }
+
+    for (size_t i = 0; i < _previous.size(); ++i) {
+      sigaction(CRASH_SIGNALS[i], &_previous[i], NULL);
+    }
+    close(_fd);
+    _fd = -1;
+#endif
+  }
+
+#if defined(__linux__)
+  /*! @brief Record the crash, then let the previous handler take the signal
+  *   @details Async-signal-safe: no allocation, no locks, no stdio.
+  */
+  inline void CrashHandler::HandleSignal(int signal, siginfo_t *info, void *context) {
+    CrashHandler &handler = GetInstance();
+
+    bool expected = false;
+    if (handler._handling.compare_exchange_strong(expected, true)) {
+      handler.WriteRecord(signal, info, context);
+    }
+
+    for (size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i) {
+      if (CRASH_SIGNALS[i] == signal && i < handler._previous.size()) {
+        sigaction(signal, &handler._previous[i], NULL);
+      }
+    }
+    raise(signal);
+  }
+
+  /*! @brief Add a frame as a module offset, copying the module into the record on first use
+  */
+  inline void CrashHandler::AddFrame(const ModuleSnapshot *snapshot, const uint64_t &address) {
+    CrashRecord &record = *_record;
+    if (record.frame_count >= CRASH_MAX_FRAMES) { return; }
+
+    CrashRecordFrame &frame = record.frames[record.frame_count++];
+    frame.module = CRASH_NO_MODULE;
+    frame.reserved = 0;
+    frame.offset = address;
+
+    const DebugImage *image = (snapshot != NULL) ? snapshot->FindImage(address) : NULL;
+    if (image == NULL) { return; }
+
+    uint32_t index = 0;
+    while (index < record.module_count && _record_images[index] != image) {
+      ++index;
+    }
+    if (index == record.module_count) {
+      if (record.module_count >= CRASH_MAX_MODULES) { return; }
+
+      CrashRecordModule &module = record.modules[record.module_count];
+      module.image_addr = image->GetImageAddr();
+      module.image_size = image->GetImageSize();
+      const std::string &code_file = image->GetCodeFile();
+      size_t length = std::min(code_file.size(), sizeof(module.code_file) - 1);
+      memcpy(module.code_file, code_file.data(), length);
+      module.code_file[length] = '\0';
+      const std::string &code_id = image->GetCodeID();
+      length = std::min(code_id.size(), sizeof(module.code_id) - 1);
+      memcpy(module.code_id, code_id.data(), length);
+      module.code_id[length] = '\0';
+
+      _record_images[record.module_count++] = image;
+    }
+
+    frame.module = index;
+    frame.offset = address - image->GetImageAddr();
+  }
+
+  /*! @brief Fill the preallocated record and write it to the open file
+  */
+  inline void CrashHandler::WriteRecord(const int &signal, const siginfo_t *info, const void *context) {
+    if (!_record || _fd < 0) { return; }
+
+    CrashRecord &record = *_record;
+    memset(&record, 0, sizeof(record));
+    record.magic = CRASH_RECORD_MAGIC;
+    record.version = CRASH_RECORD_VERSION;
+    record.signal = signal;
+    record.code = (info != NULL) ? info->si_code : 0;
+    record.fault_addr = (info != NULL) ? reinterpret_cast<uintptr_t>(info->si_addr) : 0;
+    record.thread_id = ThreadCapture::GetCurrentThreadID();
+    prctl(PR_GET_NAME, record.thread_name, 0, 0, 0);
+    record.thread_name[sizeof(record.thread_name) - 1] = '\0';
+
+    struct timespec now;
+    if (clock_gettime(CLOCK_REALTIME, &now) == 0) {
+      record.timestamp = now.tv_sec;
+    }
+
+    // A crash right after Install() gives the preparing thread a moment to finish
+    for (int waited = 0; !_is_prepared.load() && waited < CRASH_PREPARE_WAIT_MS; ++waited) {
+      struct timespec pause = { 0, 1000000 };
+      nanosleep(&pause, NULL);
+    }
+
+    // Pinned for good: the process does not outlive the handler
+    ModuleRegistry *registry = _registry.load();
+    if (registry != NULL) {
+      registry->Pin();
+    }
+    const ModuleSnapshot *snapshot = (registry != NULL) ? registry->GetSnapshot() : NULL;
+
+    // Without a loaded unwinder, e.g. a crash on the preparing thread, only the signal is recorded
+    uint64_t addresses[CRASH_MAX_FRAMES];
+    size_t count = _is_prepared.load() ? ThreadCapture::CaptureStack(context, addresses, CRASH_MAX_FRAMES) : 0;
+    for (size_t i = 0; i < count; ++i) {
+      AddFrame(snapshot, addresses[i]);
+    }
+
+    const char *cursor = reinterpret_cast<const char *>(&record);
+    size_t remaining = sizeof(record);
+    while (remaining > 0) {
+      ssize_t written = write(_fd, cursor, remaining);
+      if (written < 0 && errno == EINTR) { continue; }
+      if (written <= 0) { break; }
+      cursor += written;
+      remaining -= static_cast<size_t>(written);
+    }
+  }
+#endif
+
+  /*!
+  */
+  inline CrashReport::CrashReport() :
+    _signal(0), _timestamp(0) {
+  }
+
+  inline bool CrashReport::IsValid() const {
+    return (_signal != 0 && _exception.IsValid());
+  }
+
+  inline const int & CrashReport::GetSignal() const {
+    return _signal;
+  }
+
+  inline const std::time_t & CrashReport::GetTimestamp() const {
+    return _timestamp;
+  }
+
+  inline const Exception & CrashReport::GetException() const {
+    return _exception;
+  }
+
+  inline const Threads & CrashReport::GetThreads() const {
+    return _threads;
+  }
+
+  inline const std::vector<DebugImage>& CrashReport::GetImages() const {
+    return _images;
+  }
+
+  inline std::string CrashReport::GetSignalName(const int &signal) {
+#if defined(__linux__)
+    switch (signal) {
+    case SIGSEGV: return "SIGSEGV";
+    case SIGABRT: return "SIGABRT";
+    case SIGBUS: return "SIGBUS";
+    case SIGFPE: return "SIGFPE";
+    case SIGILL: return "SIGILL";
+    default: break;
+    }
+#endif
+    return "signal " + std::to_string(signal);
+  }
+
+  /*! @brief Read, symbolize and remove the record left by the previous run
+  *   @return true if the previous run crashed
+  */
+  inline bool CrashReport::LoadPending(const std::string &path, CrashReport &report) {
+#if defined(__linux__)
+    std::string pending = path + CRASH_PENDING_SUFFIX;
+    int fd = open(pending.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return false; }
+
+    std::unique_ptr<CrashRecord> record(new CrashRecord());
+    char *cursor = reinterpret_cast<char *>(record.get());
+    size_t remaining = sizeof(CrashRecord);
+    while (remaining > 0) {
+      ssize_t count = read(fd, cursor, remaining);
+      if (count < 0 && errno == EINTR) { continue; }
+      if (count <= 0) { break; }
+      cursor += count;
+      remaining -= static_cast<size_t>(count);
+    }
+    close(fd);
+    unlink(pending.c_str());
+
+    if (remaining != 0 || record->magic != CRASH_RECORD_MAGIC || record->version != CRASH_RECORD_VERSION) {
+      return false;
+    }
+
+    report.FromRecord(*record);
+    return report.IsValid();
+#else
+    (void)path;
+    (void)report;
+    return false;
+#endif
+  }
+
+  /*! @brief Build the exception and crashed thread from a record
+  */
+  inline void CrashReport::FromRecord(const CrashRecord &record) {
+    _signal = record.signal;
+    _timestamp = static_cast<std::time_t>(record.timestamp);
+
+    const uint32_t module_count = std::min<uint32_t>(record.module_count, CRASH_MAX_MODULES);
+    _images.clear();
+    for (uint32_t i = 0; i < module_count; ++i) {
+      const CrashRecordModule &module = record.modules[i];
+      std::string code_file(module.code_file, strnlen(module.code_file, sizeof(module.code_file)));
+      std::string code_id(module.code_id, strnlen(module.code_id, sizeof(module.code_id)));
+      _images.push_back(DebugImage(code_file, module.image_addr, module.image_size, code_id));
+    }
+
+    // Record frames are newest first, Sentry wants oldest first
+    Symbolizer symbolizer;
+    const uint32_t frame_count = std::min<uint32_t>(record.frame_count, CRASH_MAX_FRAMES);
+    std::vector<Frame> frames;
+    frames.reserve(frame_count);
+    for (uint32_t i = frame_count; i-- > 0;) {
+      const CrashRecordFrame &entry = record.frames[i];
+      if (entry.module < module_count) {
+        const DebugImage &image = _images[entry.module];
+        frames.push_back(symbolizer.Symbolize(&image, image.GetImageAddr() + entry.offset, i > 0));
+      } else {
+        frames.push_back(symbolizer.Symbolize(NULL, entry.offset, i > 0));
+      }
+    }
+
+    const int thread_id = static_cast<int>(record.thread_id);
+    std::string value = "Fatal signal " + std::to_string(record.signal);
+    value += " at address " + DebugImage::FormatAddress(record.fault_addr);
+    _exception = Exception(GetSignalName(record.signal), value, std::string(), Stacktrace(frames), thread_id);
+
+    std::vector<Thread> threads;
+    threads.push_back(Thread(thread_id, true, true, Stacktrace(),
+      std::string(record.thread_name, strnlen(record.thread_name, sizeof(record.thread_name)))));
+    _threads = Threads(threads);
+  }
+
+  /*! @brief Count the session the crash ended as crashed
+  */
+  inline void CrashReport::AddToSessions(SessionTracker &tracker, const std::string &did) const {
+    if (!IsValid()) { return; }
+    tracker.RecordCrash(_timestamp, did);
+  }
+
+  /*! @brief Add the exception, threads and debug_meta blocks to an event
+  */
+  inline void CrashReport::AddToJson(rapidjson::Document &doc) const {
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    rapidjson::Document exception_doc(&allocator);
+    _exception.ToJson(exception_doc);
+    rapidjson::Value values(rapidjson::kArrayType);
+    values.PushBack(exception_doc, allocator);
+    rapidjson::Value exception(rapidjson::kObjectType);
+    exception.AddMember(rapidjson::StringRef(JSON_ELEM_EXCEPTION_VALUES), values, allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_EXCEPTION), exception, allocator);
+
+    _threads.AddToJson(doc);
+
+    if (!_images.empty()) {
+      ModuleSnapshot snapshot(_images, 0, 0);
+      snapshot.AddToJson(doc);
+    }
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_CRASH_HANDLER_H_
\ No newline at end of file
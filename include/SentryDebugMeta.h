@@ -0,0 +1,650 @@
+/********************************************//**
+* @file SentryDebugMeta.h
+* @brief Interface for Sentry Debug Meta and the loaded module registry
+* @details https://docs.sentry.io/clientdev/interfaces/debug/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_DEBUG_META_H_
+#define SENTRY_DEBUG_META_H_
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <link.h>
+#include <elf.h>
+#include <unistd.h>
+#endif
+
+#include "SentryFrame.h"
+#include "SentryFlusher.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const JSON_ELEM_DEBUG_META = "debug_meta";
+  const char * const JSON_ELEM_DEBUG_IMAGES = "images";
+
+  const char * const JSON_ELEM_IMAGE_TYPE = "type";
+  const char * const JSON_ELEM_IMAGE_CODE_FILE = "code_file";
+  const char * const JSON_ELEM_IMAGE_CODE_ID = "code_id";
+  const char * const JSON_ELEM_IMAGE_DEBUG_ID = "debug_id";
+  const char * const JSON_ELEM_IMAGE_SIZE = "image_size";
+
+  const char * const IMAGE_TYPE_ELF = "elf";
+
+  const int64_t MODULE_REGISTRY_WATCH_MS = 1000;    // How often the shared registry checks the loader for changes
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A loaded module (debug image) in Sentry
+  */
+  class DebugImage {
+  public:
+    DebugImage();
+    DebugImage(const std::string &code_file, const uint64_t &image_addr, const uint64_t &image_size,
+      const std::string &code_id = std::string(), const std::string &debug_id = std::string());
+    DebugImage(const rapidjson::Value &json);
+
+    bool IsValid() const;
+    bool Contains(const uint64_t &address) const;
+
+    const std::string& GetType() const;
+    const std::string& GetCodeFile() const;
+    const std::string& GetCodeID() const;
+    const std::string& GetDebugID() const;
+    const uint64_t& GetImageAddr() const;
+    const uint64_t& GetImageSize() const;
+
+    void ToJson(rapidjson::Document &doc) const;
+
+    static std::string FormatAddress(const uint64_t &address);
+    static std::string DebugIDFromBuildID(const std::string &code_id);
+
+  protected:
+    void FromJson(const rapidjson::Value &json);
+
+  private:
+    std::string _type;
+    std::string _code_file;
+    std::string _code_id;     // Hex encoded GNU build id
+    std::string _debug_id;    // Build id folded into a little-endian GUID
+    uint64_t _image_addr;
+    uint64_t _image_size;
+
+  }; // class DebugImage
+
+  /*! @brief An immutable list of the modules loaded at one point in time
+  *   @details The debug_meta block is serialized once, when the snapshot is
+  *   built, and copied into each event.
+  */
+  class ModuleSnapshot {
+  public:
+    ModuleSnapshot(const std::vector<DebugImage> &images, const unsigned long long &adds, const unsigned long long &subs);
+
+    const std::vector<DebugImage>& GetImages() const;
+    const DebugImage* FindImage(const uint64_t &address) const;
+    bool AnnotateFrame(const uint64_t &instruction_addr, Frame &frame) const;
+
+    const unsigned long long& GetAdds() const;
+    const unsigned long long& GetSubs() const;
+
+    void AddToJson(rapidjson::Document &doc) const;
+
+  private:
+    ModuleSnapshot(const ModuleSnapshot &other);
+    ModuleSnapshot& operator = (const ModuleSnapshot &other);
+
+    std::vector<DebugImage> _images;  // Sorted by image address
+    unsigned long long _adds;
+    unsigned long long _subs;
+    rapidjson::Document _debug_meta;
+
+  }; // class ModuleSnapshot
+
+  /*! @brief Process-wide registry of loaded modules
+  *   @details Refresh() walks the module list only when the loader reports
+  *   that objects were added or removed since the last walk, and reuses the
+  *   build ids of modules it already knows. Readers pin the registry, then
+  *   get the current snapshot through a single atomic load. Replaced
+  *   snapshots are retired and freed by the first Refresh() that finds no
+  *   reader pinned, since any later reader sees the new snapshot.
+  */
+  class ModuleRegistry {
+  public:
+    explicit ModuleRegistry(const bool &is_watching = false);
+
+    static ModuleRegistry& GetInstance();
+
+    bool Refresh();
+    const ModuleSnapshot* GetSnapshot() const;
+    size_t GetRetiredCount();
+
+    void Pin();
+    void Unpin();
+
+    void AddToJson(rapidjson::Document &doc);
+
+    static std::string ReadBuildID(const void *info);
+
+  protected:
+    void Reclaim();
+
+  private:
+    ModuleRegistry(const ModuleRegistry &other);
+    ModuleRegistry& operator = (const ModuleRegistry &other);
+
+    std::mutex _refresh_mutex;
+    std::atomic<const ModuleSnapshot *> _current;
+    std::atomic<size_t> _readers;
+    std::vector<std::unique_ptr<const ModuleSnapshot> > _snapshots;    // The current one last
+    PeriodicFlusher _watcher;    // Destroyed first, so it never refreshes a registry being torn down
+
+  }; // class ModuleRegistry
+
+  /*! @brief Pins the registry and holds its current snapshot for a scope
+  *   @details Only pins and loads the snapshot pointer, so it never waits on
+  *   the loader. Pass is_refreshed to bring the snapshot up to date first,
+  *   from a thread that can afford to.
+  */
+  class ScopedModuleSnapshot {
+  public:
+    ScopedModuleSnapshot(ModuleRegistry &registry = ModuleRegistry::GetInstance(), const bool &is_refreshed = false);
+    ~ScopedModuleSnapshot();
+
+    const ModuleSnapshot* Get() const;
+
+  private:
+    ScopedModuleSnapshot(const ScopedModuleSnapshot &other);
+    ScopedModuleSnapshot& operator = (const ScopedModuleSnapshot &other);
+
+    ModuleRegistry &_registry;
+    const ModuleSnapshot *_snapshot;
+
+  }; // class ScopedModuleSnapshot
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline DebugImage::DebugImage() :
+    _type(IMAGE_TYPE_ELF), _image_addr(0), _image_size(0) {
+  }
+
+  inline DebugImage::DebugImage(const std::string &code_file, const uint64_t &image_addr, const uint64_t &image_size,
+    const std::string &code_id, const std::string &debug_id) :
+    _type(IMAGE_TYPE_ELF), _code_file(code_file), _code_id(code_id),
+    _debug_id(debug_id.empty() ? DebugIDFromBuildID(code_id) : debug_id),
+    _image_addr(image_addr), _image_size(image_size) {
+  }
+
+  inline DebugImage::DebugImage(const rapidjson::Value &json) :
+    _image_addr(0), _image_size(0) {
+    FromJson(json);
+  }
+
+  inline bool DebugImage::IsValid() const {
+    return (!_code_file.empty() && _image_size > 0);
+  }
+
+  inline bool DebugImage::Contains(const uint64_t &address) const {
+    return (address >= _image_addr && address - _image_addr < _image_size);
+  }
+
+  inline const std::string & DebugImage::GetType() const {
+    return _type;
+  }
+
+  inline const std::string & DebugImage::GetCodeFile() const {
+    return _code_file;
+  }
+
+  inline const std::string & DebugImage::GetCodeID() const {
+    return _code_id;
+  }
+
+  inline const std::string & DebugImage::GetDebugID() const {
+    return _debug_id;
+  }
+
+  inline const uint64_t & DebugImage::GetImageAddr() const {
+    return _image_addr;
+  }
+
+  inline const uint64_t & DebugImage::GetImageSize() const {
+    return _image_size;
+  }
+
+  /*! @brief Format an address the way Sentry expects it, e.g. 0x7f0000001000
+  */
+  inline std::string DebugImage::FormatAddress(const uint64_t &address) {
+    char buffer[19] = "";
+    snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(address));
+    return buffer;
+  }
+
+  /*! @brief Convert a hex build id into a Sentry debug id
+  *   @details The first 16 bytes are read as a GUID whose first three fields
+  *   are little-endian, shorter build ids are padded with zeros.
+  */
+  inline std::string DebugImage::DebugIDFromBuildID(const std::string &code_id) {
+    if (code_id.empty()) { return std::string(); }
+
+    unsigned char bytes[16] = { 0 };
+    for (size_t i = 0; i < 16 && (i * 2 + 1) < code_id.size(); ++i) {
+      unsigned int value = 0;
+      if (sscanf(code_id.c_str() + i * 2, "%2x", &value) != 1) { return std::string(); }
+      bytes[i] = static_cast<unsigned char>(value);
+    }
+
+    std::swap(bytes[0], bytes[3]);
+    std::swap(bytes[1], bytes[2]);
+    std::swap(bytes[4], bytes[5]);
+    std::swap(bytes[6], bytes[7]);
+
+    char buffer[37] = "";
+    snprintf(buffer, sizeof(buffer),
+      "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+      bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5], bytes[6], bytes[7],
+      bytes[8], bytes[9], bytes[10], bytes[11], bytes[12], bytes[13], bytes[14], bytes[15]);
+    return buffer;
+  }
+
+  /*! @brief Construct from a JSON object
+  */
+  inline void DebugImage::FromJson(const rapidjson::Value & json) {
+    if (json.IsNull()) { return; }
+    if (!json.IsObject()) { return; }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_TYPE)) {
+      const rapidjson::Value &type = json[JSON_ELEM_IMAGE_TYPE];
+      if (!type.IsNull()) {
+        if (type.IsString()) {
+          _type = type.GetString();
+        }
+      }
+    }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_CODE_FILE)) {
+      const rapidjson::Value &code_file = json[JSON_ELEM_IMAGE_CODE_FILE];
+      if (!code_file.IsNull()) {
+        if (code_file.IsString()) {
+          _code_file = code_file.GetString();
+        }
+      }
+    }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_CODE_ID)) {
+      const rapidjson::Value &code_id = json[JSON_ELEM_IMAGE_CODE_ID];
+      if (!code_id.IsNull()) {
+        if (code_id.IsString()) {
+          _code_id = code_id.GetString();
+        }
+      }
+    }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_DEBUG_ID)) {
+      const rapidjson::Value &debug_id = json[JSON_ELEM_IMAGE_DEBUG_ID];
+      if (!debug_id.IsNull()) {
+        if (debug_id.IsString()) {
+          _debug_id = debug_id.GetString();
+        }
+      }
+    }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_ADDR)) {
+      const rapidjson::Value &image_addr = json[JSON_ELEM_IMAGE_ADDR];
+      if (!image_addr.IsNull()) {
+        if (image_addr.IsString()) {
+          _image_addr = strtoull(image_addr.GetString(), NULL, 16);
+        } else if (image_addr.IsUint64()) {
+          _image_addr = image_addr.GetUint64();
+        }
+      }
+    }
+
+    if (json.HasMember(JSON_ELEM_IMAGE_SIZE)) {
+      const rapidjson::Value &image_size = json[JSON_ELEM_IMAGE_SIZE];
+      if (!image_size.IsNull()) {
+        if (image_size.IsUint64()) {
+          _image_size = image_size.GetUint64();
+        }
+      }
+    }
+  }
+
+  /*! @brief Convert to a JSON object
+  */
+  inline void DebugImage::ToJson(rapidjson::Document &doc) const {
+    doc.SetObject();
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    if (!_type.empty()) {
+      rapidjson::Value type(rapidjson::kStringType);
+      type.SetString(_type.data(), static_cast<rapidjson::SizeType>(_type.size()), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_TYPE), type, allocator);
+    }
+
+    if (!_code_file.empty()) {
+      rapidjson::Value code_file(rapidjson::kStringType);
+      code_file.SetString(_code_file.data(), static_cast<rapidjson::SizeType>(_code_file.size()), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_CODE_FILE), code_file, allocator);
+    }
+
+    if (!_code_id.empty()) {
+      rapidjson::Value code_id(rapidjson::kStringType);
+      code_id.SetString(_code_id.data(), static_cast<rapidjson::SizeType>(_code_id.size()), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_CODE_ID), code_id, allocator);
+    }
+
+    if (!_debug_id.empty()) {
+      rapidjson::Value debug_id(rapidjson::kStringType);
+      debug_id.SetString(_debug_id.data(), static_cast<rapidjson::SizeType>(_debug_id.size()), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_DEBUG_ID), debug_id, allocator);
+    }
+
+    std::string image_addr_str = FormatAddress(_image_addr);
+    rapidjson::Value image_addr(rapidjson::kStringType);
+    image_addr.SetString(image_addr_str.data(), static_cast<rapidjson::SizeType>(image_addr_str.size()), allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_ADDR), image_addr, allocator);
+
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_IMAGE_SIZE), static_cast<uint64_t>(_image_size), allocator);
+  }
+
+  /*!
+  */
+  inline ModuleSnapshot::ModuleSnapshot(const std::vector<DebugImage> &images, const unsigned long long &adds, const unsigned long long &subs) :
+    _images(images), _adds(adds), _subs(subs) {
+    std::sort(_images.begin(), _images.end(),
+      [](const DebugImage &a, const DebugImage &b) { return a.GetImageAddr() < b.GetImageAddr(); });
+
+    _debug_meta.SetObject();
+    rapidjson::Document::AllocatorType& allocator = _debug_meta.GetAllocator();
+
+    rapidjson::Value images_array(rapidjson::kArrayType);
+    for (auto image = _images.cbegin(); image != _images.cend(); ++image) {
+      if (!image->IsValid()) { continue; }
+      rapidjson::Document image_doc(&allocator);
+      image->ToJson(image_doc);
+      images_array.PushBack(image_doc, allocator);
+    }
+    _debug_meta.AddMember(rapidjson::StringRef(JSON_ELEM_DEBUG_IMAGES), images_array, allocator);
+  }
+
+  inline const std::vector<DebugImage>& ModuleSnapshot::GetImages() const {
+    return _images;
+  }
+
+  inline const unsigned long long & ModuleSnapshot::GetAdds() const {
+    return _adds;
+  }
+
+  inline const unsigned long long & ModuleSnapshot::GetSubs() const {
+    return _subs;
+  }
+
+  /*! @brief Find the image that contains an address
+  */
+  inline const DebugImage* ModuleSnapshot::FindImage(const uint64_t &address) const {
+    std::vector<DebugImage>::const_iterator image = std::upper_bound(_images.begin(), _images.end(), address,
+      [](const uint64_t &value, const DebugImage &entry) { return value < entry.GetImageAddr(); });
+    if (image == _images.begin()) { return NULL; }
+    --image;
+    return image->Contains(address) ? &(*image) : NULL;
+  }
+
+  /*! @brief Fill the instruction, image address and package of a frame
+  */
+  inline bool ModuleSnapshot::AnnotateFrame(const uint64_t &instruction_addr, Frame &frame) const {
+    frame.SetInstructionAddr(DebugImage::FormatAddress(instruction_addr));
+
+    const DebugImage *image = FindImage(instruction_addr);
+    if (image == NULL) { return false; }
+
+    frame.SetImageAddr(DebugImage::FormatAddress(image->GetImageAddr()));
+    frame.SetPackage(image->GetCodeFile());
+    return true;
+  }
+
+  /*! @brief Copy the cached debug_meta block into the event
+  */
+  inline void ModuleSnapshot::AddToJson(rapidjson::Document &doc) const {
+    rapidjson::Value debug_meta(rapidjson::kObjectType);
+    debug_meta.CopyFrom(_debug_meta, doc.GetAllocator());
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_DEBUG_META), debug_meta, doc.GetAllocator());
+  }
+
+  /*! @param is_watching take a snapshot now and refresh it from a background thread
+  *   @details Readers never refresh, so a watching registry is what picks up
+  *   modules loaded or unloaded later without putting the loader lock on
+  *   their path.
+  */
+  inline ModuleRegistry::ModuleRegistry(const bool &is_watching) :
+    _current(NULL), _readers(0),
+    _watcher([this]() { Refresh(); }, std::chrono::milliseconds(MODULE_REGISTRY_WATCH_MS)) {
+    if (is_watching) {
+      Refresh();
+      _watcher.Start();
+    }
+  }
+
+  /*! @brief The registry shared by the whole process, built and watched from first use
+  */
+  inline ModuleRegistry& ModuleRegistry::GetInstance() {
+    static ModuleRegistry registry(true);
+    return registry;
+  }
+
+  /*! @brief The current snapshot, only safe to use while pinned
+  */
+  inline const ModuleSnapshot* ModuleRegistry::GetSnapshot() const {
+    return _current.load();
+  }
+
+  /*! @brief Replaced snapshots not yet freed
+  */
+  inline size_t ModuleRegistry::GetRetiredCount() {
+    std::lock_guard<std::mutex> lock(_refresh_mutex);
+    return _snapshots.empty() ? 0 : _snapshots.size() - 1;
+  }
+
+  /*! @brief Keep the snapshots a reader may hold alive; safe in a signal handler
+  */
+  inline void ModuleRegistry::Pin() {
+    _readers.fetch_add(1);
+  }
+
+  inline void ModuleRegistry::Unpin() {
+    _readers.fetch_sub(1);
+  }
+
+  /*! @brief Add the debug_meta block of the current snapshot
+  */
+  inline void ModuleRegistry::AddToJson(rapidjson::Document &doc) {
+    ScopedModuleSnapshot snapshot(*this);
+    if (snapshot.Get() == NULL) { return; }
+    snapshot.Get()->AddToJson(doc);
+  }
+
+  /*! @brief Free every retired snapshot if no reader is pinned
+  *   @details A reader pins before it loads the current pointer, and the new
+  *   snapshot was stored before this check, so a reader that is not counted
+  *   here can only see the new one. The caller holds the refresh lock.
+  */
+  inline void ModuleRegistry::Reclaim() {
+    if (_snapshots.size() <= 1 || _readers.load() != 0) { return; }
+    _snapshots.erase(_snapshots.begin(), _snapshots.end() - 1);
+  }
+
+  /*! @brief Read the GNU build id note of a loaded object
+  */
+  inline std::string ModuleRegistry::ReadBuildID(const void *info) {
+    std::string code_id;
+#if defined(__linux__)
+    const struct dl_phdr_info *object = static_cast<const struct dl_phdr_info *>(info);
+    for (ElfW(Half) i = 0; i < object->dlpi_phnum; ++i) {
+      const ElfW(Phdr) &segment = object->dlpi_phdr[i];
+      if (segment.p_type != PT_NOTE) { continue; }
+
+      const unsigned char *note = reinterpret_cast<const unsigned char *>(object->dlpi_addr + segment.p_vaddr);
+      const unsigned char *end = note + segment.p_memsz;
+      while (note + sizeof(ElfW(Nhdr)) <= end) {
+        const ElfW(Nhdr) *header = reinterpret_cast<const ElfW(Nhdr) *>(note);
+        const unsigned char *name = note + sizeof(ElfW(Nhdr));
+        const unsigned char *desc = name + ((header->n_namesz + 3) & ~3u);
+        const unsigned char *next = desc + ((header->n_descsz + 3) & ~3u);
+        if (next > end) { break; }
+
+        if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+          static const char digits[] = "0123456789abcdef";
+          for (ElfW(Word) j = 0; j < header->n_descsz; ++j) {
+            code_id += digits[desc[j] >> 4];
+            code_id += digits[desc[j] & 0xf];
+          }
+          return code_id;
+        }
+        note = next;
+      }
+    }
+#else
+    (void)info;
+#endif
+    return code_id;
+  }
+
+#if defined(__linux__)
+  /*! @brief State shared with the dl_iterate_phdr callbacks
+  */
+  struct ModuleRegistryWalk {
+    const ModuleSnapshot *previous;
+    std::vector<DebugImage> images;
+    unsigned long long adds;
+    unsigned long long subs;
+    bool changed;
+  };
+
+  inline int ModuleRegistryCheckCounters(struct dl_phdr_info *info, size_t, void *data) {
+    ModuleRegistryWalk *walk = static_cast<ModuleRegistryWalk *>(data);
+    walk->adds = info->dlpi_adds;
+    walk->subs = info->dlpi_subs;
+    walk->changed = (walk->previous == NULL ||
+      walk->previous->GetAdds() != walk->adds || walk->previous->GetSubs() != walk->subs);
+    return 1; // The counters are the same for every object
+  }
+
+  /*! @brief Collect one loaded object, reusing what the previous snapshot knew
+  */
+  inline int ModuleRegistryCollect(struct dl_phdr_info *info, size_t, void *data) {
+    ModuleRegistryWalk *walk = static_cast<ModuleRegistryWalk *>(data);
+
+    uint64_t begin = UINT64_MAX;
+    uint64_t end = 0;
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+      const ElfW(Phdr) &segment = info->dlpi_phdr[i];
+      if (segment.p_type != PT_LOAD) { continue; }
+      begin = std::min<uint64_t>(begin, info->dlpi_addr + segment.p_vaddr);
+      end = std::max<uint64_t>(end, info->dlpi_addr + segment.p_vaddr + segment.p_memsz);
+    }
+    if (begin >= end) { return 0; }
+
+    std::string code_file = (info->dlpi_name != NULL) ? info->dlpi_name : "";
+    if (code_file.empty() && walk->images.empty()) {
+      // The main program comes first and has no name
+      char path[4096] = "";
+      ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+      if (length > 0) {
+        code_file.assign(path, static_cast<size_t>(length));
+      }
+    }
+    if (code_file.empty()) { return 0; }
+
+    if (walk->previous != NULL) {
+      const DebugImage *known = walk->previous->FindImage(begin);
+      if (known != NULL && known->GetImageAddr() == begin && known->GetCodeFile() == code_file) {
+        walk->images.push_back(*known);
+        return 0;
+      }
+    }
+
+    walk->images.push_back(DebugImage(code_file, begin, end - begin, ModuleRegistry::ReadBuildID(info)));
+    return 0;
+  }
+#endif
+
+  /*! @brief Bring the snapshot up to date with the loader
+  *   @return true if a new snapshot was published
+  */
+  inline bool ModuleRegistry::Refresh() {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> lock(_refresh_mutex);
+
+    ModuleRegistryWalk walk;
+    walk.previous = GetSnapshot();
+    walk.adds = 0;
+    walk.subs = 0;
+    walk.changed = false;
+
+    dl_iterate_phdr(&ModuleRegistryCheckCounters, &walk);
+    if (!walk.changed) {
+      Reclaim();
+      return false;
+    }
+
+    dl_iterate_phdr(&ModuleRegistryCollect, &walk);
+
+    ModuleSnapshot *snapshot = new ModuleSnapshot(walk.images, walk.adds, walk.subs);
+    _snapshots.push_back(std::unique_ptr<const ModuleSnapshot>(snapshot));
+    _current.store(snapshot);
+    Reclaim();
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /*!
+  */
+  inline ScopedModuleSnapshot::ScopedModuleSnapshot(ModuleRegistry &registry, const bool &is_refreshed) :
+    _registry(registry), _snapshot(NULL) {
+    if (is_refreshed) {
+      _registry.Refresh();
+    }
+    _registry.Pin();
+    _snapshot = _registry.GetSnapshot();
+  }
+
+  inline ScopedModuleSnapshot::~ScopedModuleSnapshot() {
+    _registry.Unpin();
+  }
+
+  inline const ModuleSnapshot* ScopedModuleSnapshot::Get() const {
+    return _snapshot;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_DEBUG_META_H_
\ No newline at end of file
@@ -0,0 +1,813 @@
+/********************************************//**
+* @file SentryElf.h
+* @brief Symbol and line lookup for native ELF images
+* @details https://docs.sentry.io/clientdev/interfaces/stacktrace/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_ELF_H_
+#define SENTRY_ELF_H_
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "SentryFrame.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const ELF_SECTION_SYMTAB = ".symtab";
+  const char * const ELF_SECTION_DYNSYM = ".dynsym";
+  const char * const ELF_SECTION_DEBUG_LINE = ".debug_line";
+  const char * const ELF_SECTION_DEBUG_LINE_STR = ".debug_line_str";
+  const char * const ELF_SECTION_DEBUG_STR = ".debug_str";
+
+  // Marks the row that closes a line-table sequence
+  const uint32_t ELF_LINE_END_SEQUENCE = 0xffffffff;
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief The source location of an address inside an ElfImage
+  */
+  struct ElfLocation {
+    ElfLocation() : lineno(-1), symbol_addr(0) {}
+
+    std::string filename;   // The file name as recorded in the line table
+    std::string abs_path;   // The file name joined with its directory, when the directory is known
+    std::string function;   // The (mangled) name of the enclosing symbol
+    int lineno;             // The line number, or -1 if there is no line table entry
+    uint64_t symbol_addr;   // The start address of the enclosing symbol
+  };
+
+  /*! @brief A function symbol, its name points into the mapped image
+  */
+  struct ElfSymbol {
+    uint64_t address;
+    uint64_t size;
+    const char *name;
+  };
+
+  /*! @brief A row of the decoded line table
+  */
+  struct ElfLineRow {
+    uint64_t address;
+    uint32_t file;          // Index into the image's file table, or ELF_LINE_END_SEQUENCE
+    uint32_t line;
+  };
+
+  /*! @brief A line-table file entry, all strings point into the mapped image
+  */
+  struct ElfFileEntry {
+    const char *compilation_directory;
+    const char *directory;
+    const char *name;
+  };
+
+  /*! @brief Bounds-checked reader for DWARF encoded data
+  */
+  class ElfReader {
+  public:
+    ElfReader(const unsigned char *begin, const unsigned char *end);
+
+    bool IsValid() const;
+    bool AtEnd() const;
+    const unsigned char* GetCursor() const;
+
+    uint8_t ReadU8();
+    uint16_t ReadU16();
+    uint32_t ReadU32();
+    uint64_t ReadU64();
+    uint64_t ReadOffset(const bool &is_64bit);
+    uint64_t ReadAddress(const size_t &size);
+    uint64_t ReadULEB128();
+    int64_t ReadSLEB128();
+    const char* ReadString();
+    void Skip(const uint64_t &count);
+
+  private:
+    const unsigned char *_cursor;
+    const unsigned char *_end;
+    bool _is_valid;
+
+  }; // class ElfReader
+
+  /*! @brief A read-only, memory-mapped ELF object
+  *   @details Sections stay in the mapping, only the sorted symbol and line
+  *   indexes live on the heap. Each index is built on the first lookup that
+  *   needs it. Addresses are link-time virtual addresses: subtract the load
+  *   bias of the module from a runtime address before calling Lookup.
+  */
+  class ElfImage {
+  public:
+    ElfImage(const std::string &path);
+    ~ElfImage();
+
+    bool IsValid() const;
+
+    const std::string& GetPath() const;
+    uint64_t GetBaseAddress() const;
+
+    bool Lookup(const uint64_t &address, ElfLocation &location) const;
+    Frame Symbolize(const uint64_t &address) const;
+
+    size_t GetSymbolCount() const;
+    size_t GetLineRowCount() const;
+
+  protected:
+    void Map(const std::string &path);
+    void Unmap();
+
+    const unsigned char* FindSection(const char *name, uint64_t &size) const;
+    void IndexSymbols() const;
+    void IndexSymbolTable(const char *section_name) const;
+    void IndexLines() const;
+    bool IndexLineProgram(ElfReader &reader) const;
+    bool ReadEntryFormat(ElfReader &reader, std::vector<uint64_t> &format) const;
+    bool ReadEntry(ElfReader &reader, const bool &is_64bit, const std::vector<uint64_t> &format,
+      const char *&path, uint64_t &directory_index) const;
+
+  private:
+    ElfImage(const ElfImage &other);
+    ElfImage& operator = (const ElfImage &other);
+
+    std::string _path;
+    const unsigned char *_data;
+    size_t _size;
+    uint64_t _base_address;
+
+    mutable std::once_flag _symbols_indexed;
+    mutable std::once_flag _lines_indexed;
+    mutable std::vector<ElfSymbol> _symbols;
+    mutable std::vector<ElfLineRow> _rows;
+    mutable std::vector<ElfFileEntry> _files;
+
+  }; // class ElfImage
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline ElfReader::ElfReader(const unsigned char *begin, const unsigned char *end) :
+    _cursor(begin), _end(end), _is_valid(begin != NULL && begin <= end) {
+  }
+
+  inline bool ElfReader::IsValid() const {
+    return _is_valid;
+  }
+
+  inline bool ElfReader::AtEnd() const {
+    return !_is_valid || _cursor >= _end;
+  }
+
+  inline const unsigned char* ElfReader::GetCursor() const {
+    return _cursor;
+  }
+
+  inline uint8_t ElfReader::ReadU8() {
+    if (!_is_valid || _cursor + 1 > _end) { _is_valid = false; return 0; }
+    return *_cursor++;
+  }
+
+  inline uint16_t ElfReader::ReadU16() {
+    return static_cast<uint16_t>(ReadAddress(2));
+  }
+
+  inline uint32_t ElfReader::ReadU32() {
+    return static_cast<uint32_t>(ReadAddress(4));
+  }
+
+  inline uint64_t ElfReader::ReadU64() {
+    return ReadAddress(8);
+  }
+
+  inline uint64_t ElfReader::ReadOffset(const bool &is_64bit) {
+    return is_64bit ? ReadU64() : ReadU32();
+  }
+
+  /*! @brief Read a little-endian value of up to 8 bytes
+  */
+  inline uint64_t ElfReader::ReadAddress(const size_t &size) {
+    if (!_is_valid || size > 8 || static_cast<size_t>(_end - _cursor) < size) {
+      _is_valid = false;
+      return 0;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+      value |= static_cast<uint64_t>(_cursor[i]) << (8 * i);
+    }
+    _cursor += size;
+    return value;
+  }
+
+  inline uint64_t ElfReader::ReadULEB128() {
+    uint64_t value = 0;
+    unsigned shift = 0;
+    while (_is_valid) {
+      uint8_t byte = ReadU8();
+      if (shift < 64) {
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      }
+      shift += 7;
+      if ((byte & 0x80) == 0) { break; }
+    }
+    return value;
+  }
+
+  inline int64_t ElfReader::ReadSLEB128() {
+    int64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte = 0;
+    while (_is_valid) {
+      byte = ReadU8();
+      if (shift < 64) {
+        value |= static_cast<int64_t>(byte & 0x7f) << shift;
+      }
+      shift += 7;
+      if ((byte & 0x80) == 0) { break; }
+    }
+    if (shift < 64 && (byte & 0x40)) {
+      value |= -(static_cast<int64_t>(1) << shift);
+    }
+    return value;
+  }
+
+  /*! @brief Read a NUL terminated string, returning a pointer into the data
+  */
+  inline const char* ElfReader::ReadString() {
+    if (!_is_valid) { return NULL; }
+
+    const unsigned char *terminator = static_cast<const unsigned char *>(memchr(_cursor, 0, _end - _cursor));
+    if (terminator == NULL) {
+      _is_valid = false;
+      return NULL;
+    }
+
+    const char *value = reinterpret_cast<const char *>(_cursor);
+    _cursor = terminator + 1;
+    return value;
+  }
+
+  inline void ElfReader::Skip(const uint64_t &count) {
+    if (!_is_valid || static_cast<uint64_t>(_end - _cursor) < count) {
+      _is_valid = false;
+      return;
+    }
+    _cursor += count;
+  }
+
+  /*!
+  */
+  inline ElfImage::ElfImage(const std::string &path) :
+    _path(path), _data(NULL), _size(0), _base_address(0) {
+    Map(path);
+  }
+
+  inline ElfImage::~ElfImage() {
+    Unmap();
+  }
+
+  inline bool ElfImage::IsValid() const {
+    return (_data != NULL);
+  }
+
+  inline const std::string& ElfImage::GetPath() const {
+    return _path;
+  }
+
+  /*! @brief The page-aligned virtual address of the first loadable segment
+  */
+  inline uint64_t ElfImage::GetBaseAddress() const {
+    return _base_address;
+  }
+
+  inline size_t ElfImage::GetSymbolCount() const {
+    if (!IsValid()) { return 0; }
+    std::call_once(_symbols_indexed, &ElfImage::IndexSymbols, this);
+    return _symbols.size();
+  }
+
+  inline size_t ElfImage::GetLineRowCount() const {
+    if (!IsValid()) { return 0; }
+    std::call_once(_lines_indexed, &ElfImage::IndexLines, this);
+    return _rows.size();
+  }
+
+  /*! @brief Map the file and check that it is an ELF64 little-endian object
+  */
+  inline void ElfImage::Map(const std::string &path) {
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Elf64_Ehdr))) {
+      close(fd);
+      return;
+    }
+
+    void *data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return; }
+
+    _data = static_cast<const unsigned char *>(data);
+    _size = static_cast<size_t>(info.st_size);
+
+    const Elf64_Ehdr *header = reinterpret_cast<const Elf64_Ehdr *>(_data);
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != ELFCLASS64 ||
+        header->e_ident[EI_DATA] != ELFDATA2LSB ||
+        header->e_shentsize != sizeof(Elf64_Shdr) ||
+        header->e_shoff + static_cast<uint64_t>(header->e_shnum) * sizeof(Elf64_Shdr) > _size ||
+        header->e_phoff + static_cast<uint64_t>(header->e_phnum) * sizeof(Elf64_Phdr) > _size ||
+        header->e_shstrndx >= header->e_shnum) {
+      Unmap();
+      return;
+    }
+
+    bool found_load = false;
+    const Elf64_Phdr *segments = reinterpret_cast<const Elf64_Phdr *>(_data + header->e_phoff);
+    for (uint16_t i = 0; i < header->e_phnum; ++i) {
+      if (segments[i].p_type != PT_LOAD) { continue; }
+      uint64_t address = segments[i].p_vaddr & ~static_cast<uint64_t>(0xfff);
+      if (!found_load || address < _base_address) {
+        _base_address = address;
+        found_load = true;
+      }
+    }
+#else
+    (void)path;
+#endif
+  }
+
+  inline void ElfImage::Unmap() {
+#if defined(__linux__)
+    if (_data != NULL) {
+      munmap(const_cast<unsigned char *>(_data), _size);
+    }
+#endif
+    _data = NULL;
+    _size = 0;
+  }
+
+  /*! @brief Find a section by name, returning a pointer into the mapping
+  */
+  inline const unsigned char* ElfImage::FindSection(const char *name, uint64_t &size) const {
+    size = 0;
+#if defined(__linux__)
+    if (!IsValid()) { return NULL; }
+
+    const Elf64_Ehdr *header = reinterpret_cast<const Elf64_Ehdr *>(_data);
+    const Elf64_Shdr *sections = reinterpret_cast<const Elf64_Shdr *>(_data + header->e_shoff);
+    const Elf64_Shdr &names = sections[header->e_shstrndx];
+    if (names.sh_offset + names.sh_size > _size) { return NULL; }
+
+    for (uint16_t i = 0; i < header->e_shnum; ++i) {
+      if (sections[i].sh_name >= names.sh_size) { continue; }
+      const char *section_name = reinterpret_cast<const char *>(_data + names.sh_offset + sections[i].sh_name);
+      if (strncmp(section_name, name, names.sh_size - sections[i].sh_name) != 0) { continue; }
+
+      if (sections[i].sh_type == SHT_NOBITS || sections[i].sh_offset + sections[i].sh_size > _size) {
+        return NULL;
+      }
+      size = sections[i].sh_size;
+      return _data + sections[i].sh_offset;
+    }
+#else
+    (void)name;
+#endif
+    return NULL;
+  }
+
+  /*! @brief Index function symbols, preferring the full symbol table
+  */
+  inline void ElfImage::IndexSymbols() const {
+    IndexSymbolTable(ELF_SECTION_SYMTAB);
+    if (_symbols.empty()) {
+      IndexSymbolTable(ELF_SECTION_DYNSYM);
+    }
+
+    std::sort(_symbols.begin(), _symbols.end(),
+      [](const ElfSymbol &a, const ElfSymbol &b) { return a.address < b.address; });
+  }
+
+  inline void ElfImage::IndexSymbolTable(const char *section_name) const {
+#if defined(__linux__)
+    const Elf64_Ehdr *header = reinterpret_cast<const Elf64_Ehdr *>(_data);
+    const Elf64_Shdr *sections = reinterpret_cast<const Elf64_Shdr *>(_data + header->e_shoff);
+
+    uint64_t size = 0;
+    const unsigned char *table = FindSection(section_name, size);
+    if (table == NULL) { return; }
+
+    // The linked section holds the symbol names
+    const Elf64_Shdr *symbol_section = NULL;
+    for (uint16_t i = 0; i < header->e_shnum; ++i) {
+      if (_data + sections[i].sh_offset == table) {
+        symbol_section = &sections[i];
+        break;
+      }
+    }
+    if (symbol_section == NULL || symbol_section->sh_link >= header->e_shnum) { return; }
+
+    const Elf64_Shdr &strings = sections[symbol_section->sh_link];
+    if (strings.sh_offset + strings.sh_size > _size) { return; }
+    const char *string_table = reinterpret_cast<const char *>(_data + strings.sh_offset);
+
+    const Elf64_Sym *symbols = reinterpret_cast<const Elf64_Sym *>(table);
+    size_t count = static_cast<size_t>(size / sizeof(Elf64_Sym));
+    _symbols.reserve(_symbols.size() + count);
+
+    for (size_t i = 0; i < count; ++i) {
+      const Elf64_Sym &symbol = symbols[i];
+      if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC) { continue; }
+      if (symbol.st_value == 0 || symbol.st_shndx == SHN_UNDEF) { continue; }
+      if (symbol.st_name >= strings.sh_size) { continue; }
+
+      ElfSymbol entry;
+      entry.address = symbol.st_value;
+      entry.size = symbol.st_size;
+      entry.name = string_table + symbol.st_name;
+      _symbols.push_back(entry);
+    }
+#else
+    (void)section_name;
+#endif
+  }
+
+  /*! @brief Decode every line program in .debug_line into sorted rows
+  */
+  inline void ElfImage::IndexLines() const {
+    uint64_t size = 0;
+    const unsigned char *section = FindSection(ELF_SECTION_DEBUG_LINE, size);
+    if (section == NULL) { return; }
+
+    ElfReader reader(section, section + size);
+    while (!reader.AtEnd()) {
+      if (!IndexLineProgram(reader)) { break; }
+    }
+
+    // Closing rows sort ahead of a sequence that starts at the same address
+    std::stable_sort(_rows.begin(), _rows.end(), [](const ElfLineRow &a, const ElfLineRow &b) {
+      if (a.address != b.address) { return a.address < b.address; }
+      return (a.file == ELF_LINE_END_SEQUENCE) && (b.file != ELF_LINE_END_SEQUENCE);
+    });
+  }
+
+  /*! @brief Read the format description of v5 directory and file entries
+  */
+  inline bool ElfImage::ReadEntryFormat(ElfReader &reader, std::vector<uint64_t> &format) const {
+    uint8_t count = reader.ReadU8();
+    for (uint8_t i = 0; i < count && reader.IsValid(); ++i) {
+      format.push_back(reader.ReadULEB128()); // content type
+      format.push_back(reader.ReadULEB128()); // form
+    }
+    return reader.IsValid();
+  }
+
+  /*! @brief Read one v5 directory or file entry
+  */
+  inline bool ElfImage::ReadEntry(ElfReader &reader, const bool &is_64bit, const std::vector<uint64_t> &format,
+    const char *&path, uint64_t &directory_index) const {
+    const uint64_t DW_LNCT_path = 0x1;
+    const uint64_t DW_LNCT_directory_index = 0x2;
+
+    path = NULL;
+    directory_index = 0;
+
+    for (size_t i = 0; i + 1 < format.size(); i += 2) {
+      const uint64_t content = format[i];
+      const uint64_t form = format[i + 1];
+      uint64_t value = 0;
+      const char *string = NULL;
+
+      switch (form) {
+      case 0x08: // DW_FORM_string
+        string = reader.ReadString();
+        break;
+      case 0x0e: // DW_FORM_strp
+      case 0x1f: { // DW_FORM_line_strp
+        uint64_t offset = reader.ReadOffset(is_64bit);
+        uint64_t size = 0;
+        const unsigned char *strings = FindSection(form == 0x1f ? ELF_SECTION_DEBUG_LINE_STR : ELF_SECTION_DEBUG_STR, size);
+        if (strings != NULL && offset < size && memchr(strings + offset, 0, size - offset) != NULL) {
+          string = reinterpret_cast<const char *>(strings + offset);
+        }
+        break;
+      }
+      case 0x0b: value = reader.ReadU8(); break;   // DW_FORM_data1
+      case 0x05: value = reader.ReadU16(); break;  // DW_FORM_data2
+      case 0x06: value = reader.ReadU32(); break;  // DW_FORM_data4
+      case 0x07: value = reader.ReadU64(); break;  // DW_FORM_data8
+      case 0x0f: value = reader.ReadULEB128(); break; // DW_FORM_udata
+      case 0x1e: reader.Skip(16); break;           // DW_FORM_data16
+      case 0x09: reader.Skip(reader.ReadULEB128()); break; // DW_FORM_block
+      case 0x1a: reader.ReadULEB128(); break;      // DW_FORM_strx
+      case 0x25: reader.Skip(1); break;            // DW_FORM_strx1
+      case 0x26: reader.Skip(2); break;            // DW_FORM_strx2
+      case 0x27: reader.Skip(3); break;            // DW_FORM_strx3
+      case 0x28: reader.Skip(4); break;            // DW_FORM_strx4
+      default:
+        return false;
+      }
+
+      if (content == DW_LNCT_path) {
+        path = string;
+      } else if (content == DW_LNCT_directory_index) {
+        directory_index = value;
+      }
+    }
+    return reader.IsValid();
+  }
+
+  /*! @brief Run one line-number program and append its rows
+  *   @details Supports DWARF versions 2 through 5
+  */
+  inline bool ElfImage::IndexLineProgram(ElfReader &reader) const {
+    bool is_64bit = false;
+    uint64_t unit_length = reader.ReadU32();
+    if (unit_length == 0xffffffff) {
+      is_64bit = true;
+      unit_length = reader.ReadU64();
+    }
+    if (!reader.IsValid()) { return false; }
+
+    const unsigned char *unit_begin = reader.GetCursor();
+    const unsigned char *unit_end = unit_begin + unit_length;
+    reader.Skip(unit_length);
+    if (!reader.IsValid()) { return false; }
+
+    ElfReader unit(unit_begin, unit_end);
+
+    uint16_t version = unit.ReadU16();
+    if (version < 2 || version > 5) { return true; }
+
+    if (version >= 5) {
+      unit.ReadU8(); // address size, DW_LNE_set_address carries its own length
+      unit.ReadU8(); // segment selector size
+    }
+
+    uint64_t header_length = unit.ReadOffset(is_64bit);
+    const unsigned char *program_begin = unit.GetCursor() + header_length;
+
+    uint8_t minimum_instruction_length = unit.ReadU8();
+    if (version >= 4) {
+      unit.ReadU8(); // maximum operations per instruction
+    }
+    unit.ReadU8(); // default is_stmt
+    int8_t line_base = static_cast<int8_t>(unit.ReadU8());
+    uint8_t line_range = unit.ReadU8();
+    uint8_t opcode_base = unit.ReadU8();
+    if (!unit.IsValid() || line_range == 0 || opcode_base == 0) { return true; }
+
+    std::vector<uint8_t> standard_opcode_lengths(opcode_base, 0);
+    for (uint8_t i = 1; i < opcode_base; ++i) {
+      standard_opcode_lengths[i] = unit.ReadU8();
+    }
+
+    // Directory and file tables, file indexes are translated to _files indexes
+    std::vector<const char *> directories;
+    std::vector<uint32_t> files;
+
+    if (version >= 5) {
+      std::vector<uint64_t> directory_format;
+      if (!ReadEntryFormat(unit, directory_format)) { return true; }
+      uint64_t directory_count = unit.ReadULEB128();
+      for (uint64_t i = 0; i < directory_count && unit.IsValid(); ++i) {
+        const char *path = NULL;
+        uint64_t unused = 0;
+        if (!ReadEntry(unit, is_64bit, directory_format, path, unused)) { return true; }
+        directories.push_back(path);
+      }
+
+      std::vector<uint64_t> file_format;
+      if (!ReadEntryFormat(unit, file_format)) { return true; }
+      uint64_t file_count = unit.ReadULEB128();
+      for (uint64_t i = 0; i < file_count && unit.IsValid(); ++i) {
+        const char *path = NULL;
+        uint64_t directory_index = 0;
+        if (!ReadEntry(unit, is_64bit, file_format, path, directory_index)) { return true; }
+
+        ElfFileEntry entry;
+        entry.compilation_directory = directories.empty() ? NULL : directories[0];
+        entry.directory = (directory_index < directories.size()) ? directories[directory_index] : NULL;
+        entry.name = path;
+        files.push_back(static_cast<uint32_t>(_files.size()));
+        _files.push_back(entry);
+      }
+    } else {
+      // Directory 0 is the compilation directory, which lives in .debug_info
+      directories.push_back(NULL);
+      for (;;) {
+        const char *directory = unit.ReadString();
+        if (directory == NULL || *directory == '\0') { break; }
+        directories.push_back(directory);
+      }
+
+      // File indexes start at 1 before DWARF 5
+      files.push_back(ELF_LINE_END_SEQUENCE);
+      for (;;) {
+        const char *name = unit.ReadString();
+        if (name == NULL || *name == '\0') { break; }
+        uint64_t directory_index = unit.ReadULEB128();
+        unit.ReadULEB128(); // modification time
+        unit.ReadULEB128(); // file length
+
+        ElfFileEntry entry;
+        entry.compilation_directory = NULL;
+        entry.directory = (directory_index < directories.size()) ? directories[directory_index] : NULL;
+        entry.name = name;
+        files.push_back(static_cast<uint32_t>(_files.size()));
+        _files.push_back(entry);
+      }
+    }
+    if (!unit.IsValid()) { return true; }
+
+    // Run the state machine
+    if (program_begin > unit_end) { return true; }
+    ElfReader program(program_begin, unit_end);
+
+    uint64_t address = 0;
+    uint64_t file = 1;
+    int64_t line = 1;
+
+    while (!program.AtEnd()) {
+      bool emit = false;
+      bool end_sequence = false;
+      uint8_t opcode = program.ReadU8();
+
+      if (opcode >= opcode_base) {
+        uint8_t adjusted = opcode - opcode_base;
+        address += static_cast<uint64_t>(adjusted / line_range) * minimum_instruction_length;
+        line += line_base + (adjusted % line_range);
+        emit = true;
+
+      } else if (opcode == 0) {
+        uint64_t length = program.ReadULEB128();
+        if (length == 0) { continue; }
+        const unsigned char *next = program.GetCursor() + length;
+        uint8_t extended = program.ReadU8();
+
+        if (extended == 1) { // DW_LNE_end_sequence
+          emit = true;
+          end_sequence = true;
+        } else if (extended == 2) { // DW_LNE_set_address
+          address = program.ReadAddress(static_cast<size_t>(length - 1));
+        } else if (extended == 3 && version < 5) { // DW_LNE_define_file
+          ElfFileEntry entry;
+          entry.compilation_directory = NULL;
+          entry.name = program.ReadString();
+          uint64_t directory_index = program.ReadULEB128();
+          entry.directory = (directory_index < directories.size()) ? directories[directory_index] : NULL;
+          files.push_back(static_cast<uint32_t>(_files.size()));
+          _files.push_back(entry);
+        }
+        program = ElfReader(next, unit_end);
+
+      } else {
+        switch (opcode) {
+        case 1: // DW_LNS_copy
+          emit = true;
+          break;
+        case 2: // DW_LNS_advance_pc
+          address += program.ReadULEB128() * minimum_instruction_length;
+          break;
+        case 3: // DW_LNS_advance_line
+          line += program.ReadSLEB128();
+          break;
+        case 4: // DW_LNS_set_file
+          file = program.ReadULEB128();
+          break;
+        case 8: // DW_LNS_const_add_pc
+          address += static_cast<uint64_t>((255 - opcode_base) / line_range) * minimum_instruction_length;
+          break;
+        case 9: // DW_LNS_fixed_advance_pc
+          address += program.ReadU16();
+          break;
+        default:
+          for (uint8_t i = 0; i < standard_opcode_lengths[opcode]; ++i) {
+            program.ReadULEB128();
+          }
+          break;
+        }
+      }
+
+      if (!program.IsValid()) { break; }
+
+      if (emit) {
+        ElfLineRow row;
+        row.address = address;
+        row.file = (end_sequence || file >= files.size()) ? ELF_LINE_END_SEQUENCE : files[static_cast<size_t>(file)];
+        row.line = end_sequence ? 0 : static_cast<uint32_t>(line);
+        if (!end_sequence && row.file == ELF_LINE_END_SEQUENCE) { continue; }
+        _rows.push_back(row);
+      }
+
+      if (end_sequence) {
+        address = 0;
+        file = 1;
+        line = 1;
+      }
+    }
+    return true;
+  }
+
+  /*! @brief Resolve an address to its function, file and line
+  *   @return false if neither a symbol nor a line table entry covers it
+  */
+  inline bool ElfImage::Lookup(const uint64_t &address, ElfLocation &location) const {
+    location = ElfLocation();
+    if (!IsValid()) { return false; }
+
+    std::call_once(_symbols_indexed, &ElfImage::IndexSymbols, this);
+    std::call_once(_lines_indexed, &ElfImage::IndexLines, this);
+
+    bool found = false;
+
+    std::vector<ElfSymbol>::const_iterator symbol = std::upper_bound(_symbols.begin(), _symbols.end(), address,
+      [](const uint64_t &value, const ElfSymbol &entry) { return value < entry.address; });
+    if (symbol != _symbols.begin()) {
+      --symbol;
+      if (address < symbol->address + std::max<uint64_t>(symbol->size, 1)) {
+        location.function = symbol->name;
+        location.symbol_addr = symbol->address;
+        found = true;
+      }
+    }
+
+    std::vector<ElfLineRow>::const_iterator row = std::upper_bound(_rows.begin(), _rows.end(), address,
+      [](const uint64_t &value, const ElfLineRow &entry) { return value < entry.address; });
+    if (row != _rows.begin()) {
+      --row;
+      if (row->file != ELF_LINE_END_SEQUENCE && row->file < _files.size()) {
+        const ElfFileEntry &file = _files[row->file];
+        if (file.name != NULL) {
+          location.filename = file.name;
+          if (file.name[0] == '/') {
+            location.abs_path = file.name;
+          } else if (file.directory != NULL && file.directory[0] != '\0') {
+            if (file.directory[0] != '/' && file.compilation_directory != NULL && file.directory != file.compilation_directory) {
+              location.abs_path = file.compilation_directory;
+              location.abs_path += "/";
+            }
+            location.abs_path += file.directory;
+            location.abs_path += "/";
+            location.abs_path += file.name;
+          }
+        }
+        location.lineno = static_cast<int>(row->line);
+        found = true;
+      }
+    }
+
+    return found;
+  }
+
+  /*! @brief Resolve an address into a Frame
+  *   @details The frame's module is the file name of the image
+  */
+  inline Frame ElfImage::Symbolize(const uint64_t &address) const {
+    ElfLocation location;
+    if (!Lookup(address, location)) {
+      return Frame();
+    }
+
+    std::string module = _path;
+    size_t separator = module.find_last_of('/');
+    if (separator != std::string::npos) {
+      module = module.substr(separator + 1);
+    }
+
+    Frame frame(location.filename, location.function, module);
+    frame.SetLineNumber(location.lineno);
+    frame.SetAbsPath(location.abs_path);
+    return frame;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_ELF_H_
\ No newline at end of file
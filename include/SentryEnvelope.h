@@ -0,0 +1,166 @@
+/********************************************//**
+* @file SentryEnvelope.h
+* @brief Writing Sentry envelopes
+* @details https://develop.sentry.dev/sdk/envelopes/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_ENVELOPE_H_
+#define SENTRY_ENVELOPE_H_
+#include <string>
+#include <chrono>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include "SentryClientStats.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const JSON_ELEM_ENVELOPE_EVENT_ID = "event_id";
+  const char * const JSON_ELEM_ENVELOPE_ITEM_TYPE = "type";
+  const char * const JSON_ELEM_ENVELOPE_ITEM_LENGTH = "length";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Builds an envelope: a header line, then a header line and a payload per item
+  *   @details Every item header carries the payload length, so payloads may
+  *   contain newlines.
+  */
+  class EnvelopeWriter {
+  public:
+    EnvelopeWriter(const std::string &event_id = std::string());
+
+    bool IsEmpty() const;
+    const size_t& GetItemCount() const;
+    const std::string& GetEnvelope() const;
+
+    void AddItem(const char *type, const char *payload, const size_t &length);
+    void AddItem(const char *type, const std::string &payload);
+    void AddItem(const char *type, const rapidjson::Value &payload);
+
+    static std::string MakeEnvelope(const char *type, const std::string &payload);
+    static std::string MakeEnvelope(const char *type, const rapidjson::Value &payload);
+
+  protected:
+    void AppendItem(const char *type, const char *payload, const size_t &length);
+    static void RecordSerialization(ClientCounters *counters, const size_t &length, const std::chrono::steady_clock::time_point &start);
+
+  private:
+    std::string _envelope;
+    size_t _item_count;
+
+  }; // class EnvelopeWriter
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*! @brief Start an envelope, with the event it carries if there is one
+  */
+  inline EnvelopeWriter::EnvelopeWriter(const std::string &event_id) :
+    _item_count(0) {
+    if (event_id.empty()) {
+      _envelope = "{}\n";
+      return;
+    }
+    _envelope = "{\"";
+    _envelope += JSON_ELEM_ENVELOPE_EVENT_ID;
+    _envelope += "\":\"";
+    _envelope += event_id;
+    _envelope += "\"}\n";
+  }
+
+  /*! @brief True until the first item is added
+  */
+  inline bool EnvelopeWriter::IsEmpty() const {
+    return (_item_count == 0);
+  }
+
+  inline const size_t& EnvelopeWriter::GetItemCount() const {
+    return _item_count;
+  }
+
+  inline const std::string& EnvelopeWriter::GetEnvelope() const {
+    return _envelope;
+  }
+
+  inline void EnvelopeWriter::AddItem(const char *type, const char *payload, const size_t &length) {
+    ClientCounters *counters = ClientCounters::GetRecording();
+    const std::chrono::steady_clock::time_point start = (counters != NULL) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    AppendItem(type, payload, length);
+    RecordSerialization(counters, length, start);
+  }
+
+  inline void EnvelopeWriter::AddItem(const char *type, const std::string &payload) {
+    AddItem(type, payload.data(), payload.size());
+  }
+
+  /*! @brief Add an item whose payload is written as compact JSON
+  */
+  inline void EnvelopeWriter::AddItem(const char *type, const rapidjson::Value &payload) {
+    ClientCounters *counters = ClientCounters::GetRecording();
+    const std::chrono::steady_clock::time_point start = (counters != NULL) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    payload.Accept(writer);
+    AppendItem(type, buffer.GetString(), buffer.GetSize());
+    RecordSerialization(counters, buffer.GetSize(), start);
+  }
+
+  /*! @brief Write the item header and payload
+  */
+  inline void EnvelopeWriter::AppendItem(const char *type, const char *payload, const size_t &length) {
+    _envelope += "{\"";
+    _envelope += JSON_ELEM_ENVELOPE_ITEM_TYPE;
+    _envelope += "\":\"";
+    _envelope += type;
+    _envelope += "\",\"";
+    _envelope += JSON_ELEM_ENVELOPE_ITEM_LENGTH;
+    _envelope += "\":";
+    _envelope += std::to_string(length);
+    _envelope += "}\n";
+    _envelope.append(payload, length);
+    _envelope += "\n";
+    ++_item_count;
+  }
+
+  /*! @brief Inside a pipeline's sink, count an item in the sending client's counters
+  */
+  inline void EnvelopeWriter::RecordSerialization(ClientCounters *counters, const size_t &length, const std::chrono::steady_clock::time_point &start) {
+    if (counters == NULL) { return; }
+    counters->RecordSerialization(length, static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+  }
+
+  /*! @brief An envelope with a single item and no event
+  */
+  inline std::string EnvelopeWriter::MakeEnvelope(const char *type, const std::string &payload) {
+    EnvelopeWriter envelope;
+    envelope.AddItem(type, payload);
+    return envelope.GetEnvelope();
+  }
+
+  inline std::string EnvelopeWriter::MakeEnvelope(const char *type, const rapidjson::Value &payload) {
+    EnvelopeWriter envelope;
+    envelope.AddItem(type, payload);
+    return envelope.GetEnvelope();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_ENVELOPE_H_
\ No newline at end of file
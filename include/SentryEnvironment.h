@@ -0,0 +1,444 @@
+/********************************************//**
+* @file SentryEnvironment.h
+* @brief Auto-detected OS and runtime contexts for Sentry events
+* @details https://docs.sentry.io/clientdev/interfaces/contexts/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_ENVIRONMENT_H_
+#define SENTRY_ENVIRONMENT_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+
+#include "SentryContext.h"
+#include "SentryScope.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/utsname.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <gnu/libc-version.h>
+#endif
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const OS_RELEASE_PATH = "/etc/os-release";
+
+  const char * const OS_RELEASE_NAME = "NAME";
+  const char * const OS_RELEASE_VERSION_ID = "VERSION_ID";
+  const char * const OS_RELEASE_BUILD_ID = "BUILD_ID";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A context converted to JSON once and copied into events from then on
+  */
+  class PrebuiltContext : public ContextGeneral {
+  public:
+    PrebuiltContext(const ContextGeneral &context);
+
+    void ToJson(rapidjson::Document &doc) const;
+
+  private:
+    PrebuiltContext(const PrebuiltContext &other);
+    PrebuiltContext& operator = (const PrebuiltContext &other);
+
+    rapidjson::Document _json;
+
+  }; // class PrebuiltContext
+
+  /*! @brief The OS and runtime contexts found at one detection
+  *   @details Immutable once built. Each context is converted to JSON once and
+  *   the scope carries those prebuilt contexts, so attaching them to an event
+  *   copies the cached JSON and never reads the system or formats strings.
+  *   The serialized contexts object is what Refresh compares.
+  */
+  class DetectedContexts {
+  public:
+    DetectedContexts(const std::shared_ptr<const ContextOS> &os, const std::shared_ptr<const ContextRuntime> &runtime);
+
+    const std::shared_ptr<const ContextOS>& GetOS() const;
+    const std::shared_ptr<const ContextRuntime>& GetRuntime() const;
+    const std::vector<std::shared_ptr<const ContextGeneral> >& GetPrebuilt() const;
+    const std::string& GetSerialized() const;
+
+    void AddToJson(rapidjson::Document &doc) const;
+
+  private:
+    DetectedContexts(const DetectedContexts &other);
+    DetectedContexts& operator = (const DetectedContexts &other);
+
+    std::shared_ptr<const ContextOS> _os;
+    std::shared_ptr<const ContextRuntime> _runtime;
+    std::vector<std::shared_ptr<const ContextGeneral> > _prebuilt;
+    rapidjson::Document _json;        // The "contexts" object
+    std::string _serialized;
+
+  }; // class DetectedContexts
+
+  /*! @brief Detects the OS and runtime once and publishes them to the global scope
+  *   @details Detection reads uname, /etc/os-release, the libc version and the
+  *   compiler version. Long-lived processes can opt in to a background refresh,
+  *   which republishes only when something changed. Nothing is put on the
+  *   global scope until Install() is called.
+  */
+  class EnvironmentDetector {
+  public:
+    static EnvironmentDetector& GetInstance();
+    ~EnvironmentDetector();
+
+    static std::shared_ptr<const DetectedContexts> Detect(const std::string &os_release_path = OS_RELEASE_PATH);
+    static bool ParseOSRelease(const std::string &path, std::map<std::string, std::string> &values);
+    static std::string GetCompilerName();
+    static std::string GetCompilerVersion();
+    static std::string GetLibcVersion();
+
+    std::shared_ptr<const DetectedContexts> Get();
+    bool Refresh();
+    void Install();
+
+    void StartRefresh(const std::chrono::seconds &interval);
+    void StopRefresh();
+    bool IsRefreshing() const;
+
+  protected:
+    EnvironmentDetector();
+
+    void Publish(const std::shared_ptr<const DetectedContexts> &contexts);
+
+  private:
+    EnvironmentDetector(const EnvironmentDetector &other);
+    EnvironmentDetector& operator = (const EnvironmentDetector &other);
+
+    std::shared_ptr<const DetectedContexts> _contexts;
+    std::once_flag _detected;
+
+    std::thread _refresher;
+    std::mutex _refresh_mutex;
+    std::condition_variable _refresh_wake;
+    std::atomic<bool> _is_refreshing;
+    std::atomic<bool> _is_installed;
+
+  }; // class EnvironmentDetector
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline PrebuiltContext::PrebuiltContext(const ContextGeneral &context) :
+    ContextGeneral(context.GetType(), context.GetName()) {
+    context.ToJson(_json);
+  }
+
+  /*! @brief Copy the cached JSON
+  */
+  inline void PrebuiltContext::ToJson(rapidjson::Document &doc) const {
+    doc.CopyFrom(_json, doc.GetAllocator());
+  }
+
+  /*! @brief Serialize the contexts once, at construction
+  */
+  inline DetectedContexts::DetectedContexts(const std::shared_ptr<const ContextOS> &os, const std::shared_ptr<const ContextRuntime> &runtime) :
+    _os(os), _runtime(runtime) {
+    _json.SetObject();
+    rapidjson::Document::AllocatorType& allocator = _json.GetAllocator();
+
+    const ContextGeneral *contexts[] = { _os.get(), _runtime.get() };
+    for (size_t i = 0; i < 2; ++i) {
+      if (contexts[i] == NULL || !contexts[i]->IsValid()) { continue; }
+
+      std::shared_ptr<const ContextGeneral> prebuilt = std::make_shared<const PrebuiltContext>(*contexts[i]);
+      _prebuilt.push_back(prebuilt);
+
+      rapidjson::Value key(rapidjson::kStringType);
+      key.SetString(contexts[i]->GetType().data(), static_cast<rapidjson::SizeType>(contexts[i]->GetType().size()), allocator);
+
+      rapidjson::Document context_doc(&allocator);
+      prebuilt->ToJson(context_doc);
+      _json.AddMember(key, context_doc, allocator);
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    _json.Accept(writer);
+    _serialized.assign(buffer.GetString(), buffer.GetSize());
+  }
+
+  inline const std::shared_ptr<const ContextOS>& DetectedContexts::GetOS() const {
+    return _os;
+  }
+
+  inline const std::shared_ptr<const ContextRuntime>& DetectedContexts::GetRuntime() const {
+    return _runtime;
+  }
+
+  /*! @brief The contexts as put on the global scope
+  */
+  inline const std::vector<std::shared_ptr<const ContextGeneral> >& DetectedContexts::GetPrebuilt() const {
+    return _prebuilt;
+  }
+
+  /*! @brief The contexts object as compact JSON
+  */
+  inline const std::string& DetectedContexts::GetSerialized() const {
+    return _serialized;
+  }
+
+  /*! @brief Copy the prebuilt contexts object into an event
+  */
+  inline void DetectedContexts::AddToJson(rapidjson::Document &doc) const {
+    if (_json.ObjectEmpty()) { return; }
+
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+    rapidjson::Value contexts(_json, allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_CONTEXTS), contexts, allocator);
+  }
+
+  /*!
+  */
+  inline EnvironmentDetector::EnvironmentDetector() :
+    _is_refreshing(false), _is_installed(false) {
+  }
+
+  inline EnvironmentDetector::~EnvironmentDetector() {
+    StopRefresh();
+  }
+
+  /*! @brief The detector shared by the whole process
+  */
+  inline EnvironmentDetector& EnvironmentDetector::GetInstance() {
+    static EnvironmentDetector detector;
+    return detector;
+  }
+
+  /*! @brief Read KEY=value lines from an os-release file
+  *   @details Values may be quoted; quotes are removed and backslash escapes
+  *   resolved, as the os-release format describes.
+  */
+  inline bool EnvironmentDetector::ParseOSRelease(const std::string &path, std::map<std::string, std::string> &values) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) { return false; }
+
+    std::string line;
+    while (std::getline(file, line)) {
+      size_t start = line.find_first_not_of(" \t");
+      if (start == std::string::npos || line[start] == '#') { continue; }
+
+      size_t equals = line.find('=', start);
+      if (equals == std::string::npos) { continue; }
+
+      std::string key = line.substr(start, equals - start);
+      std::string raw = line.substr(equals + 1);
+      while (!raw.empty() && (raw[raw.size() - 1] == '\r' || raw[raw.size() - 1] == ' ')) {
+        raw.erase(raw.size() - 1);
+      }
+
+      std::string value;
+      char quote = (!raw.empty() && (raw[0] == '"' || raw[0] == '\'')) ? raw[0] : '\0';
+      for (size_t i = (quote != '\0') ? 1 : 0; i < raw.size(); ++i) {
+        if (raw[i] == quote) { break; }
+        if (raw[i] == '\\' && quote != '\'' && i + 1 < raw.size()) {
+          ++i;
+        }
+        value += raw[i];
+      }
+      values[key] = value;
+    }
+    return true;
+  }
+
+  /*! @brief The compiler this library was built with
+  */
+  inline std::string EnvironmentDetector::GetCompilerName() {
+#if defined(__clang__)
+    return "clang";
+#elif defined(__GNUC__)
+    return "gcc";
+#elif defined(_MSC_VER)
+    return "msvc";
+#else
+    return "c++";
+#endif
+  }
+
+  inline std::string EnvironmentDetector::GetCompilerVersion() {
+    std::ostringstream version;
+#if defined(__clang__)
+    version << __clang_major__ << '.' << __clang_minor__ << '.' << __clang_patchlevel__;
+#elif defined(__GNUC__)
+    version << __GNUC__ << '.' << __GNUC_MINOR__ << '.' << __GNUC_PATCHLEVEL__;
+#elif defined(_MSC_VER)
+    version << _MSC_FULL_VER;
+#else
+    version << __cplusplus;
+#endif
+    return version.str();
+  }
+
+  /*! @brief The C library version at run time, empty where it cannot be asked
+  */
+  inline std::string EnvironmentDetector::GetLibcVersion() {
+#if defined(__GLIBC__)
+    return std::string("glibc ") + gnu_get_libc_version();
+#else
+    return std::string();
+#endif
+  }
+
+  /*! @brief Read the system and build new contexts
+  *   @details The OS name and version come from os-release when present and
+  *   from uname otherwise. The runtime is the compiler, with the libc version
+  *   the process actually loaded.
+  */
+  inline std::shared_ptr<const DetectedContexts> EnvironmentDetector::Detect(const std::string &os_release_path) {
+    std::string name;
+    std::string version;
+    std::string build;
+    std::string kernel_version;
+
+#if defined(__unix__) || defined(__APPLE__)
+    struct utsname system;
+    if (uname(&system) == 0) {
+      name = system.sysname;
+      version = system.release;
+      build = system.version;
+      kernel_version = system.release;
+    }
+#elif defined(_WIN32)
+    name = "Windows";
+#endif
+
+    std::map<std::string, std::string> release;
+    if (ParseOSRelease(os_release_path, release)) {
+      auto entry = release.find(OS_RELEASE_NAME);
+      if (entry != release.end() && !entry->second.empty()) {
+        name = entry->second;
+      }
+      entry = release.find(OS_RELEASE_VERSION_ID);
+      if (entry != release.end() && !entry->second.empty()) {
+        version = entry->second;
+      }
+      entry = release.find(OS_RELEASE_BUILD_ID);
+      if (entry != release.end() && !entry->second.empty()) {
+        build = entry->second;
+      }
+    }
+
+    std::string runtime_version = GetCompilerVersion();
+    std::string libc_version = GetLibcVersion();
+    if (!libc_version.empty()) {
+      runtime_version += " (" + libc_version + ")";
+    }
+
+    return std::make_shared<const DetectedContexts>(
+      std::make_shared<const ContextOS>(name, version, build, kernel_version),
+      std::make_shared<const ContextRuntime>(GetCompilerName(), runtime_version));
+  }
+
+  /*! @brief The current contexts, detected on first use
+  */
+  inline std::shared_ptr<const DetectedContexts> EnvironmentDetector::Get() {
+    std::call_once(_detected, [this]() {
+      std::atomic_store(&_contexts, Detect());
+    });
+    return std::atomic_load(&_contexts);
+  }
+
+  /*! @brief Detect again and republish if anything changed
+  *   @return true if the contexts changed
+  */
+  inline bool EnvironmentDetector::Refresh() {
+    std::shared_ptr<const DetectedContexts> previous = Get();
+    std::shared_ptr<const DetectedContexts> current = Detect();
+    if (previous && previous->GetSerialized() == current->GetSerialized()) {
+      return false;
+    }
+    Publish(current);
+    return true;
+  }
+
+  /*! @brief Put the contexts on the global scope so every capture carries them
+  */
+  inline void EnvironmentDetector::Install() {
+    _is_installed = true;
+    Publish(Get());
+  }
+
+  /*! @brief Hand out new contexts, and put them on the global scope once installed
+  */
+  inline void EnvironmentDetector::Publish(const std::shared_ptr<const DetectedContexts> &contexts) {
+    std::atomic_store(&_contexts, contexts);
+    if (!_is_installed) { return; }
+
+    const std::vector<std::shared_ptr<const ContextGeneral> > &prebuilt = contexts->GetPrebuilt();
+    for (size_t i = 0; i < prebuilt.size(); ++i) {
+      Scope::Global().SetContext(prebuilt[i]);
+    }
+  }
+
+  /*! @brief Refresh on a background thread until StopRefresh()
+  */
+  inline void EnvironmentDetector::StartRefresh(const std::chrono::seconds &interval) {
+    std::lock_guard<std::mutex> lock(_refresh_mutex);
+    if (_is_refreshing) { return; }
+    _is_refreshing = true;
+
+    _refresher = std::thread([this, interval]() {
+      std::unique_lock<std::mutex> wait_lock(_refresh_mutex);
+      while (_is_refreshing) {
+        if (_refresh_wake.wait_for(wait_lock, interval, [this]() { return !_is_refreshing; })) {
+          break;
+        }
+        wait_lock.unlock();
+        Refresh();
+        wait_lock.lock();
+      }
+    });
+  }
+
+  inline void EnvironmentDetector::StopRefresh() {
+    {
+      std::lock_guard<std::mutex> lock(_refresh_mutex);
+      _is_refreshing = false;
+    }
+    _refresh_wake.notify_all();
+    if (_refresher.joinable()) {
+      _refresher.join();
+    }
+  }
+
+  inline bool EnvironmentDetector::IsRefreshing() const {
+    return _is_refreshing.load();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_ENVIRONMENT_H_
\ No newline at end of file
@@ -0,0 +1,293 @@
+/********************************************//**
+* @file SentryEvent.h
+* @brief A Sentry event built in a single arena
+* @details https://docs.sentry.io/clientdev/attributes/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_EVENT_H_
+#define SENTRY_EVENT_H_
+#include <string>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include "SentryAttributes.h"
+#include "SentryContext.h"
+#include "SentryException.h"
+#include "SentrySDK.h"
+#include "SentryClientStats.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t EVENT_ARENA_CAPACITY = 16 * 1024;    // Allocated together with the event
+  const size_t EVENT_ARENA_CHUNK = 16 * 1024;       // Further blocks, if an event outgrows the first
+
+  const char * const EVENT_PLATFORM = "native";
+  const size_t EVENT_ID_LENGTH = 32;                // Hex digits, without the terminator
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief The memory behind one event
+  *   @details The first block of the arena, the allocator and the document
+  *   come from a single allocation. Everything the interfaces write into the
+  *   document is carved out of the arena and released with it at once.
+  */
+  struct EventArena {
+    EventArena();
+
+    std::aligned_storage<EVENT_ARENA_CAPACITY>::type buffer;
+    rapidjson::MemoryPoolAllocator<> allocator;
+    rapidjson::Document document;
+
+  private:
+    EventArena(const EventArena &other);
+    EventArena& operator = (const EventArena &other);
+
+  }; // struct EventArena
+
+  /*! @brief An event in Sentry
+  *   @details Interfaces are written into the event as they are added, so the
+  *   event holds no copies of them. Events can only be moved, which hands
+  *   over the arena without touching its contents.
+  */
+  class Event {
+  public:
+    Event(const attributes::Level &level = attributes::Level(attributes::Level::LEVEL_ERROR));
+    Event(Event &&other);
+    Event& operator = (Event &&other);
+
+    bool IsValid() const;
+
+    const char* GetEventID() const;
+    size_t GetArenaSize() const;
+
+    template <typename Interface>
+    Event& Add(const Interface &interface);
+    Event& AddException(const Exception &exception);
+    Event& AddContext(const ContextGeneral &context);
+
+    rapidjson::Document& GetDocument();
+    const rapidjson::Document& GetDocument() const;
+    rapidjson::Document::AllocatorType& GetAllocator();
+
+    std::string ToString() const;
+
+    static std::string GenerateEventID();
+    static void GenerateEventID(char (&event_id)[EVENT_ID_LENGTH + 1]);
+
+  protected:
+    rapidjson::Value& GetObject(const char *name);
+
+  private:
+    Event(const Event &other);
+    Event& operator = (const Event &other);
+
+    std::unique_ptr<EventArena> _arena;
+    char _event_id[EVENT_ID_LENGTH + 1];
+
+  }; // class Event
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline EventArena::EventArena() :
+    allocator(&buffer, sizeof(buffer), EVENT_ARENA_CHUNK), document(&allocator) {
+    document.SetObject();
+  }
+
+  /*! @brief Start an event with its id, timestamp, level, platform and SDK
+  */
+  inline Event::Event(const attributes::Level &level) :
+    _arena(new EventArena()) {
+    rapidjson::Document &doc = _arena->document;
+
+    GenerateEventID(_event_id);
+    rapidjson::Value event_id(rapidjson::kStringType);
+    event_id.SetString(_event_id, static_cast<rapidjson::SizeType>(EVENT_ID_LENGTH), doc.GetAllocator());
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_EVENT_ID), event_id, doc.GetAllocator());
+
+    std::string timestamp = attributes::Timestamp().GetTimestampString();
+    rapidjson::Value timestamp_value(rapidjson::kStringType);
+    timestamp_value.SetString(timestamp.data(), static_cast<rapidjson::SizeType>(timestamp.size()), doc.GetAllocator());
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_TIMESTAMP), timestamp_value, doc.GetAllocator());
+
+    level.AddToJson(doc);
+    rapidjson::Value platform(rapidjson::StringRef(EVENT_PLATFORM));
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_PLATFORM), platform, doc.GetAllocator());
+    SDK().AddToJson(doc);
+  }
+
+  inline Event::Event(Event &&other) :
+    _arena(std::move(other._arena)) {
+    memcpy(_event_id, other._event_id, sizeof(_event_id));
+  }
+
+  inline Event& Event::operator = (Event &&other) {
+    _arena = std::move(other._arena);
+    memcpy(_event_id, other._event_id, sizeof(_event_id));
+    return *this;
+  }
+
+  /*! @brief False once the event has been moved from
+  */
+  inline bool Event::IsValid() const {
+    return (_arena != nullptr);
+  }
+
+  /*! @brief The 32 hex digit id, null terminated
+  */
+  inline const char* Event::GetEventID() const {
+    return _event_id;
+  }
+
+  /*! @brief Bytes taken from the arena so far
+  */
+  inline size_t Event::GetArenaSize() const {
+    return (_arena != nullptr) ? _arena->allocator.Size() : 0;
+  }
+
+  /*! @brief Write an interface into the event
+  *   @details Works with anything that has AddToJson; add each one once.
+  */
+  template <typename Interface>
+  inline Event& Event::Add(const Interface &interface) {
+    if (_arena != nullptr) {
+      interface.AddToJson(_arena->document);
+    }
+    return *this;
+  }
+
+  /*! @brief Append an exception to exception.values
+  */
+  inline Event& Event::AddException(const Exception &exception) {
+    if (_arena == nullptr || !exception.IsValid()) { return *this; }
+
+    rapidjson::Value &object = GetObject(JSON_ELEM_EXCEPTION);
+    if (!object.HasMember(JSON_ELEM_EXCEPTION_VALUES)) {
+      rapidjson::Value values(rapidjson::kArrayType);
+      object.AddMember(rapidjson::StringRef(JSON_ELEM_EXCEPTION_VALUES), values, GetAllocator());
+    }
+
+    rapidjson::Document exception_doc(&GetAllocator());
+    exception.ToJson(exception_doc);
+    object[JSON_ELEM_EXCEPTION_VALUES].PushBack(exception_doc, GetAllocator());
+    return *this;
+  }
+
+  /*! @brief Add a context under contexts, keyed by its type
+  */
+  inline Event& Event::AddContext(const ContextGeneral &context) {
+    if (_arena == nullptr || !context.IsValid()) { return *this; }
+
+    rapidjson::Value &object = GetObject(JSON_ELEM_CONTEXTS);
+    if (object.HasMember(context.GetType().c_str())) {
+      object.RemoveMember(context.GetType().c_str());
+    }
+
+    rapidjson::Value key(rapidjson::kStringType);
+    key.SetString(context.GetType().data(), static_cast<rapidjson::SizeType>(context.GetType().size()), GetAllocator());
+
+    rapidjson::Document context_doc(&GetAllocator());
+    context.ToJson(context_doc);
+    object.AddMember(key, context_doc, GetAllocator());
+    return *this;
+  }
+
+  /*! @brief A top-level object of the event, created if missing
+  */
+  inline rapidjson::Value& Event::GetObject(const char *name) {
+    rapidjson::Document &doc = _arena->document;
+    if (!doc.HasMember(name) || !doc[name].IsObject()) {
+      if (doc.HasMember(name)) {
+        doc.RemoveMember(name);
+      }
+      rapidjson::Value object(rapidjson::kObjectType);
+      doc.AddMember(rapidjson::StringRef(name), object, doc.GetAllocator());
+    }
+    return doc[name];
+  }
+
+  inline rapidjson::Document& Event::GetDocument() {
+    return _arena->document;
+  }
+
+  inline const rapidjson::Document& Event::GetDocument() const {
+    return _arena->document;
+  }
+
+  inline rapidjson::Document::AllocatorType& Event::GetAllocator() {
+    return _arena->allocator;
+  }
+
+  /*! @brief The event as compact JSON
+  *   @details Inside a pipeline's sink, the size and the time taken are
+  *   recorded in the sending client's counters.
+  */
+  inline std::string Event::ToString() const {
+    if (_arena == nullptr) { return std::string(); }
+
+    ClientCounters *counters = ClientCounters::GetRecording();
+    const std::chrono::steady_clock::time_point start = (counters != NULL) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    _arena->document.Accept(writer);
+    std::string json(buffer.GetString(), buffer.GetSize());
+    if (counters != NULL) {
+      counters->RecordSerialization(json.size(), static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
+    return json;
+  }
+
+  /*! @brief A random UUID as 32 hex digits, the form Sentry expects
+  */
+  inline std::string Event::GenerateEventID() {
+    char event_id[EVENT_ID_LENGTH + 1];
+    GenerateEventID(event_id);
+    return std::string(event_id, EVENT_ID_LENGTH);
+  }
+
+  /*! @brief A random UUID written into a fixed buffer, null terminated
+  */
+  inline void Event::GenerateEventID(char (&event_id)[EVENT_ID_LENGTH + 1]) {
+    static thread_local std::mt19937_64 generator(std::random_device{}() ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&generator)));
+
+    uint64_t parts[2] = { generator(), generator() };
+    parts[0] = (parts[0] & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL;  // Version 4
+    parts[1] = (parts[1] & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;  // RFC 4122 variant
+
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < EVENT_ID_LENGTH; ++i) {
+      uint64_t part = parts[i / 16];
+      event_id[i] = digits[(part >> (60 - 4 * (i % 16))) & 0xF];
+    }
+    event_id[EVENT_ID_LENGTH] = '\0';
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_EVENT_H_
\ No newline at end of file
@@ -0,0 +1,455 @@
+/********************************************//**
+* @file SentryEventView.h
+* @brief Read-only views of a stored event parsed in place
+* @details The views point into the buffer the event was parsed from, so
+* reading a field copies nothing. Convert a view to its owning interface
+* when the event is kept.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_EVENT_VIEW_H_
+#define SENTRY_EVENT_VIEW_H_
+#include <string>
+#include <stdlib.h>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+#include "SentryStringView.h"
+#include "SentryAttributes.h"
+#include "SentryFrame.h"
+#include "SentryStacktrace.h"
+#include "SentryException.h"
+#include "SentryThreads.h"
+#include "SentryMessage.h"
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A JSON object owned by a document that outlives the view
+  *   @details A view of a missing object is empty: strings are empty and
+  *   numbers and flags take their defaults.
+  */
+  class ValueView {
+  public:
+    ValueView();
+    ValueView(const rapidjson::Value &json);
+
+    bool IsEmpty() const;
+
+  protected:
+    const rapidjson::Value* GetMember(const char *name) const;
+    const rapidjson::Value* GetElement(const char *name, const char *elements, const size_t &index) const;
+    size_t GetElementCount(const char *name, const char *elements) const;
+
+    StringView GetString(const char *name) const;
+    int GetInt(const char *name, const int &fallback) const;
+    bool GetBool(const char *name, const bool &fallback) const;
+    int GetThreadId() const;
+
+    static StringView ToStringView(const rapidjson::Value &value);
+
+    const rapidjson::Value *_json;
+
+  }; // class ValueView
+
+  /*! @brief A view of a frame
+  */
+  class FrameView : public ValueView {
+  public:
+    FrameView();
+    FrameView(const rapidjson::Value &json);
+
+    StringView GetFilename() const;
+    StringView GetFunction() const;
+    StringView GetModule() const;
+    StringView GetAbsPath() const;
+    StringView GetPackage() const;
+    StringView GetImageAddr() const;
+    StringView GetInstructionAddr() const;
+    StringView GetContextLine() const;
+    int GetLineNumber() const;
+    bool IsInApp() const;
+
+    Frame ToFrame() const;
+
+  }; // class FrameView
+
+  /*! @brief A view of a stacktrace and its frames
+  */
+  class StacktraceView : public ValueView {
+  public:
+    StacktraceView();
+    StacktraceView(const rapidjson::Value &json);
+
+    size_t GetFrameCount() const;
+    FrameView GetFrame(const size_t &index) const;
+
+    Stacktrace ToStacktrace() const;
+
+  }; // class StacktraceView
+
+  /*! @brief A view of one value of the exception interface
+  */
+  class ExceptionView : public ValueView {
+  public:
+    ExceptionView();
+    ExceptionView(const rapidjson::Value &json);
+
+    StringView GetType() const;
+    StringView GetValue() const;
+    StringView GetModule() const;
+    int GetThreadId() const;
+    StacktraceView GetStacktrace() const;
+
+    Exception ToException() const;
+
+  }; // class ExceptionView
+
+  /*! @brief A view of one value of the threads interface
+  */
+  class ThreadView : public ValueView {
+  public:
+    ThreadView();
+    ThreadView(const rapidjson::Value &json);
+
+    int GetThreadID() const;
+    StringView GetName() const;
+    bool IsCrashed() const;
+    bool IsCurrent() const;
+    StacktraceView GetStacktrace() const;
+
+    Thread ToThread() const;
+
+  }; // class ThreadView
+
+  /*! @brief A stored event parsed in place, and the root of its views
+  *   @details ParseInsitu decodes strings inside the buffer, which must be
+  *   writable, null terminated, and kept alive as long as the views. Only the
+  *   document's tree of values is allocated.
+  */
+  class EventView : public ValueView {
+  public:
+    EventView(char *buffer);
+
+    bool IsValid() const;
+
+    StringView GetEventId() const;
+    StringView GetLevel() const;
+    StringView GetPlatform() const;
+    StringView GetMessage() const;
+
+    size_t GetExceptionCount() const;
+    ExceptionView GetException(const size_t &index) const;
+
+    size_t GetThreadCount() const;
+    ThreadView GetThread(const size_t &index) const;
+
+  private:
+    EventView(const EventView &other);
+    EventView& operator = (const EventView &other);
+
+    rapidjson::Document _document;
+
+  }; // class EventView
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline ValueView::ValueView() :
+    _json(NULL) {
+  }
+
+  inline ValueView::ValueView(const rapidjson::Value &json) :
+    _json(json.IsObject() ? &json : NULL) {
+  }
+
+  inline bool ValueView::IsEmpty() const {
+    return (_json == NULL);
+  }
+
+  inline const rapidjson::Value* ValueView::GetMember(const char *name) const {
+    if (_json == NULL) { return NULL; }
+    rapidjson::Value::ConstMemberIterator member = _json->FindMember(name);
+    if (member == _json->MemberEnd() || member->value.IsNull()) { return NULL; }
+    return &member->value;
+  }
+
+  /*! @brief An element of an array inside an object member, e.g. "exception": {"values": [...]}
+  */
+  inline const rapidjson::Value* ValueView::GetElement(const char *name, const char *elements, const size_t &index) const {
+    const rapidjson::Value *member = GetMember(name);
+    if (member == NULL || !member->IsObject()) { return NULL; }
+    rapidjson::Value::ConstMemberIterator values = member->FindMember(elements);
+    if (values == member->MemberEnd() || !values->value.IsArray() || index >= values->value.Size()) { return NULL; }
+    return &values->value[static_cast<rapidjson::SizeType>(index)];
+  }
+
+  inline size_t ValueView::GetElementCount(const char *name, const char *elements) const {
+    const rapidjson::Value *member = GetMember(name);
+    if (member == NULL || !member->IsObject()) { return 0; }
+    rapidjson::Value::ConstMemberIterator values = member->FindMember(elements);
+    if (values == member->MemberEnd() || !values->value.IsArray()) { return 0; }
+    return values->value.Size();
+  }
+
+  inline StringView ValueView::GetString(const char *name) const {
+    const rapidjson::Value *member = GetMember(name);
+    if (member == NULL || !member->IsString()) { return StringView(); }
+    return ToStringView(*member);
+  }
+
+  inline int ValueView::GetInt(const char *name, const int &fallback) const {
+    const rapidjson::Value *member = GetMember(name);
+    if (member == NULL || !member->IsInt()) { return fallback; }
+    return member->GetInt();
+  }
+
+  inline bool ValueView::GetBool(const char *name, const bool &fallback) const {
+    const rapidjson::Value *member = GetMember(name);
+    if (member == NULL || !member->IsBool()) { return fallback; }
+    return member->GetBool();
+  }
+
+  /*! @brief A thread id written as a number or a string, as the interfaces accept
+  */
+  inline int ValueView::GetThreadId() const {
+    const rapidjson::Value *member = GetMember(JSON_ELEM_THREAD_ID);
+    if (member == NULL) { return -1; }
+    if (member->IsInt()) { return member->GetInt(); }
+    if (member->IsString()) { return atoi(member->GetString()); }
+    return -1;
+  }
+
+  inline StringView ValueView::ToStringView(const rapidjson::Value &value) {
+    return StringView(value.GetString(), value.GetStringLength());
+  }
+
+  /*!
+  */
+  inline FrameView::FrameView() :
+    ValueView() {
+  }
+
+  inline FrameView::FrameView(const rapidjson::Value &json) :
+    ValueView(json) {
+  }
+
+  inline StringView FrameView::GetFilename() const {
+    return GetString(JSON_ELEM_FILENAME);
+  }
+
+  inline StringView FrameView::GetFunction() const {
+    return GetString(JSON_ELEM_FUNCTION);
+  }
+
+  inline StringView FrameView::GetModule() const {
+    return GetString(JSON_ELEM_MODULE);
+  }
+
+  inline StringView FrameView::GetAbsPath() const {
+    return GetString(JSON_ELEM_ABS_PATH);
+  }
+
+  inline StringView FrameView::GetPackage() const {
+    return GetString(JSON_ELEM_PACKAGE);
+  }
+
+  inline StringView FrameView::GetImageAddr() const {
+    return GetString(JSON_ELEM_IMAGE_ADDR);
+  }
+
+  inline StringView FrameView::GetInstructionAddr() const {
+    return GetString(JSON_ELEM_INSTRUCTION_ADDR);
+  }
+
+  inline StringView FrameView::GetContextLine() const {
+    return GetString(JSON_ELEM_CONTEXT_LINE);
+  }
+
+  inline int FrameView::GetLineNumber() const {
+    return GetInt(JSON_ELEM_LINE_NO, -1);
+  }
+
+  inline bool FrameView::IsInApp() const {
+    return GetBool(JSON_ELEM_IN_APP, false);
+  }
+
+  /*! @brief Copy the frame into an owning Frame
+  */
+  inline Frame FrameView::ToFrame() const {
+    return (_json != NULL) ? Frame(*_json) : Frame();
+  }
+
+  /*!
+  */
+  inline StacktraceView::StacktraceView() :
+    ValueView() {
+  }
+
+  inline StacktraceView::StacktraceView(const rapidjson::Value &json) :
+    ValueView(json) {
+  }
+
+  inline size_t StacktraceView::GetFrameCount() const {
+    const rapidjson::Value *frames = GetMember(JSON_ELEM_FRAMES);
+    if (frames == NULL || !frames->IsArray()) { return 0; }
+    return frames->Size();
+  }
+
+  inline FrameView StacktraceView::GetFrame(const size_t &index) const {
+    const rapidjson::Value *frames = GetMember(JSON_ELEM_FRAMES);
+    if (frames == NULL || !frames->IsArray() || index >= frames->Size()) { return FrameView(); }
+    return FrameView((*frames)[static_cast<rapidjson::SizeType>(index)]);
+  }
+
+  /*! @brief Copy the stacktrace into an owning Stacktrace
+  */
+  inline Stacktrace StacktraceView::ToStacktrace() const {
+    return (_json != NULL) ? Stacktrace(*_json) : Stacktrace();
+  }
+
+  /*!
+  */
+  inline ExceptionView::ExceptionView() :
+    ValueView() {
+  }
+
+  inline ExceptionView::ExceptionView(const rapidjson::Value &json) :
+    ValueView(json) {
+  }
+
+  inline StringView ExceptionView::GetType() const {
+    return GetString(JSON_ELEM_EXCEPTION_TYPE);
+  }
+
+  inline StringView ExceptionView::GetValue() const {
+    return GetString(JSON_ELEM_EXCEPTION_VALUE);
+  }
+
+  inline StringView ExceptionView::GetModule() const {
+    return GetString(JSON_ELEM_EXCEPTION_MODULE);
+  }
+
+  inline int ExceptionView::GetThreadId() const {
+    return ValueView::GetThreadId();
+  }
+
+  inline StacktraceView ExceptionView::GetStacktrace() const {
+    const rapidjson::Value *stacktrace = GetMember(JSON_ELEM_STACKTRACE);
+    return (stacktrace != NULL) ? StacktraceView(*stacktrace) : StacktraceView();
+  }
+
+  /*! @brief Copy the exception into an owning Exception
+  */
+  inline Exception ExceptionView::ToException() const {
+    return (_json != NULL) ? Exception(*_json) : Exception();
+  }
+
+  /*!
+  */
+  inline ThreadView::ThreadView() :
+    ValueView() {
+  }
+
+  inline ThreadView::ThreadView(const rapidjson::Value &json) :
+    ValueView(json) {
+  }
+
+  inline int ThreadView::GetThreadID() const {
+    return GetThreadId();
+  }
+
+  inline StringView ThreadView::GetName() const {
+    return GetString(JSON_ELEM_THREAD_NAME);
+  }
+
+  inline bool ThreadView::IsCrashed() const {
+    return GetBool(JSON_ELEM_THREAD_CRASHED, false);
+  }
+
+  inline bool ThreadView::IsCurrent() const {
+    return GetBool(JSON_ELEM_THREAD_CURRENT, false);
+  }
+
+  inline StacktraceView ThreadView::GetStacktrace() const {
+    const rapidjson::Value *stacktrace = GetMember(JSON_ELEM_STACKTRACE);
+    return (stacktrace != NULL) ? StacktraceView(*stacktrace) : StacktraceView();
+  }
+
+  /*! @brief Copy the thread into an owning Thread
+  */
+  inline Thread ThreadView::ToThread() const {
+    return (_json != NULL) ? Thread(*_json) : Thread();
+  }
+
+  /*!
+  */
+  inline EventView::EventView(char *buffer) :
+    ValueView() {
+    if (buffer == NULL) { return; }
+    _document.ParseInsitu(buffer);
+    if (!_document.HasParseError() && _document.IsObject()) {
+      _json = &_document;
+    }
+  }
+
+  inline bool EventView::IsValid() const {
+    return (_json != NULL);
+  }
+
+  inline StringView EventView::GetEventId() const {
+    return GetString(JSON_ELEM_EVENT_ID);
+  }
+
+  inline StringView EventView::GetLevel() const {
+    return GetString(JSON_ELEM_LEVEL);
+  }
+
+  inline StringView EventView::GetPlatform() const {
+    return GetString(JSON_ELEM_PLATFORM);
+  }
+
+  /*! @brief The message, written either as a string or as the message interface
+  */
+  inline StringView EventView::GetMessage() const {
+    const rapidjson::Value *message = GetMember(JSON_ELEM_MESSAGE);
+    if (message == NULL) { return StringView(); }
+    if (message->IsString()) { return ToStringView(*message); }
+    if (!message->IsObject()) { return StringView(); }
+
+    rapidjson::Value::ConstMemberIterator formatted = message->FindMember(JSON_ELEM_MESSAGE);
+    if (formatted == message->MemberEnd() || !formatted->value.IsString()) { return StringView(); }
+    return ToStringView(formatted->value);
+  }
+
+  inline size_t EventView::GetExceptionCount() const {
+    return GetElementCount(JSON_ELEM_EXCEPTION, JSON_ELEM_EXCEPTION_VALUES);
+  }
+
+  inline ExceptionView EventView::GetException(const size_t &index) const {
+    const rapidjson::Value *exception = GetElement(JSON_ELEM_EXCEPTION, JSON_ELEM_EXCEPTION_VALUES, index);
+    return (exception != NULL) ? ExceptionView(*exception) : ExceptionView();
+  }
+
+  inline size_t EventView::GetThreadCount() const {
+    return GetElementCount(JSON_ELEM_THREADS, JSON_ELEM_THREADS_VALUES);
+  }
+
+  inline ThreadView EventView::GetThread(const size_t &index) const {
+    const rapidjson::Value *thread = GetElement(JSON_ELEM_THREADS, JSON_ELEM_THREADS_VALUES, index);
+    return (thread != NULL) ? ThreadView(*thread) : ThreadView();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_EVENT_VIEW_H_
\ No newline at end of file
@@ -10,8 +10,8 @@
 #define SENTRY_EXCEPTION_H_
 #include "SentryStacktrace.h"
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -19,6 +19,7 @@
 namespace sentry {
 
   const char * const JSON_ELEM_EXCEPTION = "exception";
+  const char * const JSON_ELEM_EXCEPTION_VALUES = "values";
 
   const char * const JSON_ELEM_EXCEPTION_TYPE = "type";
   const char * const JSON_ELEM_EXCEPTION_VALUE = "value";
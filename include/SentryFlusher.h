@@ -0,0 +1,137 @@
+/********************************************//**
+* @file SentryFlusher.h
+* @brief Runs a flush on a background thread at a fixed interval
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_FLUSHER_H_
+#define SENTRY_FLUSHER_H_
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Calls a function every interval on its own thread, from Start() until Stop()
+  *   @details The owner stops the flusher at the top of its destructor, before
+  *   anything the function uses goes away.
+  */
+  class PeriodicFlusher {
+  public:
+    typedef std::function<void()> Function;
+
+    PeriodicFlusher(const Function &function, const std::chrono::milliseconds &interval);
+    ~PeriodicFlusher();
+
+    void Start();
+    void Stop();
+    bool IsRunning() const;
+
+    const std::chrono::milliseconds& GetInterval() const;
+
+  protected:
+    void Run();
+
+  private:
+    PeriodicFlusher(const PeriodicFlusher &other);
+    PeriodicFlusher& operator = (const PeriodicFlusher &other);
+
+    Function _function;
+    std::chrono::milliseconds _interval;
+
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _is_running;
+
+  }; // class PeriodicFlusher
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline PeriodicFlusher::PeriodicFlusher(const Function &function, const std::chrono::milliseconds &interval) :
+    _function(function), _interval(interval), _is_running(false) {
+  }
+
+  /*! @brief Stop, letting go of the thread if the function itself is being torn down
+  */
+  inline PeriodicFlusher::~PeriodicFlusher() {
+    Stop();
+    if (_thread.joinable()) {
+      _thread.detach();
+    }
+  }
+
+  inline void PeriodicFlusher::Start() {
+    // A thread that stopped itself from inside the function is still joinable
+    std::thread previous;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_is_running || !_function) { return; }
+      if (_thread.get_id() == std::this_thread::get_id()) { return; }
+      previous.swap(_thread);
+    }
+    if (previous.joinable()) {
+      previous.join();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_is_running || _thread.joinable()) { return; }
+    _is_running = true;
+    _thread = std::thread(&PeriodicFlusher::Run, this);
+  }
+
+  /*! @brief Wake the thread and join it
+  *   @details Called from inside the function, it only asks the thread to
+  *   stop: a thread cannot join itself. Start() or the destructor joins it.
+  */
+  inline void PeriodicFlusher::Stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _is_running = false;
+    }
+    _wake.notify_all();
+    if (_thread.joinable() && _thread.get_id() != std::this_thread::get_id()) {
+      _thread.join();
+    }
+  }
+
+  inline bool PeriodicFlusher::IsRunning() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _is_running;
+  }
+
+  inline const std::chrono::milliseconds& PeriodicFlusher::GetInterval() const {
+    return _interval;
+  }
+
+  /*! @brief Wait out the interval, then flush without holding the lock
+  */
+  inline void PeriodicFlusher::Run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_is_running) {
+      if (_wake.wait_for(lock, _interval, [this]() { return !_is_running; })) {
+        break;
+      }
+      lock.unlock();
+      _function();
+      lock.lock();
+    }
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_FLUSHER_H_
\ No newline at end of file
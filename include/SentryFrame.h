@@ -10,12 +10,12 @@
 #define SENTRY_FRAME_H_
 #include <string>
 #include <vector>
-#include <map>
 #include <stdio.h>
 #include "SentryAttributes.h"
+#include "SentrySmallMap.h"
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -44,6 +44,10 @@ namespace sentry {
   const char * const JSON_ELEM_SYMBOL_ADDR = "symbol_addr";
   const char * const JSON_ELEM_INSTRUCTION_OFFSET = "instruction_offset";
 
+  const size_t FRAME_INLINE_VARS = 1;   // Most frames have no vars; more than this spill to the heap
+
+  typedef SmallMap<std::string, FRAME_INLINE_VARS> FrameVarMap;
+
 } // namespace sentry
 
 /***********************************************
@@ -58,6 +62,9 @@ namespace sentry {
     Frame(const std::string &filename = std::string(), const std::string &function = std::string(), const std::string &module = std::string());
     Frame(const rapidjson::Value &json);
 
+    bool operator == (const Frame& other) const;
+    bool operator != (const Frame& other) const;
+
     bool IsValid() const;
 
     // Required Members
@@ -69,6 +76,24 @@ namespace sentry {
     int GetLineNumber() const;
     void SetLineNumber(const int &line_no);
 
+    const std::string& GetAbsPath() const;
+    void SetAbsPath(const std::string &abs_path);
+
+    const std::string& GetPackage() const;
+    void SetPackage(const std::string &package);
+
+    const std::string& GetImageAddr() const;
+    void SetImageAddr(const std::string &image_addr);
+
+    const std::string& GetInstructionAddr() const;
+    void SetInstructionAddr(const std::string &instruction_addr);
+
+    const std::string& GetContextLine() const;
+    const std::vector<std::string>& GetPreContext() const;
+    const std::vector<std::string>& GetPostContext() const;
+    void SetContext(const std::vector<std::string> &pre_context, const std::string &context_line, const std::vector<std::string> &post_context);
+    void ClearContext();
+
     bool IsInApp() const;
     void SetIsInApp(const bool &in_app);
 
@@ -91,7 +116,7 @@ namespace sentry {
     std::vector<std::string> _pre_context;   // A list of source code lines before context_line(in order)  usually[lineno - 5:lineno]
     std::vector<std::string> _post_context;  // A list of source code lines after context_line(in order)  usually[lineno + 1:lineno + 5]
     bool _in_app;           // Signifies whether this frame is related to the execution of the relevant code in this stacktrace.
-    std::map<std::string, std::string> _vars; // A mapping of variables which were available within this frame(usually context - locals).
+    FrameVarMap _vars; // A mapping of variables which were available within this frame(usually context - locals).
 
     std::string _package;
     std::string _platform;
@@ -123,6 +148,20 @@ namespace sentry {
     FromJson(json);
   }
 
+  /*! @brief Frames are equal when they describe the same code location
+  */
+  inline bool Frame::operator == (const Frame& other) const {
+    return (_lineno == other._lineno &&
+      _instruction_addr == other._instruction_addr &&
+      _function == other._function &&
+      _filename == other._filename &&
+      _module == other._module);
+  }
+
+  inline bool Frame::operator != (const Frame& other) const {
+    return !(operator==(other));
+  }
+
   /*! @brief Determine if the frame has the required information
   *   @details From API documentation - one of the three must exist
   */
@@ -154,6 +193,62 @@ namespace sentry {
     _lineno = line_no;
   }
 
+  inline const std::string & Frame::GetAbsPath() const {
+    return _abs_path;
+  }
+
+  inline void Frame::SetAbsPath(const std::string & abs_path) {
+    _abs_path = abs_path;
+  }
+
+  inline const std::string & Frame::GetPackage() const {
+    return _package;
+  }
+
+  inline void Frame::SetPackage(const std::string & package) {
+    _package = package;
+  }
+
+  inline const std::string & Frame::GetImageAddr() const {
+    return _image_addr;
+  }
+
+  inline void Frame::SetImageAddr(const std::string & image_addr) {
+    _image_addr = image_addr;
+  }
+
+  inline const std::string & Frame::GetInstructionAddr() const {
+    return _instruction_addr;
+  }
+
+  inline void Frame::SetInstructionAddr(const std::string & instruction_addr) {
+    _instruction_addr = instruction_addr;
+  }
+
+  inline const std::string & Frame::GetContextLine() const {
+    return _context_line;
+  }
+
+  inline const std::vector<std::string>& Frame::GetPreContext() const {
+    return _pre_context;
+  }
+
+  inline const std::vector<std::string>& Frame::GetPostContext() const {
+    return _post_context;
+  }
+
+  inline void Frame::SetContext(const std::vector<std::string>& pre_context, const std::string & context_line, const std::vector<std::string>& post_context) {
+    _pre_context = pre_context;
+    _context_line = context_line;
+    _post_context = post_context;
+  }
+
+  inline void Frame::ClearContext() {
+    _pre_context.clear();
+    _context_line.clear();
+    _post_context.clear();
+  }
+
   /*! @brief Construct from a JSON object
   */
   inline void Frame::FromJson(const rapidjson::Value & json) {
@@ -216,7 +311,7 @@ namespace sentry {
               value = str;
             }
 
-            _vars[key] = value;
+            _vars[key] = std::move(value);
           }
         }
       }
@@ -364,7 +459,7 @@ namespace sentry {
     } // module
 
     // Optional Members
-    if (_abs_path.empty()) {
+    if (!_abs_path.empty()) {
       rapidjson::Value abs_path(rapidjson::kStringType);
       abs_path.SetString(_abs_path.data(), static_cast<rapidjson::SizeType>(_abs_path.size()), allocator);
       doc.AddMember(rapidjson::StringRef(JSON_ELEM_ABS_PATH), abs_path, allocator);
@@ -10,11 +10,11 @@
 #define SENTRY_MESSAGE_H_
 #include <string>
 #include <iostream>
-#include <map>
 #include "SentryAttributes.h"
+#include "SentrySmallMap.h"
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -44,8 +44,8 @@ namespace sentry {
 
     const std::string& GetMessage() const;
     const std::string& GetFormatParams() const;
-    const std::map<std::string, std::string>& GetAdditionalFields() const;
-    void SetAdditionalFields(const std::map<std::string, std::string>& additional_fields);
+    const StringMap& GetAdditionalFields() const;
+    void SetAdditionalFields(const StringMap& additional_fields);
 
     void AddToJson(rapidjson::Document &doc) const;
 
@@ -56,7 +56,7 @@ namespace sentry {
   private:
     std::string _message;
     std::string _format_params;
-    std::map<std::string, std::string> _additional_fields;
+    StringMap _additional_fields;
 
   }; // class Message
 
@@ -89,11 +89,11 @@ namespace sentry {
     return _message;
   }
 
-  inline const std::map<std::string, std::string>& Message::GetAdditionalFields() const {
+  inline const StringMap& Message::GetAdditionalFields() const {
     return _additional_fields;
   }
 
-  inline void Message::SetAdditionalFields(const std::map<std::string, std::string>& additional_fields) {
+  inline void Message::SetAdditionalFields(const StringMap& additional_fields) {
     _additional_fields = additional_fields;
   }
 
@@ -146,7 +146,7 @@ namespace sentry {
         } else {
           if (strlen(member->name.GetString()) > 0) {
             if (member->value.IsString()) {
-              _additional_fields[member->name.GetString()] = member->value.GetString();
+              _additional_fields[StringView(member->name.GetString(), member->name.GetStringLength())].assign(member->value.GetString(), member->value.GetStringLength());
             }
           }
         }
@@ -0,0 +1,384 @@
+/********************************************//**
+* @file SentryMessageAggregator.h
+* @brief Counts repeated log messages and reports them as periodic summaries
+* @details https://docs.sentry.io/clientdev/interfaces/message/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_MESSAGE_AGGREGATOR_H_
+#define SENTRY_MESSAGE_AGGREGATOR_H_
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <stdint.h>
+
+#include "SentryAttributes.h"
+#include "SentryMessage.h"
+#include "SentryEvent.h"
+#include "SentryScope.h"
+#include "SentryBreadcrumbs.h"
+#include "SentryClient.h"
+#include "SentryFlusher.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t MESSAGE_AGGREGATOR_CAPACITY = 4096;  // Distinct templates per interval, power of two
+  const size_t MESSAGE_AGGREGATOR_WRITER_SLOTS = 16; // Writer counts per table; threads are spread over them
+  const size_t MESSAGE_AGGREGATOR_CACHE_LINE = 64;
+
+  const uint64_t MESSAGE_AGGREGATOR_EMPTY = 0;
+
+  const char * const JSON_ELEM_AGGREGATE_COUNT = "count";
+  const char * const JSON_ELEM_AGGREGATE_FIRST_SEEN = "first_seen";
+  const char * const JSON_ELEM_AGGREGATE_LAST_SEEN = "last_seen";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief One message template and its counters
+  *   @details The key is claimed with compare-and-swap by the first thread to
+  *   see the template, which then copies the message, sets the check hash and
+  *   sets is_ready. Later occurrences wait for is_ready, compare the check
+  *   hash, and then only touch the counters.
+  */
+  struct MessageAggregate {
+    std::atomic<uint64_t> key;
+    std::atomic<bool> is_ready;
+    uint64_t check;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> first_ms;
+    std::atomic<uint64_t> last_ms;
+    Message message;
+    attributes::Level level;
+  };
+
+  /*! @brief Threads recording into one table, padded so each count has a cache line to itself
+  */
+  struct MessageWriters {
+    std::atomic<uint32_t> count;
+    char padding[MESSAGE_AGGREGATOR_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+  };
+
+  /*! @brief Turns high-rate info and warning messages into one event per template per interval
+  *   @details Templates are keyed by a 64-bit hash of the message, its format
+  *   parameters and its level, and told apart within a key by a second,
+  *   independent 64-bit hash of the same, so recording never compares
+  *   strings. At each interval every template seen
+  *   since the last one is emitted as a single event with the count and the
+  *   first and last times it was seen. Other levels, and templates arriving
+  *   once the table is full, are left to the caller to capture as usual.
+  *   Given a client, the summaries go to it and every repeat folded into one
+  *   is counted as a duplicate in its counters.
+  *
+  *   There are two tables. Flush() points new records at the other one, waits
+  *   for the records still writing to the old one, then emits and empties it,
+  *   so templates last one interval and a full table frees up at the next.
+  */
+  class MessageAggregator {
+  public:
+    typedef std::function<void(Event &&event)> Emitter;
+
+    MessageAggregator(const Emitter &emitter, const std::chrono::milliseconds &interval = std::chrono::milliseconds(60000));
+    MessageAggregator(const Client &client, const std::chrono::milliseconds &interval = std::chrono::milliseconds(60000));
+    ~MessageAggregator();
+
+    static bool IsAggregated(const attributes::Level &level);
+    static uint64_t HashMessage(const Message &message, const attributes::Level &level);
+
+    bool Record(const Message &message, const attributes::Level &level);
+    size_t Flush();
+
+    void Start();
+    void Stop();
+
+    size_t GetTemplateCount() const;
+    uint64_t GetOverflowCount() const;
+
+  protected:
+    bool Record(const uint64_t &key, const uint64_t &check, const Message &message, const attributes::Level &level);
+    MessageAggregate* Find(const size_t &table, const uint64_t &key, const uint64_t &check, const Message &message, const attributes::Level &level);
+    static uint64_t HashMessage(const Message &message, const attributes::Level &level, uint64_t &check);
+    static size_t GetWriterSlot();
+    static void Reset(MessageAggregate &aggregate);
+    Event MakeEvent(const MessageAggregate &aggregate, const uint64_t &count, const uint64_t &first_ms, const uint64_t &last_ms) const;
+
+  private:
+    MessageAggregator(const MessageAggregator &other);
+    MessageAggregator& operator = (const MessageAggregator &other);
+
+    Emitter _emitter;
+    std::unique_ptr<Client> _client;          // Set when the summaries go to a client
+    std::unique_ptr<MessageAggregate[]> _tables[2];
+    std::atomic<size_t> _active;              // The table taking new records
+    MessageWriters _writers[2][MESSAGE_AGGREGATOR_WRITER_SLOTS];    // Records in progress on each table
+    std::atomic<size_t> _template_count[2];
+    std::atomic<uint64_t> _overflow;
+
+    std::mutex _flush_mutex;
+    PeriodicFlusher _flusher;
+
+  }; // class MessageAggregator
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline MessageAggregator::MessageAggregator(const Emitter &emitter, const std::chrono::milliseconds &interval) :
+    _emitter(emitter),
+    _active(0), _overflow(0),
+    _flusher([this]() { Flush(); }, interval) {
+    for (size_t t = 0; t < 2; ++t) {
+      _tables[t].reset(new MessageAggregate[MESSAGE_AGGREGATOR_CAPACITY]);
+      for (size_t i = 0; i < MESSAGE_AGGREGATOR_WRITER_SLOTS; ++i) {
+        _writers[t][i].count.store(0, std::memory_order_relaxed);
+      }
+      _template_count[t].store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < MESSAGE_AGGREGATOR_CAPACITY; ++i) {
+        Reset(_tables[t][i]);
+      }
+    }
+  }
+
+  /*! @brief Capture the summaries with a client, which also counts the duplicates
+  */
+  inline MessageAggregator::MessageAggregator(const Client &client, const std::chrono::milliseconds &interval) :
+    MessageAggregator(Emitter(), interval) {
+    _client.reset(new Client(client));
+    _emitter = [this](Event &&event) { _client->Capture(std::move(event)); };
+  }
+
+  /*! @brief Stop the interval thread and emit what is left
+  */
+  inline MessageAggregator::~MessageAggregator() {
+    Stop();
+    Flush();
+  }
+
+  inline bool MessageAggregator::IsAggregated(const attributes::Level &level) {
+    return (level == attributes::Level(attributes::Level::LEVEL_INFO) ||
+      level == attributes::Level(attributes::Level::LEVEL_WARNING));
+  }
+
+  /*! @brief The key of a template; never returns the empty key
+  */
+  inline uint64_t MessageAggregator::HashMessage(const Message &message, const attributes::Level &level) {
+    uint64_t check = 0;
+    return HashMessage(message, level, check);
+  }
+
+  /*! @brief FNV-1a over the template for the key, and a multiply-xorshift hash for the check
+  *   @details Both are taken in the same pass over the strings.
+  */
+  inline uint64_t MessageAggregator::HashMessage(const Message &message, const attributes::Level &level, uint64_t &check) {
+    uint64_t hash = 14695981039346656037ULL;
+    check = 0x9E3779B97F4A7C15ULL;
+    const std::string *parts[] = { &message.GetMessage(), &message.GetFormatParams() };
+    for (size_t i = 0; i < 2; ++i) {
+      for (size_t j = 0; j < parts[i]->size(); ++j) {
+        const unsigned char c = static_cast<unsigned char>((*parts[i])[j]);
+        hash = (hash ^ c) * 1099511628211ULL;
+        check = (check + c + 1) * 0xBF58476D1CE4E5B9ULL;
+        check ^= check >> 31;
+      }
+      hash = (hash ^ 0x1F) * 1099511628211ULL;  // Keeps "ab"+"c" apart from "a"+"bc"
+      check = (check ^ 0x1F) * 0x94D049BB133111EBULL;
+    }
+    unsigned char rank = 0;
+    for (int value = attributes::Level::LEVEL_DEBUG; value <= attributes::Level::LEVEL_FATAL; ++value) {
+      if (attributes::Level(static_cast<attributes::Level::LevelEnum>(value)) < level) { ++rank; }
+    }
+    hash = (hash ^ rank) * 1099511628211ULL;
+    check = (check + rank) * 0x94D049BB133111EBULL;
+    check ^= check >> 29;
+    return (hash != MESSAGE_AGGREGATOR_EMPTY) ? hash : 1;
+  }
+
+  /*! @brief The writer count the calling thread uses, handed out in turn
+  */
+  inline size_t MessageAggregator::GetWriterSlot() {
+    static std::atomic<size_t> next(0);
+    static thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed) % MESSAGE_AGGREGATOR_WRITER_SLOTS;
+    return slot;
+  }
+
+  /*! @brief Empty a slot; only called when no record can reach its table
+  */
+  inline void MessageAggregator::Reset(MessageAggregate &aggregate) {
+    aggregate.is_ready.store(false, std::memory_order_relaxed);
+    aggregate.check = 0;
+    aggregate.count.store(0, std::memory_order_relaxed);
+    aggregate.first_ms.store(0, std::memory_order_relaxed);
+    aggregate.last_ms.store(0, std::memory_order_relaxed);
+    aggregate.message = Message();
+    aggregate.level = attributes::Level();
+    aggregate.key.store(MESSAGE_AGGREGATOR_EMPTY, std::memory_order_release);
+  }
+
+  /*! @brief The aggregate for a template, claiming a free one for a new template
+  *   @details A slot with the same key may still be copying its message, so
+  *   the check hash is compared only once is_ready is set. Different
+  *   templates that share a key take separate slots.
+  *   @return NULL if the table is full
+  */
+  inline MessageAggregate* MessageAggregator::Find(const size_t &table, const uint64_t &key, const uint64_t &check, const Message &message, const attributes::Level &level) {
+    const size_t mask = MESSAGE_AGGREGATOR_CAPACITY - 1;
+    for (size_t probe = 0; probe < MESSAGE_AGGREGATOR_CAPACITY; ++probe) {
+      MessageAggregate &aggregate = _tables[table][(static_cast<size_t>(key) + probe) & mask];
+      uint64_t current = aggregate.key.load(std::memory_order_acquire);
+      if (current == MESSAGE_AGGREGATOR_EMPTY) {
+        if (aggregate.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+          aggregate.message = message;
+          aggregate.level = level;
+          aggregate.check = check;
+          aggregate.is_ready.store(true, std::memory_order_release);
+          _template_count[table].fetch_add(1, std::memory_order_relaxed);
+          return &aggregate;
+        }
+      }
+      if (current != key) { continue; }
+
+      while (!aggregate.is_ready.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      if (aggregate.check == check) {
+        return &aggregate;
+      }
+    }
+    return NULL;
+  }
+
+  /*! @brief Count one occurrence of a message
+  *   @return false if the caller should capture the message itself
+  */
+  inline bool MessageAggregator::Record(const Message &message, const attributes::Level &level) {
+    if (!IsAggregated(level) || !message.IsValid()) { return false; }
+    uint64_t check = 0;
+    const uint64_t key = HashMessage(message, level, check);
+    return Record(key, check, message, level);
+  }
+
+  /*! @brief Count one occurrence under a given key and check hash
+  *   @details Registers as a writer of the active table first, and retries if
+  *   Flush() switched tables in between, so Flush() never empties a table
+  *   that a record is still using. Threads register on separate writer
+  *   counts, so concurrent records do not share a cache line to do it.
+  */
+  inline bool MessageAggregator::Record(const uint64_t &key, const uint64_t &check, const Message &message, const attributes::Level &level) {
+    const size_t slot = GetWriterSlot();
+    size_t table = _active.load();
+    for (;;) {
+      _writers[table][slot].count.fetch_add(1);
+      const size_t active = _active.load();
+      if (active == table) { break; }
+      _writers[table][slot].count.fetch_sub(1);
+      table = active;
+    }
+    std::atomic<uint32_t> &writers = _writers[table][slot].count;
+
+    MessageAggregate *aggregate = Find(table, key, check, message, level);
+    if (aggregate == NULL) {
+      writers.fetch_sub(1, std::memory_order_release);
+      _overflow.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    const uint64_t now = Breadcrumbs::CoarseNow();
+    if (aggregate->count.fetch_add(1, std::memory_order_relaxed) == 0) {
+      uint64_t first = 0;
+      aggregate->first_ms.compare_exchange_strong(first, now, std::memory_order_relaxed);
+    }
+    else if (_client) {
+      _client->GetCounters().AddDiscarded(DISCARD_DUPLICATE, CATEGORY_ERROR);
+    }
+    aggregate->last_ms.store(now, std::memory_order_relaxed);
+    writers.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /*! @brief Emit one event for each template seen since the last flush, then forget them
+  *   @return the number of events emitted
+  */
+  inline size_t MessageAggregator::Flush() {
+    std::lock_guard<std::mutex> lock(_flush_mutex);
+
+    const size_t table = _active.load();
+    _active.store(1 - table);
+    for (size_t i = 0; i < MESSAGE_AGGREGATOR_WRITER_SLOTS; ++i) {
+      while (_writers[table][i].count.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+    }
+
+    size_t emitted = 0;
+    for (size_t i = 0; i < MESSAGE_AGGREGATOR_CAPACITY; ++i) {
+      MessageAggregate &aggregate = _tables[table][i];
+      if (aggregate.key.load(std::memory_order_acquire) == MESSAGE_AGGREGATOR_EMPTY) { continue; }
+
+      const uint64_t count = aggregate.count.load(std::memory_order_relaxed);
+      if (count > 0 && _emitter) {
+        _emitter(MakeEvent(aggregate, count, aggregate.first_ms.load(std::memory_order_relaxed), aggregate.last_ms.load(std::memory_order_relaxed)));
+      }
+      emitted += (count > 0) ? 1 : 0;
+      Reset(aggregate);
+    }
+    _template_count[table].store(0, std::memory_order_relaxed);
+    return emitted;
+  }
+
+  /*! @brief A summary event: the message, its level and the counters under extra
+  */
+  inline Event MessageAggregator::MakeEvent(const MessageAggregate &aggregate, const uint64_t &count, const uint64_t &first_ms, const uint64_t &last_ms) const {
+    Event event(aggregate.level);
+    event.Add(aggregate.message);
+
+    rapidjson::Document::AllocatorType &allocator = event.GetAllocator();
+    rapidjson::Value extra(rapidjson::kObjectType);
+    extra.AddMember(rapidjson::StringRef(JSON_ELEM_AGGREGATE_COUNT), count, allocator);
+    extra.AddMember(rapidjson::StringRef(JSON_ELEM_AGGREGATE_FIRST_SEEN), static_cast<double>((first_ms != 0) ? first_ms : last_ms) / 1000.0, allocator);
+    extra.AddMember(rapidjson::StringRef(JSON_ELEM_AGGREGATE_LAST_SEEN), static_cast<double>(last_ms) / 1000.0, allocator);
+    event.GetDocument().AddMember(rapidjson::StringRef(JSON_ELEM_EXTRA), extra, allocator);
+    return event;
+  }
+
+  /*! @brief Flush every interval on a background thread until Stop()
+  */
+  inline void MessageAggregator::Start() {
+    _flusher.Start();
+  }
+
+  inline void MessageAggregator::Stop() {
+    _flusher.Stop();
+  }
+
+  /*! @brief Distinct templates seen since the last flush
+  */
+  inline size_t MessageAggregator::GetTemplateCount() const {
+    return _template_count[_active.load()].load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Messages handed back to the caller because the table was full
+  */
+  inline uint64_t MessageAggregator::GetOverflowCount() const {
+    return _overflow.load(std::memory_order_relaxed);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_MESSAGE_AGGREGATOR_H_
@@ -0,0 +1,904 @@
+/********************************************//**
+* @file SentryMetrics.h
+* @brief Counters, gauges, distributions and sets aggregated in process
+* @details https://develop.sentry.dev/sdk/metrics/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_METRICS_H_
+#define SENTRY_METRICS_H_
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+#include "SentryStringView.h"
+#include "SentrySmallMap.h"
+#include "SentryEnvelope.h"
+#include "SentryFlusher.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t METRICS_SHARD_COUNT = 16;          // Power of two
+  const size_t METRICS_WRITER_SLOTS = 16;         // Writer counts per table; threads are spread over them
+  const size_t METRICS_CACHE_LINE = 64;
+  const size_t METRICS_SHARD_CAPACITY = 256;      // Series per shard, power of two
+  const int64_t METRICS_BUCKET_SECONDS = 10;
+
+  const uint64_t METRICS_SERIES_EMPTY = 0;
+
+  const size_t DISTRIBUTION_BINS = 2048;          // Each sign, centred on 1.0; about 2e-18 to 5e17 at 2%
+  const double DISTRIBUTION_ACCURACY = 0.02;      // Relative error of a reported value
+  const size_t DISTRIBUTION_OUTLIERS = 16;        // Values past the largest bin kept exactly per bucket
+  const size_t DISTRIBUTION_SAMPLES = 256;        // Values sent per bucket at most
+
+  const size_t HYPERLOGLOG_PRECISION = 10;        // 2^10 one-byte registers
+  const size_t SET_SAMPLE_MEMBERS = 1024;         // Members sent per set and bucket at most, power of two
+
+  const char * const METRICS_ITEM_TYPE = "statsd";
+  const char * const METRICS_DEFAULT_UNIT = "none";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief The statsd type of a metric
+  */
+  enum MetricType {
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_DISTRIBUTION,
+    METRIC_SET
+  };
+
+  /*! @brief Values in logarithmic bins, each within the configured relative error
+  *   @details Memory is fixed no matter how many values are added. Values
+  *   below the smallest bin count as zero. The first few values past the
+  *   largest bin are kept exactly; any more are clamped to it.
+  */
+  class DistributionSketch {
+  public:
+    DistributionSketch();
+
+    void Add(const double &value);
+    uint64_t GetCount() const;
+    bool TakeValues(std::vector<double> &values, const size_t &max_values);
+
+    static double GetBinValue(const size_t &bin);
+
+  protected:
+    static size_t GetBin(const double &magnitude);
+    static double GetGamma();
+    static double GetLargestMagnitude();
+
+  private:
+    DistributionSketch(const DistributionSketch &other);
+    DistributionSketch& operator = (const DistributionSketch &other);
+
+    std::atomic<uint32_t> _positive[DISTRIBUTION_BINS];
+    std::atomic<uint32_t> _negative[DISTRIBUTION_BINS];
+    std::atomic<uint64_t> _zero;
+    std::atomic<uint64_t> _outliers[DISTRIBUTION_OUTLIERS];   // Doubles, stored as their bits
+    std::atomic<uint32_t> _outlier_count;
+
+  }; // class DistributionSketch
+
+  /*! @brief A HyperLogLog estimate of distinct members
+  */
+  class HyperLogLog {
+  public:
+    HyperLogLog();
+
+    void Add(const uint64_t &hash);
+    uint64_t TakeEstimate();
+
+  private:
+    HyperLogLog(const HyperLogLog &other);
+    HyperLogLog& operator = (const HyperLogLog &other);
+
+    std::atomic<uint8_t> _registers[static_cast<size_t>(1) << HYPERLOGLOG_PRECISION];
+
+  }; // class HyperLogLog
+
+  /*! @brief The distinct members of a set as 32-bit hashes, up to a fixed number
+  *   @details Members past the limit are dropped, and the sample remembers
+  *   that it is no longer the whole set.
+  */
+  class SetSample {
+  public:
+    SetSample();
+
+    void Add(const uint32_t &member);
+    bool TakeMembers(std::vector<uint32_t> &members);
+
+  private:
+    SetSample(const SetSample &other);
+    SetSample& operator = (const SetSample &other);
+
+    std::atomic<uint32_t> _members[SET_SAMPLE_MEMBERS];   // Zero is a free slot
+    std::atomic<bool> _has_zero;
+    std::atomic<bool> _is_truncated;
+
+  }; // class SetSample
+
+  /*! @brief The values one series collects in one bucket
+  */
+  struct MetricValues {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;        // Doubles, stored as their bits
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> last;
+    std::unique_ptr<DistributionSketch> distribution;
+    std::unique_ptr<HyperLogLog> set;
+    std::unique_ptr<SetSample> members;
+  };
+
+  /*! @brief Threads recording into one table, padded so each count has a cache line to itself
+  */
+  struct MetricWriters {
+    std::atomic<uint32_t> count;
+    char padding[METRICS_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+  };
+
+  /*! @brief One (type, name, unit, tags) series in one bucket
+  *   @details The key is claimed with compare-and-swap by the first thread to
+  *   record the series, which fills in the rest and then sets is_ready.
+  *   Later records wait for is_ready and compare the series before using it.
+  */
+  struct MetricSeries {
+    std::atomic<uint64_t> key;
+    std::atomic<bool> is_ready;
+    MetricType type;
+    std::string name;
+    std::string unit;
+    StringMap tags;
+    MetricValues values;
+  };
+
+  /*! @brief Aggregates metrics in process and sends them as statsd lines
+  *   @details Series live in sharded open-addressing tables and are found
+  *   without locks. Recording is a handful of atomic operations on the
+  *   series, bracketed by a writer count that a flush waits on. Each thread
+  *   keeps to one of several writer counts, each on its own cache line, so
+  *   threads do not share one line just to announce themselves. There are
+  *   two tables, one per bucket: every interval the
+  *   current one is closed, each of its series is written into one statsd
+  *   envelope item, and the table is emptied for the bucket after next. A
+  *   series therefore only takes a slot in buckets it was recorded in.
+  */
+  class MetricsAggregator {
+  public:
+    typedef std::function<void(const std::string &envelope)> Sink;
+
+    MetricsAggregator(const Sink &sink, const std::chrono::milliseconds &interval = std::chrono::milliseconds(METRICS_BUCKET_SECONDS * 1000));
+    ~MetricsAggregator();
+
+    bool Increment(const StringView &name, const double &value = 1.0, const StringView &unit = METRICS_DEFAULT_UNIT, const StringMap &tags = StringMap());
+    bool Gauge(const StringView &name, const double &value, const StringView &unit = METRICS_DEFAULT_UNIT, const StringMap &tags = StringMap());
+    bool Distribution(const StringView &name, const double &value, const StringView &unit = METRICS_DEFAULT_UNIT, const StringMap &tags = StringMap());
+    bool Set(const StringView &name, const StringView &member, const StringView &unit = METRICS_DEFAULT_UNIT, const StringMap &tags = StringMap());
+
+    size_t Flush();
+
+    void Start();
+    void Stop();
+
+    size_t GetSeriesCount() const;
+    uint64_t GetOverflowCount() const;
+
+    static uint64_t HashSeries(const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags);
+    static uint64_t HashString(const StringView &value, uint64_t hash = 14695981039346656037ULL);
+
+  protected:
+    MetricValues* Begin(const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags, std::atomic<uint32_t> *&writers);
+    MetricSeries* Find(const uint32_t &epoch, const uint64_t &key, const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags);
+    bool AppendLine(std::string &payload, const MetricSeries &series, MetricValues &values, const int64_t &timestamp);
+    static void AppendSummary(std::string &payload, const double &last, const double &min, const double &max, const double &sum, const double &count);
+    static void AddToSummary(MetricValues &values, const double &value);
+    static void ResetSeries(MetricSeries &series);
+    static size_t GetShard(const uint64_t &key);
+    static size_t GetWriterSlot();
+
+    static void AppendSeries(std::string &payload, const MetricSeries &series);
+    static void AppendSuffix(std::string &payload, const MetricSeries &series, const char *type, const int64_t &timestamp);
+    static void AppendName(std::string &payload, const std::string &name);
+    static void AppendNumber(std::string &payload, const double &value);
+    static void ResetValues(MetricValues &values);
+
+    static uint64_t DoubleToBits(const double &value);
+    static double BitsToDouble(const uint64_t &bits);
+    static int64_t CurrentBucketStart();
+
+  private:
+    MetricsAggregator(const MetricsAggregator &other);
+    MetricsAggregator& operator = (const MetricsAggregator &other);
+
+    Sink _sink;
+    std::unique_ptr<MetricSeries[]> _series[2];
+    MetricWriters _writers[2][METRICS_WRITER_SLOTS];
+    std::atomic<size_t> _series_count[2];
+    std::atomic<uint64_t> _overflow;
+
+    std::atomic<uint32_t> _epoch;     // Which of the two tables is being written
+    int64_t _bucket_start;            // Seconds; guarded by _flush_mutex
+
+    std::mutex _flush_mutex;
+    PeriodicFlusher _flusher;
+
+  }; // class MetricsAggregator
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline DistributionSketch::DistributionSketch() :
+    _zero(0), _outlier_count(0) {
+    for (size_t i = 0; i < DISTRIBUTION_BINS; ++i) {
+      _positive[i].store(0, std::memory_order_relaxed);
+      _negative[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < DISTRIBUTION_OUTLIERS; ++i) {
+      _outliers[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline double DistributionSketch::GetGamma() {
+    return (1.0 + DISTRIBUTION_ACCURACY) / (1.0 - DISTRIBUTION_ACCURACY);
+  }
+
+  /*! @brief The bin holding a magnitude, with 1.0 in the middle bin
+  */
+  inline size_t DistributionSketch::GetBin(const double &magnitude) {
+    static const double log_gamma = std::log(GetGamma());
+    double index = std::ceil(std::log(magnitude) / log_gamma) + static_cast<double>(DISTRIBUTION_BINS / 2);
+    if (index < 1.0) { return 1; }
+    if (index > static_cast<double>(DISTRIBUTION_BINS - 1)) { return DISTRIBUTION_BINS - 1; }
+    return static_cast<size_t>(index);
+  }
+
+  /*! @brief The value reported for a bin, within the relative error of all it holds
+  */
+  inline double DistributionSketch::GetBinValue(const size_t &bin) {
+    const double gamma = GetGamma();
+    return 2.0 * std::pow(gamma, static_cast<double>(bin) - static_cast<double>(DISTRIBUTION_BINS / 2)) / (gamma + 1.0);
+  }
+
+  /*! @brief The upper edge of the largest bin
+  */
+  inline double DistributionSketch::GetLargestMagnitude() {
+    static const double largest = std::pow(GetGamma(), static_cast<double>(DISTRIBUTION_BINS - 1) - static_cast<double>(DISTRIBUTION_BINS / 2));
+    return largest;
+  }
+
+  inline void DistributionSketch::Add(const double &value) {
+    const double magnitude = std::fabs(value);
+    if (!(magnitude > GetBinValue(0))) {
+      _zero.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (magnitude > GetLargestMagnitude()) {
+      const uint32_t outlier = _outlier_count.fetch_add(1, std::memory_order_relaxed);
+      if (outlier < DISTRIBUTION_OUTLIERS) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        _outliers[outlier].store(bits, std::memory_order_relaxed);
+        return;
+      }
+    }
+    std::atomic<uint32_t> *bins = (value > 0.0) ? _positive : _negative;
+    bins[GetBin(magnitude)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  inline uint64_t DistributionSketch::GetCount() const {
+    uint64_t count = _zero.load(std::memory_order_relaxed);
+    count += std::min<uint64_t>(_outlier_count.load(std::memory_order_relaxed), DISTRIBUTION_OUTLIERS);
+    for (size_t i = 0; i < DISTRIBUTION_BINS; ++i) {
+      count += _positive[i].load(std::memory_order_relaxed) + _negative[i].load(std::memory_order_relaxed);
+    }
+    return count;
+  }
+
+  /*! @brief Empty the sketch into a list of values in ascending order
+  *   @details Up to max_values every value is reported. Beyond that the list
+  *   holds evenly spaced quantiles, which keeps the shape of the distribution
+  *   but not its count.
+  *   @return false if the values were collapsed into quantiles
+  */
+  inline bool DistributionSketch::TakeValues(std::vector<double> &values, const size_t &max_values) {
+    std::vector<double> outliers;
+    const uint32_t outlier_count = std::min<uint32_t>(_outlier_count.exchange(0, std::memory_order_relaxed), DISTRIBUTION_OUTLIERS);
+    for (uint32_t i = 0; i < outlier_count; ++i) {
+      const uint64_t bits = _outliers[i].exchange(0, std::memory_order_relaxed);
+      double outlier;
+      memcpy(&outlier, &bits, sizeof(outlier));
+      outliers.push_back(outlier);
+    }
+    std::sort(outliers.begin(), outliers.end());
+    const size_t negative_outliers = static_cast<size_t>(std::lower_bound(outliers.begin(), outliers.end(), 0.0) - outliers.begin());
+
+    std::vector<std::pair<double, uint64_t> > bins;
+    for (size_t i = 0; i < negative_outliers; ++i) {
+      bins.push_back(std::make_pair(outliers[i], 1));
+    }
+    for (size_t i = DISTRIBUTION_BINS; i-- > 0;) {
+      uint32_t count = _negative[i].exchange(0, std::memory_order_relaxed);
+      if (count != 0) { bins.push_back(std::make_pair(-GetBinValue(i), count)); }
+    }
+    uint64_t zero = _zero.exchange(0, std::memory_order_relaxed);
+    if (zero != 0) { bins.push_back(std::make_pair(0.0, zero)); }
+    for (size_t i = 0; i < DISTRIBUTION_BINS; ++i) {
+      uint32_t count = _positive[i].exchange(0, std::memory_order_relaxed);
+      if (count != 0) { bins.push_back(std::make_pair(GetBinValue(i), count)); }
+    }
+    for (size_t i = negative_outliers; i < outliers.size(); ++i) {
+      bins.push_back(std::make_pair(outliers[i], 1));
+    }
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < bins.size(); ++i) {
+      total += bins[i].second;
+    }
+    if (total == 0) { return true; }
+    if (max_values == 0) { return false; }
+
+    if (total <= max_values) {
+      for (size_t i = 0; i < bins.size(); ++i) {
+        values.insert(values.end(), static_cast<size_t>(bins[i].second), bins[i].first);
+      }
+      return true;
+    }
+
+    size_t bin = 0;
+    uint64_t seen = bins[0].second;
+    for (size_t i = 0; i < max_values; ++i) {
+      const uint64_t rank = (total * (2 * i + 1)) / (2 * max_values);
+      while (rank >= seen && bin + 1 < bins.size()) {
+        seen += bins[++bin].second;
+      }
+      values.push_back(bins[bin].first);
+    }
+    return false;
+  }
+
+  /*!
+  */
+  inline HyperLogLog::HyperLogLog() {
+    for (size_t i = 0; i < (static_cast<size_t>(1) << HYPERLOGLOG_PRECISION); ++i) {
+      _registers[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /*! @brief Count a member by its 64-bit hash
+  */
+  inline void HyperLogLog::Add(const uint64_t &hash) {
+    const size_t index = static_cast<size_t>(hash >> (64 - HYPERLOGLOG_PRECISION));
+    uint64_t rest = (hash << HYPERLOGLOG_PRECISION) | (static_cast<uint64_t>(1) << (HYPERLOGLOG_PRECISION - 1));
+    uint8_t rank = 1;
+    while ((rest & 0x8000000000000000ULL) == 0) {
+      rest <<= 1;
+      ++rank;
+    }
+
+    uint8_t current = _registers[index].load(std::memory_order_relaxed);
+    while (current < rank && !_registers[index].compare_exchange_weak(current, rank, std::memory_order_relaxed)) {}
+  }
+
+  /*! @brief Estimate the number of distinct members and clear the registers
+  */
+  inline uint64_t HyperLogLog::TakeEstimate() {
+    const size_t count = static_cast<size_t>(1) << HYPERLOGLOG_PRECISION;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t rank = _registers[i].exchange(0, std::memory_order_relaxed);
+      sum += std::ldexp(1.0, -static_cast<int>(rank));
+      if (rank == 0) { ++zeros; }
+    }
+
+    const double m = static_cast<double>(count);
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros != 0) {
+      estimate = m * std::log(m / static_cast<double>(zeros));  // Linear counting for small sets
+    }
+    return static_cast<uint64_t>(estimate + 0.5);
+  }
+
+  /*!
+  */
+  inline SetSample::SetSample() :
+    _has_zero(false), _is_truncated(false) {
+    for (size_t i = 0; i < SET_SAMPLE_MEMBERS; ++i) {
+      _members[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /*! @brief Keep a member unless the sample is full
+  */
+  inline void SetSample::Add(const uint32_t &member) {
+    if (member == 0) {
+      _has_zero.store(true, std::memory_order_relaxed);
+      return;
+    }
+
+    const size_t mask = SET_SAMPLE_MEMBERS - 1;
+    for (size_t probe = 0; probe < SET_SAMPLE_MEMBERS; ++probe) {
+      std::atomic<uint32_t> &slot = _members[(static_cast<size_t>(member) + probe) & mask];
+      uint32_t current = slot.load(std::memory_order_relaxed);
+      if (current == 0 && slot.compare_exchange_strong(current, member, std::memory_order_relaxed)) { return; }
+      if (current == member) { return; }
+    }
+    _is_truncated.store(true, std::memory_order_relaxed);
+  }
+
+  /*! @brief Empty the sample into a list of members
+  *   @return false if members were dropped, so the list is not the whole set
+  */
+  inline bool SetSample::TakeMembers(std::vector<uint32_t> &members) {
+    if (_has_zero.exchange(false, std::memory_order_relaxed)) {
+      members.push_back(0);
+    }
+    for (size_t i = 0; i < SET_SAMPLE_MEMBERS; ++i) {
+      const uint32_t member = _members[i].exchange(0, std::memory_order_relaxed);
+      if (member != 0) {
+        members.push_back(member);
+      }
+    }
+    return !_is_truncated.exchange(false, std::memory_order_relaxed);
+  }
+
+  /*!
+  */
+  inline MetricsAggregator::MetricsAggregator(const Sink &sink, const std::chrono::milliseconds &interval) :
+    _sink(sink),
+    _overflow(0), _epoch(0), _bucket_start(CurrentBucketStart()),
+    _flusher([this]() { Flush(); }, interval) {
+    for (size_t t = 0; t < 2; ++t) {
+      _series[t].reset(new MetricSeries[METRICS_SHARD_COUNT * METRICS_SHARD_CAPACITY]);
+      _series_count[t].store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < METRICS_WRITER_SLOTS; ++i) {
+        _writers[t][i].count.store(0, std::memory_order_relaxed);
+      }
+      for (size_t i = 0; i < METRICS_SHARD_COUNT * METRICS_SHARD_CAPACITY; ++i) {
+        ResetSeries(_series[t][i]);
+      }
+    }
+  }
+
+  /*! @brief Stop the interval thread and send what is left
+  */
+  inline MetricsAggregator::~MetricsAggregator() {
+    Stop();
+    Flush();
+  }
+
+  inline uint64_t MetricsAggregator::HashString(const StringView &value, uint64_t hash) {
+    for (size_t i = 0; i < value.size(); ++i) {
+      hash = (hash ^ static_cast<unsigned char>(value.data()[i])) * 1099511628211ULL;
+    }
+    return (hash ^ 0x1F) * 1099511628211ULL;
+  }
+
+  /*! @brief FNV-1a over the type, name, unit and sorted tags; never the empty key
+  */
+  inline uint64_t MetricsAggregator::HashSeries(const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags) {
+    uint64_t hash = (14695981039346656037ULL ^ static_cast<uint64_t>(type)) * 1099511628211ULL;
+    hash = HashString(unit, HashString(name, hash));
+    for (StringMap::const_iterator tag = tags.begin(); tag != tags.end(); ++tag) {
+      hash = HashString(tag->second, HashString(tag->first, hash));
+    }
+    return (hash != METRICS_SERIES_EMPTY) ? hash : 1;
+  }
+
+  inline size_t MetricsAggregator::GetShard(const uint64_t &key) {
+    return static_cast<size_t>(key >> 60) % METRICS_SHARD_COUNT;
+  }
+
+  /*! @brief The writer count the calling thread uses, handed out in turn
+  */
+  inline size_t MetricsAggregator::GetWriterSlot() {
+    static std::atomic<size_t> next(0);
+    static thread_local const size_t slot = next.fetch_add(1, std::memory_order_relaxed) % METRICS_WRITER_SLOTS;
+    return slot;
+  }
+
+  /*! @brief The series in one table, claiming a free slot for a new series
+  *   @details Series whose keys collide take separate slots.
+  *   @return NULL if the key's shard is full
+  */
+  inline MetricSeries* MetricsAggregator::Find(const uint32_t &epoch, const uint64_t &key, const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags) {
+    MetricSeries *shard = &_series[epoch][GetShard(key) * METRICS_SHARD_CAPACITY];
+    const size_t mask = METRICS_SHARD_CAPACITY - 1;
+    for (size_t probe = 0; probe < METRICS_SHARD_CAPACITY; ++probe) {
+      MetricSeries &series = shard[(static_cast<size_t>(key) + probe) & mask];
+      uint64_t current = series.key.load(std::memory_order_acquire);
+      if (current == METRICS_SERIES_EMPTY) {
+        if (series.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+          series.type = type;
+          series.name = name.ToString();
+          series.unit = unit.ToString();
+          series.tags = tags;
+          if (type == METRIC_DISTRIBUTION && !series.values.distribution) {
+            series.values.distribution.reset(new DistributionSketch());
+          }
+          if (type == METRIC_SET && !series.values.set) {
+            series.values.set.reset(new HyperLogLog());
+            series.values.members.reset(new SetSample());
+          }
+          series.is_ready.store(true, std::memory_order_release);
+          _series_count[epoch].fetch_add(1, std::memory_order_relaxed);
+          return &series;
+        }
+      }
+      if (current != key) { continue; }
+
+      // Claimed a moment ago by another thread, which may still be filling it in
+      while (!series.is_ready.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      if (series.type == type && StringView(series.name) == name && StringView(series.unit) == unit && series.tags == tags) {
+        return &series;
+      }
+    }
+    return NULL;
+  }
+
+  /*! @brief The values to write into, announced so a flush waits for the write
+  *   @details Release the returned writers count once the values are written.
+  */
+  inline MetricValues* MetricsAggregator::Begin(const MetricType &type, const StringView &name, const StringView &unit, const StringMap &tags, std::atomic<uint32_t> *&writers) {
+    const uint64_t key = HashSeries(type, name, unit, tags);
+    const size_t slot = GetWriterSlot();
+
+    uint32_t epoch = _epoch.load();
+    for (;;) {
+      _writers[epoch][slot].count.fetch_add(1);
+      const uint32_t current = _epoch.load();
+      if (current == epoch) { break; }
+      _writers[epoch][slot].count.fetch_sub(1);
+      epoch = current;
+    }
+    writers = &_writers[epoch][slot].count;
+
+    MetricSeries *series = Find(epoch, key, type, name, unit, tags);
+    if (series == NULL) {
+      writers->fetch_sub(1, std::memory_order_release);
+      _overflow.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    return &series->values;
+  }
+
+  /*! @brief Add to a counter
+  *   @return false if the series table is full
+  */
+  inline bool MetricsAggregator::Increment(const StringView &name, const double &value, const StringView &unit, const StringMap &tags) {
+    std::atomic<uint32_t> *writers = NULL;
+    MetricValues *values = Begin(METRIC_COUNTER, name, unit, tags, writers);
+    if (values == NULL) { return false; }
+
+    // A counter's series only exists in a bucket it was recorded in, so it needs no count
+    uint64_t current = values->sum.load(std::memory_order_relaxed);
+    while (!values->sum.compare_exchange_weak(current, DoubleToBits(BitsToDouble(current) + value), std::memory_order_relaxed)) {}
+
+    writers->fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /*! @brief Record a gauge reading; the bucket keeps last, min, max, sum and count
+  */
+  inline void MetricsAggregator::AddToSummary(MetricValues &values, const double &value) {
+    values.count.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t bits = DoubleToBits(value);
+    values.last.store(bits, std::memory_order_relaxed);
+    uint64_t current = values.sum.load(std::memory_order_relaxed);
+    while (!values.sum.compare_exchange_weak(current, DoubleToBits(BitsToDouble(current) + value), std::memory_order_relaxed)) {}
+    current = values.min.load(std::memory_order_relaxed);
+    while (value < BitsToDouble(current) && !values.min.compare_exchange_weak(current, bits, std::memory_order_relaxed)) {}
+    current = values.max.load(std::memory_order_relaxed);
+    while (value > BitsToDouble(current) && !values.max.compare_exchange_weak(current, bits, std::memory_order_relaxed)) {}
+  }
+
+  /*! @brief Record a gauge reading
+  */
+  inline bool MetricsAggregator::Gauge(const StringView &name, const double &value, const StringView &unit, const StringMap &tags) {
+    std::atomic<uint32_t> *writers = NULL;
+    MetricValues *values = Begin(METRIC_GAUGE, name, unit, tags, writers);
+    if (values == NULL) { return false; }
+
+    AddToSummary(*values, value);
+
+    writers->fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /*! @brief Add a value to a distribution's sketch and to its exact count and sum
+  */
+  inline bool MetricsAggregator::Distribution(const StringView &name, const double &value, const StringView &unit, const StringMap &tags) {
+    std::atomic<uint32_t> *writers = NULL;
+    MetricValues *values = Begin(METRIC_DISTRIBUTION, name, unit, tags, writers);
+    if (values == NULL) { return false; }
+
+    values->distribution->Add(value);
+    AddToSummary(*values, value);
+
+    writers->fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /*! @brief Add a member to a set
+  *   @details The member is sent as a 32-bit hash, as Sentry expects; a
+  *   HyperLogLog keeps the distinct count in case the sample fills up.
+  */
+  inline bool MetricsAggregator::Set(const StringView &name, const StringView &member, const StringView &unit, const StringMap &tags) {
+    std::atomic<uint32_t> *writers = NULL;
+    MetricValues *values = Begin(METRIC_SET, name, unit, tags, writers);
+    if (values == NULL) { return false; }
+
+    uint64_t hash = HashString(member);
+    values->members->Add(static_cast<uint32_t>(hash ^ (hash >> 32)));
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;  // Spread the low FNV bits into the register index
+    hash ^= hash >> 33;
+    values->set->Add(hash);
+    values->count.fetch_add(1, std::memory_order_relaxed);
+
+    writers->fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /*! @brief Close the current bucket and send it as one statsd envelope
+  *   @details The closed table is emptied afterwards, so a series that is no
+  *   longer recorded gives up its slot.
+  *   @return the number of series sent
+  */
+  inline size_t MetricsAggregator::Flush() {
+    std::lock_guard<std::mutex> lock(_flush_mutex);
+
+    const uint32_t closed = _epoch.load();
+    _epoch.store(closed ^ 1);
+    const int64_t timestamp = _bucket_start;
+    _bucket_start = CurrentBucketStart();
+
+    for (size_t i = 0; i < METRICS_WRITER_SLOTS; ++i) {
+      while (_writers[closed][i].count.load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+
+    std::string payload;
+    size_t sent = 0;
+    for (size_t i = 0; i < METRICS_SHARD_COUNT * METRICS_SHARD_CAPACITY; ++i) {
+      MetricSeries &series = _series[closed][i];
+      if (series.key.load(std::memory_order_acquire) == METRICS_SERIES_EMPTY) { continue; }
+
+      if (AppendLine(payload, series, series.values, timestamp)) {
+        ++sent;
+      }
+      ResetSeries(series);
+    }
+    _series_count[closed].store(0);
+
+    if (sent != 0 && _sink) {
+      _sink(EnvelopeWriter::MakeEnvelope(METRICS_ITEM_TYPE, payload));
+    }
+    return sent;
+  }
+
+  /*! @brief Write a series' closed bucket as a statsd line and reset it
+  *   @details name@unit:value[:value...]|type|#tag:value,...|T<timestamp>
+  *   @return false if nothing was recorded in the bucket
+  */
+  inline bool MetricsAggregator::AppendLine(std::string &payload, const MetricSeries &series, MetricValues &values, const int64_t &timestamp) {
+    const uint64_t count = values.count.load(std::memory_order_relaxed);
+    if (count == 0 && series.type != METRIC_COUNTER) { return false; }
+
+    AppendSeries(payload, series);
+
+    const double sum = BitsToDouble(values.sum.load(std::memory_order_relaxed));
+    const char *type = "c";
+    switch (series.type) {
+    case METRIC_COUNTER:
+      payload += ':';
+      AppendNumber(payload, sum);
+      break;
+    case METRIC_GAUGE:
+      AppendSummary(payload, BitsToDouble(values.last.load(std::memory_order_relaxed)),
+        BitsToDouble(values.min.load(std::memory_order_relaxed)),
+        BitsToDouble(values.max.load(std::memory_order_relaxed)),
+        sum, static_cast<double>(count));
+      type = "g";
+      break;
+    case METRIC_DISTRIBUTION: {
+      std::vector<double> samples;
+      const bool is_complete = values.distribution->TakeValues(samples, DISTRIBUTION_SAMPLES);
+      for (size_t i = 0; i < samples.size(); ++i) {
+        payload += ':';
+        AppendNumber(payload, samples[i]);
+      }
+      type = "d";
+      if (is_complete) { break; }
+
+      // The quantiles lose the count and sum, which also go out as a gauge of
+      // the same name
+      AppendSuffix(payload, series, type, timestamp);
+      AppendSeries(payload, series);
+      AppendSummary(payload, BitsToDouble(values.last.load(std::memory_order_relaxed)),
+        BitsToDouble(values.min.load(std::memory_order_relaxed)),
+        BitsToDouble(values.max.load(std::memory_order_relaxed)),
+        sum, static_cast<double>(count));
+      type = "g";
+      break;
+    }
+    case METRIC_SET: {
+      std::vector<uint32_t> members;
+      const bool is_complete = values.members->TakeMembers(members);
+      const uint64_t estimate = values.set->TakeEstimate();
+      for (size_t i = 0; i < members.size(); ++i) {
+        payload += ':';
+        payload += std::to_string(members[i]);
+      }
+      type = "s";
+      if (is_complete) { break; }
+
+      // The sample is only part of the set, so its distinct count also goes
+      // out as a gauge of the same name
+      AppendSuffix(payload, series, type, timestamp);
+      AppendSeries(payload, series);
+      AppendSummary(payload, static_cast<double>(estimate), static_cast<double>(estimate),
+        static_cast<double>(estimate), static_cast<double>(estimate), 1.0);
+      type = "g";
+      break;
+    }
+    }
+
+    AppendSuffix(payload, series, type, timestamp);
+    ResetValues(values);
+    return true;
+  }
+
+  /*! @brief Start a statsd line: name@unit
+  */
+  inline void MetricsAggregator::AppendSeries(std::string &payload, const MetricSeries &series) {
+    if (!payload.empty()) { payload += '\n'; }
+    AppendName(payload, series.name);
+    payload += '@';
+    AppendName(payload, series.unit);
+  }
+
+  /*! @brief The fields of a gauge line: :last:min:max:sum:count
+  */
+  inline void MetricsAggregator::AppendSummary(std::string &payload, const double &last, const double &min, const double &max, const double &sum, const double &count) {
+    const double fields[] = { last, min, max, sum, count };
+    for (size_t i = 0; i < 5; ++i) {
+      payload += ':';
+      AppendNumber(payload, fields[i]);
+    }
+  }
+
+  /*! @brief End a statsd line: |type|#tags|Ttimestamp
+  */
+  inline void MetricsAggregator::AppendSuffix(std::string &payload, const MetricSeries &series, const char *type, const int64_t &timestamp) {
+    payload += '|';
+    payload += type;
+    if (!series.tags.empty()) {
+      payload += "|#";
+      for (StringMap::const_iterator tag = series.tags.begin(); tag != series.tags.end(); ++tag) {
+        if (tag != series.tags.begin()) { payload += ','; }
+        AppendName(payload, tag->first);
+        payload += ':';
+        for (size_t i = 0; i < tag->second.size(); ++i) {
+          const char c = tag->second[i];
+          payload += (c == '|' || c == ',' || c == '\n') ? '_' : c;
+        }
+      }
+    }
+    payload += "|T";
+    payload += std::to_string(timestamp);
+  }
+
+  /*! @brief An empty bucket; min and max start at the far ends
+  */
+  inline void MetricsAggregator::ResetValues(MetricValues &values) {
+    values.count.store(0, std::memory_order_relaxed);
+    values.sum.store(DoubleToBits(0.0), std::memory_order_relaxed);
+    values.min.store(DoubleToBits(HUGE_VAL), std::memory_order_relaxed);
+    values.max.store(DoubleToBits(-HUGE_VAL), std::memory_order_relaxed);
+    values.last.store(DoubleToBits(0.0), std::memory_order_relaxed);
+  }
+
+  /*! @brief An unclaimed slot; its sketches are kept for the next series of the same type
+  */
+  inline void MetricsAggregator::ResetSeries(MetricSeries &series) {
+    series.is_ready.store(false, std::memory_order_relaxed);
+    series.name.clear();
+    series.unit.clear();
+    series.tags = StringMap();
+    ResetValues(series.values);
+    series.key.store(METRICS_SERIES_EMPTY, std::memory_order_release);
+  }
+
+  inline uint64_t MetricsAggregator::DoubleToBits(const double &value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  inline double MetricsAggregator::BitsToDouble(const uint64_t &bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  /*! @brief The start of the current bucket, in seconds since the epoch
+  */
+  inline int64_t MetricsAggregator::CurrentBucketStart() {
+    int64_t seconds = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    return seconds - (seconds % METRICS_BUCKET_SECONDS);
+  }
+
+  /*! @brief Names, units and tag keys are limited to [A-Za-z0-9_.-]
+  */
+  inline void MetricsAggregator::AppendName(std::string &payload, const std::string &name) {
+    for (size_t i = 0; i < name.size(); ++i) {
+      const char c = name[i];
+      const bool is_allowed = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        c == '_' || c == '.' || c == '-';
+      payload += is_allowed ? c : '_';
+    }
+  }
+
+  inline void MetricsAggregator::AppendNumber(std::string &payload, const double &value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (length > 0) {
+      payload.append(buffer, static_cast<size_t>(length));
+    }
+  }
+
+  /*! @brief Flush every interval on a background thread until Stop()
+  */
+  inline void MetricsAggregator::Start() {
+    _flusher.Start();
+  }
+
+  inline void MetricsAggregator::Stop() {
+    _flusher.Stop();
+  }
+
+  /*! @brief Distinct series recorded in the current bucket
+  */
+  inline size_t MetricsAggregator::GetSeriesCount() const {
+    return _series_count[_epoch.load()].load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Records refused because a shard of the series table was full
+  */
+  inline uint64_t MetricsAggregator::GetOverflowCount() const {
+    return _overflow.load(std::memory_order_relaxed);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_METRICS_H_
\ No newline at end of file
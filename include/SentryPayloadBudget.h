@@ -0,0 +1,390 @@
+/********************************************//**
+* @file SentryPayloadBudget.h
+* @brief Keeps serialized events under a byte budget
+* @details https://docs.sentry.io/clientdev/data-handling/#variable-size
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_PAYLOAD_BUDGET_H_
+#define SENTRY_PAYLOAD_BUDGET_H_
+#include <string>
+#include <functional>
+#include <stdint.h>
+#include <string.h>
+
+#include "SentryEvent.h"
+#include "SentryFrame.h"
+#include "SentryDebugMeta.h"
+#include "SentryException.h"
+#include "SentryStacktrace.h"
+#include "SentryThreads.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t PAYLOAD_BUDGET = 200 * 1024;         // Bytes of compact JSON per event
+  const size_t PAYLOAD_VAR_COUNT = 16;              // Vars kept per frame
+  const size_t PAYLOAD_VAR_LENGTH = 128;            // Bytes kept per var value
+  const size_t PAYLOAD_STRING_LENGTH = 1024;        // First limit for any string
+  const size_t PAYLOAD_MIN_STRING_LENGTH = 64;      // Strings are never cut shorter than this
+
+  const size_t PAYLOAD_NUMBER_LENGTH = 25;          // Longest number the writer produces
+
+  const char * const PAYLOAD_ELLIPSIS = "...";
+
+  // Members that name code rather than describe it; cutting them breaks symbolication and grouping
+  const char * const PAYLOAD_IDENTIFIERS[] = {
+    JSON_ELEM_EVENT_ID,
+    JSON_ELEM_EXCEPTION_TYPE,
+    JSON_ELEM_FUNCTION,
+    JSON_ELEM_MODULE,
+    JSON_ELEM_PACKAGE,
+    JSON_ELEM_FILENAME,
+    JSON_ELEM_ABS_PATH,
+    JSON_ELEM_IMAGE_ADDR,
+    JSON_ELEM_INSTRUCTION_ADDR,
+    JSON_ELEM_SYMBOL_ADDR,
+    JSON_ELEM_IMAGE_CODE_FILE,
+    JSON_ELEM_IMAGE_CODE_ID,
+    JSON_ELEM_IMAGE_DEBUG_ID
+  };
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Trims events until their serialized form fits a byte budget
+  *   @details The size is estimated by walking the document, which gives the
+  *   exact length of every string as the writer escapes it and an upper bound
+  *   for numbers, so an event that fits the estimate fits on the wire. The
+  *   cheapest losses come first and each step runs only while the event is
+  *   still too large:
+  *   1. drop source context lines from every frame
+  *   2. keep the first vars of each frame and cut their values
+  *   3. cut long free text on UTF-8 boundaries, halving the limit each round;
+  *      identifiers such as function names, paths and debug ids are kept whole
+  *   4. drop the stacks of threads that did not crash
+  *   The document is estimated once; each step returns the bytes it saved.
+  */
+  class PayloadBudget {
+  public:
+    enum TrimEnum {
+      TRIM_NONE,              // Fit as it was
+      TRIM_SOURCE_CONTEXT,
+      TRIM_VARS,
+      TRIM_STRINGS,
+      TRIM_THREADS,
+      TRIM_FAILED             // Still over budget after every step
+    };
+
+    PayloadBudget(const size_t &max_bytes = PAYLOAD_BUDGET);
+
+    const size_t& GetMaxBytes() const;
+
+    TrimEnum Apply(rapidjson::Value &doc, rapidjson::Document::AllocatorType &allocator) const;
+    TrimEnum Apply(Event &event) const;
+    std::function<bool(Event &event)> GetProcessor() const;
+
+    static size_t Estimate(const rapidjson::Value &value);
+    static size_t EstimateString(const char *data, const size_t &size);
+    static size_t TruncateUTF8(const char *data, const size_t &size, const size_t &max_size);
+    static bool IsIdentifier(const rapidjson::Value &name);
+
+  protected:
+    typedef std::function<void(rapidjson::Value &frame)> FrameFunction;
+
+    static void ForEachFrame(rapidjson::Value &doc, const FrameFunction &function);
+    static size_t RemoveMember(rapidjson::Value &object, const char *name);
+    static size_t DropSourceContext(rapidjson::Value &doc);
+    static size_t TruncateVars(rapidjson::Value &doc, rapidjson::Document::AllocatorType &allocator);
+    static size_t TruncateStrings(rapidjson::Value &value, const size_t &max_size, rapidjson::Document::AllocatorType &allocator);
+    static size_t DropThreadStacks(rapidjson::Value &doc);
+    static size_t TruncateString(rapidjson::Value &value, const size_t &max_size, rapidjson::Document::AllocatorType &allocator);
+
+  private:
+    size_t _max_bytes;
+
+  }; // class PayloadBudget
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline PayloadBudget::PayloadBudget(const size_t &max_bytes) :
+    _max_bytes(max_bytes) {
+  }
+
+  inline const size_t& PayloadBudget::GetMaxBytes() const {
+    return _max_bytes;
+  }
+
+  /*! @brief Trim a document in place
+  *   @return the last step that was needed, or TRIM_FAILED
+  */
+  inline PayloadBudget::TrimEnum PayloadBudget::Apply(rapidjson::Value &doc, rapidjson::Document::AllocatorType &allocator) const {
+    size_t size = Estimate(doc);
+    if (size <= _max_bytes) { return TRIM_NONE; }
+
+    size -= DropSourceContext(doc);
+    if (size <= _max_bytes) { return TRIM_SOURCE_CONTEXT; }
+
+    size -= TruncateVars(doc, allocator);
+    if (size <= _max_bytes) { return TRIM_VARS; }
+
+    for (size_t limit = PAYLOAD_STRING_LENGTH; limit >= PAYLOAD_MIN_STRING_LENGTH; limit /= 2) {
+      size -= TruncateStrings(doc, limit, allocator);
+      if (size <= _max_bytes) { return TRIM_STRINGS; }
+    }
+
+    size -= DropThreadStacks(doc);
+    if (size <= _max_bytes) { return TRIM_THREADS; }
+
+    return TRIM_FAILED;
+  }
+
+  inline PayloadBudget::TrimEnum PayloadBudget::Apply(Event &event) const {
+    if (!event.IsValid()) { return TRIM_FAILED; }
+    return Apply(event.GetDocument(), event.GetAllocator());
+  }
+
+  /*! @brief A pipeline processor that trims events and drops those that cannot fit
+  */
+  inline std::function<bool(Event &event)> PayloadBudget::GetProcessor() const {
+    PayloadBudget budget(*this);
+    return [budget](Event &event) {
+      return budget.Apply(event) != TRIM_FAILED;
+    };
+  }
+
+  /*! @brief Bytes the writer needs for a string, quotes included
+  */
+  inline size_t PayloadBudget::EstimateString(const char *data, const size_t &size) {
+    size_t length = 2;
+    for (size_t i = 0; i < size; ++i) {
+      const unsigned char c = static_cast<unsigned char>(data[i]);
+      if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+        length += 2;
+      } else if (c < 0x20) {
+        length += 6;  // \u00XX
+      } else {
+        length += 1;
+      }
+    }
+    return length;
+  }
+
+  /*! @brief Bytes of compact JSON for a value, never less than the writer produces
+  */
+  inline size_t PayloadBudget::Estimate(const rapidjson::Value &value) {
+    switch (value.GetType()) {
+    case rapidjson::kNullType:
+      return 4;
+    case rapidjson::kFalseType:
+      return 5;
+    case rapidjson::kTrueType:
+      return 4;
+    case rapidjson::kStringType:
+      return EstimateString(value.GetString(), value.GetStringLength());
+    case rapidjson::kNumberType: {
+      if (value.IsDouble()) { return PAYLOAD_NUMBER_LENGTH; }
+      uint64_t magnitude = value.IsUint64() ? value.GetUint64() : static_cast<uint64_t>(-(value.GetInt64() + 1)) + 1;
+      size_t length = value.IsUint64() ? 1 : 2;
+      while (magnitude >= 10) {
+        magnitude /= 10;
+        ++length;
+      }
+      return length;
+    }
+    case rapidjson::kArrayType: {
+      size_t length = 2;
+      for (rapidjson::Value::ConstValueIterator element = value.Begin(); element != value.End(); ++element) {
+        length += Estimate(*element) + 1;  // The comma, or one byte spare after the last element
+      }
+      return length;
+    }
+    case rapidjson::kObjectType: {
+      size_t length = 2;
+      for (rapidjson::Value::ConstMemberIterator member = value.MemberBegin(); member != value.MemberEnd(); ++member) {
+        length += EstimateString(member->name.GetString(), member->name.GetStringLength()) + 1;
+        length += Estimate(member->value) + 1;
+      }
+      return length;
+    }
+    }
+    return 0;
+  }
+
+  /*! @brief The longest prefix of at most max_size bytes that ends on a whole character
+  */
+  inline size_t PayloadBudget::TruncateUTF8(const char *data, const size_t &size, const size_t &max_size) {
+    if (size <= max_size) { return size; }
+
+    size_t length = max_size;
+    while (length > 0 && (static_cast<unsigned char>(data[length]) & 0xC0) == 0x80) {
+      --length;
+    }
+    return length;
+  }
+
+  /*! @brief Whether a member names code rather than describing it
+  */
+  inline bool PayloadBudget::IsIdentifier(const rapidjson::Value &name) {
+    if (!name.IsString()) { return false; }
+
+    for (size_t i = 0; i < sizeof(PAYLOAD_IDENTIFIERS) / sizeof(PAYLOAD_IDENTIFIERS[0]); ++i) {
+      if (strcmp(name.GetString(), PAYLOAD_IDENTIFIERS[i]) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*! @brief Cut a string value, marking the cut with an ellipsis
+  *   @return the bytes saved, 0 if the string was left alone
+  */
+  inline size_t PayloadBudget::TruncateString(rapidjson::Value &value, const size_t &max_size, rapidjson::Document::AllocatorType &allocator) {
+    if (!value.IsString() || value.GetStringLength() <= max_size) { return 0; }
+
+    const size_t ellipsis = strlen(PAYLOAD_ELLIPSIS);
+    const size_t keep = TruncateUTF8(value.GetString(), value.GetStringLength(), (max_size > ellipsis) ? max_size - ellipsis : 0);
+
+    const size_t before = Estimate(value);
+    std::string truncated(value.GetString(), keep);
+    truncated += PAYLOAD_ELLIPSIS;
+    value.SetString(truncated.data(), static_cast<rapidjson::SizeType>(truncated.size()), allocator);
+    const size_t after = Estimate(value);
+    return (before > after) ? before - after : 0;
+  }
+
+  /*! @brief Visit every frame of every exception and thread stacktrace
+  */
+  inline void PayloadBudget::ForEachFrame(rapidjson::Value &doc, const FrameFunction &function) {
+    if (!doc.IsObject()) { return; }
+
+    const char * const interfaces[] = { JSON_ELEM_EXCEPTION, JSON_ELEM_THREADS };
+    const char * const lists[] = { JSON_ELEM_EXCEPTION_VALUES, JSON_ELEM_THREADS_VALUES };
+    for (size_t i = 0; i < 2; ++i) {
+      rapidjson::Value::MemberIterator interface = doc.FindMember(interfaces[i]);
+      if (interface == doc.MemberEnd() || !interface->value.IsObject()) { continue; }
+
+      rapidjson::Value::MemberIterator values = interface->value.FindMember(lists[i]);
+      if (values == interface->value.MemberEnd() || !values->value.IsArray()) { continue; }
+
+      for (rapidjson::Value::ValueIterator value = values->value.Begin(); value != values->value.End(); ++value) {
+        if (!value->IsObject()) { continue; }
+
+        rapidjson::Value::MemberIterator stacktrace = value->FindMember(JSON_ELEM_STACKTRACE);
+        if (stacktrace == value->MemberEnd() || !stacktrace->value.IsObject()) { continue; }
+
+        rapidjson::Value::MemberIterator frames = stacktrace->value.FindMember(JSON_ELEM_FRAMES);
+        if (frames == stacktrace->value.MemberEnd() || !frames->value.IsArray()) { continue; }
+
+        for (rapidjson::Value::ValueIterator frame = frames->value.Begin(); frame != frames->value.End(); ++frame) {
+          if (frame->IsObject()) {
+            function(*frame);
+          }
+        }
+      }
+    }
+  }
+
+  /*! @brief Remove a member of an object
+  *   @return the bytes saved: the name, the value and their separators
+  */
+  inline size_t PayloadBudget::RemoveMember(rapidjson::Value &object, const char *name) {
+    rapidjson::Value::MemberIterator member = object.FindMember(name);
+    if (member == object.MemberEnd()) { return 0; }
+
+    const size_t saved = EstimateString(member->name.GetString(), member->name.GetStringLength()) + 1 + Estimate(member->value) + 1;
+    object.RemoveMember(name);
+    return saved;
+  }
+
+  inline size_t PayloadBudget::DropSourceContext(rapidjson::Value &doc) {
+    size_t saved = 0;
+    ForEachFrame(doc, [&saved](rapidjson::Value &frame) {
+      saved += RemoveMember(frame, JSON_ELEM_PRE_CONTEXT);
+      saved += RemoveMember(frame, JSON_ELEM_CONTEXT_LINE);
+      saved += RemoveMember(frame, JSON_ELEM_POST_CONTEXT);
+    });
+    return saved;
+  }
+
+  inline size_t PayloadBudget::TruncateVars(rapidjson::Value &doc, rapidjson::Document::AllocatorType &allocator) {
+    size_t saved = 0;
+    ForEachFrame(doc, [&allocator, &saved](rapidjson::Value &frame) {
+      rapidjson::Value::MemberIterator vars = frame.FindMember(JSON_ELEM_VARS);
+      if (vars == frame.MemberEnd() || !vars->value.IsObject()) { return; }
+
+      if (vars->value.MemberCount() > PAYLOAD_VAR_COUNT) {
+        for (rapidjson::Value::MemberIterator var = vars->value.MemberBegin() + PAYLOAD_VAR_COUNT; var != vars->value.MemberEnd(); ++var) {
+          saved += EstimateString(var->name.GetString(), var->name.GetStringLength()) + 1 + Estimate(var->value) + 1;
+        }
+        vars->value.EraseMember(vars->value.MemberBegin() + PAYLOAD_VAR_COUNT, vars->value.MemberEnd());
+      }
+      for (rapidjson::Value::MemberIterator var = vars->value.MemberBegin(); var != vars->value.MemberEnd(); ++var) {
+        saved += TruncateString(var->value, PAYLOAD_VAR_LENGTH, allocator);
+      }
+    });
+    return saved;
+  }
+
+  /*! @brief Cut every free text string below this one
+  *   @details Member names and identifier members are kept whole.
+  */
+  inline size_t PayloadBudget::TruncateStrings(rapidjson::Value &value, const size_t &max_size, rapidjson::Document::AllocatorType &allocator) {
+    size_t saved = 0;
+    if (value.IsString()) {
+      saved += TruncateString(value, max_size, allocator);
+    } else if (value.IsArray()) {
+      for (rapidjson::Value::ValueIterator element = value.Begin(); element != value.End(); ++element) {
+        saved += TruncateStrings(*element, max_size, allocator);
+      }
+    } else if (value.IsObject()) {
+      for (rapidjson::Value::MemberIterator member = value.MemberBegin(); member != value.MemberEnd(); ++member) {
+        if (IsIdentifier(member->name)) { continue; }
+        saved += TruncateStrings(member->value, max_size, allocator);
+      }
+    }
+    return saved;
+  }
+
+  /*! @brief Remove the stacktrace of every thread that did not crash
+  */
+  inline size_t PayloadBudget::DropThreadStacks(rapidjson::Value &doc) {
+    if (!doc.IsObject()) { return 0; }
+
+    rapidjson::Value::MemberIterator threads = doc.FindMember(JSON_ELEM_THREADS);
+    if (threads == doc.MemberEnd() || !threads->value.IsObject()) { return 0; }
+
+    rapidjson::Value::MemberIterator values = threads->value.FindMember(JSON_ELEM_THREADS_VALUES);
+    if (values == threads->value.MemberEnd() || !values->value.IsArray()) { return 0; }
+
+    size_t saved = 0;
+    for (rapidjson::Value::ValueIterator thread = values->value.Begin(); thread != values->value.End(); ++thread) {
+      if (!thread->IsObject()) { continue; }
+
+      rapidjson::Value::MemberIterator crashed = thread->FindMember(JSON_ELEM_THREAD_CRASHED);
+      if (crashed != thread->MemberEnd() && crashed->value.IsTrue()) { continue; }
+      saved += RemoveMember(*thread, JSON_ELEM_STACKTRACE);
+    }
+    return saved;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_PAYLOAD_BUDGET_H_
\ No newline at end of file
@@ -0,0 +1,454 @@
+/********************************************//**
+* @file SentryPipeline.h
+* @brief Before-send event processors run on worker threads
+* @details https://docs.sentry.io/clientdev/features/#before-send
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_PIPELINE_H_
+#define SENTRY_PIPELINE_H_
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#include "SentryEvent.h"
+#include "SentryClientStats.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t PIPELINE_WORKERS = 2;
+  const size_t PIPELINE_BATCH_SIZE = 32;
+  const size_t PIPELINE_QUEUE_CAPACITY = 1024;
+
+  const char * const JSON_ELEM_EVENT_TYPE = "type";
+  const char * const EVENT_TYPE_TRANSACTION = "transaction";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Counters for one processor, readable while the pipeline runs
+  */
+  struct ProcessorStats {
+    std::string name;
+    uint64_t processed;     // Events the processor saw
+    uint64_t dropped;       // Events the processor dropped
+    uint64_t category_dropped[CATEGORY_COUNT];  // The same drops by data category
+    uint64_t nanoseconds;   // Time spent in the processor
+  };
+
+  /*! @brief One named stage of the pipeline
+  *   @details The function may change the event and returns false to drop it.
+  */
+  class EventProcessor {
+  public:
+    typedef std::function<bool(Event &event)> Function;
+
+    EventProcessor(const std::string &name, const Function &function);
+
+    const std::string& GetName() const;
+    ProcessorStats GetStats() const;
+
+    void Process(std::vector<Event> &batch);
+
+    static DataCategory GetCategory(const Event &event);
+
+  private:
+    EventProcessor(const EventProcessor &other);
+    EventProcessor& operator = (const EventProcessor &other);
+
+    std::string _name;
+    Function _function;
+    std::atomic<uint64_t> _processed;
+    std::atomic<uint64_t> _dropped[CATEGORY_COUNT];
+    std::atomic<uint64_t> _nanoseconds;
+
+  }; // class EventProcessor
+
+  /*! @brief Runs captured events through the processors off the capture thread
+  *   @details Capture only moves the event into a bounded queue. Workers take
+  *   events in batches and pass each batch through one processor at a time,
+  *   dropping events as soon as a processor rejects them. Surviving events are
+  *   handed to the sink, which returns how many of them it accepted from the
+  *   front of the batch; only those count as sent. Every drop is counted by
+  *   the data category of the event dropped. Each call of the sink is timed
+  *   into the counters given to SetCounters(), which also record what the sink
+  *   serializes. Processors are added before the first Submit().
+  */
+  class ProcessorPipeline {
+  public:
+    typedef std::function<size_t(std::vector<Event> &batch)> Sink;
+
+    ProcessorPipeline(const size_t &worker_count = PIPELINE_WORKERS, const size_t &batch_size = PIPELINE_BATCH_SIZE,
+      const size_t &queue_capacity = PIPELINE_QUEUE_CAPACITY);
+    ~ProcessorPipeline();
+
+    void AddProcessor(const std::string &name, const EventProcessor::Function &function);
+    void SetSink(const Sink &sink);
+    void SetCounters(const std::shared_ptr<ClientCounters> &counters);
+
+    bool Submit(Event &&event);
+    bool Flush(const std::chrono::milliseconds &timeout);
+    void Stop();
+
+    std::vector<ProcessorStats> GetStats() const;
+    uint64_t GetQueueDropCount() const;
+    uint64_t GetQueueDropCount(const DataCategory &category) const;
+    uint64_t GetSentCount() const;
+    uint64_t GetUnsentCount() const;
+    uint64_t GetUnsentCount(const DataCategory &category) const;
+    size_t GetQueueDepth() const;
+
+  protected:
+    void Start();
+    void Run();
+    bool IsWorkerThread() const;
+
+  private:
+    ProcessorPipeline(const ProcessorPipeline &other);
+    ProcessorPipeline& operator = (const ProcessorPipeline &other);
+
+    size_t _worker_count;
+    size_t _batch_size;
+    size_t _queue_capacity;
+
+    std::vector<std::unique_ptr<EventProcessor> > _processors;
+    Sink _sink;
+    std::shared_ptr<ClientCounters> _counters;
+
+    std::vector<std::thread> _workers;
+    std::vector<std::thread::id> _worker_ids;    // Kept until the workers are joined
+    std::deque<Event> _queue;
+    size_t _in_flight;
+    bool _is_running;
+    bool _is_stopping;
+    mutable std::mutex _mutex;
+    std::condition_variable _work;
+    std::condition_variable _idle;
+
+    std::atomic<uint64_t> _queue_drops[CATEGORY_COUNT];
+    std::atomic<uint64_t> _sent;
+    std::atomic<uint64_t> _unsent[CATEGORY_COUNT];    // Passed the processors, but the sink did not take them
+
+  }; // class ProcessorPipeline
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline EventProcessor::EventProcessor(const std::string &name, const Function &function) :
+    _name(name), _function(function), _processed(0), _nanoseconds(0) {
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      _dropped[category].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline const std::string& EventProcessor::GetName() const {
+    return _name;
+  }
+
+  inline ProcessorStats EventProcessor::GetStats() const {
+    ProcessorStats stats;
+    stats.name = _name;
+    stats.processed = _processed.load(std::memory_order_relaxed);
+    stats.dropped = 0;
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      stats.category_dropped[category] = _dropped[category].load(std::memory_order_relaxed);
+      stats.dropped += stats.category_dropped[category];
+    }
+    stats.nanoseconds = _nanoseconds.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /*! @brief Run the function over a batch, removing the events it drops
+  */
+  inline void EventProcessor::Process(std::vector<Event> &batch) {
+    if (batch.empty()) { return; }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t kept = 0;
+    uint64_t dropped[CATEGORY_COUNT] = {};
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (!_function(batch[i])) {
+        ++dropped[GetCategory(batch[i])];
+        continue;
+      }
+      if (kept != i) {
+        batch[kept] = std::move(batch[i]);
+      }
+      ++kept;
+    }
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+    _processed.fetch_add(batch.size(), std::memory_order_relaxed);
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      if (dropped[category] != 0) {
+        _dropped[category].fetch_add(dropped[category], std::memory_order_relaxed);
+      }
+    }
+    _nanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+
+    while (batch.size() > kept) {
+      batch.pop_back();
+    }
+  }
+
+  /*! @brief Transactions by their type, everything else as an error
+  */
+  inline DataCategory EventProcessor::GetCategory(const Event &event) {
+    if (!event.IsValid()) { return CATEGORY_ERROR; }
+    const rapidjson::Document &doc = event.GetDocument();
+    rapidjson::Value::ConstMemberIterator type = doc.FindMember(JSON_ELEM_EVENT_TYPE);
+    if (type != doc.MemberEnd() && type->value.IsString() && strcmp(type->value.GetString(), EVENT_TYPE_TRANSACTION) == 0) {
+      return CATEGORY_TRANSACTION;
+    }
+    return CATEGORY_ERROR;
+  }
+
+  /*!
+  */
+  inline ProcessorPipeline::ProcessorPipeline(const size_t &worker_count, const size_t &batch_size, const size_t &queue_capacity) :
+    _worker_count(worker_count > 0 ? worker_count : 1),
+    _batch_size(batch_size > 0 ? batch_size : 1),
+    _queue_capacity(queue_capacity),
+    _in_flight(0), _is_running(false), _is_stopping(false),
+    _sent(0) {
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      _queue_drops[category].store(0, std::memory_order_relaxed);
+      _unsent[category].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  inline ProcessorPipeline::~ProcessorPipeline() {
+    Stop();
+  }
+
+  /*! @brief Append a processor; ignored once events are flowing
+  */
+  inline void ProcessorPipeline::AddProcessor(const std::string &name, const EventProcessor::Function &function) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_is_running || !function) { return; }
+    _processors.push_back(std::unique_ptr<EventProcessor>(new EventProcessor(name, function)));
+  }
+
+  inline void ProcessorPipeline::SetSink(const Sink &sink) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_is_running) { return; }
+    _sink = sink;
+  }
+
+  /*! @brief The counters that sink calls and serialization are recorded into; ignored once events are flowing
+  */
+  inline void ProcessorPipeline::SetCounters(const std::shared_ptr<ClientCounters> &counters) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_is_running) { return; }
+    _counters = counters;
+  }
+
+  /*! @brief Queue an event, starting the workers on first use
+  *   @return false if the pipeline is stopped or the queue is full
+  */
+  inline bool ProcessorPipeline::Submit(Event &&event) {
+    if (!event.IsValid()) { return false; }
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_is_stopping) { return false; }
+      if (_queue.size() >= _queue_capacity) {
+        _queue_drops[EventProcessor::GetCategory(event)].fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (!_is_running) {
+        Start();
+      }
+      _queue.push_back(std::move(event));
+    }
+    _work.notify_one();
+    return true;
+  }
+
+  /*! @brief Wait until every queued event has left the pipeline
+  *   @return false if the timeout passed first
+  */
+  inline bool ProcessorPipeline::Flush(const std::chrono::milliseconds &timeout) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _idle.wait_for(lock, timeout, [this]() { return _queue.empty() && _in_flight == 0; });
+  }
+
+  /*! @brief Finish the queued events and join the workers
+  *   @details Called from a worker, a processor or the sink, it only tells the
+  *   workers to stop: a worker cannot join itself. The workers are joined by
+  *   the next Stop() from another thread, or by the destructor. The workers
+  *   are taken out of the list under the lock, so two threads stopping at
+  *   once never join the same worker.
+  */
+  inline void ProcessorPipeline::Stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _is_stopping = true;
+    }
+    _work.notify_all();
+    if (IsWorkerThread()) { return; }
+
+    std::vector<std::thread> workers;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      workers.swap(_workers);
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      if (workers[i].joinable()) {
+        workers[i].join();
+      }
+    }
+    if (!workers.empty()) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _worker_ids.clear();
+    }
+  }
+
+  /*! @brief Whether the calling thread is one of the workers
+  *   @details Start() saves the ids under the lock before any worker can take
+  *   a batch, and Stop() only forgets them after joining every worker.
+  */
+  inline bool ProcessorPipeline::IsWorkerThread() const {
+    const std::thread::id current = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(_mutex);
+    return (std::find(_worker_ids.begin(), _worker_ids.end(), current) != _worker_ids.end());
+  }
+
+  /*! @brief Called with the lock held
+  */
+  inline void ProcessorPipeline::Start() {
+    _is_running = true;
+    for (size_t i = 0; i < _worker_count; ++i) {
+      _workers.push_back(std::thread(&ProcessorPipeline::Run, this));
+      _worker_ids.push_back(_workers.back().get_id());
+    }
+  }
+
+  /*! @brief Worker loop: take a batch, run the stages, hand it to the sink
+  */
+  inline void ProcessorPipeline::Run() {
+    std::vector<Event> batch;
+    batch.reserve(_batch_size);
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _work.wait(lock, [this]() { return !_queue.empty() || _is_stopping; });
+        if (_queue.empty()) { return; }
+
+        while (!_queue.empty() && batch.size() < _batch_size) {
+          batch.push_back(std::move(_queue.front()));
+          _queue.pop_front();
+        }
+        _in_flight += batch.size();
+      }
+
+      const size_t taken = batch.size();
+      for (size_t i = 0; i < _processors.size() && !batch.empty(); ++i) {
+        _processors[i]->Process(batch);
+      }
+      size_t accepted = 0;
+      if (!batch.empty() && _sink) {
+        ScopedStatsRecording recording(_counters.get());
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        accepted = std::min(_sink(batch), batch.size());
+        if (_counters) {
+          _counters->RecordSend(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+        }
+      }
+      _sent.fetch_add(accepted, std::memory_order_relaxed);
+      for (size_t i = accepted; i < batch.size(); ++i) {
+        _unsent[EventProcessor::GetCategory(batch[i])].fetch_add(1, std::memory_order_relaxed);
+      }
+      batch.clear();
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _in_flight -= taken;
+        if (_queue.empty() && _in_flight == 0) {
+          _idle.notify_all();
+        }
+      }
+    }
+  }
+
+  inline std::vector<ProcessorStats> ProcessorPipeline::GetStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<ProcessorStats> stats;
+    for (size_t i = 0; i < _processors.size(); ++i) {
+      stats.push_back(_processors[i]->GetStats());
+    }
+    return stats;
+  }
+
+  /*! @brief Events refused because the queue was full
+  */
+  inline uint64_t ProcessorPipeline::GetQueueDropCount() const {
+    uint64_t total = 0;
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      total += _queue_drops[category].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  inline uint64_t ProcessorPipeline::GetQueueDropCount(const DataCategory &category) const {
+    if (category >= CATEGORY_COUNT) { return 0; }
+    return _queue_drops[category].load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Events the sink accepted
+  */
+  inline uint64_t ProcessorPipeline::GetSentCount() const {
+    return _sent.load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Events that passed every processor but that the sink did not accept, or that had no sink
+  */
+  inline uint64_t ProcessorPipeline::GetUnsentCount() const {
+    uint64_t total = 0;
+    for (size_t category = 0; category < CATEGORY_COUNT; ++category) {
+      total += _unsent[category].load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  inline uint64_t ProcessorPipeline::GetUnsentCount(const DataCategory &category) const {
+    if (category >= CATEGORY_COUNT) { return 0; }
+    return _unsent[category].load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Events queued or being processed right now
+  */
+  inline size_t ProcessorPipeline::GetQueueDepth() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queue.size() + _in_flight;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_PIPELINE_H_
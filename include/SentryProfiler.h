@@ -0,0 +1,745 @@
+/********************************************//**
+* @file SentryProfiler.h
+* @brief Sampling CPU profiler producing Sentry profiles
+* @details https://develop.sentry.dev/sdk/telemetry/profiles/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_PROFILER_H_
+#define SENTRY_PROFILER_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#include "SentryThreadCapture.h"
+#include "SentryThreadRegistry.h"
+#include "SentryDebugMeta.h"
+#include "SentrySymbolizer.h"
+#include "SentryTracing.h"
+#include "SentryEvent.h"
+#include "SentryEnvelope.h"
+#include "SentryFlusher.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#endif
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const int PROFILER_FREQUENCY = 100;                 // Samples per second of process CPU time
+  const size_t PROFILER_MAX_THREADS = 128;            // Threads with a sample buffer, power of two
+  const size_t PROFILER_RING_SIZE = 32;               // Samples buffered per thread, power of two
+  const size_t PROFILER_MAX_SAMPLES = 30000;          // Samples held between payloads
+  const size_t PROFILER_MAX_STACKS = 16384;           // Distinct stacks held between payloads
+  const int64_t PROFILER_DRAIN_MS = 50;
+  const int64_t PROFILER_WINDOW_NS = 30LL * 1000000000LL;  // Samples kept for transactions still running
+
+  const char * const PROFILE_ITEM_TYPE = "profile";
+  const char * const PROFILE_CHUNK_ITEM_TYPE = "profile_chunk";
+
+  const char * const JSON_ELEM_PROFILE = "profile";
+  const char * const JSON_ELEM_PROFILE_VERSION = "version";
+  const char * const JSON_ELEM_PROFILER_ID = "profiler_id";
+  const char * const JSON_ELEM_CHUNK_ID = "chunk_id";
+  const char * const JSON_ELEM_SAMPLES = "samples";
+  const char * const JSON_ELEM_STACKS = "stacks";
+  const char * const JSON_ELEM_THREAD_METADATA = "thread_metadata";
+  const char * const JSON_ELEM_STACK_ID = "stack_id";
+  const char * const JSON_ELEM_ELAPSED_NS = "elapsed_since_start_ns";
+  const char * const JSON_ELEM_ACTIVE_THREAD_ID = "active_thread_id";
+  const char * const JSON_ELEM_PROFILE_NAME = "name";
+  const char * const JSON_ELEM_PROFILE_ID = "id";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief One raw sample, written from the signal handler
+  */
+  struct ProfileSampleSlot {
+    int64_t steady_ns;
+    uint32_t count;
+    uint64_t frames[THREAD_CAPTURE_MAX_FRAMES];
+  };
+
+  /*! @brief A thread's sample buffer
+  *   @details The thread's own signal handler is the only writer and the
+  *   collector the only reader, so head and tail are enough to share it.
+  */
+  struct ProfileRing {
+    std::atomic<int> thread_id;
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint64_t> dropped;
+    ProfileSampleSlot slots[PROFILER_RING_SIZE];
+  };
+
+  /*! @brief A sample after deduplication
+  */
+  struct ProfileSample {
+    int64_t steady_ns;
+    int thread_id;
+    uint32_t stack_id;
+  };
+
+  /*! @brief Samples the stacks of threads using CPU and builds profiles from them
+  *   @details The ITIMER_PROF timer counts the CPU time of the whole process
+  *   and raises SIGPROF at the configured frequency on the thread whose tick
+  *   expired it, which is a thread that is running. A timer_create() timer
+  *   would instead prefer the main thread on kernels before 6.3, even idle. The handler unwinds that
+  *   thread into its preallocated ring and returns. A collector thread drains
+  *   the rings, deduplicates stacks and symbolizes each new address once into
+  *   a Frame. In continuous mode the samples go out as profile chunks; in
+  *   transaction mode a window of samples is kept, and each sampled
+  *   transaction goes out in one envelope with its profile.
+  *   Only one profiler samples at a time. The SIGPROF handler stays
+  *   installed once the first profiler has started.
+  */
+  class Profiler {
+  public:
+    enum ModeEnum {
+      MODE_CONTINUOUS,
+      MODE_TRANSACTION
+    };
+
+    typedef std::function<void(const std::string &envelope)> Sink;
+
+    Profiler(const Sink &sink, const ModeEnum &mode = MODE_CONTINUOUS, const int &frequency = PROFILER_FREQUENCY,
+      const std::chrono::milliseconds &chunk_interval = std::chrono::milliseconds(60000));
+    ~Profiler();
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const;
+
+    size_t Drain();
+    bool FlushChunk();
+    bool ProfileTransaction(const TransactionRecord &record, const Event &event);
+    void Attach(Tracer &tracer);
+
+    const std::string& GetProfilerID() const;
+    uint64_t GetSampleCount() const;
+    uint64_t GetDroppedCount() const;
+    size_t GetStackCount() const;
+
+    void RecordSample(const void *context);
+
+  protected:
+    ProfileRing* FindRing(const int &thread_id);
+    uint32_t AddStack(const uint64_t *frames, const uint32_t &count);
+    const Frame& GetFrame(const uint64_t &address, const bool &is_return_address);
+    void Prune(const int64_t &oldest_ns);
+    bool MakeProfile(rapidjson::Document &doc, const int64_t &start_ns, const int64_t &end_ns,
+      const TransactionRecord *record, const std::string &event_id);
+    double ToTimestamp(const int64_t &steady_ns) const;
+    void Collect();
+
+    static void AddString(rapidjson::Value &object, const char *key, const std::string &value, rapidjson::Document::AllocatorType &allocator);
+
+    static std::atomic<Profiler *>& GetActive();
+    static std::atomic<int>& GetHandlerCount();
+#if defined(__linux__)
+    static bool InstallHandler();
+    static void HandleSignal(int signal, siginfo_t *info, void *context);
+#endif
+
+  private:
+    Profiler(const Profiler &other);
+    Profiler& operator = (const Profiler &other);
+
+    Sink _sink;
+    ModeEnum _mode;
+    int _frequency;
+    std::chrono::milliseconds _chunk_interval;
+    std::string _profiler_id;
+
+    int64_t _steady_origin;     // steady_clock and system_clock read together, in ns
+    int64_t _system_origin;
+
+    std::unique_ptr<ProfileRing[]> _rings;   // Kept until destruction, late signals may still arrive
+    std::atomic<uint64_t> _sampled;
+    std::atomic<uint64_t> _dropped;
+
+    mutable std::mutex _mutex;                // Guards everything below
+    std::vector<ProfileSample> _samples;
+    std::vector<std::vector<uint64_t> > _stacks;
+    std::map<std::vector<uint64_t>, uint32_t> _stack_index;
+    std::map<uint64_t, Frame> _frames;        // Address and return flag to symbolized frame
+    std::map<int, std::string> _thread_names;
+    Symbolizer _symbolizer;
+    int64_t _chunk_start;
+
+    std::chrono::steady_clock::time_point _last_chunk;   // Only touched by the collector
+    std::mutex _run_mutex;
+    bool _is_running;
+    PeriodicFlusher _collector;
+
+  }; // class Profiler
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline Profiler::Profiler(const Sink &sink, const ModeEnum &mode, const int &frequency, const std::chrono::milliseconds &chunk_interval) :
+    _sink(sink), _mode(mode), _frequency(frequency > 0 ? frequency : PROFILER_FREQUENCY), _chunk_interval(chunk_interval),
+    _profiler_id(Event::GenerateEventID()),
+    _steady_origin(Tracer::Now()),
+    _system_origin(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count())),
+    _sampled(0), _dropped(0), _chunk_start(0), _is_running(false),
+    _collector([this]() { Collect(); }, std::chrono::milliseconds(PROFILER_DRAIN_MS)) {
+  }
+
+  /*! @brief Stop sampling and send what is left
+  */
+  inline Profiler::~Profiler() {
+    Stop();
+    if (_mode == MODE_CONTINUOUS) {
+      FlushChunk();
+    }
+  }
+
+  /*! @brief The profiler whose rings the signal handler writes into
+  */
+  inline std::atomic<Profiler *>& Profiler::GetActive() {
+    static std::atomic<Profiler *> active(NULL);
+    return active;
+  }
+
+  /*! @brief Signal handlers running right now, which Stop() waits out
+  */
+  inline std::atomic<int>& Profiler::GetHandlerCount() {
+    static std::atomic<int> count(0);
+    return count;
+  }
+
+#if defined(__linux__)
+  /*! @brief Install the SIGPROF handler for the rest of the process
+  *   @details It is never put back: a SIGPROF still queued when a timer is
+  *   deleted would otherwise reach the default action and end the process.
+  *   With no profiler active the handler returns at once.
+  */
+  inline bool Profiler::InstallHandler() {
+    static std::mutex mutex;
+    static bool is_installed = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_installed) { return true; }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &Profiler::HandleSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    is_installed = (sigaction(SIGPROF, &action, NULL) == 0);
+    return is_installed;
+  }
+#endif
+
+  /*! @brief Install the handler, arm the timer and start the collector
+  *   @return false if another profiler is running or the timer is unavailable
+  */
+  inline bool Profiler::Start() {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> lock(_run_mutex);
+    if (_is_running) { return true; }
+
+    Profiler *expected = NULL;
+    if (!GetActive().compare_exchange_strong(expected, this)) { return false; }
+
+    // backtrace() loads the unwinder with dlopen() and malloc() on first use,
+    // which must happen here and not in the handler; see RecordSample()
+    void *warm_up[4];
+    backtrace(warm_up, 4);
+
+    if (!_rings) {
+      _rings.reset(new ProfileRing[PROFILER_MAX_THREADS]);
+      for (size_t i = 0; i < PROFILER_MAX_THREADS; ++i) {
+        _rings[i].thread_id.store(0, std::memory_order_relaxed);
+        _rings[i].head.store(0, std::memory_order_relaxed);
+        _rings[i].tail.store(0, std::memory_order_relaxed);
+        _rings[i].dropped.store(0, std::memory_order_relaxed);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> table_lock(_mutex);
+      _chunk_start = Tracer::Now();
+    }
+
+    if (!InstallHandler()) {
+      GetActive().store(NULL);
+      return false;
+    }
+
+    const long interval_us = std::max(1L, 1000000L / _frequency);
+    struct itimerval timer;
+    timer.it_interval.tv_sec = interval_us / 1000000L;
+    timer.it_interval.tv_usec = interval_us % 1000000L;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+      GetActive().store(NULL);
+      return false;
+    }
+
+    _is_running = true;
+    _last_chunk = std::chrono::steady_clock::now();
+    _collector.Start();
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /*! @brief Disarm the timer, wait out handlers still sampling and drain the rings
+  */
+  inline void Profiler::Stop() {
+#if defined(__linux__)
+    {
+      std::lock_guard<std::mutex> lock(_run_mutex);
+      if (!_is_running) { return; }
+      _is_running = false;
+      struct itimerval timer;
+      memset(&timer, 0, sizeof(timer));
+      setitimer(ITIMER_PROF, &timer, NULL);
+      GetActive().store(NULL);
+      while (GetHandlerCount().load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+    _collector.Stop();
+    Drain();
+#endif
+  }
+
+  inline bool Profiler::IsRunning() const {
+    return (GetActive().load() == this);
+  }
+
+#if defined(__linux__)
+  /*! @brief SIGPROF: sample the interrupted thread
+  */
+  inline void Profiler::HandleSignal(int, siginfo_t *, void *context) {
+    GetHandlerCount().fetch_add(1);
+    Profiler *profiler = GetActive().load();
+    if (profiler != NULL) {
+      const int saved_errno = errno;
+      profiler->RecordSample(context);
+      errno = saved_errno;
+    }
+    GetHandlerCount().fetch_sub(1, std::memory_order_release);
+  }
+#endif
+
+  /*! @brief Write the calling thread's stack into its ring
+  *   @details Takes no locks and allocates nothing itself. The stack is
+  *   walked with backtrace(), which POSIX does not list as async-signal-safe;
+  *   Start() calls it once so the unwinder is loaded before the first signal.
+  *   The unwinder still searches the loaded modules for unwind tables, so a
+  *   sample that interrupts dlopen() or dlclose() on its thread can be wrong
+  *   or cut short. Code built without unwind tables also ends the stack early.
+  */
+  inline void Profiler::RecordSample(const void *context) {
+#if defined(__linux__)
+    ProfileRing *ring = FindRing(ThreadCapture::GetCurrentThreadID());
+    if (ring == NULL) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    const uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= PROFILER_RING_SIZE) {
+      ring->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    ProfileSampleSlot &slot = ring->slots[head & (PROFILER_RING_SIZE - 1)];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    slot.steady_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    slot.count = static_cast<uint32_t>(ThreadCapture::CaptureStack(context, slot.frames, THREAD_CAPTURE_MAX_FRAMES));
+    ring->head.store(head + 1, std::memory_order_release);
+#else
+    (void)context;
+#endif
+  }
+
+  /*! @brief The ring of a thread, claiming a free one on its first sample
+  *   @return NULL once every ring is taken
+  */
+  inline ProfileRing* Profiler::FindRing(const int &thread_id) {
+    if (!_rings || thread_id <= 0) { return NULL; }
+
+    const size_t mask = PROFILER_MAX_THREADS - 1;
+    for (size_t probe = 0; probe < PROFILER_MAX_THREADS; ++probe) {
+      ProfileRing &ring = _rings[(static_cast<size_t>(thread_id) + probe) & mask];
+      int current = ring.thread_id.load(std::memory_order_acquire);
+      if (current == thread_id) { return &ring; }
+      if (current != 0) { continue; }
+      if (ring.thread_id.compare_exchange_strong(current, thread_id, std::memory_order_acq_rel) || current == thread_id) {
+        return &ring;
+      }
+    }
+    return NULL;
+  }
+
+  /*! @brief Move buffered samples into the tables, symbolizing new addresses
+  *   @details Rings of threads that have exited are released for reuse.
+  *   @return the number of samples moved
+  */
+  inline size_t Profiler::Drain() {
+    if (!_rings) { return 0; }
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < PROFILER_MAX_THREADS; ++i) {
+      ProfileRing &ring = _rings[i];
+      const int thread_id = ring.thread_id.load(std::memory_order_acquire);
+      if (thread_id == 0) { continue; }
+
+      uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+      const uint32_t head = ring.head.load(std::memory_order_acquire);
+      for (; tail != head; ++tail) {
+        const ProfileSampleSlot &slot = ring.slots[tail & (PROFILER_RING_SIZE - 1)];
+        if (slot.count == 0) { continue; }
+        if (_samples.size() >= PROFILER_MAX_SAMPLES || _stack_index.size() >= PROFILER_MAX_STACKS) {
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+
+        ProfileSample sample;
+        sample.steady_ns = slot.steady_ns;
+        sample.thread_id = thread_id;
+        sample.stack_id = AddStack(slot.frames, slot.count);
+        _samples.push_back(sample);
+        ++moved;
+      }
+      ring.tail.store(tail, std::memory_order_release);
+      _dropped.fetch_add(ring.dropped.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+
+      if (_thread_names.find(thread_id) == _thread_names.end()) {
+        std::string name;
+        if (!ThreadRegistry::GetInstance().FindThreadName(thread_id, name)) {
+          name = ThreadCapture::ReadThreadName(thread_id);
+        }
+        _thread_names[thread_id] = name;
+      }
+
+#if defined(__linux__)
+      if (head == tail && syscall(SYS_tgkill, getpid(), thread_id, 0) != 0 && errno == ESRCH) {
+        int expected = thread_id;
+        ring.thread_id.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+      }
+#endif
+    }
+    _sampled.fetch_add(moved, std::memory_order_relaxed);
+
+    if (_mode == MODE_TRANSACTION) {
+      Prune(Tracer::Now() - PROFILER_WINDOW_NS);
+    }
+    return moved;
+  }
+
+  /*! @brief The id of a stack, adding it and symbolizing its new addresses
+  */
+  inline uint32_t Profiler::AddStack(const uint64_t *frames, const uint32_t &count) {
+    std::vector<uint64_t> stack(frames, frames + count);
+    std::map<std::vector<uint64_t>, uint32_t>::iterator found = _stack_index.find(stack);
+    if (found != _stack_index.end()) { return found->second; }
+
+    ScopedModuleSnapshot modules;
+    for (uint32_t i = 0; i < count; ++i) {
+      GetFrame(frames[i], i > 0);
+    }
+
+    const uint32_t stack_id = static_cast<uint32_t>(_stacks.size());
+    _stacks.push_back(stack);
+    _stack_index.insert(std::make_pair(stack, stack_id));
+    return stack_id;
+  }
+
+  /*! @brief The frame for an address, symbolized on first use
+  */
+  inline const Frame& Profiler::GetFrame(const uint64_t &address, const bool &is_return_address) {
+    const uint64_t key = (address << 1) | (is_return_address ? 1 : 0);
+    std::map<uint64_t, Frame>::iterator found = _frames.find(key);
+    if (found == _frames.end()) {
+      ScopedModuleSnapshot modules(ModuleRegistry::GetInstance(), false);
+      const DebugImage *image = (modules.Get() != NULL) ? modules.Get()->FindImage(address) : NULL;
+      found = _frames.insert(std::make_pair(key, _symbolizer.Symbolize(image, address, is_return_address))).first;
+    }
+    return found->second;
+  }
+
+  /*! @brief Forget samples older than a time, and the stacks and thread names no sample uses
+  */
+  inline void Profiler::Prune(const int64_t &oldest_ns) {
+    size_t kept = 0;
+    for (size_t i = 0; i < _samples.size(); ++i) {
+      if (_samples[i].steady_ns >= oldest_ns) {
+        _samples[kept++] = _samples[i];
+      }
+    }
+    _samples.resize(kept);
+
+    // Names of exited threads with no samples left
+    std::map<int, std::string> names;
+    for (size_t i = 0; i < _samples.size(); ++i) {
+      std::map<int, std::string>::iterator name = _thread_names.find(_samples[i].thread_id);
+      if (name != _thread_names.end()) { names.insert(*name); }
+    }
+    for (size_t i = 0; i < PROFILER_MAX_THREADS; ++i) {
+      std::map<int, std::string>::iterator name = _thread_names.find(_rings[i].thread_id.load(std::memory_order_relaxed));
+      if (name != _thread_names.end()) { names.insert(*name); }
+    }
+    _thread_names.swap(names);
+
+    if (_stacks.size() < PROFILER_MAX_STACKS / 2) { return; }
+
+    std::vector<uint32_t> remap(_stacks.size(), UINT32_MAX);
+    std::vector<std::vector<uint64_t> > stacks;
+    for (size_t i = 0; i < _samples.size(); ++i) {
+      uint32_t &stack_id = remap[_samples[i].stack_id];
+      if (stack_id == UINT32_MAX) {
+        stack_id = static_cast<uint32_t>(stacks.size());
+        stacks.push_back(_stacks[_samples[i].stack_id]);
+      }
+      _samples[i].stack_id = stack_id;
+    }
+    _stacks.swap(stacks);
+    _stack_index.clear();
+    for (size_t i = 0; i < _stacks.size(); ++i) {
+      _stack_index.insert(std::make_pair(_stacks[i], static_cast<uint32_t>(i)));
+    }
+  }
+
+  /*! @brief Send everything since the last chunk as one continuous profile chunk
+  *   @return false if there was nothing to send
+  */
+  inline bool Profiler::FlushChunk() {
+    Drain();
+
+    std::string envelope;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_samples.empty()) { return false; }
+
+      const int64_t now = Tracer::Now();
+      rapidjson::Document doc;
+      MakeProfile(doc, _chunk_start, now, NULL, std::string());
+      envelope = EnvelopeWriter::MakeEnvelope(PROFILE_CHUNK_ITEM_TYPE, doc);
+      _samples.clear();
+      _stacks.clear();
+      _stack_index.clear();
+      _thread_names.clear();
+      _chunk_start = now;
+    }
+    if (_sink) {
+      _sink(envelope);
+    }
+    return true;
+  }
+
+  /*! @brief Send a transaction and the samples taken while it ran as one envelope
+  *   @return false if no samples were taken, and nothing was sent
+  */
+  inline bool Profiler::ProfileTransaction(const TransactionRecord &record, const Event &event) {
+    Drain();
+
+    rapidjson::Document doc;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!MakeProfile(doc, record.root.start_ns, record.root.end_ns, &record, event.GetEventID())) { return false; }
+    }
+
+    EnvelopeWriter writer(event.GetEventID());
+    writer.AddItem(TRANSACTION_TYPE, event.GetDocument());
+    writer.AddItem(PROFILE_ITEM_TYPE, doc);
+    if (_sink) {
+      _sink(writer.GetEnvelope());
+    }
+    return true;
+  }
+
+  /*! @brief Send every profiled transaction the tracer finishes together with its profile
+  *   @details Transactions without samples still go to the tracer's client.
+  */
+  inline void Profiler::Attach(Tracer &tracer) {
+    tracer.SetTransactionCallback([this](const TransactionRecord &record, const Event &event) {
+      return ProfileTransaction(record, event);
+    });
+  }
+
+  /*! @brief The profile of the samples in a time range; called with the lock held
+  *   @details Only the stacks and frames the samples use are written, each
+  *   once, and stacks list frame indexes newest call first. Transaction
+  *   profiles use the version 1 format, chunks version 2.
+  *   @return false if no sample falls in the range
+  */
+  inline bool Profiler::MakeProfile(rapidjson::Document &doc, const int64_t &start_ns, const int64_t &end_ns,
+    const TransactionRecord *record, const std::string &event_id) {
+    doc.SetObject();
+    rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
+
+    std::vector<uint32_t> stack_remap(_stacks.size(), UINT32_MAX);
+    std::map<uint64_t, uint32_t> frame_remap;
+    rapidjson::Value samples(rapidjson::kArrayType);
+    rapidjson::Value stacks(rapidjson::kArrayType);
+    rapidjson::Value frames(rapidjson::kArrayType);
+    std::map<int, bool> threads;
+
+    for (size_t i = 0; i < _samples.size(); ++i) {
+      const ProfileSample &sample = _samples[i];
+      if (sample.steady_ns < start_ns || sample.steady_ns > end_ns) { continue; }
+
+      uint32_t &stack_id = stack_remap[sample.stack_id];
+      if (stack_id == UINT32_MAX) {
+        stack_id = stacks.Size();
+        const std::vector<uint64_t> &addresses = _stacks[sample.stack_id];
+        rapidjson::Value stack(rapidjson::kArrayType);
+        for (size_t j = 0; j < addresses.size(); ++j) {
+          const uint64_t key = (addresses[j] << 1) | (j > 0 ? 1 : 0);
+          std::map<uint64_t, uint32_t>::iterator frame_id = frame_remap.find(key);
+          if (frame_id == frame_remap.end()) {
+            frame_id = frame_remap.insert(std::make_pair(key, static_cast<uint32_t>(frames.Size()))).first;
+            rapidjson::Document frame_doc(&allocator);
+            GetFrame(addresses[j], j > 0).ToJson(frame_doc);
+            frames.PushBack(frame_doc, allocator);
+          }
+          stack.PushBack(frame_id->second, allocator);
+        }
+        stacks.PushBack(stack, allocator);
+      }
+
+      const std::string thread_id = std::to_string(sample.thread_id);
+      rapidjson::Value value(rapidjson::kObjectType);
+      if (record != NULL) {
+        const std::string elapsed = std::to_string(sample.steady_ns - start_ns);
+        AddString(value, JSON_ELEM_ELAPSED_NS, elapsed, allocator);
+      }
+      else {
+        value.AddMember(rapidjson::StringRef(JSON_ELEM_TIMESTAMP), ToTimestamp(sample.steady_ns), allocator);
+      }
+      AddString(value, JSON_ELEM_THREAD_ID, thread_id, allocator);
+      value.AddMember(rapidjson::StringRef(JSON_ELEM_STACK_ID), stack_id, allocator);
+      samples.PushBack(value, allocator);
+      threads[sample.thread_id] = true;
+    }
+    if (samples.Empty()) { return false; }
+
+    rapidjson::Value thread_metadata(rapidjson::kObjectType);
+    for (std::map<int, bool>::const_iterator thread = threads.begin(); thread != threads.end(); ++thread) {
+      const std::string thread_id = std::to_string(thread->first);
+      const std::string &name = _thread_names[thread->first];
+      rapidjson::Value metadata(rapidjson::kObjectType);
+      AddString(metadata, JSON_ELEM_PROFILE_NAME, name, allocator);
+      rapidjson::Value key(rapidjson::kStringType);
+      key.SetString(thread_id.data(), static_cast<rapidjson::SizeType>(thread_id.size()), allocator);
+      thread_metadata.AddMember(key, metadata, allocator);
+    }
+
+    rapidjson::Value profile(rapidjson::kObjectType);
+    profile.AddMember(rapidjson::StringRef(JSON_ELEM_SAMPLES), samples, allocator);
+    profile.AddMember(rapidjson::StringRef(JSON_ELEM_STACKS), stacks, allocator);
+    profile.AddMember(rapidjson::StringRef(JSON_ELEM_FRAMES), frames, allocator);
+    profile.AddMember(rapidjson::StringRef(JSON_ELEM_THREAD_METADATA), thread_metadata, allocator);
+
+    const std::string own_id = Event::GenerateEventID();
+    if (record != NULL) {
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_PROFILE_VERSION), rapidjson::StringRef("1"), allocator);
+      attributes::EventID(own_id).AddToJson(doc);
+      std::string timestamp = attributes::Timestamp(static_cast<time_t>(ToTimestamp(start_ns))).GetTimestampString();
+      AddString(doc, JSON_ELEM_TIMESTAMP, timestamp, allocator);
+
+      const std::string active_thread_id = std::to_string(record->thread_id);
+      rapidjson::Value transaction(rapidjson::kObjectType);
+      AddString(transaction, JSON_ELEM_PROFILE_ID, event_id, allocator);
+      AddString(transaction, JSON_ELEM_PROFILE_NAME, record->name, allocator);
+      AddString(transaction, JSON_ELEM_TRACE_ID, record->trace_id, allocator);
+      AddString(transaction, JSON_ELEM_ACTIVE_THREAD_ID, active_thread_id, allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_TRANSACTION), transaction, allocator);
+    }
+    else {
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_PROFILE_VERSION), rapidjson::StringRef("2"), allocator);
+      AddString(doc, JSON_ELEM_PROFILER_ID, _profiler_id, allocator);
+      AddString(doc, JSON_ELEM_CHUNK_ID, own_id, allocator);
+    }
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_PLATFORM), rapidjson::StringRef(EVENT_PLATFORM), allocator);
+    ModuleRegistry::GetInstance().AddToJson(doc);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_PROFILE), profile, allocator);
+    return true;
+  }
+
+  /*! @brief Seconds since the epoch for a steady clock reading
+  */
+  inline double Profiler::ToTimestamp(const int64_t &steady_ns) const {
+    return static_cast<double>(_system_origin + (steady_ns - _steady_origin)) / 1e9;
+  }
+
+  inline void Profiler::AddString(rapidjson::Value &object, const char *key, const std::string &value, rapidjson::Document::AllocatorType &allocator) {
+    rapidjson::Value string(rapidjson::kStringType);
+    string.SetString(value.data(), static_cast<rapidjson::SizeType>(value.size()), allocator);
+    object.AddMember(rapidjson::StringRef(key), string, allocator);
+  }
+
+  /*! @brief One collector tick: drain the rings, and send a chunk in continuous mode when one is due
+  */
+  inline void Profiler::Collect() {
+    Drain();
+    if (_mode == MODE_CONTINUOUS && std::chrono::steady_clock::now() - _last_chunk >= _chunk_interval) {
+      FlushChunk();
+      _last_chunk = std::chrono::steady_clock::now();
+    }
+  }
+
+  /*! @brief A random id shared by every chunk from this profiler
+  */
+  inline const std::string& Profiler::GetProfilerID() const {
+    return _profiler_id;
+  }
+
+  /*! @brief Samples moved out of the rings so far
+  */
+  inline uint64_t Profiler::GetSampleCount() const {
+    return _sampled.load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Samples lost to full rings, full tables or threads without a ring
+  */
+  inline uint64_t Profiler::GetDroppedCount() const {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+  inline size_t Profiler::GetStackCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stacks.size();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_PROFILER_H_
\ No newline at end of file
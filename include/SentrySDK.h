@@ -10,8 +10,8 @@
 #define SENTRY_SDK_H_
 #include <string>
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
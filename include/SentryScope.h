@@ -0,0 +1,385 @@
+/********************************************//**
+* @file SentryScope.h
+* @brief Global, thread and local scopes for Sentry events
+* @details https://docs.sentry.io/clientdev/interfaces/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_SCOPE_H_
+#define SENTRY_SCOPE_H_
+#include <string>
+#include <map>
+#include <memory>
+#include <atomic>
+
+#include "SentryUser.h"
+#include "SentryContext.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const char * const JSON_ELEM_TAGS = "tags";
+  const char * const JSON_ELEM_EXTRA = "extra";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief One immutable layer of scope data
+  *   @details Nodes are never changed once published. An edit copies the node,
+  *   changes the copy and publishes it in place of the original, so anyone
+  *   holding the old node keeps a consistent view. Local scopes point at the
+  *   layer they were pushed on, down to the thread's base layer.
+  */
+  class ScopeNode {
+  public:
+    ScopeNode(const std::shared_ptr<const ScopeNode> &parent = std::shared_ptr<const ScopeNode>());
+
+    const std::shared_ptr<const ScopeNode>& GetParent() const;
+
+    bool HasUser() const;
+    const User& GetUser() const;
+    const std::map<std::string, std::string>& GetTags() const;
+    const std::map<std::string, std::string>& GetExtra() const;
+    const std::map<std::string, std::shared_ptr<const ContextGeneral> >& GetContexts() const;
+
+  private:
+    std::shared_ptr<const ScopeNode> _parent;
+    bool _has_user;
+    User _user;
+    std::map<std::string, std::string> _tags;
+    std::map<std::string, std::string> _extra;
+    std::map<std::string, std::shared_ptr<const ContextGeneral> > _contexts;  // Keyed by context type
+
+    friend class Scope;
+
+  }; // class ScopeNode
+
+  /*! @brief The scope layers in effect at capture time
+  *   @details Taking one only copies two shared pointers. Merge the layers
+  *   with AddToJson on the worker thread; inner layers win over outer ones
+  *   and the thread's layers win over the global scope.
+  */
+  class ScopeSnapshot {
+  public:
+    ScopeSnapshot();
+    ScopeSnapshot(const std::shared_ptr<const ScopeNode> &global, const std::shared_ptr<const ScopeNode> &local);
+
+    bool IsEmpty() const;
+
+    const std::shared_ptr<const ScopeNode>& GetGlobal() const;
+    const std::shared_ptr<const ScopeNode>& GetLocal() const;
+
+    void AddToJson(rapidjson::Document &doc) const;
+
+  private:
+    std::shared_ptr<const ScopeNode> _global;
+    std::shared_ptr<const ScopeNode> _local;
+
+  }; // class ScopeSnapshot
+
+  /*! @brief An editable handle on a scope layer
+  *   @details Global() is shared by all threads and edited with
+  *   compare-and-swap. Current() is the innermost layer of the calling
+  *   thread; Push() and Pop() add and remove local layers on top of it.
+  */
+  class Scope {
+  public:
+    static Scope& Global();
+    static Scope& Current();
+
+    static void Push();
+    static void Pop();
+    static size_t GetDepth();
+
+    static ScopeSnapshot Capture();
+
+    std::shared_ptr<const ScopeNode> GetNode() const;
+
+    void SetUser(const User &user);
+    void SetTag(const std::string &key, const std::string &value);
+    void RemoveTag(const std::string &key);
+    void SetExtra(const std::string &key, const std::string &value);
+    void RemoveExtra(const std::string &key);
+    void SetContext(const std::shared_ptr<const ContextGeneral> &context);
+    void Clear();
+
+  protected:
+    explicit Scope(const bool &is_global);
+
+    template <typename Edit>
+    void Update(const Edit &edit);
+
+  private:
+    Scope(const Scope &other);
+    Scope& operator = (const Scope &other);
+
+    bool _is_global;
+    size_t _depth;
+    std::shared_ptr<const ScopeNode> _node;
+
+  }; // class Scope
+
+  /*! @brief Pushes a local scope for its lifetime
+  */
+  class LocalScope {
+  public:
+    LocalScope();
+    ~LocalScope();
+
+  private:
+    LocalScope(const LocalScope &other);
+    LocalScope& operator = (const LocalScope &other);
+
+  }; // class LocalScope
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline ScopeNode::ScopeNode(const std::shared_ptr<const ScopeNode> &parent) :
+    _parent(parent), _has_user(false) {
+  }
+
+  inline const std::shared_ptr<const ScopeNode>& ScopeNode::GetParent() const {
+    return _parent;
+  }
+
+  inline bool ScopeNode::HasUser() const {
+    return _has_user;
+  }
+
+  inline const User & ScopeNode::GetUser() const {
+    return _user;
+  }
+
+  inline const std::map<std::string, std::string>& ScopeNode::GetTags() const {
+    return _tags;
+  }
+
+  inline const std::map<std::string, std::string>& ScopeNode::GetExtra() const {
+    return _extra;
+  }
+
+  inline const std::map<std::string, std::shared_ptr<const ContextGeneral> >& ScopeNode::GetContexts() const {
+    return _contexts;
+  }
+
+  /*!
+  */
+  inline ScopeSnapshot::ScopeSnapshot() {
+  }
+
+  inline ScopeSnapshot::ScopeSnapshot(const std::shared_ptr<const ScopeNode> &global, const std::shared_ptr<const ScopeNode> &local) :
+    _global(global), _local(local) {
+  }
+
+  inline bool ScopeSnapshot::IsEmpty() const {
+    return (!_global && !_local);
+  }
+
+  inline const std::shared_ptr<const ScopeNode>& ScopeSnapshot::GetGlobal() const {
+    return _global;
+  }
+
+  inline const std::shared_ptr<const ScopeNode>& ScopeSnapshot::GetLocal() const {
+    return _local;
+  }
+
+  /*! @brief Merge the layers and add user, tags, extra and contexts to an event
+  */
+  inline void ScopeSnapshot::AddToJson(rapidjson::Document &doc) const {
+    const User *user = NULL;
+    std::map<std::string, std::string> tags;
+    std::map<std::string, std::string> extra;
+    std::map<std::string, std::shared_ptr<const ContextGeneral> > contexts;
+
+    // Innermost first; insert() keeps the first value seen for a key
+    const ScopeNode *layers[] = { _local.get(), _global.get() };
+    for (size_t i = 0; i < 2; ++i) {
+      for (const ScopeNode *node = layers[i]; node != NULL; node = node->GetParent().get()) {
+        if (user == NULL && node->HasUser()) {
+          user = &node->GetUser();
+        }
+        tags.insert(node->GetTags().begin(), node->GetTags().end());
+        extra.insert(node->GetExtra().begin(), node->GetExtra().end());
+        contexts.insert(node->GetContexts().begin(), node->GetContexts().end());
+      }
+    }
+
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    if (user != NULL && user->IsValid()) {
+      user->AddToJson(doc);
+    }
+
+    const char * const names[] = { JSON_ELEM_TAGS, JSON_ELEM_EXTRA };
+    const std::map<std::string, std::string> *values[] = { &tags, &extra };
+    for (size_t i = 0; i < 2; ++i) {
+      if (values[i]->empty()) { continue; }
+
+      rapidjson::Value object(rapidjson::kObjectType);
+      for (auto entry = values[i]->cbegin(); entry != values[i]->cend(); ++entry) {
+        rapidjson::Value key(rapidjson::kStringType);
+        key.SetString(entry->first.data(), static_cast<rapidjson::SizeType>(entry->first.size()), allocator);
+
+        rapidjson::Value value(rapidjson::kStringType);
+        value.SetString(entry->second.data(), static_cast<rapidjson::SizeType>(entry->second.size()), allocator);
+
+        object.AddMember(key, value, allocator);
+      }
+      doc.AddMember(rapidjson::StringRef(names[i]), object, allocator);
+    }
+
+    if (!contexts.empty()) {
+      rapidjson::Value object(rapidjson::kObjectType);
+      for (auto context = contexts.cbegin(); context != contexts.cend(); ++context) {
+        rapidjson::Value key(rapidjson::kStringType);
+        key.SetString(context->first.data(), static_cast<rapidjson::SizeType>(context->first.size()), allocator);
+
+        rapidjson::Document context_doc(&allocator);
+        context->second->ToJson(context_doc);
+        object.AddMember(key, context_doc, allocator);
+      }
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_CONTEXTS), object, allocator);
+    }
+  }
+
+  /*!
+  */
+  inline Scope::Scope(const bool &is_global) :
+    _is_global(is_global), _depth(0), _node(std::make_shared<const ScopeNode>()) {
+  }
+
+  /*! @brief The scope shared by every thread
+  */
+  inline Scope& Scope::Global() {
+    static Scope global(true);
+    return global;
+  }
+
+  /*! @brief The calling thread's innermost scope
+  */
+  inline Scope& Scope::Current() {
+    static thread_local Scope current(false);
+    return current;
+  }
+
+  /*! @brief Start a local scope that inherits the current one
+  */
+  inline void Scope::Push() {
+    Scope &current = Current();
+    current._node = std::make_shared<const ScopeNode>(current._node);
+    ++current._depth;
+  }
+
+  /*! @brief Drop the innermost local scope; the thread's base scope is kept
+  */
+  inline void Scope::Pop() {
+    Scope &current = Current();
+    if (current._depth == 0) { return; }
+    current._node = current._node->GetParent();
+    --current._depth;
+  }
+
+  inline size_t Scope::GetDepth() {
+    return Current()._depth;
+  }
+
+  /*! @brief Take the global and thread layers as they are now
+  */
+  inline ScopeSnapshot Scope::Capture() {
+    return ScopeSnapshot(Global().GetNode(), Current().GetNode());
+  }
+
+  inline std::shared_ptr<const ScopeNode> Scope::GetNode() const {
+    if (_is_global) {
+      return std::atomic_load(&_node);
+    }
+    return _node;
+  }
+
+  /*! @brief Copy the node, apply an edit and publish the copy
+  */
+  template <typename Edit>
+  inline void Scope::Update(const Edit &edit) {
+    if (!_is_global) {
+      std::shared_ptr<ScopeNode> copy = std::make_shared<ScopeNode>(*_node);
+      edit(*copy);
+      _node = copy;
+      return;
+    }
+
+    std::shared_ptr<const ScopeNode> expected = std::atomic_load(&_node);
+    std::shared_ptr<const ScopeNode> desired;
+    do {
+      std::shared_ptr<ScopeNode> copy = std::make_shared<ScopeNode>(*expected);
+      edit(*copy);
+      desired = copy;
+    } while (!std::atomic_compare_exchange_weak(&_node, &expected, desired));
+  }
+
+  inline void Scope::SetUser(const User &user) {
+    Update([&user](ScopeNode &node) {
+      node._user = user;
+      node._has_user = true;
+    });
+  }
+
+  inline void Scope::SetTag(const std::string &key, const std::string &value) {
+    Update([&key, &value](ScopeNode &node) { node._tags[key] = value; });
+  }
+
+  inline void Scope::RemoveTag(const std::string &key) {
+    Update([&key](ScopeNode &node) { node._tags.erase(key); });
+  }
+
+  inline void Scope::SetExtra(const std::string &key, const std::string &value) {
+    Update([&key, &value](ScopeNode &node) { node._extra[key] = value; });
+  }
+
+  inline void Scope::RemoveExtra(const std::string &key) {
+    Update([&key](ScopeNode &node) { node._extra.erase(key); });
+  }
+
+  inline void Scope::SetContext(const std::shared_ptr<const ContextGeneral> &context) {
+    if (!context || !context->IsValid()) { return; }
+    Update([&context](ScopeNode &node) { node._contexts[context->GetType()] = context; });
+  }
+
+  /*! @brief Remove everything set on this layer, outer layers are untouched
+  */
+  inline void Scope::Clear() {
+    Update([](ScopeNode &node) {
+      ScopeNode empty(node._parent);
+      node = empty;
+    });
+  }
+
+  /*!
+  */
+  inline LocalScope::LocalScope() {
+    Scope::Push();
+  }
+
+  inline LocalScope::~LocalScope() {
+    Scope::Pop();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_SCOPE_H_
\ No newline at end of file
@@ -0,0 +1,475 @@
+/********************************************//**
+* @file SentrySessions.h
+* @brief Release health sessions, counted per minute and sent in aggregate
+* @details https://develop.sentry.dev/sdk/sessions/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_SESSIONS_H_
+#define SENTRY_SESSIONS_H_
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <ctime>
+#include <stdint.h>
+
+#include "SentryAttributes.h"
+#include "SentryUser.h"
+#include "SentryEnvelope.h"
+#include "SentryFlusher.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t SESSION_BUCKET_COUNT = 64;   // Minutes held without locking, power of two
+  const size_t SESSION_SHARD_COUNT = 16;    // Locks for sessions with a user, power of two
+
+  const int64_t SESSION_BUCKET_FREE = 0;
+  const int64_t SESSION_BUCKET_CLOSING = -1;
+
+  const char * const SESSION_ITEM_TYPE = "sessions";
+
+  const char * const JSON_ELEM_SESSION_AGGREGATES = "aggregates";
+  const char * const JSON_ELEM_SESSION_ATTRS = "attrs";
+  const char * const JSON_ELEM_SESSION_STARTED = "started";
+  const char * const JSON_ELEM_SESSION_DID = "did";
+  const char * const JSON_ELEM_SESSION_EXITED = "exited";
+  const char * const JSON_ELEM_SESSION_ERRORED = "errored";
+  const char * const JSON_ELEM_SESSION_CRASHED = "crashed";
+  const char * const JSON_ELEM_SESSION_ABNORMAL = "abnormal";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief How a session ended
+  */
+  enum SessionStatus {
+    SESSION_EXITED = 0,
+    SESSION_ERRORED,
+    SESSION_CRASHED,
+    SESSION_ABNORMAL,
+    SESSION_STATUS_COUNT
+  };
+
+  /*! @brief Ended sessions that started in one minute
+  */
+  struct SessionBucket {
+    std::atomic<int64_t> minute;      // Free, closing, or the minute being counted
+    std::atomic<uint32_t> writers;    // Threads between reading minute and counting
+    std::atomic<uint64_t> counts[SESSION_STATUS_COUNT];
+  };
+
+  /*! @brief Ended sessions with a user, keyed by minute and distinct id
+  */
+  struct SessionShard {
+    typedef std::pair<int64_t, std::string> Key;
+    struct Counts { uint64_t values[SESSION_STATUS_COUNT]; };
+
+    std::mutex mutex;
+    std::map<Key, Counts> counts;
+  };
+
+  class SessionTracker;
+
+  /*! @brief One session, ended once by End() or by going out of scope
+  *   @details Nothing is counted until the session ends, and then only a
+  *   counter in the minute it started is touched.
+  */
+  class Session {
+  public:
+    Session(Session &&other);
+    Session& operator = (Session &&other);
+    ~Session();
+
+    bool IsValid() const;
+
+    const std::string& GetDistinctID() const;
+
+    void MarkErrored();
+    void End(const SessionStatus &status = SESSION_EXITED);
+
+  protected:
+    friend class SessionTracker;
+    Session(SessionTracker *tracker, const int64_t &minute, const std::string &did);
+
+  private:
+    Session(const Session &other);
+    Session& operator = (const Session &other);
+
+    SessionTracker *_tracker;
+    int64_t _minute;
+    std::string _did;
+    bool _is_errored;
+
+  }; // class Session
+
+  /*! @brief Counts sessions for one release and sends them as a sessions item
+  *   @details Sessions without a user are counted in a ring of per-minute
+  *   buckets with atomic counters. Sessions with a user are counted per
+  *   distinct id behind a small set of locks, so crash free users can be
+  *   worked out. Every interval the finished minutes are written into one
+  *   envelope and passed to the sink.
+  */
+  class SessionTracker {
+  public:
+    typedef std::function<void(const std::string &envelope)> Sink;
+
+    SessionTracker(const attributes::Release &release, const attributes::Environment &environment, const Sink &sink,
+      const std::chrono::milliseconds &interval = std::chrono::milliseconds(60000));
+    ~SessionTracker();
+
+    bool IsValid() const;
+
+    const attributes::Release& GetRelease() const;
+    const attributes::Environment& GetEnvironment() const;
+
+    Session StartSession();
+    Session StartSession(const User &user);
+
+    void Record(const int64_t &minute, const std::string &did, const SessionStatus &status);
+    void RecordCrash(const std::time_t &crashed_at, const std::string &did = std::string());
+    size_t Flush(const bool &force = false);
+
+    void Start();
+    void Stop();
+
+    static int64_t CurrentMinute();
+    static std::string GetDistinctID(const User &user);
+
+  protected:
+    bool RecordInBucket(const int64_t &minute, const SessionStatus &status);
+    void RecordInShard(const int64_t &minute, const std::string &did, const SessionStatus &status);
+    std::string MakeEnvelope(const std::map<SessionShard::Key, SessionShard::Counts> &aggregates) const;
+
+  private:
+    SessionTracker(const SessionTracker &other);
+    SessionTracker& operator = (const SessionTracker &other);
+
+    attributes::Release _release;
+    attributes::Environment _environment;
+    Sink _sink;
+
+    std::unique_ptr<SessionBucket[]> _buckets;
+    std::unique_ptr<SessionShard[]> _shards;
+
+    std::mutex _flush_mutex;
+    PeriodicFlusher _flusher;
+
+  }; // class SessionTracker
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline Session::Session(SessionTracker *tracker, const int64_t &minute, const std::string &did) :
+    _tracker(tracker), _minute(minute), _did(did), _is_errored(false) {
+  }
+
+  inline Session::Session(Session &&other) :
+    _tracker(other._tracker), _minute(other._minute), _did(std::move(other._did)), _is_errored(other._is_errored) {
+    other._tracker = NULL;
+  }
+
+  inline Session& Session::operator = (Session &&other) {
+    if (this != &other) {
+      End();
+      _tracker = other._tracker;
+      _minute = other._minute;
+      _did = std::move(other._did);
+      _is_errored = other._is_errored;
+      other._tracker = NULL;
+    }
+    return *this;
+  }
+
+  /*! @brief A session still open when it goes out of scope exited normally
+  */
+  inline Session::~Session() {
+    End();
+  }
+
+  /*! @brief False once the session has ended or been moved from
+  */
+  inline bool Session::IsValid() const {
+    return (_tracker != NULL);
+  }
+
+  inline const std::string& Session::GetDistinctID() const {
+    return _did;
+  }
+
+  /*! @brief An error was captured during the session
+  */
+  inline void Session::MarkErrored() {
+    _is_errored = true;
+  }
+
+  /*! @brief End the session; an exited session with errors counts as errored
+  */
+  inline void Session::End(const SessionStatus &status) {
+    if (_tracker == NULL) { return; }
+
+    SessionStatus final_status = status;
+    if (final_status == SESSION_EXITED && _is_errored) {
+      final_status = SESSION_ERRORED;
+    }
+    _tracker->Record(_minute, _did, final_status);
+    _tracker = NULL;
+  }
+
+  /*!
+  */
+  inline SessionTracker::SessionTracker(const attributes::Release &release, const attributes::Environment &environment, const Sink &sink,
+    const std::chrono::milliseconds &interval) :
+    _release(release), _environment(environment), _sink(sink),
+    _buckets(new SessionBucket[SESSION_BUCKET_COUNT]),
+    _shards(new SessionShard[SESSION_SHARD_COUNT]),
+    _flusher([this]() { Flush(); }, interval) {
+    for (size_t i = 0; i < SESSION_BUCKET_COUNT; ++i) {
+      _buckets[i].minute.store(SESSION_BUCKET_FREE, std::memory_order_relaxed);
+      _buckets[i].writers.store(0, std::memory_order_relaxed);
+      for (size_t j = 0; j < SESSION_STATUS_COUNT; ++j) {
+        _buckets[i].counts[j].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /*! @brief Stop the interval thread and send what is left
+  */
+  inline SessionTracker::~SessionTracker() {
+    Stop();
+    Flush(true);
+  }
+
+  /*! @brief Sessions need a release to be accepted
+  */
+  inline bool SessionTracker::IsValid() const {
+    return _release.IsValid();
+  }
+
+  inline const attributes::Release& SessionTracker::GetRelease() const {
+    return _release;
+  }
+
+  inline const attributes::Environment& SessionTracker::GetEnvironment() const {
+    return _environment;
+  }
+
+  inline Session SessionTracker::StartSession() {
+    return Session(this, CurrentMinute(), std::string());
+  }
+
+  inline Session SessionTracker::StartSession(const User &user) {
+    return Session(this, CurrentMinute(), GetDistinctID(user));
+  }
+
+  /*! @brief Minutes since the epoch, never zero
+  */
+  inline int64_t SessionTracker::CurrentMinute() {
+    std::chrono::system_clock::duration since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    int64_t minute = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::minutes>(since_epoch).count());
+    return (minute > SESSION_BUCKET_FREE) ? minute : 1;
+  }
+
+  /*! @brief The user's id, falling back to email, username and IP address
+  */
+  inline std::string SessionTracker::GetDistinctID(const User &user) {
+    if (!user.GetUserUniqueID().empty()) { return user.GetUserUniqueID(); }
+    if (!user.GetEmail().empty()) { return user.GetEmail(); }
+    if (!user.GetUsername().empty()) { return user.GetUsername(); }
+    return user.GetIPAddress();
+  }
+
+  /*! @brief Count one ended session against the minute it started in
+  */
+  inline void SessionTracker::Record(const int64_t &minute, const std::string &did, const SessionStatus &status) {
+    if (status < SESSION_EXITED || status >= SESSION_STATUS_COUNT) { return; }
+
+    if (did.empty() && RecordInBucket(minute, status)) { return; }
+    RecordInShard(minute, did, status);
+  }
+
+  /*! @brief Count a session that a crash of the previous run left open
+  *   @details A crash ends the process before its open sessions can end, so
+  *   nothing was counted for them. Fed from a pending crash report on the next
+  *   start, this counts the crashed session against the minute of the crash,
+  *   since the minute it started was lost with the process. The tracker should
+  *   be for the release that crashed.
+  */
+  inline void SessionTracker::RecordCrash(const std::time_t &crashed_at, const std::string &did) {
+    const int64_t minute = static_cast<int64_t>(crashed_at) / 60;
+    Record((minute > SESSION_BUCKET_FREE) ? minute : CurrentMinute(), did, SESSION_CRASHED);
+  }
+
+  /*! @brief Count in the minute's bucket, claiming it if free
+  *   @return false if the bucket holds another minute or is being flushed
+  */
+  inline bool SessionTracker::RecordInBucket(const int64_t &minute, const SessionStatus &status) {
+    SessionBucket &bucket = _buckets[static_cast<size_t>(minute) & (SESSION_BUCKET_COUNT - 1)];
+
+    // Flush closes a bucket and then waits for writers, so a writer that
+    // sees the minute after announcing itself is counted before the reset
+    bucket.writers.fetch_add(1);
+    int64_t current = bucket.minute.load();
+    if (current == SESSION_BUCKET_FREE) {
+      bucket.minute.compare_exchange_strong(current, minute);
+      if (current == SESSION_BUCKET_FREE) { current = minute; }
+    }
+
+    const bool is_counted = (current == minute);
+    if (is_counted) {
+      bucket.counts[status].fetch_add(1, std::memory_order_relaxed);
+    }
+    bucket.writers.fetch_sub(1, std::memory_order_release);
+    return is_counted;
+  }
+
+  inline void SessionTracker::RecordInShard(const int64_t &minute, const std::string &did, const SessionStatus &status) {
+    SessionShard &shard = _shards[std::hash<std::string>()(did) & (SESSION_SHARD_COUNT - 1)];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::map<SessionShard::Key, SessionShard::Counts>::iterator found = shard.counts.find(SessionShard::Key(minute, did));
+    if (found == shard.counts.end()) {
+      SessionShard::Counts counts = { { 0 } };
+      found = shard.counts.insert(std::make_pair(SessionShard::Key(minute, did), counts)).first;
+    }
+    ++found->second.values[status];
+  }
+
+  /*! @brief Send every finished minute as one sessions envelope
+  *   @details The current minute is held back unless forced, so each minute
+  *   is normally sent once. Sessions ending later still count against the
+  *   minute they started in and go out with the next flush.
+  *   @return the number of aggregates sent
+  */
+  inline size_t SessionTracker::Flush(const bool &force) {
+    std::lock_guard<std::mutex> lock(_flush_mutex);
+
+    const int64_t now = CurrentMinute();
+    std::map<SessionShard::Key, SessionShard::Counts> aggregates;
+
+    for (size_t i = 0; i < SESSION_BUCKET_COUNT; ++i) {
+      SessionBucket &bucket = _buckets[i];
+      int64_t minute = bucket.minute.load();
+      if (minute == SESSION_BUCKET_FREE || (!force && minute >= now)) { continue; }
+      if (!bucket.minute.compare_exchange_strong(minute, SESSION_BUCKET_CLOSING)) { continue; }
+      while (bucket.writers.load() != 0) {
+        std::this_thread::yield();
+      }
+
+      SessionShard::Counts counts = { { 0 } };
+      uint64_t total = 0;
+      for (size_t j = 0; j < SESSION_STATUS_COUNT; ++j) {
+        counts.values[j] = bucket.counts[j].exchange(0, std::memory_order_relaxed);
+        total += counts.values[j];
+      }
+      bucket.minute.store(SESSION_BUCKET_FREE);
+      if (total != 0) {
+        aggregates[SessionShard::Key(minute, std::string())] = counts;
+      }
+    }
+
+    for (size_t i = 0; i < SESSION_SHARD_COUNT; ++i) {
+      SessionShard &shard = _shards[i];
+      std::lock_guard<std::mutex> shard_lock(shard.mutex);
+      std::map<SessionShard::Key, SessionShard::Counts>::iterator it = shard.counts.begin();
+      while (it != shard.counts.end()) {
+        if (!force && it->first.first >= now) {
+          ++it;
+          continue;
+        }
+        SessionShard::Counts &merged = aggregates[it->first];
+        for (size_t j = 0; j < SESSION_STATUS_COUNT; ++j) {
+          merged.values[j] += it->second.values[j];
+        }
+        shard.counts.erase(it++);
+      }
+    }
+
+    if (aggregates.empty() || !IsValid()) { return 0; }
+    if (_sink) {
+      _sink(MakeEnvelope(aggregates));
+    }
+    return aggregates.size();
+  }
+
+  /*! @brief An envelope with a single sessions item
+  *   @details The aggregates are ordered by minute, then by distinct id.
+  */
+  inline std::string SessionTracker::MakeEnvelope(const std::map<SessionShard::Key, SessionShard::Counts> &aggregates) const {
+    static const char * const names[SESSION_STATUS_COUNT] = {
+      JSON_ELEM_SESSION_EXITED, JSON_ELEM_SESSION_ERRORED, JSON_ELEM_SESSION_CRASHED, JSON_ELEM_SESSION_ABNORMAL
+    };
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Document::AllocatorType &allocator = doc.GetAllocator();
+
+    rapidjson::Value values(rapidjson::kArrayType);
+    std::map<SessionShard::Key, SessionShard::Counts>::const_iterator it;
+    for (it = aggregates.begin(); it != aggregates.end(); ++it) {
+      rapidjson::Value aggregate(rapidjson::kObjectType);
+
+      std::string started = attributes::Timestamp(static_cast<time_t>(it->first.first * 60)).GetTimestampString();
+      rapidjson::Value started_value(rapidjson::kStringType);
+      started_value.SetString(started.data(), static_cast<rapidjson::SizeType>(started.size()), allocator);
+      aggregate.AddMember(rapidjson::StringRef(JSON_ELEM_SESSION_STARTED), started_value, allocator);
+
+      if (!it->first.second.empty()) {
+        rapidjson::Value did(rapidjson::kStringType);
+        did.SetString(it->first.second.data(), static_cast<rapidjson::SizeType>(it->first.second.size()), allocator);
+        aggregate.AddMember(rapidjson::StringRef(JSON_ELEM_SESSION_DID), did, allocator);
+      }
+
+      for (size_t j = 0; j < SESSION_STATUS_COUNT; ++j) {
+        if (it->second.values[j] == 0) { continue; }
+        aggregate.AddMember(rapidjson::StringRef(names[j]), it->second.values[j], allocator);
+      }
+      values.PushBack(aggregate, allocator);
+    }
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_SESSION_AGGREGATES), values, allocator);
+
+    rapidjson::Document attrs(&allocator);
+    attrs.SetObject();
+    _release.AddToJson(attrs);
+    _environment.AddToJson(attrs);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_SESSION_ATTRS), attrs, allocator);
+
+    return EnvelopeWriter::MakeEnvelope(SESSION_ITEM_TYPE, doc);
+  }
+
+  /*! @brief Flush every interval on a background thread until Stop()
+  */
+  inline void SessionTracker::Start() {
+    _flusher.Start();
+  }
+
+  inline void SessionTracker::Stop() {
+    _flusher.Stop();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_SESSIONS_H_
\ No newline at end of file
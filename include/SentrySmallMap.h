@@ -0,0 +1,383 @@
+/********************************************//**
+* @file SentrySmallMap.h
+* @brief A sorted map stored in one contiguous block
+* @details Small string-keyed maps without a node allocation per entry
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_SMALL_MAP_H_
+#define SENTRY_SMALL_MAP_H_
+#include <string>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <new>
+#include <initializer_list>
+#include <type_traits>
+
+#include "SentryStringView.h"
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief String keys to values, kept sorted in an array
+  *   @details The first Capacity entries live inside the map itself; larger
+  *   maps move to the heap. Lookups take a StringView, so callers holding a
+  *   char pointer or a JSON string never build a std::string to search.
+  *   Iteration is in key order, as with std::map.
+  */
+  template <typename Value, size_t Capacity = 4>
+  class SmallMap {
+  public:
+    typedef std::pair<std::string, Value> value_type;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+
+    SmallMap();
+    SmallMap(const SmallMap &other);
+    SmallMap(SmallMap &&other);
+    SmallMap(const std::map<std::string, Value> &values);
+    SmallMap(std::initializer_list<value_type> values);
+    ~SmallMap();
+
+    SmallMap& operator = (const SmallMap &other);
+    SmallMap& operator = (SmallMap &&other);
+
+    bool operator == (const SmallMap &other) const;
+    bool operator != (const SmallMap &other) const;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_iterator cbegin() const;
+    const_iterator cend() const;
+
+    size_t size() const;
+    bool empty() const;
+    size_t capacity() const;
+    bool IsInline() const;
+
+    iterator find(const StringView &key);
+    const_iterator find(const StringView &key) const;
+    size_t count(const StringView &key) const;
+
+    Value& operator [] (const StringView &key);
+    std::pair<iterator, bool> insert(const StringView &key, const Value &value);
+    std::pair<iterator, bool> emplace(std::string &&key, Value &&value);
+    size_t erase(const StringView &key);
+    void clear();
+    void reserve(const size_t &count);
+
+  protected:
+    iterator LowerBound(const StringView &key) const;
+    iterator Insert(iterator position, std::string &&key, Value &&value);
+    void Grow(const size_t &count);
+    void Release();
+    void Steal(SmallMap &other);
+
+  private:
+    typedef typename std::aligned_storage<sizeof(value_type), std::alignment_of<value_type>::value>::type Storage;
+
+    value_type *_data;
+    size_t _size;
+    size_t _capacity;
+    Storage _inline[Capacity];
+
+  }; // class SmallMap
+
+  typedef SmallMap<std::string> StringMap;
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::SmallMap() :
+    _data(reinterpret_cast<value_type*>(_inline)), _size(0), _capacity(Capacity) {
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::SmallMap(const SmallMap &other) :
+    _data(reinterpret_cast<value_type*>(_inline)), _size(0), _capacity(Capacity) {
+    reserve(other._size);
+    for (; _size < other._size; ++_size) {
+      new (_data + _size) value_type(other._data[_size]);
+    }
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::SmallMap(SmallMap &&other) :
+    _data(reinterpret_cast<value_type*>(_inline)), _size(0), _capacity(Capacity) {
+    Steal(other);
+  }
+
+  /*! @brief Copy a std::map, which is already in key order
+  */
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::SmallMap(const std::map<std::string, Value> &values) :
+    _data(reinterpret_cast<value_type*>(_inline)), _size(0), _capacity(Capacity) {
+    reserve(values.size());
+    for (auto value = values.cbegin(); value != values.cend(); ++value, ++_size) {
+      new (_data + _size) value_type(value->first, value->second);
+    }
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::SmallMap(std::initializer_list<value_type> values) :
+    _data(reinterpret_cast<value_type*>(_inline)), _size(0), _capacity(Capacity) {
+    reserve(values.size());
+    for (auto value = values.begin(); value != values.end(); ++value) {
+      insert(value->first, value->second);
+    }
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>::~SmallMap() {
+    Release();
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>& SmallMap<Value, Capacity>::operator = (const SmallMap &other) {
+    if (this != &other) {
+      SmallMap copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline SmallMap<Value, Capacity>& SmallMap<Value, Capacity>::operator = (SmallMap &&other) {
+    if (this != &other) {
+      Release();
+      Steal(other);
+    }
+    return *this;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline bool SmallMap<Value, Capacity>::operator == (const SmallMap &other) const {
+    return (_size == other._size) && std::equal(begin(), end(), other.begin());
+  }
+
+  template <typename Value, size_t Capacity>
+  inline bool SmallMap<Value, Capacity>::operator != (const SmallMap &other) const {
+    return !(operator==(other));
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::iterator SmallMap<Value, Capacity>::begin() {
+    return _data;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::iterator SmallMap<Value, Capacity>::end() {
+    return _data + _size;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::const_iterator SmallMap<Value, Capacity>::begin() const {
+    return _data;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::const_iterator SmallMap<Value, Capacity>::end() const {
+    return _data + _size;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::const_iterator SmallMap<Value, Capacity>::cbegin() const {
+    return _data;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::const_iterator SmallMap<Value, Capacity>::cend() const {
+    return _data + _size;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline size_t SmallMap<Value, Capacity>::size() const {
+    return _size;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline bool SmallMap<Value, Capacity>::empty() const {
+    return (_size == 0);
+  }
+
+  template <typename Value, size_t Capacity>
+  inline size_t SmallMap<Value, Capacity>::capacity() const {
+    return _capacity;
+  }
+
+  /*! @brief True while the entries fit inside the map
+  */
+  template <typename Value, size_t Capacity>
+  inline bool SmallMap<Value, Capacity>::IsInline() const {
+    return (_data == reinterpret_cast<const value_type*>(_inline));
+  }
+
+  /*! @brief The first entry whose key is not less than key
+  */
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::iterator SmallMap<Value, Capacity>::LowerBound(const StringView &key) const {
+    return std::lower_bound(_data, _data + _size, key, [](const value_type &entry, const StringView &value) {
+      return StringView(entry.first) < value;
+    });
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::iterator SmallMap<Value, Capacity>::find(const StringView &key) {
+    iterator position = LowerBound(key);
+    return (position != end() && StringView(position->first) == key) ? position : end();
+  }
+
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::const_iterator SmallMap<Value, Capacity>::find(const StringView &key) const {
+    iterator position = LowerBound(key);
+    return (position != end() && StringView(position->first) == key) ? position : end();
+  }
+
+  template <typename Value, size_t Capacity>
+  inline size_t SmallMap<Value, Capacity>::count(const StringView &key) const {
+    return (find(key) != end()) ? 1 : 0;
+  }
+
+  /*! @brief The value for key, inserting a default value if there is none
+  */
+  template <typename Value, size_t Capacity>
+  inline Value& SmallMap<Value, Capacity>::operator [] (const StringView &key) {
+    iterator position = LowerBound(key);
+    if (position != end() && StringView(position->first) == key) {
+      return position->second;
+    }
+    return Insert(position, key.ToString(), Value())->second;
+  }
+
+  /*! @brief Add an entry unless the key is already present
+  */
+  template <typename Value, size_t Capacity>
+  inline std::pair<typename SmallMap<Value, Capacity>::iterator, bool> SmallMap<Value, Capacity>::insert(const StringView &key, const Value &value) {
+    iterator position = LowerBound(key);
+    if (position != end() && StringView(position->first) == key) {
+      return std::make_pair(position, false);
+    }
+    return std::make_pair(Insert(position, key.ToString(), Value(value)), true);
+  }
+
+  template <typename Value, size_t Capacity>
+  inline std::pair<typename SmallMap<Value, Capacity>::iterator, bool> SmallMap<Value, Capacity>::emplace(std::string &&key, Value &&value) {
+    iterator position = LowerBound(key);
+    if (position != end() && position->first == key) {
+      return std::make_pair(position, false);
+    }
+    return std::make_pair(Insert(position, std::move(key), std::move(value)), true);
+  }
+
+  template <typename Value, size_t Capacity>
+  inline size_t SmallMap<Value, Capacity>::erase(const StringView &key) {
+    iterator position = find(key);
+    if (position == end()) { return 0; }
+
+    std::move(position + 1, end(), position);
+    _data[--_size].~value_type();
+    return 1;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline void SmallMap<Value, Capacity>::clear() {
+    for (size_t i = 0; i < _size; ++i) {
+      _data[i].~value_type();
+    }
+    _size = 0;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline void SmallMap<Value, Capacity>::reserve(const size_t &count) {
+    if (count > _capacity) {
+      Grow(count);
+    }
+  }
+
+  /*! @brief Place a new entry at position, shifting the later ones up
+  */
+  template <typename Value, size_t Capacity>
+  inline typename SmallMap<Value, Capacity>::iterator SmallMap<Value, Capacity>::Insert(iterator position, std::string &&key, Value &&value) {
+    if (_size == _capacity) {
+      size_t index = static_cast<size_t>(position - _data);
+      Grow(_capacity * 2);
+      position = _data + index;
+    }
+
+    if (position == end()) {
+      new (_data + _size) value_type(std::move(key), std::move(value));
+      ++_size;
+      return position;
+    }
+
+    new (_data + _size) value_type(std::move(_data[_size - 1]));
+    std::move_backward(position, end() - 1, end());
+    ++_size;
+    position->first = std::move(key);
+    position->second = std::move(value);
+    return position;
+  }
+
+  /*! @brief Move the entries to a heap block holding at least count entries
+  */
+  template <typename Value, size_t Capacity>
+  inline void SmallMap<Value, Capacity>::Grow(const size_t &count) {
+    size_t capacity = std::max(count, _capacity * 2);
+    value_type *data = static_cast<value_type*>(::operator new(capacity * sizeof(value_type)));
+    for (size_t i = 0; i < _size; ++i) {
+      new (data + i) value_type(std::move(_data[i]));
+      _data[i].~value_type();
+    }
+    if (!IsInline()) {
+      ::operator delete(_data);
+    }
+    _data = data;
+    _capacity = capacity;
+  }
+
+  template <typename Value, size_t Capacity>
+  inline void SmallMap<Value, Capacity>::Release() {
+    clear();
+    if (!IsInline()) {
+      ::operator delete(_data);
+    }
+    _data = reinterpret_cast<value_type*>(_inline);
+    _capacity = Capacity;
+  }
+
+  /*! @brief Take the heap block, or move the inline entries one by one
+  *   @details Expects this map to be empty and inline; leaves other that way.
+  */
+  template <typename Value, size_t Capacity>
+  inline void SmallMap<Value, Capacity>::Steal(SmallMap &other) {
+    if (!other.IsInline()) {
+      _data = other._data;
+      _size = other._size;
+      _capacity = other._capacity;
+      other._data = reinterpret_cast<value_type*>(other._inline);
+      other._size = 0;
+      other._capacity = Capacity;
+      return;
+    }
+    for (; _size < other._size; ++_size) {
+      new (_data + _size) value_type(std::move(other._data[_size]));
+    }
+    other.clear();
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_SMALL_MAP_H_
\ No newline at end of file
@@ -0,0 +1,510 @@
+/********************************************//**
+* @file SentrySourceContext.h
+* @brief Source context lines for Sentry Frames
+* @details https://docs.sentry.io/clientdev/interfaces/stacktrace/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_SOURCE_CONTEXT_H_
+#define SENTRY_SOURCE_CONTEXT_H_
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "SentryStringView.h"
+#include "SentryStacktrace.h"
+#include "SentryEvent.h"
+#include "SentryThreads.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const int SOURCE_CONTEXT_LINES = 5;
+  const size_t SOURCE_CONTEXT_MAX_MAPPED_BYTES = 64 * 1024 * 1024;
+  const size_t SOURCE_CONTEXT_MAX_MISSING = 1024;     // Paths remembered as unreadable before starting over
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A memory-mapped source file with an index of line starts
+  */
+  class SourceFile {
+  public:
+    SourceFile(const std::string &path);
+    ~SourceFile();
+
+    bool IsValid() const;
+    bool IsCurrent() const;
+
+    const std::string& GetPath() const;
+    size_t GetMappedSize() const;
+    int GetLineCount() const;
+
+    StringView GetLine(const int &lineno) const;
+
+  protected:
+    void Map(const std::string &path);
+    void IndexLines();
+
+  private:
+    SourceFile(const SourceFile &other);
+    SourceFile& operator = (const SourceFile &other);
+
+    std::string _path;
+    const char *_data;
+    size_t _size;
+    int64_t _mtime;
+    bool _is_valid;
+    std::vector<uint32_t> _line_starts;
+
+  }; // class SourceFile
+
+  /*! @brief Loads source context into frames from an LRU cache of mapped files
+  *   @details Files are mapped on first use and evicted least recently used
+  *   first once the mapped total goes over the configured limit. A file that
+  *   changed size or time since it was mapped is mapped again, so a file
+  *   truncated under the cache is not read past its end. Files are checked and
+  *   mapped outside the lock. Apply is meant for a worker thread: it does
+  *   nothing on a thread marked with ScopedCaptureThread and stops when its
+  *   time budget runs out. Client::AddSourceContext runs it as a processor.
+  */
+  class SourceContextCache {
+  public:
+    SourceContextCache(const size_t &max_mapped_bytes = SOURCE_CONTEXT_MAX_MAPPED_BYTES,
+      const int &context_lines = SOURCE_CONTEXT_LINES);
+
+    bool Apply(Frame &frame);
+    bool Apply(rapidjson::Value &frame, rapidjson::Document::AllocatorType &allocator);
+    size_t Apply(Stacktrace &stacktrace, const std::chrono::microseconds &budget = std::chrono::microseconds(2000));
+    size_t Apply(Event &event, const std::chrono::microseconds &budget = std::chrono::microseconds(2000));
+
+    size_t GetMappedBytes() const;
+    size_t GetFileCount() const;
+    size_t GetMissingCount() const;
+    void Clear();
+
+    static bool IsCaptureThread();
+
+  protected:
+    std::shared_ptr<const SourceFile> GetFile(const std::string &path);
+    bool GetContext(const std::string &path, const int &lineno, std::vector<std::string> &pre_context,
+      std::string &context_line, std::vector<std::string> &post_context);
+    size_t ApplyFrames(rapidjson::Value &values, rapidjson::Document::AllocatorType &allocator,
+      const std::chrono::steady_clock::time_point &deadline);
+    void Remove(const std::shared_ptr<const SourceFile> &file);
+    void Evict();
+
+  private:
+    typedef std::list<std::shared_ptr<const SourceFile> > FileList;
+
+    size_t _max_mapped_bytes;
+    int _context_lines;
+
+    mutable std::mutex _mutex;
+    size_t _mapped_bytes;
+    FileList _files;                                      // Most recently used first
+    std::map<std::string, FileList::iterator> _index;
+    std::set<std::string> _missing;                       // Paths that could not be mapped
+
+    friend class ScopedCaptureThread;
+    static bool& CaptureThreadFlag();
+
+  }; // class SourceContextCache
+
+  /*! @brief Marks the current thread as a capture thread while in scope
+  */
+  class ScopedCaptureThread {
+  public:
+    ScopedCaptureThread();
+    ~ScopedCaptureThread();
+
+  private:
+    bool _previous;
+
+  }; // class ScopedCaptureThread
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline SourceFile::SourceFile(const std::string &path) :
+    _path(path), _data(NULL), _size(0), _mtime(0), _is_valid(false) {
+    Map(path);
+    if (_is_valid) {
+      IndexLines();
+    }
+  }
+
+  inline SourceFile::~SourceFile() {
+#if defined(__linux__)
+    if (_data != NULL) {
+      munmap(const_cast<char *>(_data), _size);
+    }
+#endif
+  }
+
+  inline bool SourceFile::IsValid() const {
+    return _is_valid;
+  }
+
+  /*! @brief Whether the file on disk still has the size and time it was mapped with
+  */
+  inline bool SourceFile::IsCurrent() const {
+#if defined(__linux__)
+    struct stat info;
+    if (stat(_path.c_str(), &info) != 0) { return false; }
+    return (static_cast<size_t>(info.st_size) == _size && static_cast<int64_t>(info.st_mtime) == _mtime);
+#else
+    return _is_valid;
+#endif
+  }
+
+  inline const std::string & SourceFile::GetPath() const {
+    return _path;
+  }
+
+  inline size_t SourceFile::GetMappedSize() const {
+    return _size;
+  }
+
+  inline int SourceFile::GetLineCount() const {
+    return static_cast<int>(_line_starts.size());
+  }
+
+  inline void SourceFile::Map(const std::string &path) {
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return; }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || static_cast<uint64_t>(info.st_size) > UINT32_MAX) {
+      close(fd);
+      return;
+    }
+
+    if (info.st_size > 0) {
+      void *data = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        close(fd);
+        return;
+      }
+      _data = static_cast<const char *>(data);
+      _size = static_cast<size_t>(info.st_size);
+    }
+    _mtime = static_cast<int64_t>(info.st_mtime);
+    close(fd);
+    _is_valid = true;
+#else
+    (void)path;
+#endif
+  }
+
+  /*! @brief Record the offset of every line start
+  */
+  inline void SourceFile::IndexLines() {
+    if (_size == 0) { return; }
+
+    _line_starts.push_back(0);
+    const char *cursor = _data;
+    const char *end = _data + _size;
+    while (cursor < end) {
+      const char *newline = static_cast<const char *>(memchr(cursor, '\n', end - cursor));
+      if (newline == NULL || newline + 1 >= end) { break; }
+      _line_starts.push_back(static_cast<uint32_t>(newline + 1 - _data));
+      cursor = newline + 1;
+    }
+  }
+
+  /*! @brief A view of a line (1-based) without its line ending
+  */
+  inline StringView SourceFile::GetLine(const int &lineno) const {
+    if (lineno < 1 || lineno > GetLineCount()) { return StringView(); }
+
+    size_t begin = _line_starts[lineno - 1];
+    size_t end = (lineno < GetLineCount()) ? _line_starts[lineno] : _size;
+    while (end > begin && (_data[end - 1] == '\n' || _data[end - 1] == '\r')) {
+      --end;
+    }
+    return StringView(_data + begin, end - begin);
+  }
+
+  /*!
+  */
+  inline SourceContextCache::SourceContextCache(const size_t &max_mapped_bytes, const int &context_lines) :
+    _max_mapped_bytes(max_mapped_bytes), _context_lines(context_lines), _mapped_bytes(0) {
+  }
+
+  inline bool& SourceContextCache::CaptureThreadFlag() {
+    static thread_local bool is_capture_thread = false;
+    return is_capture_thread;
+  }
+
+  inline bool SourceContextCache::IsCaptureThread() {
+    return CaptureThreadFlag();
+  }
+
+  inline size_t SourceContextCache::GetMappedBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _mapped_bytes;
+  }
+
+  inline size_t SourceContextCache::GetFileCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _files.size();
+  }
+
+  inline size_t SourceContextCache::GetMissingCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _missing.size();
+  }
+
+  inline void SourceContextCache::Clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _files.clear();
+    _index.clear();
+    _missing.clear();
+    _mapped_bytes = 0;
+  }
+
+  /*! @brief Find or map a file and mark it most recently used
+  */
+  inline std::shared_ptr<const SourceFile> SourceContextCache::GetFile(const std::string &path) {
+    std::shared_ptr<const SourceFile> cached;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      std::map<std::string, FileList::iterator>::iterator found = _index.find(path);
+      if (found != _index.end()) {
+        _files.splice(_files.begin(), _files, found->second);
+        cached = _files.front();
+      } else if (_missing.find(path) != _missing.end()) {
+        return std::shared_ptr<const SourceFile>();
+      }
+    }
+    if (cached && cached->IsCurrent()) {
+      return cached;
+    }
+
+    std::shared_ptr<const SourceFile> file(new SourceFile(path));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (cached) {
+      Remove(cached);
+    }
+    if (!file->IsValid() || file->GetMappedSize() > _max_mapped_bytes) {
+      if (_missing.size() >= SOURCE_CONTEXT_MAX_MISSING) {
+        _missing.clear();
+      }
+      _missing.insert(path);
+      return std::shared_ptr<const SourceFile>();
+    }
+
+    // Another worker may have mapped it meanwhile
+    std::map<std::string, FileList::iterator>::iterator found = _index.find(path);
+    if (found != _index.end()) {
+      _files.splice(_files.begin(), _files, found->second);
+      return _files.front();
+    }
+
+    _files.push_front(file);
+    _index[path] = _files.begin();
+    _mapped_bytes += file->GetMappedSize();
+    Evict();
+    return file;
+  }
+
+  /*! @brief Forget a file that went stale, unless it was already replaced
+  */
+  inline void SourceContextCache::Remove(const std::shared_ptr<const SourceFile> &file) {
+    std::map<std::string, FileList::iterator>::iterator found = _index.find(file->GetPath());
+    if (found == _index.end() || *found->second != file) { return; }
+    _mapped_bytes -= file->GetMappedSize();
+    _files.erase(found->second);
+    _index.erase(found);
+  }
+
+  /*! @brief Drop least recently used files until under the mapped limit
+  *   @details Frames still reading an evicted file keep it mapped until done
+  */
+  inline void SourceContextCache::Evict() {
+    while (_mapped_bytes > _max_mapped_bytes && _files.size() > 1) {
+      const std::shared_ptr<const SourceFile> &oldest = _files.back();
+      _mapped_bytes -= oldest->GetMappedSize();
+      _index.erase(oldest->GetPath());
+      _files.pop_back();
+    }
+  }
+
+  /*! @brief The lines around a line of a file
+  */
+  inline bool SourceContextCache::GetContext(const std::string &path, const int &lineno, std::vector<std::string> &pre_context,
+    std::string &context_line, std::vector<std::string> &post_context) {
+    if (lineno < 1 || path.empty()) { return false; }
+
+    std::shared_ptr<const SourceFile> file = GetFile(path);
+    if (!file || lineno > file->GetLineCount()) { return false; }
+
+    for (int line = std::max(1, lineno - _context_lines); line < lineno; ++line) {
+      pre_context.push_back(file->GetLine(line).ToString());
+    }
+    context_line = file->GetLine(lineno).ToString();
+    for (int line = lineno + 1; line <= std::min(file->GetLineCount(), lineno + _context_lines); ++line) {
+      post_context.push_back(file->GetLine(line).ToString());
+    }
+    return true;
+  }
+
+  /*! @brief Fill a frame's context lines from its abs_path or filename
+  *   @return true if the context line was found
+  */
+  inline bool SourceContextCache::Apply(Frame &frame) {
+    if (IsCaptureThread()) { return false; }
+
+    const std::string &path = frame.GetAbsPath().empty() ? frame.GetFilename() : frame.GetAbsPath();
+    std::vector<std::string> pre_context;
+    std::string context_line;
+    std::vector<std::string> post_context;
+    if (!GetContext(path, frame.GetLineNumber(), pre_context, context_line, post_context)) { return false; }
+
+    frame.SetContext(pre_context, context_line, post_context);
+    return true;
+  }
+
+  /*! @brief Fill the context lines of a frame already serialized into an event
+  */
+  inline bool SourceContextCache::Apply(rapidjson::Value &frame, rapidjson::Document::AllocatorType &allocator) {
+    if (IsCaptureThread() || !frame.IsObject() || frame.HasMember(JSON_ELEM_CONTEXT_LINE)) { return false; }
+
+    std::string path;
+    if (frame.HasMember(JSON_ELEM_ABS_PATH) && frame[JSON_ELEM_ABS_PATH].IsString()) {
+      path = frame[JSON_ELEM_ABS_PATH].GetString();
+    } else if (frame.HasMember(JSON_ELEM_FILENAME) && frame[JSON_ELEM_FILENAME].IsString()) {
+      path = frame[JSON_ELEM_FILENAME].GetString();
+    }
+    const int lineno = (frame.HasMember(JSON_ELEM_LINE_NO) && frame[JSON_ELEM_LINE_NO].IsInt()) ? frame[JSON_ELEM_LINE_NO].GetInt() : -1;
+
+    std::vector<std::string> pre_context;
+    std::string context_line;
+    std::vector<std::string> post_context;
+    if (!GetContext(path, lineno, pre_context, context_line, post_context)) { return false; }
+
+    rapidjson::Value pre(rapidjson::kArrayType);
+    for (size_t i = 0; i < pre_context.size(); ++i) {
+      rapidjson::Value line(rapidjson::kStringType);
+      line.SetString(pre_context[i].data(), static_cast<rapidjson::SizeType>(pre_context[i].size()), allocator);
+      pre.PushBack(line, allocator);
+    }
+    rapidjson::Value line(rapidjson::kStringType);
+    line.SetString(context_line.data(), static_cast<rapidjson::SizeType>(context_line.size()), allocator);
+    rapidjson::Value post(rapidjson::kArrayType);
+    for (size_t i = 0; i < post_context.size(); ++i) {
+      rapidjson::Value post_line(rapidjson::kStringType);
+      post_line.SetString(post_context[i].data(), static_cast<rapidjson::SizeType>(post_context[i].size()), allocator);
+      post.PushBack(post_line, allocator);
+    }
+    frame.AddMember(rapidjson::StringRef(JSON_ELEM_PRE_CONTEXT), pre, allocator);
+    frame.AddMember(rapidjson::StringRef(JSON_ELEM_CONTEXT_LINE), line, allocator);
+    frame.AddMember(rapidjson::StringRef(JSON_ELEM_POST_CONTEXT), post, allocator);
+    return true;
+  }
+
+  /*! @brief Fill the frames of a stacktrace, newest frame first, within a time budget
+  *   @return The number of frames that received context
+  */
+  inline size_t SourceContextCache::Apply(Stacktrace &stacktrace, const std::chrono::microseconds &budget) {
+    if (IsCaptureThread()) { return 0; }
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget;
+    size_t applied = 0;
+
+    std::vector<Frame> &frames = stacktrace.GetFrames();
+    for (std::vector<Frame>::reverse_iterator frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+      if (std::chrono::steady_clock::now() >= deadline) { break; }
+      if (Apply(*frame)) {
+        ++applied;
+      }
+    }
+    return applied;
+  }
+
+  /*! @brief Fill the frames of every exception and thread of an event within a time budget
+  *   @return The number of frames that received context
+  */
+  inline size_t SourceContextCache::Apply(Event &event, const std::chrono::microseconds &budget) {
+    if (IsCaptureThread() || !event.IsValid()) { return 0; }
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + budget;
+    rapidjson::Document &doc = event.GetDocument();
+    size_t applied = 0;
+    if (doc.HasMember(JSON_ELEM_EXCEPTION) && doc[JSON_ELEM_EXCEPTION].IsObject() && doc[JSON_ELEM_EXCEPTION].HasMember(JSON_ELEM_EXCEPTION_VALUES)) {
+      applied += ApplyFrames(doc[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES], doc.GetAllocator(), deadline);
+    }
+    if (doc.HasMember(JSON_ELEM_THREADS) && doc[JSON_ELEM_THREADS].IsObject() && doc[JSON_ELEM_THREADS].HasMember(JSON_ELEM_THREADS_VALUES)) {
+      applied += ApplyFrames(doc[JSON_ELEM_THREADS][JSON_ELEM_THREADS_VALUES], doc.GetAllocator(), deadline);
+    }
+    return applied;
+  }
+
+  /*! @brief Fill the frames of the stacktraces in an array of exceptions or threads, newest frame first
+  */
+  inline size_t SourceContextCache::ApplyFrames(rapidjson::Value &values, rapidjson::Document::AllocatorType &allocator,
+    const std::chrono::steady_clock::time_point &deadline) {
+    if (!values.IsArray()) { return 0; }
+
+    size_t applied = 0;
+    for (rapidjson::SizeType i = 0; i < values.Size(); ++i) {
+      rapidjson::Value &value = values[i];
+      if (!value.IsObject() || !value.HasMember(JSON_ELEM_STACKTRACE)) { continue; }
+      rapidjson::Value &stacktrace = value[JSON_ELEM_STACKTRACE];
+      if (!stacktrace.IsObject() || !stacktrace.HasMember(JSON_ELEM_FRAMES) || !stacktrace[JSON_ELEM_FRAMES].IsArray()) { continue; }
+
+      rapidjson::Value &frames = stacktrace[JSON_ELEM_FRAMES];
+      for (rapidjson::SizeType j = frames.Size(); j > 0; --j) {
+        if (std::chrono::steady_clock::now() >= deadline) { return applied; }
+        if (Apply(frames[j - 1], allocator)) {
+          ++applied;
+        }
+      }
+    }
+    return applied;
+  }
+
+  /*!
+  */
+  inline ScopedCaptureThread::ScopedCaptureThread() :
+    _previous(SourceContextCache::CaptureThreadFlag()) {
+    SourceContextCache::CaptureThreadFlag() = true;
+  }
+
+  inline ScopedCaptureThread::~ScopedCaptureThread() {
+    SourceContextCache::CaptureThreadFlag() = _previous;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_SOURCE_CONTEXT_H_
\ No newline at end of file
@@ -10,11 +10,12 @@
 #define SENTRY_STACKTRACE_H_
 #include <string>
 #include <vector>
+#include <utility>
 
 #include "SentryFrame.h"
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -26,6 +27,10 @@ namespace sentry {
 
   const char * const JSON_ELEM_THREAD_ID = "thread_id";
 
+  const size_t STACKTRACE_CRASH_FRAMES = 64;
+  const size_t STACKTRACE_ROOT_FRAMES = 16;
+  const size_t STACKTRACE_MAX_CYCLE_LENGTH = 8;
+
 } // namespace sentry
 
 /***********************************************
@@ -33,6 +38,27 @@ namespace sentry {
 ***********************************************/
 namespace sentry {
 
+  /*! @brief Limits applied to a Stacktrace before it is serialized
+  *   @details Setting both frame limits to zero keeps every frame
+  */
+  class StacktraceTruncation {
+  public:
+    StacktraceTruncation(const size_t &crash_frames = STACKTRACE_CRASH_FRAMES, const size_t &root_frames = STACKTRACE_ROOT_FRAMES,
+      const bool &collapse_recursion = true, const size_t &max_cycle_length = STACKTRACE_MAX_CYCLE_LENGTH);
+
+    const size_t& GetCrashFrames() const;
+    const size_t& GetRootFrames() const;
+    const bool& IsCollapsingRecursion() const;
+    const size_t& GetMaxCycleLength() const;
+
+  private:
+    size_t _crash_frames;       // Frames kept nearest the crash (the end of the list)
+    size_t _root_frames;        // Frames kept nearest the root (the start of the list)
+    bool _collapse_recursion;   // Drop back-to-back repeats of a call cycle
+    size_t _max_cycle_length;   // Longest call cycle looked for
+
+  }; // class StacktraceTruncation
+
   /*! @brief An Stacktrace in Sentry
   *   @details Per Sentry Documentation, frames are ordered oldest call first
   */
@@ -45,14 +71,23 @@ namespace sentry {
     bool IsValid() const;
 
     const std::vector<Frame>& GetFrames() const;
+    std::vector<Frame>& GetFrames();
+
+    typedef std::pair<size_t, size_t> OmittedRange;
+    const OmittedRange& GetFramesOmitted() const;
+    bool IsTruncated() const;
+    size_t Truncate(const StacktraceTruncation &truncation = StacktraceTruncation());
 
     void ToJson(rapidjson::Document &doc) const;
 
   protected:
     void FromJson(const rapidjson::Value &json);
+    bool IsRepeatedCycle(const size_t &position, const size_t &length) const;
 
   private:
     std::vector<Frame> _frames;
+    OmittedRange _frames_omitted;   // [start, end) of the head/tail split, indexes into the frames before truncation
+    bool _is_truncated;             // Truncated once already, so indexes would no longer match
 
   }; // class Stacktrace
 
@@ -65,15 +100,42 @@ namespace sentry {
 
   /*!
   */
-  inline Stacktrace::Stacktrace() { }
+  inline StacktraceTruncation::StacktraceTruncation(const size_t &crash_frames, const size_t &root_frames,
+    const bool &collapse_recursion, const size_t &max_cycle_length) :
+    _crash_frames(crash_frames), _root_frames(root_frames),
+    _collapse_recursion(collapse_recursion), _max_cycle_length(max_cycle_length) {
+  }
+
+  inline const size_t& StacktraceTruncation::GetCrashFrames() const {
+    return _crash_frames;
+  }
+
+  inline const size_t& StacktraceTruncation::GetRootFrames() const {
+    return _root_frames;
+  }
+
+  inline const bool& StacktraceTruncation::IsCollapsingRecursion() const {
+    return _collapse_recursion;
+  }
+
+  inline const size_t& StacktraceTruncation::GetMaxCycleLength() const {
+    return _max_cycle_length;
+  }
+
+  /*!
+  */
+  inline Stacktrace::Stacktrace() :
+    _frames_omitted(0, 0), _is_truncated(false) {
+  }
 
   inline Stacktrace::Stacktrace(const std::vector<Frame>& frames) :
-    _frames(frames) {
+    _frames(frames), _frames_omitted(0, 0), _is_truncated(false) {
   }
 
   /*!
   */
-  inline Stacktrace::Stacktrace(const rapidjson::Value &json) {
+  inline Stacktrace::Stacktrace(const rapidjson::Value &json) :
+    _frames_omitted(0, 0), _is_truncated(false) {
     FromJson(json);
   }
 
@@ -96,6 +158,93 @@ namespace sentry {
     return _frames;
   }
 
+  inline std::vector<Frame>& Stacktrace::GetFrames() {
+    return _frames;
+  }
+
+  /*! @brief The frames dropped between the root and crash ends, empty if none were
+  */
+  inline const Stacktrace::OmittedRange& Stacktrace::GetFramesOmitted() const {
+    return _frames_omitted;
+  }
+
+  inline bool Stacktrace::IsTruncated() const {
+    return _is_truncated;
+  }
+
+  /*! @brief Check if frames [position, position + length) repeat the frames just before them
+  */
+  inline bool Stacktrace::IsRepeatedCycle(const size_t &position, const size_t &length) const {
+    if (position < length || position + length > _frames.size()) { return false; }
+    for (size_t i = 0; i < length; ++i) {
+      if (_frames[position + i] != _frames[position - length + i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*! @brief Collapse recursion and drop the middle of deep stacks
+  *   @details Walks the frames once to pick the ones to keep, then compacts
+  *   them in place. Repeated call cycles after their first occurrence are
+  *   dropped, then only the frames nearest the crash and nearest the root
+  *   are kept. The frames dropped between the two ends are recorded as the
+  *   single frames_omitted range. A stacktrace is only truncated once, since
+  *   a second pass could not express its range in the original indexes.
+  *   @return The number of frames removed
+  */
+  inline size_t Stacktrace::Truncate(const StacktraceTruncation &truncation) {
+    if (_is_truncated) { return 0; }
+
+    const size_t count = _frames.size();
+    std::vector<size_t> kept;
+    kept.reserve(count);
+
+    size_t position = 0;
+    while (position < count) {
+      size_t cycle = 0;
+      if (truncation.IsCollapsingRecursion()) {
+        for (size_t length = 1; length <= truncation.GetMaxCycleLength(); ++length) {
+          if (IsRepeatedCycle(position, length)) {
+            cycle = length;
+            break;
+          }
+        }
+      }
+
+      if (cycle == 0) {
+        kept.push_back(position);
+        ++position;
+        continue;
+      }
+
+      // Skip every further repeat of the cycle
+      while (IsRepeatedCycle(position, cycle)) {
+        position += cycle;
+      }
+    }
+
+    const size_t root_frames = truncation.GetRootFrames();
+    const size_t crash_frames = truncation.GetCrashFrames();
+    if ((root_frames + crash_frames) > 0 && kept.size() > root_frames + crash_frames) {
+      const size_t start = kept[root_frames];
+      const size_t end = (crash_frames > 0) ? kept[kept.size() - crash_frames] : count;
+      _frames_omitted = OmittedRange(start, end);
+      kept.erase(kept.begin() + root_frames, kept.end() - crash_frames);
+    }
+
+    if (kept.size() == count) { return 0; }
+    _is_truncated = true;
+
+    for (size_t i = 0; i < kept.size(); ++i) {
+      if (i != kept[i]) {
+        _frames[i] = _frames[kept[i]];
+      }
+    }
+    _frames.resize(kept.size());
+    return count - kept.size();
+  }
+
   /*! @brief Construct from a JSON object
   */
   inline void Stacktrace::FromJson(const rapidjson::Value & json) {
@@ -115,6 +264,18 @@ namespace sentry {
         }
       }
     }
+
+    if (json.HasMember(JSON_ELEM_FRAMES_OMITTED)) {
+      const rapidjson::Value &frames_omitted = json[JSON_ELEM_FRAMES_OMITTED];
+      if (!frames_omitted.IsNull()) {
+        if (frames_omitted.IsArray()) {
+          if (frames_omitted.Size() == 2 && frames_omitted[0].IsUint() && frames_omitted[1].IsUint()) {
+            _frames_omitted = OmittedRange(frames_omitted[0].GetUint(), frames_omitted[1].GetUint());
+            _is_truncated = true;
+          }
+        }
+      }
+    }
   }
 
   /*! @brief Convert to a JSON object
@@ -133,6 +294,13 @@ namespace sentry {
       frames.PushBack(frame_doc, allocator);
     }
     doc.AddMember(rapidjson::StringRef(JSON_ELEM_FRAMES), frames, allocator);
+
+    if (_frames_omitted.second > _frames_omitted.first) {
+      rapidjson::Value frames_omitted(rapidjson::kArrayType);
+      frames_omitted.PushBack(static_cast<unsigned>(_frames_omitted.first), allocator);
+      frames_omitted.PushBack(static_cast<unsigned>(_frames_omitted.second), allocator);
+      doc.AddMember(rapidjson::StringRef(JSON_ELEM_FRAMES_OMITTED), frames_omitted, allocator);
+    }
   }
 
 } // namespace sentry
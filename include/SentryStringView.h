@@ -0,0 +1,128 @@
+/********************************************//**
+* @file SentryStringView.h
+* @brief A non-owning view of a character range
+* @details Stands in for std::string_view, which the supported compilers lack
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_STRING_VIEW_H_
+#define SENTRY_STRING_VIEW_H_
+#include <string>
+#include <string.h>
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A pointer and a length into memory owned by someone else
+  */
+  class StringView {
+  public:
+    StringView();
+    StringView(const char *data);
+    StringView(const char *data, const size_t &size);
+    StringView(const std::string &value);
+
+    bool operator == (const StringView& other) const;
+    bool operator != (const StringView& other) const;
+    bool operator < (const StringView& other) const;
+
+    const char* data() const;
+    size_t size() const;
+    bool empty() const;
+
+    const char* begin() const;
+    const char* end() const;
+
+    int compare(const StringView &other) const;
+    StringView substr(const size_t &position, const size_t &count = std::string::npos) const;
+    std::string ToString() const;
+
+  private:
+    const char *_data;
+    size_t _size;
+
+  }; // class StringView
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline StringView::StringView() :
+    _data(""), _size(0) {
+  }
+
+  inline StringView::StringView(const char *data) :
+    _data(data != NULL ? data : ""), _size(data != NULL ? strlen(data) : 0) {
+  }
+
+  inline StringView::StringView(const char *data, const size_t &size) :
+    _data(data != NULL ? data : ""), _size(data != NULL ? size : 0) {
+  }
+
+  inline StringView::StringView(const std::string &value) :
+    _data(value.data()), _size(value.size()) {
+  }
+
+  inline bool StringView::operator == (const StringView& other) const {
+    return (_size == other._size) && (memcmp(_data, other._data, _size) == 0);
+  }
+
+  inline bool StringView::operator != (const StringView& other) const {
+    return !(operator==(other));
+  }
+
+  inline bool StringView::operator < (const StringView& other) const {
+    return compare(other) < 0;
+  }
+
+  inline const char* StringView::data() const {
+    return _data;
+  }
+
+  inline size_t StringView::size() const {
+    return _size;
+  }
+
+  inline bool StringView::empty() const {
+    return (_size == 0);
+  }
+
+  inline const char* StringView::begin() const {
+    return _data;
+  }
+
+  inline const char* StringView::end() const {
+    return _data + _size;
+  }
+
+  /*! @brief Lexicographic comparison, same ordering as std::string::compare
+  */
+  inline int StringView::compare(const StringView &other) const {
+    size_t length = (_size < other._size) ? _size : other._size;
+    int result = (length > 0) ? memcmp(_data, other._data, length) : 0;
+    if (result != 0) { return result; }
+    if (_size == other._size) { return 0; }
+    return (_size < other._size) ? -1 : 1;
+  }
+
+  inline StringView StringView::substr(const size_t &position, const size_t &count) const {
+    if (position >= _size) { return StringView(); }
+    size_t remaining = _size - position;
+    return StringView(_data + position, (count < remaining) ? count : remaining);
+  }
+
+  inline std::string StringView::ToString() const {
+    return std::string(_data, _size);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_STRING_VIEW_H_
\ No newline at end of file
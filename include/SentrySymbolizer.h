@@ -0,0 +1,120 @@
+/********************************************//**
+* @file SentrySymbolizer.h
+* @brief Turns raw instruction addresses into Sentry Frames
+* @details https://docs.sentry.io/clientdev/interfaces/stacktrace/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_SYMBOLIZER_H_
+#define SENTRY_SYMBOLIZER_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include "SentryStacktrace.h"
+#include "SentryDebugMeta.h"
+#include "SentryElf.h"
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Symbolizes addresses against loaded modules, mapping each module once
+  *   @details Not thread safe; use one per batch of stacks on a worker thread.
+  */
+  class Symbolizer {
+  public:
+    Symbolizer();
+
+    Frame Symbolize(const DebugImage *image, const uint64_t &address, const bool &is_return_address);
+    Stacktrace Symbolize(const ModuleSnapshot *snapshot, const std::vector<uint64_t> &addresses);
+
+    size_t GetImageCount() const;
+
+  protected:
+    const ElfImage& GetImage(const std::string &path);
+
+  private:
+    Symbolizer(const Symbolizer &other);
+    Symbolizer& operator = (const Symbolizer &other);
+
+    std::map<std::string, std::unique_ptr<ElfImage> > _images;
+
+  }; // class Symbolizer
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline Symbolizer::Symbolizer() {
+  }
+
+  inline size_t Symbolizer::GetImageCount() const {
+    return _images.size();
+  }
+
+  inline const ElfImage& Symbolizer::GetImage(const std::string &path) {
+    std::unique_ptr<ElfImage> &image = _images[path];
+    if (!image) {
+      image.reset(new ElfImage(path));
+    }
+    return *image;
+  }
+
+  /*! @brief Build a frame for one address
+  *   @details Return addresses point past the call, so the call itself is looked up.
+  *   Frames that cannot be resolved keep the module name, or the address if no
+  *   module contains them.
+  */
+  inline Frame Symbolizer::Symbolize(const DebugImage *image, const uint64_t &address, const bool &is_return_address) {
+    Frame frame;
+    if (image != NULL) {
+      const ElfImage &elf = GetImage(image->GetCodeFile());
+      uint64_t offset = address - image->GetImageAddr();
+      if (is_return_address && offset > 0) {
+        --offset;
+      }
+      if (elf.IsValid()) {
+        frame = elf.Symbolize(offset + elf.GetBaseAddress());
+      }
+      if (!frame.IsValid()) {
+        const std::string &code_file = image->GetCodeFile();
+        size_t separator = code_file.find_last_of('/');
+        frame = Frame(std::string(), std::string(),
+          (separator != std::string::npos) ? code_file.substr(separator + 1) : code_file);
+      }
+      frame.SetImageAddr(DebugImage::FormatAddress(image->GetImageAddr()));
+      frame.SetPackage(image->GetCodeFile());
+    } else {
+      frame = Frame(std::string(), DebugImage::FormatAddress(address));
+    }
+    frame.SetInstructionAddr(DebugImage::FormatAddress(address));
+    return frame;
+  }
+
+  /*! @brief Build a stacktrace from addresses ordered newest call first
+  *   @details The first address is the interrupted instruction, the rest are
+  *   return addresses. Frames come out oldest call first, as Sentry expects.
+  */
+  inline Stacktrace Symbolizer::Symbolize(const ModuleSnapshot *snapshot, const std::vector<uint64_t> &addresses) {
+    std::vector<Frame> frames;
+    frames.reserve(addresses.size());
+    for (size_t i = addresses.size(); i-- > 0;) {
+      const DebugImage *image = (snapshot != NULL) ? snapshot->FindImage(addresses[i]) : NULL;
+      frames.push_back(Symbolize(image, addresses[i], i > 0));
+    }
+    return Stacktrace(frames);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_SYMBOLIZER_H_
\ No newline at end of file
@@ -0,0 +1,403 @@
+/********************************************//**
+* @file SentryThreadCapture.h
+* @brief Raw stack capture of every thread in the process
+* @details https://docs.sentry.io/clientdev/interfaces/thread/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_THREAD_CAPTURE_H_
+#define SENTRY_THREAD_CAPTURE_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <ucontext.h>
+#include <sys/syscall.h>
+#endif
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t THREAD_CAPTURE_MAX_THREADS = 4096;
+  const size_t THREAD_CAPTURE_MAX_FRAMES = 64;
+  const size_t THREAD_CAPTURE_WALK_FRAMES = 256;
+  const int THREAD_CAPTURE_SIGNAL_OFFSET = 4;   // Added to SIGRTMIN
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief A stack shared by one or more threads, newest call first
+  */
+  struct CapturedStack {
+    std::vector<int> thread_ids;
+    std::vector<uint64_t> addresses;
+    bool is_current;
+  };
+
+  /*! @brief A preassigned place for one thread to write its stack
+  *   @details The state word packs the capture ticket with the slot state, so
+  *   a late signal from an earlier capture can never claim a reused slot.
+  */
+  struct ThreadStackSlot {
+    std::atomic<uint64_t> state;
+    int thread_id;
+    uint32_t count;
+    uint64_t frames[THREAD_CAPTURE_MAX_FRAMES];
+  };
+
+  /*! @brief Captures the raw stacks of all threads by signalling each one
+  *   @details Every thread is sent a real-time signal carrying its slot ticket,
+  *   and unwinds itself into its slot from the signal handler. Threads that do
+  *   not answer before the timeout are left out. Identical stacks are grouped,
+  *   so the callers' work grows with the number of distinct stacks.
+  */
+  class ThreadCapture {
+  public:
+    static ThreadCapture& GetInstance();
+
+    std::vector<CapturedStack> Capture(const std::chrono::milliseconds &timeout);
+    const size_t& GetTimedOutCount() const;
+
+    static int GetSignal();
+    static int GetCurrentThreadID();
+    static std::vector<int> ListThreadIDs();
+    static std::string ReadThreadName(const int &thread_id);
+
+    static uint64_t GetContextAddress(const void *context);
+    static size_t CaptureStack(const void *context, uint64_t *addresses, const size_t &max_frames);
+
+  protected:
+    ThreadCapture();
+
+    bool Prepare();
+#if defined(__linux__)
+    static void HandleSignal(int signal, siginfo_t *info, void *context);
+#endif
+
+  private:
+    ThreadCapture(const ThreadCapture &other);
+    ThreadCapture& operator = (const ThreadCapture &other);
+
+    enum SlotState { kSlotPending = 0, kSlotWriting = 1, kSlotDone = 2, kSlotAbandoned = 3 };
+
+    std::mutex _mutex;
+    std::unique_ptr<ThreadStackSlot[]> _slots;  // Allocated once and never freed, late signals may still arrive
+    std::atomic<ThreadStackSlot *> _published;
+    uint64_t _generation;
+    size_t _timed_out;
+
+  }; // class ThreadCapture
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline ThreadCapture::ThreadCapture() :
+    _published(NULL), _generation(0), _timed_out(0) {
+  }
+
+  /*! @brief The capture shared by the whole process
+  */
+  inline ThreadCapture& ThreadCapture::GetInstance() {
+    static ThreadCapture capture;
+    return capture;
+  }
+
+  /*! @brief Threads that did not answer during the last capture
+  */
+  inline const size_t & ThreadCapture::GetTimedOutCount() const {
+    return _timed_out;
+  }
+
+  inline int ThreadCapture::GetSignal() {
+#if defined(__linux__)
+    return SIGRTMIN + THREAD_CAPTURE_SIGNAL_OFFSET;
+#else
+    return -1;
+#endif
+  }
+
+  inline int ThreadCapture::GetCurrentThreadID() {
+#if defined(__linux__)
+    return static_cast<int>(syscall(SYS_gettid));
+#else
+    return -1;
+#endif
+  }
+
+  /*! @brief The ids of every thread in the process
+  */
+  inline std::vector<int> ThreadCapture::ListThreadIDs() {
+    std::vector<int> thread_ids;
+#if defined(__linux__)
+    DIR *tasks = opendir("/proc/self/task");
+    if (tasks == NULL) { return thread_ids; }
+
+    for (struct dirent *entry = readdir(tasks); entry != NULL; entry = readdir(tasks)) {
+      int thread_id = atoi(entry->d_name);
+      if (thread_id > 0) {
+        thread_ids.push_back(thread_id);
+      }
+    }
+    closedir(tasks);
+#endif
+    return thread_ids;
+  }
+
+  inline std::string ThreadCapture::ReadThreadName(const int &thread_id) {
+    std::string name;
+#if defined(__linux__)
+    std::string path = "/proc/self/task/" + std::to_string(thread_id) + "/comm";
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return name; }
+
+    char buffer[64];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (length > 0) {
+      name.assign(buffer, static_cast<size_t>(length));
+      while (!name.empty() && name[name.size() - 1] == '\n') {
+        name.erase(name.size() - 1);
+      }
+    }
+#else
+    (void)thread_id;
+#endif
+    return name;
+  }
+
+  /*! @brief The interrupted instruction of a signal context, or 0
+  */
+  inline uint64_t ThreadCapture::GetContextAddress(const void *context) {
+#if defined(__linux__)
+    if (context == NULL) { return 0; }
+    const ucontext_t *ucontext = static_cast<const ucontext_t *>(context);
+#if defined(__x86_64__)
+    return static_cast<uint64_t>(ucontext->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__i386__)
+    return static_cast<uint64_t>(ucontext->uc_mcontext.gregs[REG_EIP]);
+#elif defined(__aarch64__)
+    return static_cast<uint64_t>(ucontext->uc_mcontext.pc);
+#else
+    (void)ucontext;
+#endif
+#else
+    (void)context;
+#endif
+    return 0;
+  }
+
+  /*! @brief Unwind the current thread, newest call first
+  *   @details Async-signal-safe once backtrace() has been called outside a handler.
+  *   With a signal context the handler's own frames are dropped and the
+  *   interrupted instruction comes first.
+  *   @return The number of addresses written
+  */
+  inline size_t ThreadCapture::CaptureStack(const void *context, uint64_t *addresses, const size_t &max_frames) {
+    size_t count = 0;
+#if defined(__linux__)
+    if (max_frames == 0) { return 0; }
+
+    const uint64_t pc = GetContextAddress(context);
+    if (pc != 0) {
+      addresses[count++] = pc;
+    }
+
+    void *walk[THREAD_CAPTURE_WALK_FRAMES];
+    int walked = backtrace(walk, static_cast<int>(THREAD_CAPTURE_WALK_FRAMES));
+    int first = 0;
+    if (pc != 0) {
+      for (int i = 0; i < walked; ++i) {
+        if (reinterpret_cast<uintptr_t>(walk[i]) == pc) {
+          first = i + 1;
+          break;
+        }
+      }
+    }
+    for (int i = first; i < walked && count < max_frames; ++i) {
+      addresses[count++] = reinterpret_cast<uintptr_t>(walk[i]);
+    }
+#else
+    (void)context;
+    (void)addresses;
+    (void)max_frames;
+#endif
+    return count;
+  }
+
+#if defined(__linux__)
+  /*! @brief Write the interrupted stack into the slot named by the signal's ticket
+  */
+  inline void ThreadCapture::HandleSignal(int, siginfo_t *info, void *context) {
+    if (info == NULL || info->si_code != SI_QUEUE || info->si_pid != getpid()) { return; }
+
+    ThreadStackSlot *slots = GetInstance()._published.load(std::memory_order_acquire);
+    if (slots == NULL) { return; }
+
+    const int saved_errno = errno;
+    const uint64_t ticket = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(info->si_value.sival_ptr));
+    ThreadStackSlot &slot = slots[ticket % THREAD_CAPTURE_MAX_THREADS];
+
+    uint64_t expected = (ticket << 2) | kSlotPending;
+    if (slot.state.compare_exchange_strong(expected, (ticket << 2) | kSlotWriting, std::memory_order_acquire)) {
+      slot.count = static_cast<uint32_t>(CaptureStack(context, slot.frames, THREAD_CAPTURE_MAX_FRAMES));
+      slot.state.store((ticket << 2) | kSlotDone, std::memory_order_release);
+    }
+    errno = saved_errno;
+  }
+#endif
+
+  /*! @brief Allocate the slots and install the signal handler on first use
+  */
+  inline bool ThreadCapture::Prepare() {
+#if defined(__linux__)
+    if (_slots) { return true; }
+
+    // backtrace() loads the unwinder on first use, which must not happen in the handler
+    void *warm_up[4];
+    backtrace(warm_up, 4);
+
+    _slots.reset(new ThreadStackSlot[THREAD_CAPTURE_MAX_THREADS]);
+    for (size_t i = 0; i < THREAD_CAPTURE_MAX_THREADS; ++i) {
+      _slots[i].state.store(kSlotAbandoned);
+    }
+    _published.store(_slots.get(), std::memory_order_release);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &ThreadCapture::HandleSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    return (sigaction(GetSignal(), &action, NULL) == 0);
+#else
+    return false;
+#endif
+  }
+
+  /*! @brief Capture every thread's stack and group identical stacks
+  *   @details Stacks are grouped in the order their first thread was listed.
+  */
+  inline std::vector<CapturedStack> ThreadCapture::Capture(const std::chrono::milliseconds &timeout) {
+    std::vector<CapturedStack> stacks;
+#if defined(__linux__)
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!Prepare()) { return stacks; }
+
+    std::vector<int> thread_ids = ListThreadIDs();
+    if (thread_ids.size() > THREAD_CAPTURE_MAX_THREADS) {
+      thread_ids.resize(THREAD_CAPTURE_MAX_THREADS);
+    }
+
+    const uint64_t generation = ++_generation;
+    const int current = GetCurrentThreadID();
+    const pid_t process = getpid();
+    const int signal = GetSignal();
+
+    for (size_t i = 0; i < thread_ids.size(); ++i) {
+      ThreadStackSlot &slot = _slots[i];
+      const uint64_t ticket = generation * THREAD_CAPTURE_MAX_THREADS + i;
+      slot.thread_id = thread_ids[i];
+      slot.count = 0;
+
+      if (thread_ids[i] == current) {
+        slot.count = static_cast<uint32_t>(CaptureStack(NULL, slot.frames, THREAD_CAPTURE_MAX_FRAMES));
+        slot.state.store((ticket << 2) | kSlotDone, std::memory_order_release);
+        continue;
+      }
+
+      slot.state.store((ticket << 2) | kSlotPending, std::memory_order_release);
+
+      siginfo_t info;
+      memset(&info, 0, sizeof(info));
+      info.si_signo = signal;
+      info.si_code = SI_QUEUE;
+      info.si_pid = process;
+      info.si_uid = getuid();
+      info.si_value.sival_ptr = reinterpret_cast<void *>(static_cast<uintptr_t>(ticket));
+      if (syscall(SYS_rt_tgsigqueueinfo, process, thread_ids[i], signal, &info) != 0) {
+        slot.state.store((ticket << 2) | kSlotAbandoned, std::memory_order_release);
+      }
+    }
+
+    // Wait for the answers, then close every slot still pending
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    size_t pending = thread_ids.size();
+    while (pending > 0 && std::chrono::steady_clock::now() < deadline) {
+      pending = 0;
+      for (size_t i = 0; i < thread_ids.size(); ++i) {
+        if ((_slots[i].state.load(std::memory_order_acquire) & 3) < kSlotDone) {
+          ++pending;
+        }
+      }
+      if (pending > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+
+    _timed_out = 0;
+    std::map<std::vector<uint64_t>, size_t> groups;
+    for (size_t i = 0; i < thread_ids.size(); ++i) {
+      ThreadStackSlot &slot = _slots[i];
+      const uint64_t ticket = generation * THREAD_CAPTURE_MAX_THREADS + i;
+
+      uint64_t expected = (ticket << 2) | kSlotPending;
+      if (slot.state.compare_exchange_strong(expected, (ticket << 2) | kSlotAbandoned, std::memory_order_acq_rel)) {
+        ++_timed_out;
+        continue;
+      }
+      while ((slot.state.load(std::memory_order_acquire) & 3) == kSlotWriting) {
+        std::this_thread::yield();
+      }
+      if ((slot.state.load(std::memory_order_acquire) & 3) != kSlotDone || slot.count == 0) { continue; }
+
+      std::vector<uint64_t> addresses(slot.frames, slot.frames + slot.count);
+      std::map<std::vector<uint64_t>, size_t>::iterator group = groups.find(addresses);
+      if (group == groups.end()) {
+        group = groups.insert(std::make_pair(addresses, stacks.size())).first;
+        CapturedStack stack;
+        stack.addresses.swap(addresses);
+        stack.is_current = false;
+        stacks.push_back(stack);
+      }
+
+      CapturedStack &stack = stacks[group->second];
+      stack.thread_ids.push_back(slot.thread_id);
+      if (slot.thread_id == current) {
+        stack.is_current = true;
+      }
+    }
+#else
+    (void)timeout;
+#endif
+    return stacks;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_THREAD_CAPTURE_H_
\ No newline at end of file
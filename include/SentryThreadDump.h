@@ -0,0 +1,89 @@
+/********************************************//**
+* @file SentryThreadDump.h
+* @brief Capturing Sentry Threads from the running process
+* @details https://docs.sentry.io/clientdev/interfaces/thread/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_THREAD_DUMP_H_
+#define SENTRY_THREAD_DUMP_H_
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "SentryThreads.h"
+#include "SentryThreadCapture.h"
+#include "SentryThreadRegistry.h"
+#include "SentryDebugMeta.h"
+#include "SentrySymbolizer.h"
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief Builds Thread and Threads from the threads of this process
+  *   @details Kept apart from SentryThreads.h so the interfaces can be used
+  *   without the capture, registry and symbolizer machinery.
+  */
+  class ThreadDump {
+  public:
+    static Thread Current(const bool &is_crashed = false, const Stacktrace &stacktrace = Stacktrace());
+    static Threads CaptureAll(const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100));
+
+  private:
+    ThreadDump();
+
+  }; // class ThreadDump
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*! @brief The calling thread, from the thread registry's cache
+  */
+  inline Thread ThreadDump::Current(const bool &is_crashed, const Stacktrace &stacktrace) {
+    return Thread(ThreadRegistry::GetCurrentThreadID(), is_crashed, true, stacktrace, ThreadRegistry::GetCurrentThreadName());
+  }
+
+  /*! @brief Snapshot the stacks of every thread in the process
+  *   @details Each distinct stack is symbolized and sent once, on the current
+  *   thread if it had that stack and otherwise on the first thread that did.
+  *   The other threads with the same stack keep their id and name but carry
+  *   no stacktrace, so the payload grows with the distinct stacks rather than
+  *   with the threads.
+  */
+  inline Threads ThreadDump::CaptureAll(const std::chrono::milliseconds &timeout) {
+    std::vector<CapturedStack> stacks = ThreadCapture::GetInstance().Capture(timeout);
+    const int current_id = ThreadRegistry::GetCurrentThreadID();
+
+    ScopedModuleSnapshot modules;
+    const ModuleSnapshot *snapshot = modules.Get();
+
+    Symbolizer symbolizer;
+    std::vector<Thread> threads;
+    threads.reserve(stacks.size());
+    for (auto stack = stacks.cbegin(); stack != stacks.cend(); ++stack) {
+      const Stacktrace stacktrace = symbolizer.Symbolize(snapshot, stack->addresses);
+      const bool has_current = (std::find(stack->thread_ids.cbegin(), stack->thread_ids.cend(), current_id) != stack->thread_ids.cend());
+      for (auto thread_id = stack->thread_ids.cbegin(); thread_id != stack->thread_ids.cend(); ++thread_id) {
+        std::string name;
+        if (!ThreadRegistry::GetInstance().FindThreadName(*thread_id, name)) {
+          name = ThreadCapture::ReadThreadName(*thread_id);
+        }
+        const bool is_current = (*thread_id == current_id);
+        const bool is_shown = has_current ? is_current : (thread_id == stack->thread_ids.cbegin());
+        threads.push_back(Thread(*thread_id, false, is_current, is_shown ? stacktrace : Stacktrace(), name));
+      }
+    }
+    return Threads(threads);
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_THREAD_DUMP_H_
\ No newline at end of file
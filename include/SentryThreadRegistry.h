@@ -0,0 +1,347 @@
+/********************************************//**
+* @file SentryThreadRegistry.h
+* @brief Cached thread ids and names for Sentry Threads
+* @details https://docs.sentry.io/clientdev/interfaces/thread/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_THREAD_REGISTRY_H_
+#define SENTRY_THREAD_REGISTRY_H_
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t THREAD_REGISTRY_CAPACITY = 4096;   // Power of two
+  const size_t THREAD_NAME_LENGTH = 16;           // Including the terminator, as on Linux
+
+  const int THREAD_REGISTRY_EMPTY = 0;
+  const int THREAD_REGISTRY_REMOVED = -1;
+  const int THREAD_REGISTRY_CLAIMED = -2;
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief One registered thread
+  *   @details The name is only written by its own thread and guarded by a
+  *   sequence counter, which is odd while a write is in progress.
+  */
+  struct ThreadRegistryEntry {
+    std::atomic<int> thread_id;
+    std::atomic<uint32_t> sequence;
+    char name[THREAD_NAME_LENGTH];
+  };
+
+  /*! @brief Process-wide table of thread ids and names
+  *   @details Each thread resolves its id and name once, on first use, and
+  *   keeps them in thread-local storage. The table is an open-addressed hash
+  *   keyed by thread id, written with compare-and-swap and read without locks,
+  *   so all-thread snapshots can name threads without touching /proc.
+  *   Exited threads leave tombstones, which new threads reuse and which turn
+  *   back into empty slots once nothing is probed past them. A forked child
+  *   starts over with a table holding only its one thread.
+  */
+  class ThreadRegistry {
+  public:
+    static ThreadRegistry& GetInstance();
+
+    static const int& GetCurrentThreadID();
+    static const std::string& GetCurrentThreadName();
+    static bool SetCurrentThreadName(const std::string &name);
+
+    bool FindThreadName(const int &thread_id, std::string &name) const;
+    size_t GetThreadCount() const;
+    size_t GetTombstoneCount() const;
+
+  protected:
+    ThreadRegistry();
+
+    ThreadRegistryEntry* Register(const int &thread_id, const std::string &name);
+    void Unregister(ThreadRegistryEntry *entry);
+    void Reset();
+    static void WriteName(ThreadRegistryEntry &entry, const std::string &name);
+    static void AtForkChild();
+
+  private:
+    ThreadRegistry(const ThreadRegistry &other);
+    ThreadRegistry& operator = (const ThreadRegistry &other);
+
+    ThreadRegistryEntry _entries[THREAD_REGISTRY_CAPACITY];
+    std::atomic<size_t> _count;
+
+    friend class ThreadRegistration;
+
+  }; // class ThreadRegistry
+
+  /*! @brief The calling thread's cached id and name, resolved on first use
+  */
+  class ThreadRegistration {
+  public:
+    static ThreadRegistration& Current();
+
+    const int& GetThreadID() const;
+    const std::string& GetName() const;
+    bool SetName(const std::string &name);
+
+  protected:
+    void Register();
+
+  private:
+    ThreadRegistration();
+    ~ThreadRegistration();
+    ThreadRegistration(const ThreadRegistration &other);
+    ThreadRegistration& operator = (const ThreadRegistration &other);
+
+    int _thread_id;
+    std::string _name;
+    ThreadRegistryEntry *_entry;
+
+    friend class ThreadRegistry;
+
+  }; // class ThreadRegistration
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline ThreadRegistry::ThreadRegistry() :
+    _count(0) {
+    for (size_t i = 0; i < THREAD_REGISTRY_CAPACITY; ++i) {
+      _entries[i].thread_id.store(THREAD_REGISTRY_EMPTY, std::memory_order_relaxed);
+      _entries[i].sequence.store(0, std::memory_order_relaxed);
+      _entries[i].name[0] = '\0';
+    }
+#if defined(__linux__)
+    pthread_atfork(NULL, NULL, &ThreadRegistry::AtForkChild);
+#endif
+  }
+
+  /*! @brief Only the forking thread survives in the child, under a new id
+  */
+  inline void ThreadRegistry::AtForkChild() {
+    GetInstance().Reset();
+    ThreadRegistration::Current().Register();
+  }
+
+  /*! @brief Empty the table, only while no other thread can touch it
+  */
+  inline void ThreadRegistry::Reset() {
+    for (size_t i = 0; i < THREAD_REGISTRY_CAPACITY; ++i) {
+      _entries[i].thread_id.store(THREAD_REGISTRY_EMPTY, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+  }
+
+  /*! @brief The registry shared by the whole process
+  */
+  inline ThreadRegistry& ThreadRegistry::GetInstance() {
+    static ThreadRegistry registry;
+    return registry;
+  }
+
+  inline const int& ThreadRegistry::GetCurrentThreadID() {
+    return ThreadRegistration::Current().GetThreadID();
+  }
+
+  inline const std::string& ThreadRegistry::GetCurrentThreadName() {
+    return ThreadRegistration::Current().GetName();
+  }
+
+  /*! @brief Rename the calling thread in the OS, the thread-local cache and the table
+  */
+  inline bool ThreadRegistry::SetCurrentThreadName(const std::string &name) {
+    return ThreadRegistration::Current().SetName(name);
+  }
+
+  inline size_t ThreadRegistry::GetThreadCount() const {
+    return _count.load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Entries left by exited threads that lookups still probe past
+  */
+  inline size_t ThreadRegistry::GetTombstoneCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < THREAD_REGISTRY_CAPACITY; ++i) {
+      if (_entries[i].thread_id.load(std::memory_order_relaxed) == THREAD_REGISTRY_REMOVED) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  /*! @brief Copy a name into an entry under its sequence counter
+  */
+  inline void ThreadRegistry::WriteName(ThreadRegistryEntry &entry, const std::string &name) {
+    const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t length = std::min(name.size(), THREAD_NAME_LENGTH - 1);
+    memcpy(entry.name, name.data(), length);
+    entry.name[length] = '\0';
+
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /*! @brief Claim the first free or tombstoned entry for a thread id, or NULL if the table is full
+  */
+  inline ThreadRegistryEntry* ThreadRegistry::Register(const int &thread_id, const std::string &name) {
+    if (thread_id <= 0) { return NULL; }
+
+    const size_t mask = THREAD_REGISTRY_CAPACITY - 1;
+    for (size_t probe = 0; probe < THREAD_REGISTRY_CAPACITY; ++probe) {
+      ThreadRegistryEntry &entry = _entries[(static_cast<size_t>(thread_id) + probe) & mask];
+      int current = entry.thread_id.load(std::memory_order_relaxed);
+      if (current != THREAD_REGISTRY_EMPTY && current != THREAD_REGISTRY_REMOVED) { continue; }
+
+      // Hold the entry while its name is written, then publish it
+      if (entry.thread_id.compare_exchange_strong(current, THREAD_REGISTRY_CLAIMED, std::memory_order_acquire)) {
+        WriteName(entry, name);
+        entry.thread_id.store(thread_id, std::memory_order_release);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        return &entry;
+      }
+    }
+    return NULL;
+  }
+
+  /*! @brief Release an entry when its thread exits
+  *   @details The entry becomes a tombstone so lookups keep probing past it.
+  *   A tombstone followed by an empty slot ends every probe sequence through
+  *   it, so it and the tombstones just before it are emptied again. A thread
+  *   registering at the same moment may land past a slot emptied here; its
+  *   name is then read from the OS instead.
+  */
+  inline void ThreadRegistry::Unregister(ThreadRegistryEntry *entry) {
+    if (entry == NULL) { return; }
+    entry->thread_id.store(THREAD_REGISTRY_REMOVED, std::memory_order_release);
+    _count.fetch_sub(1, std::memory_order_relaxed);
+
+    const size_t mask = THREAD_REGISTRY_CAPACITY - 1;
+    size_t index = static_cast<size_t>(entry - _entries);
+    for (size_t steps = 0; steps < THREAD_REGISTRY_CAPACITY; ++steps) {
+      if (_entries[(index + 1) & mask].thread_id.load(std::memory_order_acquire) != THREAD_REGISTRY_EMPTY) { return; }
+
+      int removed = THREAD_REGISTRY_REMOVED;
+      if (!_entries[index].thread_id.compare_exchange_strong(removed, THREAD_REGISTRY_EMPTY, std::memory_order_acq_rel)) { return; }
+      index = (index + mask) & mask;
+    }
+  }
+
+  /*! @brief Look up a registered thread's name without locking
+  *   @return false if the thread never used the registry
+  */
+  inline bool ThreadRegistry::FindThreadName(const int &thread_id, std::string &name) const {
+    if (thread_id <= 0) { return false; }
+
+    const size_t mask = THREAD_REGISTRY_CAPACITY - 1;
+    for (size_t probe = 0; probe < THREAD_REGISTRY_CAPACITY; ++probe) {
+      const ThreadRegistryEntry &entry = _entries[(static_cast<size_t>(thread_id) + probe) & mask];
+      const int current = entry.thread_id.load(std::memory_order_acquire);
+      if (current == THREAD_REGISTRY_EMPTY) { return false; }
+      if (current != thread_id) { continue; }
+
+      char buffer[THREAD_NAME_LENGTH];
+      uint32_t before = 0;
+      uint32_t after = 0;
+      do {
+        before = entry.sequence.load(std::memory_order_acquire);
+        memcpy(buffer, entry.name, sizeof(buffer));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = entry.sequence.load(std::memory_order_relaxed);
+      } while ((before & 1) != 0 || before != after);
+
+      buffer[THREAD_NAME_LENGTH - 1] = '\0';
+      name = buffer;
+      return true;
+    }
+    return false;
+  }
+
+  /*! @brief The calling thread's registration, created on first use
+  */
+  inline ThreadRegistration& ThreadRegistration::Current() {
+    static thread_local ThreadRegistration registration;
+    return registration;
+  }
+
+  /*! @brief Resolve the id and name, the only syscalls the registry makes for this thread
+  */
+  inline ThreadRegistration::ThreadRegistration() :
+    _thread_id(-1), _entry(NULL) {
+#if defined(__linux__)
+    char name[THREAD_NAME_LENGTH] = "";
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+      _name = name;
+    }
+#endif
+    Register();
+  }
+
+  /*! @brief Resolve the id and add it to the table, again in a forked child
+  */
+  inline void ThreadRegistration::Register() {
+    int thread_id = _thread_id;
+#if defined(__linux__)
+    thread_id = static_cast<int>(syscall(SYS_gettid));
+#endif
+    if (_entry != NULL && _entry->thread_id.load(std::memory_order_relaxed) == thread_id) { return; }
+
+    _thread_id = thread_id;
+    _entry = ThreadRegistry::GetInstance().Register(_thread_id, _name);
+  }
+
+  inline ThreadRegistration::~ThreadRegistration() {
+    ThreadRegistry::GetInstance().Unregister(_entry);
+  }
+
+  inline const int& ThreadRegistration::GetThreadID() const {
+    return _thread_id;
+  }
+
+  inline const std::string& ThreadRegistration::GetName() const {
+    return _name;
+  }
+
+  /*! @brief Rename the thread, keeping the cache and table in step
+  */
+  inline bool ThreadRegistration::SetName(const std::string &name) {
+    std::string truncated = name.substr(0, THREAD_NAME_LENGTH - 1);
+#if defined(__linux__)
+    if (pthread_setname_np(pthread_self(), truncated.c_str()) != 0) {
+      return false;
+    }
+#endif
+    _name = truncated;
+    if (_entry != NULL) {
+      ThreadRegistry::WriteName(*_entry, _name);
+    }
+    return true;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_THREAD_REGISTRY_H_
\ No newline at end of file
@@ -10,8 +10,8 @@
 #define SENTRY_THREADS_H_
 #include "SentryStacktrace.h"
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
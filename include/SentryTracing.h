@@ -0,0 +1,731 @@
+/********************************************//**
+* @file SentryTracing.h
+* @brief Performance tracing with transactions and spans
+* @details https://develop.sentry.dev/sdk/event-payloads/transaction/
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#ifndef SENTRY_TRACING_H_
+#define SENTRY_TRACING_H_
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdint.h>
+
+#include "SentryStringView.h"
+#include "SentrySmallMap.h"
+#include "SentryEvent.h"
+#include "SentryScope.h"
+#include "SentryClient.h"
+#include "SentryThreadCapture.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
+
+/***********************************************
+*	Constants
+***********************************************/
+namespace sentry {
+
+  const size_t TRACING_MAX_SPANS = 1000;      // Spans kept per transaction, the rest are counted
+  const size_t TRACING_SPAN_CHUNK = 32;       // Spans allocated together
+  const size_t TRACING_BATCH_SIZE = 32;
+
+  const char * const TRANSACTION_TYPE = "transaction";
+  const char * const SPAN_STATUS_OK = "ok";
+
+  const char * const JSON_ELEM_TYPE = "type";
+  const char * const JSON_ELEM_TRANSACTION = "transaction";
+  const char * const JSON_ELEM_START_TIMESTAMP = "start_timestamp";
+  const char * const JSON_ELEM_SPANS = "spans";
+  const char * const JSON_ELEM_TRACE = "trace";
+  const char * const JSON_ELEM_TRACE_ID = "trace_id";
+  const char * const JSON_ELEM_SPAN_ID = "span_id";
+  const char * const JSON_ELEM_PARENT_SPAN_ID = "parent_span_id";
+  const char * const JSON_ELEM_SPAN_OP = "op";
+  const char * const JSON_ELEM_SPAN_DESCRIPTION = "description";
+  const char * const JSON_ELEM_SPAN_STATUS = "status";
+
+} // namespace sentry
+
+/***********************************************
+*	Classes
+***********************************************/
+namespace sentry {
+
+  /*! @brief One timed operation; written by its owner, read once finished
+  */
+  struct SpanRecord {
+    SpanRecord();
+
+    uint64_t span_id;
+    uint64_t parent_span_id;
+    std::string op;
+    std::string description;
+    std::string status;
+    int64_t start_ns;               // steady_clock
+    int64_t end_ns;
+    StringMap tags;
+    std::atomic<bool> is_finished;  // Set last, after which the span is not touched
+  };
+
+  /*! @brief A fixed number of spans, allocated on first use
+  */
+  struct SpanChunk {
+    SpanRecord spans[TRACING_SPAN_CHUNK];
+  };
+
+  /*! @brief Everything recorded for one sampled transaction
+  *   @details Spans claim a slot with a single atomic increment, so any
+  *   thread can start a span without a lock. Storage grows a chunk at a time
+  *   up to the span limit.
+  */
+  struct TransactionRecord {
+    TransactionRecord(const size_t &max_spans);
+    ~TransactionRecord();
+
+    SpanRecord* ClaimSpan();
+    size_t GetSpanCount() const;
+    const SpanRecord* GetSpan(const size_t &index) const;
+
+    std::string name;
+    std::string trace_id;
+    int thread_id;                  // The thread that started the transaction
+    SpanRecord root;
+
+    size_t max_spans;
+    std::unique_ptr<std::atomic<SpanChunk*>[]> chunks;
+    std::atomic<size_t> claimed;
+    std::atomic<uint64_t> dropped;
+
+  private:
+    TransactionRecord(const TransactionRecord &other);
+    TransactionRecord& operator = (const TransactionRecord &other);
+
+  }; // struct TransactionRecord
+
+  /*! @brief A child operation of a transaction
+  *   @details A span of an unsampled transaction holds nothing and every call
+  *   on it returns at once.
+  */
+  class Span {
+  public:
+    Span();
+    Span(Span &&other);
+    Span& operator = (Span &&other);
+    ~Span();
+
+    bool IsSampled() const;
+    uint64_t GetSpanID() const;
+
+    Span StartChild(const StringView &op, const StringView &description = StringView());
+    void SetTag(const StringView &key, const StringView &value);
+    void SetStatus(const StringView &status);
+    void Finish();
+
+  protected:
+    friend class Transaction;
+    Span(const std::shared_ptr<TransactionRecord> &record, const uint64_t &parent_span_id, const StringView &op, const StringView &description);
+
+  private:
+    Span(const Span &other);
+    Span& operator = (const Span &other);
+
+    std::shared_ptr<TransactionRecord> _record;
+    SpanRecord *_span;
+
+  }; // class Span
+
+  class Tracer;
+
+  /*! @brief The root of a trace, sent as one event when it finishes
+  */
+  class Transaction {
+  public:
+    Transaction();
+    Transaction(Transaction &&other);
+    Transaction& operator = (Transaction &&other);
+    ~Transaction();
+
+    bool IsSampled() const;
+    const std::string& GetTraceID() const;
+    uint64_t GetSpanID() const;
+    std::string GetTraceHeader() const;
+
+    Span StartChild(const StringView &op, const StringView &description = StringView());
+    void SetTag(const StringView &key, const StringView &value);
+    void SetStatus(const StringView &status);
+    void Finish();
+
+  protected:
+    friend class Tracer;
+    Transaction(Tracer *tracer, const std::shared_ptr<TransactionRecord> &record);
+
+  private:
+    Transaction(const Transaction &other);
+    Transaction& operator = (const Transaction &other);
+
+    Tracer *_tracer;
+    std::shared_ptr<TransactionRecord> _record;
+
+  }; // class Transaction
+
+  /*! @brief Starts transactions and sends the sampled ones through a client
+  *   @details The sampling decision is made once per transaction and ignores
+  *   event levels. Finished transactions are queued and a background thread
+  *   turns each batch into events for the client's pipeline, so the thread
+  *   that finished them does no serialization.
+  */
+  class Tracer {
+  public:
+    typedef std::function<bool(const TransactionRecord &record, const Event &event)> TransactionCallback;
+
+    Tracer(const Client &client, const double &sample_rate = 1.0, const size_t &max_spans = TRACING_MAX_SPANS,
+      const std::chrono::milliseconds &interval = std::chrono::milliseconds(1000));
+    ~Tracer();
+
+    const double& GetSampleRate() const;
+    void SetTransactionCallback(const TransactionCallback &callback);
+
+    Transaction StartTransaction(const StringView &name, const StringView &op);
+
+    bool Submit(std::shared_ptr<TransactionRecord> &&record);
+    size_t Flush();
+    void Stop();
+
+    uint64_t GetSampledCount() const;
+    uint64_t GetUnsampledCount() const;
+    uint64_t GetDroppedSpanCount() const;
+
+    Event MakeEvent(const TransactionRecord &record) const;
+
+    static uint64_t GenerateSpanID();
+    static std::string SpanIDToString(const uint64_t &span_id);
+    static int64_t Now();
+
+  protected:
+    bool ShouldSample() const;
+    double ToTimestamp(const int64_t &steady_ns) const;
+    void Run();
+
+    static void AddString(rapidjson::Value &object, const char *key, const std::string &value, rapidjson::Document::AllocatorType &allocator);
+    static void AddTags(rapidjson::Value &object, const StringMap &tags, rapidjson::Document::AllocatorType &allocator);
+    static void AddSpan(rapidjson::Value &object, const std::string &trace_id, const SpanRecord &span, rapidjson::Document::AllocatorType &allocator);
+
+  private:
+    Tracer(const Tracer &other);
+    Tracer& operator = (const Tracer &other);
+
+    Client _client;
+    double _sample_rate;
+    size_t _max_spans;
+    std::chrono::milliseconds _interval;
+    TransactionCallback _callback;
+
+    int64_t _steady_origin;     // steady_clock and system_clock read together, in ns
+    int64_t _system_origin;
+
+    std::vector<std::shared_ptr<TransactionRecord> > _queue;
+    std::thread _worker;
+    std::mutex _mutex;
+    std::mutex _flush_mutex;
+    std::condition_variable _wake;
+    bool _is_running;
+    bool _is_stopping;
+
+    std::atomic<uint64_t> _sampled;
+    std::atomic<uint64_t> _unsampled;
+    std::atomic<uint64_t> _dropped_spans;
+
+  }; // class Tracer
+
+} // namespace sentry
+
+/***********************************************
+*	Method Definitions
+***********************************************/
+namespace sentry {
+
+  /*!
+  */
+  inline SpanRecord::SpanRecord() :
+    span_id(0), parent_span_id(0), start_ns(0), end_ns(0), is_finished(false) {
+  }
+
+  /*!
+  */
+  inline TransactionRecord::TransactionRecord(const size_t &max_spans) :
+    thread_id(0), max_spans(max_spans),
+    chunks(new std::atomic<SpanChunk*>[(max_spans + TRACING_SPAN_CHUNK - 1) / TRACING_SPAN_CHUNK]),
+    claimed(0), dropped(0) {
+    for (size_t i = 0; i < (max_spans + TRACING_SPAN_CHUNK - 1) / TRACING_SPAN_CHUNK; ++i) {
+      chunks[i].store(NULL, std::memory_order_relaxed);
+    }
+  }
+
+  inline TransactionRecord::~TransactionRecord() {
+    for (size_t i = 0; i < (max_spans + TRACING_SPAN_CHUNK - 1) / TRACING_SPAN_CHUNK; ++i) {
+      delete chunks[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  /*! @brief A free span slot for the calling thread
+  *   @return NULL once the span limit is reached
+  */
+  inline SpanRecord* TransactionRecord::ClaimSpan() {
+    const size_t index = claimed.fetch_add(1, std::memory_order_relaxed);
+    if (index >= max_spans) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    std::atomic<SpanChunk*> &slot = chunks[index / TRACING_SPAN_CHUNK];
+    SpanChunk *chunk = slot.load(std::memory_order_acquire);
+    if (chunk == NULL) {
+      SpanChunk *created = new SpanChunk();
+      if (slot.compare_exchange_strong(chunk, created, std::memory_order_acq_rel)) {
+        chunk = created;
+      }
+      else {
+        delete created;
+      }
+    }
+    return &chunk->spans[index % TRACING_SPAN_CHUNK];
+  }
+
+  /*! @brief Slots claimed so far, some of which may still be open
+  */
+  inline size_t TransactionRecord::GetSpanCount() const {
+    const size_t count = claimed.load(std::memory_order_acquire);
+    return (count < max_spans) ? count : max_spans;
+  }
+
+  /*! @brief The span in a slot, or NULL if its chunk is still being allocated
+  */
+  inline const SpanRecord* TransactionRecord::GetSpan(const size_t &index) const {
+    const SpanChunk *chunk = chunks[index / TRACING_SPAN_CHUNK].load(std::memory_order_acquire);
+    return (chunk != NULL) ? &chunk->spans[index % TRACING_SPAN_CHUNK] : NULL;
+  }
+
+  /*! @brief A span that records nothing
+  */
+  inline Span::Span() :
+    _span(NULL) {
+  }
+
+  inline Span::Span(const std::shared_ptr<TransactionRecord> &record, const uint64_t &parent_span_id, const StringView &op, const StringView &description) :
+    _span(NULL) {
+    SpanRecord *span = record->ClaimSpan();
+    if (span == NULL) { return; }
+
+    span->span_id = Tracer::GenerateSpanID();
+    span->parent_span_id = parent_span_id;
+    span->op.assign(op.data(), op.size());
+    span->description.assign(description.data(), description.size());
+    span->start_ns = Tracer::Now();
+    _record = record;
+    _span = span;
+  }
+
+  inline Span::Span(Span &&other) :
+    _record(std::move(other._record)), _span(other._span) {
+    other._span = NULL;
+  }
+
+  inline Span& Span::operator = (Span &&other) {
+    if (this != &other) {
+      Finish();
+      _record = std::move(other._record);
+      _span = other._span;
+      other._span = NULL;
+    }
+    return *this;
+  }
+
+  /*! @brief A span still open when it goes out of scope finishes then
+  */
+  inline Span::~Span() {
+    Finish();
+  }
+
+  inline bool Span::IsSampled() const {
+    return (_span != NULL);
+  }
+
+  inline uint64_t Span::GetSpanID() const {
+    return (_span != NULL) ? _span->span_id : 0;
+  }
+
+  inline Span Span::StartChild(const StringView &op, const StringView &description) {
+    if (_span == NULL) { return Span(); }
+    return Span(_record, _span->span_id, op, description);
+  }
+
+  inline void Span::SetTag(const StringView &key, const StringView &value) {
+    if (_span == NULL) { return; }
+    _span->tags[key].assign(value.data(), value.size());
+  }
+
+  inline void Span::SetStatus(const StringView &status) {
+    if (_span == NULL) { return; }
+    _span->status.assign(status.data(), status.size());
+  }
+
+  /*! @brief Stamp the end time and hand the span over to the reader
+  */
+  inline void Span::Finish() {
+    if (_span == NULL) { return; }
+    _span->end_ns = Tracer::Now();
+    _span->is_finished.store(true, std::memory_order_release);
+    _span = NULL;
+    _record.reset();
+  }
+
+  /*! @brief A transaction that was not sampled
+  */
+  inline Transaction::Transaction() :
+    _tracer(NULL) {
+  }
+
+  inline Transaction::Transaction(Tracer *tracer, const std::shared_ptr<TransactionRecord> &record) :
+    _tracer(tracer), _record(record) {
+  }
+
+  inline Transaction::Transaction(Transaction &&other) :
+    _tracer(other._tracer), _record(std::move(other._record)) {
+    other._tracer = NULL;
+  }
+
+  inline Transaction& Transaction::operator = (Transaction &&other) {
+    if (this != &other) {
+      Finish();
+      _tracer = other._tracer;
+      _record = std::move(other._record);
+      other._tracer = NULL;
+    }
+    return *this;
+  }
+
+  inline Transaction::~Transaction() {
+    Finish();
+  }
+
+  inline bool Transaction::IsSampled() const {
+    return (_record != nullptr);
+  }
+
+  inline const std::string& Transaction::GetTraceID() const {
+    static const std::string empty;
+    return (_record != nullptr) ? _record->trace_id : empty;
+  }
+
+  inline uint64_t Transaction::GetSpanID() const {
+    return (_record != nullptr) ? _record->root.span_id : 0;
+  }
+
+  /*! @brief The sentry-trace header for outgoing requests
+  *   @details {TRACE_ID}-{SPAN_ID}-{SAMPLED}, empty if not sampled
+  */
+  inline std::string Transaction::GetTraceHeader() const {
+    if (_record == nullptr) { return std::string(); }
+    return _record->trace_id + "-" + Tracer::SpanIDToString(_record->root.span_id) + "-1";
+  }
+
+  inline Span Transaction::StartChild(const StringView &op, const StringView &description) {
+    if (_record == nullptr) { return Span(); }
+    return Span(_record, _record->root.span_id, op, description);
+  }
+
+  inline void Transaction::SetTag(const StringView &key, const StringView &value) {
+    if (_record == nullptr) { return; }
+    _record->root.tags[key].assign(value.data(), value.size());
+  }
+
+  inline void Transaction::SetStatus(const StringView &status) {
+    if (_record == nullptr) { return; }
+    _record->root.status.assign(status.data(), status.size());
+  }
+
+  /*! @brief Stamp the end time and queue the transaction for sending
+  *   @details Spans that are still open at this point are left out, even if
+  *   they finish before the transaction is sent.
+  */
+  inline void Transaction::Finish() {
+    if (_record == nullptr) { return; }
+    _record->root.end_ns = Tracer::Now();
+    _record->root.is_finished.store(true, std::memory_order_release);
+    if (_tracer != NULL) {
+      _tracer->Submit(std::move(_record));
+    }
+    _record.reset();
+    _tracer = NULL;
+  }
+
+  /*!
+  */
+  inline Tracer::Tracer(const Client &client, const double &sample_rate, const size_t &max_spans, const std::chrono::milliseconds &interval) :
+    _client(client), _sample_rate(sample_rate), _max_spans(max_spans), _interval(interval),
+    _steady_origin(Now()),
+    _system_origin(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count())),
+    _is_running(false), _is_stopping(false),
+    _sampled(0), _unsampled(0), _dropped_spans(0) {
+  }
+
+  inline Tracer::~Tracer() {
+    Stop();
+  }
+
+  inline const double& Tracer::GetSampleRate() const {
+    return _sample_rate;
+  }
+
+  /*! @brief Called on the worker with each transaction event before it is captured
+  *   @details Set before the first transaction finishes; later calls are ignored.
+  *   A callback that sends the event itself returns true, which counts it as
+  *   sent and keeps it out of the client.
+  */
+  inline void Tracer::SetTransactionCallback(const TransactionCallback &callback) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_is_running) { return; }
+    _callback = callback;
+  }
+
+  /*! @brief Start a transaction, deciding here whether the whole trace is sampled
+  */
+  inline Transaction Tracer::StartTransaction(const StringView &name, const StringView &op) {
+    if (!ShouldSample()) {
+      _unsampled.fetch_add(1, std::memory_order_relaxed);
+      _client.GetCounters().AddDiscarded(DISCARD_SAMPLE_RATE, CATEGORY_TRANSACTION);
+      return Transaction();
+    }
+    _sampled.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<TransactionRecord> record = std::make_shared<TransactionRecord>(_max_spans);
+    record->name.assign(name.data(), name.size());
+    record->trace_id = Event::GenerateEventID();
+    record->thread_id = ThreadCapture::GetCurrentThreadID();
+    record->root.span_id = GenerateSpanID();
+    record->root.op.assign(op.data(), op.size());
+    record->root.start_ns = Now();
+    return Transaction(this, record);
+  }
+
+  inline bool Tracer::ShouldSample() const {
+    if (_sample_rate >= 1.0) { return true; }
+    if (_sample_rate <= 0.0) { return false; }
+    return (static_cast<double>(GenerateSpanID() >> 11) * (1.0 / 9007199254740992.0)) < _sample_rate;
+  }
+
+  /*! @brief Queue a finished transaction, starting the worker on first use
+  *   @return false once the tracer is stopped
+  */
+  inline bool Tracer::Submit(std::shared_ptr<TransactionRecord> &&record) {
+    if (record == nullptr) { return false; }
+
+    bool is_full = false;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_is_stopping) { return false; }
+      if (!_is_running) {
+        _is_running = true;
+        _worker = std::thread(&Tracer::Run, this);
+      }
+      _queue.push_back(std::move(record));
+      is_full = (_queue.size() >= TRACING_BATCH_SIZE);
+    }
+    if (is_full) {
+      _wake.notify_one();
+    }
+    return true;
+  }
+
+  /*! @brief Turn the queued transactions into events for the client
+  *   @return the number of transactions handed to the client
+  */
+  inline size_t Tracer::Flush() {
+    std::lock_guard<std::mutex> flush_lock(_flush_mutex);
+
+    std::vector<std::shared_ptr<TransactionRecord> > batch;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      batch.swap(_queue);
+    }
+
+    size_t sent = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      _dropped_spans.fetch_add(batch[i]->dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      Event event = MakeEvent(*batch[i]);
+      if (_callback && _callback(*batch[i], event)) {
+        ++sent;
+        continue;
+      }
+      if (_client.Capture(std::move(event))) {
+        ++sent;
+      }
+    }
+    return sent;
+  }
+
+  /*! @brief Send what is queued and join the worker
+  */
+  inline void Tracer::Stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _is_stopping = true;
+    }
+    _wake.notify_all();
+    if (_worker.joinable()) {
+      _worker.join();
+    }
+    Flush();
+  }
+
+  /*! @brief Worker loop: wait for a full batch or the interval, then flush
+  */
+  inline void Tracer::Run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_is_stopping) {
+      _wake.wait_for(lock, _interval, [this]() { return _is_stopping || _queue.size() >= TRACING_BATCH_SIZE; });
+      lock.unlock();
+      Flush();
+      lock.lock();
+    }
+  }
+
+  inline uint64_t Tracer::GetSampledCount() const {
+    return _sampled.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t Tracer::GetUnsampledCount() const {
+    return _unsampled.load(std::memory_order_relaxed);
+  }
+
+  /*! @brief Spans left out of sent transactions because of the span limit
+  */
+  inline uint64_t Tracer::GetDroppedSpanCount() const {
+    return _dropped_spans.load(std::memory_order_relaxed);
+  }
+
+  /*! @brief The transaction event: the root in contexts.trace, finished children under spans
+  */
+  inline Event Tracer::MakeEvent(const TransactionRecord &record) const {
+    Event event;
+    rapidjson::Document &doc = event.GetDocument();
+    rapidjson::Document::AllocatorType &allocator = event.GetAllocator();
+
+    doc.RemoveMember(JSON_ELEM_LEVEL);
+    doc.RemoveMember(JSON_ELEM_TIMESTAMP);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_TYPE), rapidjson::StringRef(TRANSACTION_TYPE), allocator);
+
+    rapidjson::Value name(rapidjson::kStringType);
+    name.SetString(record.name.data(), static_cast<rapidjson::SizeType>(record.name.size()), allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_TRANSACTION), name, allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_START_TIMESTAMP), ToTimestamp(record.root.start_ns), allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_TIMESTAMP), ToTimestamp(record.root.end_ns), allocator);
+
+
+    rapidjson::Value trace(rapidjson::kObjectType);
+    AddSpan(trace, record.trace_id, record.root, allocator);
+    rapidjson::Value contexts(rapidjson::kObjectType);
+    contexts.AddMember(rapidjson::StringRef(JSON_ELEM_TRACE), trace, allocator);
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_CONTEXTS), contexts, allocator);
+    AddTags(doc, record.root.tags, allocator);
+
+    rapidjson::Value spans(rapidjson::kArrayType);
+    const size_t count = record.GetSpanCount();
+    for (size_t i = 0; i < count; ++i) {
+      const SpanRecord *span = record.GetSpan(i);
+      if (span == NULL || !span->is_finished.load(std::memory_order_acquire) || span->end_ns > record.root.end_ns) { continue; }
+
+      rapidjson::Value value(rapidjson::kObjectType);
+      AddSpan(value, record.trace_id, *span, allocator);
+      value.AddMember(rapidjson::StringRef(JSON_ELEM_START_TIMESTAMP), ToTimestamp(span->start_ns), allocator);
+      value.AddMember(rapidjson::StringRef(JSON_ELEM_TIMESTAMP), ToTimestamp(span->end_ns), allocator);
+      AddTags(value, span->tags, allocator);
+      spans.PushBack(value, allocator);
+    }
+    doc.AddMember(rapidjson::StringRef(JSON_ELEM_SPANS), spans, allocator);
+    return event;
+  }
+
+  inline void Tracer::AddString(rapidjson::Value &object, const char *key, const std::string &value, rapidjson::Document::AllocatorType &allocator) {
+    if (value.empty()) { return; }
+    rapidjson::Value string(rapidjson::kStringType);
+    string.SetString(value.data(), static_cast<rapidjson::SizeType>(value.size()), allocator);
+    object.AddMember(rapidjson::StringRef(key), string, allocator);
+  }
+
+  inline void Tracer::AddTags(rapidjson::Value &object, const StringMap &tags, rapidjson::Document::AllocatorType &allocator) {
+    if (tags.empty()) { return; }
+    rapidjson::Value values(rapidjson::kObjectType);
+    for (StringMap::const_iterator tag = tags.begin(); tag != tags.end(); ++tag) {
+      rapidjson::Value key(rapidjson::kStringType);
+      key.SetString(tag->first.data(), static_cast<rapidjson::SizeType>(tag->first.size()), allocator);
+      rapidjson::Value value(rapidjson::kStringType);
+      value.SetString(tag->second.data(), static_cast<rapidjson::SizeType>(tag->second.size()), allocator);
+      values.AddMember(key, value, allocator);
+    }
+    object.AddMember(rapidjson::StringRef(JSON_ELEM_TAGS), values, allocator);
+  }
+
+  /*! @brief The fields a span shares with the trace context
+  */
+  inline void Tracer::AddSpan(rapidjson::Value &object, const std::string &trace_id, const SpanRecord &span, rapidjson::Document::AllocatorType &allocator) {
+    AddString(object, JSON_ELEM_TRACE_ID, trace_id, allocator);
+    AddString(object, JSON_ELEM_SPAN_ID, SpanIDToString(span.span_id), allocator);
+    if (span.parent_span_id != 0) {
+      AddString(object, JSON_ELEM_PARENT_SPAN_ID, SpanIDToString(span.parent_span_id), allocator);
+    }
+    AddString(object, JSON_ELEM_SPAN_OP, span.op, allocator);
+    AddString(object, JSON_ELEM_SPAN_DESCRIPTION, span.description, allocator);
+    AddString(object, JSON_ELEM_SPAN_STATUS, span.status.empty() ? std::string(SPAN_STATUS_OK) : span.status, allocator);
+  }
+
+  /*! @brief A random, non-zero span id from a per-thread generator
+  */
+  inline uint64_t Tracer::GenerateSpanID() {
+    static thread_local uint64_t state = std::random_device{}() ^ (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&state)) << 16) ^ 0x9E3779B97F4A7C15ULL;
+    uint64_t span_id = 0;
+    while (span_id == 0) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      span_id = state;
+    }
+    return span_id;
+  }
+
+  /*! @brief A span id as 16 hex digits
+  */
+  inline std::string Tracer::SpanIDToString(const uint64_t &span_id) {
+    static const char digits[] = "0123456789abcdef";
+    std::string value(16, '0');
+    for (size_t i = 0; i < 16; ++i) {
+      value[i] = digits[(span_id >> (60 - 4 * i)) & 0xF];
+    }
+    return value;
+  }
+
+  /*! @brief The steady clock in nanoseconds; spans are timed with this alone
+  */
+  inline int64_t Tracer::Now() {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  /*! @brief Seconds since the epoch for a steady clock reading
+  */
+  inline double Tracer::ToTimestamp(const int64_t &steady_ns) const {
+    return static_cast<double>(_system_origin + (steady_ns - _steady_origin)) / 1e9;
+  }
+
+} // namespace sentry
+
+#endif // SENTRY_TRACING_H_
\ No newline at end of file
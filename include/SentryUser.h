@@ -9,10 +9,11 @@
 #ifndef SENTRY_USER_H_
 #define SENTRY_USER_H_
 #include <string>
-#include <map>
 
-#include "rapidjson\rapidjson.h"
-#include "rapidjson\document.h"
+#include "SentrySmallMap.h"
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/document.h"
 
 /***********************************************
 *	Constants
@@ -40,7 +41,7 @@ namespace sentry {
     User();
     User(const std::string &user_unique_id, const std::string &email, 
       const std::string &username, const std::string &ip_address = std::string(),
-      const std::map<std::string, std::string> &additional_user_fields = std::map<std::string, std::string>());
+      const StringMap &additional_user_fields = StringMap());
     User(const rapidjson::Value &json);
 
     bool IsValid() const;
@@ -49,8 +50,8 @@ namespace sentry {
     const std::string &GetEmail() const;
     const std::string &GetUsername() const;
     const std::string &GetIPAddress() const;
-    const std::map<std::string, std::string> &GetAdditionalFields() const;
-    void SetAdditionalFields(const std::map<std::string, std::string>& additional_fields);
+    const StringMap &GetAdditionalFields() const;
+    void SetAdditionalFields(const StringMap& additional_fields);
 
     void AddToJson(rapidjson::Document &doc) const;
 
@@ -63,7 +64,7 @@ namespace sentry {
     std::string _email;
     std::string _username;
     std::string _ip_address;
-    std::map<std::string, std::string> _additional_fields;
+    StringMap _additional_fields;
 
   }; // class User
 
@@ -77,7 +78,7 @@ namespace sentry {
   */
   inline User::User() {}
 
-  inline User::User(const std::string &user_unique_id, const std::string &email, const std::string &username, const std::string &ip_address, const std::map<std::string, std::string> &additional_user_fields) :
+  inline User::User(const std::string &user_unique_id, const std::string &email, const std::string &username, const std::string &ip_address, const StringMap &additional_user_fields) :
     _user_unique_id(user_unique_id),
     _email(email),
     _username(username),
@@ -102,11 +103,11 @@ namespace sentry {
     return _ip_address;
   }
 
-  inline const std::map<std::string, std::string>& User::GetAdditionalFields() const {
+  inline const StringMap& User::GetAdditionalFields() const {
     return _additional_fields;
   }
 
-  inline void User::SetAdditionalFields(const std::map<std::string, std::string>& additional_fields) {
+  inline void User::SetAdditionalFields(const StringMap& additional_fields) {
     _additional_fields = additional_fields;
   }
 
@@ -169,7 +170,7 @@ namespace sentry {
       } else {
         if (strlen(member->name.GetString()) > 0) {
           if (member->value.IsString()) {
-            _additional_fields[member->name.GetString()] = member->value.GetString();
+            _additional_fields[StringView(member->name.GetString(), member->name.GetStringLength())].assign(member->value.GetString(), member->value.GetStringLength());
           }
         }
       }
@@ -0,0 +1,306 @@
+/********************************************//**
+* @file SentryAllocationTest.cpp
+* @brief Allocation budgets for building and serializing the interfaces
+* @details Replaces the global operator new and delete, and rapidjson's
+* malloc, with counting versions, so it builds as its own test program.
+* Each test runs an operation once to warm up, then counts the allocations
+* and bytes of a second run against a budget. The counts for every
+* interface and operation are printed at the end.
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <map>
+#include <string>
+#include <stdint.h>
+
+/***********************************************
+*	Allocation Counting
+***********************************************/
+/*! @brief Allocations made by one thread while counting is on
+*/
+struct AllocationCount {
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+static thread_local bool is_counting = false;
+static thread_local AllocationCount counted = { 0, 0 };
+
+static void* CountedMalloc(const size_t &size) {
+  if (is_counting) {
+    ++counted.allocations;
+    counted.bytes += size;
+  }
+  return std::malloc(size);
+}
+
+// Only used by rapidjson versions that reallocate through RAPIDJSON_REALLOC
+#if defined(__GNUC__)
+__attribute__((unused))
+#endif
+static void* CountedRealloc(void *ptr, const size_t &size) {
+  if (is_counting) {
+    ++counted.allocations;
+    counted.bytes += size;
+  }
+  return std::realloc(ptr, size);
+}
+
+#define RAPIDJSON_MALLOC(size) CountedMalloc(size)
+#define RAPIDJSON_REALLOC(ptr, new_size) CountedRealloc(ptr, new_size)
+#define RAPIDJSON_FREE(ptr) std::free(ptr)
+
+void* operator new(size_t size) {
+  void *ptr = CountedMalloc(size > 0 ? size : 1);
+  if (ptr == NULL) { throw std::bad_alloc(); }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+#include "SentryEvent.h"
+#include "SentryFrame.h"
+#include "SentryStacktrace.h"
+#include "SentryThreads.h"
+#include "SentryException.h"
+#include "SentryMessage.h"
+#include "SentryUser.h"
+#include "SentryEventView.h"
+#include <gtest/gtest.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief Counts for every interface and operation measured, printed after the tests
+*/
+class AllocationReport : public ::testing::Environment {
+public:
+  static std::map<std::string, AllocationCount>& GetCounts() {
+    static std::map<std::string, AllocationCount> counts;
+    return counts;
+  }
+
+  void TearDown() {
+    std::printf("\n%-32s %12s %12s\n", "Interface/Operation", "Allocations", "Bytes");
+    for (auto count = GetCounts().cbegin(); count != GetCounts().cend(); ++count) {
+      std::printf("%-32s %12llu %12llu\n", count->first.c_str(),
+        static_cast<unsigned long long>(count->second.allocations), static_cast<unsigned long long>(count->second.bytes));
+    }
+  }
+};
+
+static ::testing::Environment * const allocation_report = ::testing::AddGlobalTestEnvironment(new AllocationReport);
+
+/*! @brief Run an operation twice and count the allocations of the second run
+*/
+template <typename Operation>
+static AllocationCount Measure(const std::string &name, Operation operation) {
+  operation();
+
+  counted.allocations = 0;
+  counted.bytes = 0;
+  is_counting = true;
+  operation();
+  is_counting = false;
+
+  AllocationReport::GetCounts()[name] = counted;
+  return counted;
+}
+
+static Frame MakeFrame(const size_t &index) {
+  Frame frame("src/document_writer.cpp", "DocumentWriter::Save" + std::to_string(index), "app");
+  frame.SetLineNumber(static_cast<int>(100 + index));
+  frame.SetInstructionAddr("0x00007f3a12c4d0e8");
+  frame.SetIsInApp(true);
+  return frame;
+}
+
+static std::vector<Frame> MakeFrames(const size_t &count) {
+  std::vector<Frame> frames;
+  for (size_t i = 0; i < count; ++i) {
+    frames.push_back(MakeFrame(i));
+  }
+  return frames;
+}
+
+/*! @test Test the allocations of a frame
+*/
+TEST(Allocation, Frame) {
+  AllocationCount construct = Measure("Frame/Construct", []() {
+    Frame frame = MakeFrame(1);
+  });
+  EXPECT_LE(construct.allocations, 8u);
+
+  const Frame frame = MakeFrame(1);
+  AllocationCount to_json = Measure("Frame/ToJson", [&frame]() {
+    rapidjson::Document doc;
+    frame.ToJson(doc);
+  });
+  EXPECT_LE(to_json.allocations, 16u);
+}
+
+/*! @test Test the allocations of a 32-frame stacktrace
+*/
+TEST(Allocation, Stacktrace) {
+  const std::vector<Frame> frames = MakeFrames(32);
+  AllocationCount construct = Measure("Stacktrace/Construct", [&frames]() {
+    Stacktrace stacktrace(frames);
+  });
+  EXPECT_LE(construct.allocations, 104u);
+
+  const Stacktrace stacktrace(frames);
+  AllocationCount to_json = Measure("Stacktrace/ToJson", [&stacktrace]() {
+    rapidjson::Document doc;
+    stacktrace.ToJson(doc);
+  });
+  EXPECT_LE(to_json.allocations, 384u);
+
+  rapidjson::Document json;
+  stacktrace.ToJson(json);
+  AllocationCount from_json = Measure("Stacktrace/FromJson", [&json]() {
+    Stacktrace parsed(json);
+  });
+  EXPECT_LE(from_json.allocations, 384u);
+}
+
+/*! @test Test the allocations of a dump of 8 threads
+*/
+TEST(Allocation, Threads) {
+  const Stacktrace stacktrace(MakeFrames(16));
+  std::vector<Thread> list;
+  for (int i = 0; i < 8; ++i) {
+    list.push_back(Thread(1000 + i, i == 0, i == 0, stacktrace, "worker"));
+  }
+
+  AllocationCount construct = Measure("Threads/Construct", [&list]() {
+    sentry::Threads threads(list);
+  });
+  EXPECT_LE(construct.allocations, 480u);
+
+  const sentry::Threads threads(list);
+  AllocationCount to_json = Measure("Threads/ToJson", [&threads]() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    threads.AddToJson(doc);
+  });
+  EXPECT_LE(to_json.allocations, 1600u);
+}
+
+/*! @test Test the allocations of an exception
+*/
+TEST(Allocation, Exception) {
+  const Stacktrace stacktrace(MakeFrames(16));
+  AllocationCount construct = Measure("Exception/Construct", [&stacktrace]() {
+    Exception exception("std::runtime_error", "Could not open the document for writing", "app", stacktrace);
+  });
+  EXPECT_LE(construct.allocations, 64u);
+
+  const Exception exception("std::runtime_error", "Could not open the document for writing", "app", stacktrace);
+  AllocationCount to_json = Measure("Exception/ToJson", [&exception]() {
+    rapidjson::Document doc;
+    exception.ToJson(doc);
+  });
+  EXPECT_LE(to_json.allocations, 16u);
+}
+
+/*! @test Test the allocations of a user and a message with additional fields
+*/
+TEST(Allocation, UserMessage) {
+  StringMap fields;
+  fields["plan"] = "enterprise";
+  fields["seat"] = "42";
+
+  AllocationCount user_construct = Measure("User/Construct", [&fields]() {
+    User user("user-2f7d9c41", "someone@example.com", "someone", "127.0.0.1", fields);
+  });
+  EXPECT_LE(user_construct.allocations, 4u);
+
+  const User user("user-2f7d9c41", "someone@example.com", "someone", "127.0.0.1", fields);
+  AllocationCount user_to_json = Measure("User/ToJson", [&user]() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    user.AddToJson(doc);
+  });
+  EXPECT_LE(user_to_json.allocations, 16u);
+
+  AllocationCount message_construct = Measure("Message/Construct", [&fields]() {
+    Message message("Could not save %s to %s", "drawing.dwg,/mnt/share");
+    message.SetAdditionalFields(fields);
+  });
+  EXPECT_LE(message_construct.allocations, 8u);
+
+  Message message("Could not save %s to %s", "drawing.dwg,/mnt/share");
+  message.SetAdditionalFields(fields);
+  AllocationCount message_to_json = Measure("Message/ToJson", [&message]() {
+    rapidjson::Document doc;
+    doc.SetObject();
+    message.AddToJson(doc);
+  });
+  EXPECT_LE(message_to_json.allocations, 16u);
+}
+
+/*! @test Test the allocations of capturing and serializing a whole event
+*/
+TEST(Allocation, Event) {
+  const Exception exception("std::runtime_error", "Could not open the document for writing", "app", Stacktrace(MakeFrames(16)));
+  const Message message("Could not save %s", "drawing.dwg");
+  const User user("user-2f7d9c41", "someone@example.com", "someone");
+
+  AllocationCount capture = Measure("Event/Capture", [&]() {
+    Event event;
+    event.AddException(exception).Add(message).Add(user);
+  });
+  AllocationCount serialize = Measure("Event/ToString", [&]() {
+    Event event;
+    event.AddException(exception).Add(message).Add(user);
+    std::string payload = event.ToString();
+  });
+  EXPECT_LE(capture.allocations, 48u);
+  EXPECT_LE(serialize.allocations, capture.allocations + 16u);
+}
+
+/*! @test Test that reading a stored event through views allocates nothing
+*/
+TEST(Allocation, EventView) {
+  Event stored;
+  stored.AddException(Exception("std::runtime_error", "Could not open the document for writing", "app", Stacktrace(MakeFrames(16))));
+  const std::string payload = stored.ToString();
+  std::vector<char> buffer(payload.c_str(), payload.c_str() + payload.size() + 1);
+  const EventView event(&buffer[0]);
+  ASSERT_EQ(true, event.IsValid());
+
+  size_t length = 0;
+  AllocationCount read = Measure("EventView/Read", [&event, &length]() {
+    length = event.GetLevel().size() + event.GetException(0).GetType().size();
+    StacktraceView stacktrace = event.GetException(0).GetStacktrace();
+    for (size_t i = 0; i < stacktrace.GetFrameCount(); ++i) {
+      length += stacktrace.GetFrame(i).GetFunction().size();
+    }
+  });
+  EXPECT_EQ(true, length > 0);
+  EXPECT_EQ(0u, read.allocations);
+}
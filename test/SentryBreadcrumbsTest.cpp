@@ -0,0 +1,81 @@
+/********************************************//**
+* @file SentryBreadcrumbsTest.cpp
+* @brief Testing for SentryBreadcrumbs.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryBreadcrumbs.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test formatting a breadcrumb
+*/
+TEST(Breadcrumb, Base) {
+  Breadcrumb breadcrumb;
+  breadcrumb.timestamp_ms = 1500000000000;
+  breadcrumb.sequence = 0;
+  breadcrumb.category = "http";
+  breadcrumb.message = "GET {} returned {} in {}s {}";
+  breadcrumb.level = attributes::Level::LEVEL_INFO;
+  breadcrumb.arg_count = 3;
+  breadcrumb.args[0] = BreadcrumbArg::Make("/api");
+  breadcrumb.args[1] = BreadcrumbArg::Make(404);
+  breadcrumb.args[2] = BreadcrumbArg::Make(0.25);
+  EXPECT_EQ(true, breadcrumb.FormatMessage() == "GET /api returned 404 in 0.25s {}");
+
+  // String arguments are copies, cut to fit
+  {
+    std::string path = "/api/" + std::string(100, 'x');
+    breadcrumb.args[0] = BreadcrumbArg::Make(path);
+  }
+  EXPECT_EQ(BREADCRUMB_ARG_LENGTH - 1, strlen(breadcrumb.args[0].string_value));
+  EXPECT_EQ(0, strncmp(breadcrumb.args[0].string_value, "/api/xxx", 8));
+
+  // Multi-byte characters are not split
+  const std::string accents(40, 'e');
+  breadcrumb.args[0] = BreadcrumbArg::Make(std::string(BREADCRUMB_ARG_LENGTH - 2, 'a') + "\xC3\xA9" + accents);
+  EXPECT_EQ(BREADCRUMB_ARG_LENGTH - 2, strlen(breadcrumb.args[0].string_value));
+}
+
+/*! @test Test merging the rings of several threads
+*/
+TEST(Breadcrumbs, JSON) {
+  Breadcrumbs &breadcrumbs = Breadcrumbs::GetInstance();
+
+  Breadcrumbs::Record("test", "main thread");
+  std::thread worker([]() {
+    for (int i = 0; i < 1000; ++i) {
+      Breadcrumbs::Record("test", attributes::Level::LEVEL_DEBUG, "worker {}", i);
+    }
+  });
+  worker.join();
+
+  // Breadcrumbs of different threads within one coarse clock tick have no order
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  Breadcrumbs::Record("test", attributes::Level::LEVEL_WARNING, "main thread {}", "again");
+
+  // Only the most recent breadcrumbs are kept, oldest first
+  std::vector<Breadcrumb> collected = breadcrumbs.Collect(10);
+  ASSERT_EQ(10u, collected.size());
+  for (size_t i = 1; i < collected.size(); ++i) {
+    EXPECT_EQ(true, collected[i - 1].timestamp_ms <= collected[i].timestamp_ms);
+  }
+  EXPECT_EQ(true, collected.back().FormatMessage() == "main thread again");
+
+  rapidjson::Document json;
+  json.SetObject();
+  breadcrumbs.AddToJson(json);
+  ASSERT_EQ(true, json.HasMember(JSON_ELEM_BREADCRUMBS));
+  const rapidjson::Value &values = json[JSON_ELEM_BREADCRUMBS][JSON_ELEM_BREADCRUMBS_VALUES];
+  EXPECT_EQ(BREADCRUMB_MAX_SENT, values.Size());
+  EXPECT_EQ(true, values[values.Size() - 1].HasMember(JSON_ELEM_BREADCRUMB_MESSAGE));
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+/********************************************//**
+* @file SentryBulkReaderTest.cpp
+* @brief Testing for SentryBulkReader.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryBulkReader.h"
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+#if defined(__linux__)
+/*! @brief Write a new temporary file with the given contents
+*/
+static std::string WriteBulkFile(const std::string &contents) {
+  const char *directory = getenv("TMPDIR");
+  std::string path = std::string((directory != NULL && directory[0] != '\0') ? directory : "/tmp") + "/sentry_bulk_reader_XXXXXX";
+  const int fd = mkstemp(&path[0]);
+  if (fd < 0) { return std::string(); }
+  FILE *file = fdopen(fd, "wb");
+  if (file == NULL) {
+    close(fd);
+    remove(path.c_str());
+    return std::string();
+  }
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+  return path;
+}
+#endif
+
+/*! @brief A stored event with an exception, threads, and a message
+*/
+static std::string MakeEvent(const size_t &index) {
+  const std::string number = std::to_string(index);
+  return "{\"event_id\":\"" + number + "\","
+    "\"exception\":{\"values\":[{\"type\":\"std::runtime_error\",\"value\":\"failure " + number + "\"}]},"
+    "\"threads\":{\"values\":[{\"thread_id\":" + number + ",\"crashed\":true,\"current\":true,\"name\":\"worker\"}]},"
+    "\"message\":{\"message\":\"message " + number + "\"}}";
+}
+
+/*! @test Test a missing file and the newline scan
+*/
+TEST(BulkReader, Base) {
+  BulkReader missing("/this/file/does/not/exist.ndjson");
+  EXPECT_EQ(false, missing.IsValid());
+  EXPECT_EQ(true, missing.GetRecordCount() == 0);
+
+  // Newlines before, inside, and after a 16 byte block
+  const std::string text = "0123456789abcdefghijklmnopqrstu\nvwxyz\n";
+  const char *end = text.data() + text.size();
+  EXPECT_EQ(true, BulkReader::FindNewline(text.data(), end) == text.data() + 31);
+  EXPECT_EQ(true, BulkReader::FindNewline(text.data() + 32, end) == text.data() + 37);
+  EXPECT_EQ(true, BulkReader::FindNewline(text.data() + 38, end) == end);
+  EXPECT_EQ(true, BulkReader::FindNewline(text.data(), text.data() + 31) == text.data() + 31);
+
+  BulkEvent event;
+  EXPECT_EQ(false, BulkReader::ParseRecord(StringView("not json"), event));
+  EXPECT_EQ(true, BulkReader::ParseRecord(StringView(MakeEvent(7)), event));
+  ASSERT_EQ(true, event.exceptions.size() == 1);
+  EXPECT_EQ(true, event.exceptions[0].GetValue() == "failure 7");
+  EXPECT_EQ(true, event.threads.GetThreads().size() == 1);
+  EXPECT_EQ(true, event.message.GetMessage() == "message 7");
+}
+
+#if defined(__linux__)
+/*! @test Test parsing an NDJSON file on several workers
+*/
+TEST(BulkReader, Lines) {
+  const size_t count = 1000;
+  std::string contents;
+  for (size_t i = 0; i < count; ++i) {
+    contents += MakeEvent(i) + ((i % 2 == 0) ? "\n" : "\r\n");
+    if (i == 500) {
+      contents += "\n{not an event\n";
+    }
+  }
+  std::string path = WriteBulkFile(contents);
+  ASSERT_EQ(false, path.empty());
+
+  BulkReader reader(path);
+  EXPECT_EQ(true, reader.IsValid());
+  EXPECT_EQ(BULK_FORMAT_NDJSON, reader.GetFormat());
+  EXPECT_EQ(true, reader.GetMappedSize() == contents.size());
+  EXPECT_EQ(true, reader.GetRecordCount() == count + 1);
+  EXPECT_EQ(true, reader.GetRecord(1) == StringView(MakeEvent(1)));
+
+  std::mutex mutex;
+  std::vector<int> seen(count + 1, 0);
+  bool is_parsed = true;
+  BulkReadStats stats = reader.Read([&](BulkEvent &event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++seen[event.index];
+    const size_t number = (event.index > 501) ? event.index - 1 : event.index;
+    is_parsed = is_parsed && (event.exceptions.size() == 1) && (event.message.GetMessage() == "message " + std::to_string(number));
+  }, 4);
+
+  EXPECT_EQ(true, stats.workers == 4);
+  EXPECT_EQ(true, stats.records == count);
+  EXPECT_EQ(true, stats.invalid == 1);
+  EXPECT_EQ(true, stats.bytes == contents.size());
+  EXPECT_EQ(true, is_parsed);
+  EXPECT_EQ(0, seen[501]);
+  EXPECT_EQ(true, std::count(seen.begin(), seen.end(), 1) == static_cast<long>(count));
+
+  remove(path.c_str());
+}
+
+/*! @test Test parsing the event items of concatenated envelopes
+*/
+TEST(BulkReader, Envelope) {
+  const std::string pretty = "{\n  \"message\": \"pretty printed\"\n}";
+  const std::string attachment = "line one\nline two";
+  std::string contents;
+  contents += "{\"event_id\":\"1\"}\n";
+  contents += "{\"type\":\"event\",\"length\":" + std::to_string(pretty.size()) + "}\n" + pretty + "\n";
+  contents += "{\"type\":\"attachment\",\"length\":" + std::to_string(attachment.size()) + "}\n" + attachment + "\n";
+  contents += "{}\n";
+  contents += "{\"type\":\"event\"}\n" + MakeEvent(2) + "\n";
+  contents += "{\"type\":\"event\",\"length\":" + std::to_string(MakeEvent(3).size()) + "}\n" + MakeEvent(3);
+  std::string path = WriteBulkFile(contents);
+  ASSERT_EQ(false, path.empty());
+
+  BulkReader reader(path);
+  EXPECT_EQ(true, reader.IsValid());
+  EXPECT_EQ(BULK_FORMAT_ENVELOPE, reader.GetFormat());
+  ASSERT_EQ(true, reader.GetRecordCount() == 3);
+  EXPECT_EQ(true, reader.GetRecord(0) == StringView(pretty));
+  EXPECT_EQ(true, reader.GetRecord(2) == StringView(MakeEvent(3)));
+
+  std::mutex mutex;
+  std::vector<std::string> messages(3);
+  BulkReadStats stats = reader.Read([&](BulkEvent &event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages[event.index] = event.message.GetMessage();
+  });
+  EXPECT_EQ(true, stats.records == 3);
+  EXPECT_EQ(true, messages[0] == "pretty printed");
+  EXPECT_EQ(true, messages[1] == "message 2");
+  EXPECT_EQ(true, messages[2] == "message 3");
+
+  // Read as lines, the pretty printed payload falls apart
+  BulkReader lines(path, BULK_FORMAT_NDJSON);
+  EXPECT_EQ(BULK_FORMAT_NDJSON, lines.GetFormat());
+  EXPECT_EQ(true, lines.GetRecordCount() > 3);
+
+  remove(path.c_str());
+}
+/*! @test Test telling envelopes from NDJSON by their first two lines
+*/
+TEST(BulkReader, Detect) {
+  // Items without a length after an envelope header with a dsn
+  std::string path = WriteBulkFile("{\"dsn\":\"https://public@sentry.example.com/1\"}\n{\"type\":\"event\"}\n" + MakeEvent(1) + "\n");
+  ASSERT_EQ(false, path.empty());
+  BulkReader envelope(path);
+  EXPECT_EQ(BULK_FORMAT_ENVELOPE, envelope.GetFormat());
+  EXPECT_EQ(true, envelope.GetRecordCount() == 1);
+  remove(path.c_str());
+
+  // Stored transactions carry a type on every line
+  const std::string transaction = "{\"event_id\":\"1\",\"type\":\"transaction\",\"transaction\":\"load\"}";
+  path = WriteBulkFile(transaction + "\n" + transaction + "\n");
+  ASSERT_EQ(false, path.empty());
+  BulkReader transactions(path);
+  EXPECT_EQ(BULK_FORMAT_NDJSON, transactions.GetFormat());
+  EXPECT_EQ(true, transactions.GetRecordCount() == 2);
+  remove(path.c_str());
+
+  // An event followed by an event with a type
+  path = WriteBulkFile(MakeEvent(1) + "\n{\"event_id\":\"2\",\"type\":\"error\"}\n");
+  ASSERT_EQ(false, path.empty());
+  BulkReader events(path);
+  EXPECT_EQ(BULK_FORMAT_NDJSON, events.GetFormat());
+  EXPECT_EQ(true, events.GetRecordCount() == 2);
+  remove(path.c_str());
+}
+#endif
\ No newline at end of file
@@ -7,7 +7,7 @@
 * @copyright CadActive Technologies, LLC
 ***********************************************/
 #include "SentryClient.h"
-#include <gtest\gtest.h>
+#include <gtest/gtest.h>
 
 using namespace sentry;
 using namespace rapidjson;
@@ -0,0 +1,76 @@
+/********************************************//**
+* @file SentryCrashHandlerTest.cpp
+* @brief Testing for SentryCrashHandler.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryCrashHandler.h"
+#include <gtest/gtest.h>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test loading without a pending crash
+*/
+TEST(CrashReport, Base) {
+  CrashReport report;
+  EXPECT_EQ(false, report.IsValid());
+  EXPECT_EQ(false, CrashReport::LoadPending("/this/file/does/not/exist", report));
+  EXPECT_EQ(false, report.IsValid());
+}
+
+#if defined(__linux__)
+/*! @test Test a crash written by the handler and loaded on the next start
+*/
+TEST(CrashHandler, Crash) {
+  const std::string path = "/tmp/sentry-cpp-crash-test.bin";
+  unlink(path.c_str());
+  unlink((path + CRASH_PENDING_SUFFIX).c_str());
+
+  EXPECT_EXIT({
+    CrashHandler::GetInstance().Install(path);
+    raise(SIGSEGV);
+  }, ::testing::KilledBySignal(SIGSEGV), "");
+
+  // The next start moves the record aside before installing
+  CrashHandler &handler = CrashHandler::GetInstance();
+  ASSERT_EQ(true, handler.Install(path));
+  handler.Uninstall();
+
+  CrashReport report;
+  ASSERT_EQ(true, CrashReport::LoadPending(path, report));
+  EXPECT_EQ(SIGSEGV, report.GetSignal());
+  EXPECT_EQ(true, report.GetException().GetType() == "SIGSEGV");
+  EXPECT_EQ(true, report.GetException().GetStacktrace().IsValid());
+  EXPECT_EQ(false, report.GetImages().empty());
+  ASSERT_EQ(true, report.GetThreads().GetThreads().size() == 1);
+  EXPECT_EQ(true, report.GetThreads().GetThreads().at(0).IsCrashed());
+
+  rapidjson::Document json;
+  json.SetObject();
+  report.AddToJson(json);
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_EXCEPTION));
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_THREADS));
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_DEBUG_META));
+
+  // The session open at the crash is counted as crashed
+  std::vector<std::string> envelopes;
+  {
+    SessionTracker tracker(attributes::Release("app@1.0.0"), attributes::Environment("production"),
+      [&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+    report.AddToSessions(tracker);
+  }
+  ASSERT_EQ(1u, envelopes.size());
+  EXPECT_EQ(true, envelopes[0].find("\"crashed\":1") != std::string::npos);
+
+  // The record is consumed
+  CrashReport again;
+  EXPECT_EQ(false, CrashReport::LoadPending(path, again));
+  unlink(path.c_str());
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+/********************************************//**
+* @file SentryDebugMetaTest.cpp
+* @brief Testing for SentryDebugMeta.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryDebugMeta.h"
+#include <gtest/gtest.h>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test a debug image
+*/
+TEST(DebugImage, Base) {
+  DebugImage empty;
+  EXPECT_EQ(false, empty.IsValid());
+
+  DebugImage some("/usr/lib/libsome.so", 0x7f0000000000, 0x2000, "b1c2d3e4f5a60718293a4b5c6d7e8f90");
+  EXPECT_EQ(true, some.IsValid());
+  EXPECT_EQ(true, some.Contains(0x7f0000001fff));
+  EXPECT_EQ(false, some.Contains(0x7f0000002000));
+  EXPECT_EQ(true, some.GetDebugID() == "e4d3c2b1-a6f5-1807-293a-4b5c6d7e8f90");
+}
+
+/*! @test Test JSON methods
+*/
+TEST(DebugImage, JSON) {
+  DebugImage some("/usr/lib/libsome.so", 0x7f0000000000, 0x2000, "b1c2d3e4f5a60718293a4b5c6d7e8f90");
+
+  rapidjson::Document json;
+  some.ToJson(json);
+
+  DebugImage some_json(json);
+  EXPECT_EQ(true, some_json.IsValid());
+  EXPECT_EQ(true, some_json.GetImageAddr() == some.GetImageAddr());
+  EXPECT_EQ(true, some_json.GetImageSize() == some.GetImageSize());
+  EXPECT_EQ(true, some_json.GetDebugID() == some.GetDebugID());
+}
+
+#if defined(__linux__)
+/*! @test Test the loaded module registry
+*/
+TEST(ModuleRegistry, Snapshot) {
+  ModuleRegistry registry;
+  EXPECT_EQ(true, registry.GetSnapshot() == NULL);
+  {
+    // Readers only load the snapshot, they never walk the loader themselves
+    ScopedModuleSnapshot unrefreshed(registry);
+    EXPECT_EQ(true, unrefreshed.Get() == NULL);
+  }
+  EXPECT_EQ(true, registry.Refresh());
+
+  const ModuleSnapshot *snapshot = registry.GetSnapshot();
+  ASSERT_EQ(true, snapshot != NULL);
+  EXPECT_EQ(false, snapshot->GetImages().empty());
+
+  // Nothing was loaded or unloaded, so the snapshot is kept
+  EXPECT_EQ(false, registry.Refresh());
+  EXPECT_EQ(true, registry.GetSnapshot() == snapshot);
+  EXPECT_EQ(true, registry.GetRetiredCount() == 0);
+  {
+    ScopedModuleSnapshot pinned(registry);
+    EXPECT_EQ(true, pinned.Get() == snapshot);
+  }
+
+  uint64_t address = reinterpret_cast<uintptr_t>(&DebugImage::FormatAddress);
+  Frame frame("abcd", "some_function");
+  EXPECT_EQ(true, snapshot->AnnotateFrame(address, frame));
+  EXPECT_EQ(false, frame.GetImageAddr().empty());
+  EXPECT_EQ(false, frame.GetPackage().empty());
+
+  rapidjson::Document json;
+  json.SetObject();
+  registry.AddToJson(json);
+  ASSERT_EQ(true, json.HasMember(JSON_ELEM_DEBUG_META));
+  EXPECT_EQ(true, json[JSON_ELEM_DEBUG_META][JSON_ELEM_DEBUG_IMAGES].Size() > 0);
+}
+
+/*! @test Test that a watching registry has a snapshot before anyone reads it
+*/
+TEST(ModuleRegistry, Watch) {
+  ModuleRegistry registry(true);
+  ScopedModuleSnapshot pinned(registry);
+  ASSERT_EQ(true, pinned.Get() != NULL);
+  EXPECT_EQ(false, pinned.Get()->GetImages().empty());
+  EXPECT_EQ(true, ModuleRegistry::GetInstance().GetSnapshot() != NULL);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+/********************************************//**
+* @file SentryElfTest.cpp
+* @brief Testing for SentryElf.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryElf.h"
+#include <gtest/gtest.h>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#endif
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+
+/*! @test Test a missing image
+*/
+TEST(ElfImage, Base) {
+  ElfImage missing("/this/file/does/not/exist");
+  EXPECT_EQ(false, missing.IsValid());
+  EXPECT_EQ(true, missing.GetSymbolCount() == 0);
+
+  ElfLocation location;
+  EXPECT_EQ(false, missing.Lookup(0x1000, location));
+}
+
+#if defined(__linux__)
+/*! @brief A function with a known location to look up
+*/
+extern "C" __attribute__((noinline)) int SentryElfTestTarget(int value) {
+  return value * 3 + 1;
+}
+
+/*! @test Test resolving an address in the running executable
+*/
+TEST(ElfImage, Lookup) {
+  ElfImage self("/proc/self/exe");
+  ASSERT_EQ(true, self.IsValid());
+  EXPECT_EQ(true, self.GetSymbolCount() > 0);
+
+  Dl_info info;
+  void *target = reinterpret_cast<void *>(&SentryElfTestTarget);
+  ASSERT_NE(0, dladdr(target, &info));
+
+  uint64_t address = reinterpret_cast<uintptr_t>(target) - reinterpret_cast<uintptr_t>(info.dli_fbase) + self.GetBaseAddress();
+
+  ElfLocation location;
+  EXPECT_EQ(true, self.Lookup(address, location));
+  EXPECT_EQ(true, location.function == "SentryElfTestTarget");
+  EXPECT_EQ(true, location.symbol_addr == address);
+
+  if (self.GetLineRowCount() > 0) {
+    EXPECT_EQ(true, location.lineno > 0);
+    EXPECT_EQ(true, location.filename.find("SentryElfTest.cpp") != std::string::npos);
+  }
+
+  Frame frame = self.Symbolize(address);
+  EXPECT_EQ(true, frame.IsValid());
+  EXPECT_EQ(true, frame.GetFunction() == "SentryElfTestTarget");
+}
+#endif
\ No newline at end of file
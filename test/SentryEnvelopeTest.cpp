@@ -0,0 +1,40 @@
+/********************************************//**
+* @file SentryEnvelopeTest.cpp
+* @brief Testing for SentryEnvelope.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEnvelope.h"
+#include <gtest/gtest.h>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test the envelope header and items with and without newlines
+*/
+TEST(EnvelopeWriter, Base) {
+  EnvelopeWriter empty;
+  EXPECT_EQ(true, empty.IsEmpty());
+  EXPECT_EQ(std::string("{}\n"), empty.GetEnvelope());
+
+  EnvelopeWriter envelope("fc6d8c0c43fc4630ad850ee518f1b9d0");
+  envelope.AddItem("attachment", std::string("line one\nline two"));
+  EXPECT_EQ(false, envelope.IsEmpty());
+  EXPECT_EQ(1u, envelope.GetItemCount());
+
+  Document payload;
+  payload.Parse("{\"message\":\"hello\"}");
+  envelope.AddItem("event", payload);
+  EXPECT_EQ(2u, envelope.GetItemCount());
+  EXPECT_EQ(std::string(
+    "{\"event_id\":\"fc6d8c0c43fc4630ad850ee518f1b9d0\"}\n"
+    "{\"type\":\"attachment\",\"length\":17}\nline one\nline two\n"
+    "{\"type\":\"event\",\"length\":19}\n{\"message\":\"hello\"}\n"), envelope.GetEnvelope());
+
+  EXPECT_EQ(std::string("{}\n{\"type\":\"statsd\",\"length\":5}\na:1|c\n"), EnvelopeWriter::MakeEnvelope("statsd", std::string("a:1|c")));
+}
\ No newline at end of file
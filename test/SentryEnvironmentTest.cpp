@@ -0,0 +1,94 @@
+/********************************************//**
+* @file SentryEnvironmentTest.cpp
+* @brief Testing for SentryEnvironment.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEnvironment.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test detecting from an os-release file
+*/
+TEST(EnvironmentDetector, Base) {
+  const std::string path = "sentry_environment_test_os_release";
+  {
+    std::ofstream file(path.c_str());
+    file << "# comment\n";
+    file << "NAME=\"Example \\\"Linux\\\"\"\n";
+    file << "VERSION_ID='1.2'\n";
+    file << "BUILD_ID=rolling\n";
+  }
+
+  std::map<std::string, std::string> values;
+  EXPECT_EQ(true, EnvironmentDetector::ParseOSRelease(path, values));
+  EXPECT_EQ(true, values["NAME"] == "Example \"Linux\"");
+  EXPECT_EQ(true, values["VERSION_ID"] == "1.2");
+  EXPECT_EQ(true, values["BUILD_ID"] == "rolling");
+
+  std::shared_ptr<const DetectedContexts> contexts = EnvironmentDetector::Detect(path);
+  std::remove(path.c_str());
+  EXPECT_EQ(true, contexts->GetOS()->GetName() == "Example \"Linux\"");
+  EXPECT_EQ(true, contexts->GetOS()->GetVersion() == "1.2");
+  EXPECT_EQ(true, contexts->GetOS()->GetBuild() == "rolling");
+  EXPECT_EQ(true, contexts->GetRuntime()->IsValid());
+  EXPECT_EQ(true, contexts->GetRuntime()->GetName() == EnvironmentDetector::GetCompilerName());
+
+  // Missing files fall back to uname
+  EXPECT_EQ(false, EnvironmentDetector::ParseOSRelease(path, values));
+  EXPECT_EQ(true, EnvironmentDetector::Detect(path)->GetOS()->IsValid());
+
+  // Detection happens once and the same contexts are handed out
+  EnvironmentDetector &detector = EnvironmentDetector::GetInstance();
+  EXPECT_EQ(true, detector.Get() == detector.Get());
+  EXPECT_EQ(false, detector.Refresh());
+  EXPECT_EQ(0u, Scope::Global().GetNode()->GetContexts().count(JSON_ELEM_CONTEXT_OS));
+
+  detector.Install();
+  const auto &installed = Scope::Global().GetNode()->GetContexts();
+  EXPECT_EQ(true, installed.at(JSON_ELEM_CONTEXT_OS) == detector.Get()->GetPrebuilt().front());
+
+  detector.StartRefresh(std::chrono::seconds(60));
+  EXPECT_EQ(true, detector.IsRefreshing());
+  detector.StopRefresh();
+  EXPECT_EQ(false, detector.IsRefreshing());
+}
+
+/*! @test Test the cached JSON
+*/
+TEST(EnvironmentDetector, JSON) {
+  DetectedContexts contexts(std::make_shared<ContextOS>("Linux", "6.1", "", "6.1.0"),
+    std::make_shared<ContextRuntime>("gcc", "13.2.0"));
+
+  rapidjson::Document json;
+  json.SetObject();
+  contexts.AddToJson(json);
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_CONTEXTS));
+
+  const rapidjson::Value &os = json[JSON_ELEM_CONTEXTS][JSON_ELEM_CONTEXT_OS];
+  ContextOS os_json(os);
+  EXPECT_EQ(true, os_json.GetName() == "Linux");
+  EXPECT_EQ(true, os_json.GetKernelVersion() == "6.1.0");
+
+  ContextRuntime runtime_json(json[JSON_ELEM_CONTEXTS][JSON_ELEM_CONTEXT_RUNTIME]);
+  EXPECT_EQ(true, runtime_json.GetVersion() == "13.2.0");
+
+  // The scope carries the prebuilt JSON into events
+  ASSERT_EQ(2u, contexts.GetPrebuilt().size());
+  rapidjson::Document prebuilt;
+  contexts.GetPrebuilt().front()->ToJson(prebuilt);
+  EXPECT_EQ(true, std::string(prebuilt[JSON_ELEM_OS_KERNEL_VERSION].GetString()) == "6.1.0");
+  EXPECT_EQ(true, contexts.GetPrebuilt().front()->GetType() == JSON_ELEM_CONTEXT_OS);
+
+  EXPECT_EQ(false, contexts.GetSerialized().empty());
+  EXPECT_EQ(true, contexts.GetSerialized().find("\"kernel_version\":\"6.1.0\"") != std::string::npos);
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+/********************************************//**
+* @file SentryEventTest.cpp
+* @brief Testing for SentryEvent.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEvent.h"
+#include "SentryMessage.h"
+#include "SentryUser.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <string.h>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test creating and moving events
+*/
+TEST(Event, Base) {
+  Event event;
+  EXPECT_EQ(true, event.IsValid());
+  EXPECT_EQ(EVENT_ID_LENGTH, strlen(event.GetEventID()));
+  EXPECT_EQ(EVENT_ID_LENGTH, strspn(event.GetEventID(), "0123456789abcdef"));
+  EXPECT_EQ(true, std::string(Event().GetEventID()) != event.GetEventID());
+
+  // Moving hands over the arena as it is
+  const rapidjson::Document *document = &event.GetDocument();
+  std::string event_id = event.GetEventID();
+  Event moved(std::move(event));
+  EXPECT_EQ(false, event.IsValid());
+  EXPECT_EQ(true, moved.IsValid());
+  EXPECT_EQ(true, &moved.GetDocument() == document);
+  EXPECT_EQ(true, moved.GetEventID() == event_id);
+
+  std::vector<Event> queue;
+  queue.push_back(std::move(moved));
+  EXPECT_EQ(true, queue.back().GetEventID() == event_id);
+  EXPECT_EQ(true, event.ToString().empty());
+  EXPECT_EQ(0u, event.GetArenaSize());
+}
+
+/*! @test Test writing interfaces into the event
+*/
+TEST(Event, JSON) {
+  Event event(attributes::Level(attributes::Level::LEVEL_WARNING));
+  event.Add(Message("Request failed"))
+    .Add(User("42", "user@example.com", "user"))
+    .AddException(Exception("std::runtime_error", "timed out", "main"))
+    .AddException(Exception("std::logic_error", "bad state", "main"))
+    .AddContext(ContextRuntime("gcc", "13.2.0"))
+    .AddContext(ContextRuntime("gcc", "14.1.0"));
+
+  const rapidjson::Document &json = event.GetDocument();
+  EXPECT_EQ(true, std::string(json[JSON_ELEM_EVENT_ID].GetString()) == event.GetEventID());
+  EXPECT_EQ(true, std::string(json[JSON_ELEM_LEVEL].GetString()) == attributes::LEVEL_TYPE_WARNING);
+  EXPECT_EQ(true, std::string(json[JSON_ELEM_PLATFORM].GetString()) == EVENT_PLATFORM);
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_TIMESTAMP));
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_SDK));
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_MESSAGE));
+  EXPECT_EQ(true, json.HasMember(JSON_ELEM_USER));
+  EXPECT_EQ(2u, json[JSON_ELEM_EXCEPTION][JSON_ELEM_EXCEPTION_VALUES].Size());
+
+  // A context of the same type replaces the earlier one
+  ContextRuntime runtime(json[JSON_ELEM_CONTEXTS][JSON_ELEM_CONTEXT_RUNTIME]);
+  EXPECT_EQ(true, runtime.GetVersion() == "14.1.0");
+
+  EXPECT_EQ(true, event.ToString().find(event.GetEventID()) != std::string::npos);
+}
\ No newline at end of file
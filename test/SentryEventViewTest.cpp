@@ -0,0 +1,134 @@
+/********************************************//**
+* @file SentryEventViewTest.cpp
+* @brief Testing for SentryEventView.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryEventView.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+static const char * const STORED_EVENT =
+  "{\"event_id\":\"fc6d8c0c43fc4630ad850ee518f1b9d0\",\"level\":\"fatal\",\"platform\":\"native\","
+  "\"message\":{\"message\":\"Could not save \\\"drawing.dwg\\\"\"},"
+  "\"exception\":{\"values\":[{\"type\":\"std::runtime_error\",\"value\":\"Could not open the document\",\"module\":\"app\",\"thread_id\":\"1204\","
+  "\"stacktrace\":{\"frames\":["
+  "{\"filename\":\"src/main.cpp\",\"function\":\"main\",\"lineno\":12,\"in_app\":true},"
+  "{\"filename\":\"src/document_writer.cpp\",\"function\":\"DocumentWriter::Save\",\"lineno\":210,\"in_app\":true,\"instruction_addr\":\"0x00007f3a12c4d0e8\"}]}}]},"
+  "\"threads\":{\"values\":["
+  "{\"thread_id\":1204,\"crashed\":true,\"current\":true,\"name\":\"main\",\"stacktrace\":{\"frames\":[{\"filename\":\"src/main.cpp\",\"function\":\"main\"}]}},"
+  "{\"thread_id\":1205,\"crashed\":false,\"current\":false,\"name\":\"worker\"}]}}";
+
+/*! @brief A writable, null terminated copy for parsing in place
+*/
+static std::vector<char> MakeBuffer(const std::string &text) {
+  return std::vector<char>(text.c_str(), text.c_str() + text.size() + 1);
+}
+
+/*! @test Test views of an invalid event and of missing members
+*/
+TEST(EventView, Base) {
+  std::vector<char> buffer = MakeBuffer("[not, an, event]");
+  EventView invalid(&buffer[0]);
+  EXPECT_EQ(false, invalid.IsValid());
+  EXPECT_EQ(true, invalid.GetEventId().empty());
+  EXPECT_EQ(true, invalid.GetExceptionCount() == 0);
+  EXPECT_EQ(true, invalid.GetException(0).IsEmpty());
+
+  EventView missing(NULL);
+  EXPECT_EQ(false, missing.IsValid());
+
+  buffer = MakeBuffer("{\"message\":\"plain message\"}");
+  EventView event(&buffer[0]);
+  EXPECT_EQ(true, event.IsValid());
+  EXPECT_EQ(true, event.GetMessage() == StringView("plain message"));
+  EXPECT_EQ(true, event.GetLevel().empty());
+  EXPECT_EQ(true, event.GetThreadCount() == 0);
+
+  ExceptionView exception = event.GetException(3);
+  EXPECT_EQ(true, exception.IsEmpty());
+  EXPECT_EQ(-1, exception.GetThreadId());
+  EXPECT_EQ(true, exception.GetStacktrace().GetFrameCount() == 0);
+  EXPECT_EQ(false, exception.ToException().IsValid());
+}
+
+/*! @test Test reading a stored event through views
+*/
+TEST(EventView, Read) {
+  std::vector<char> buffer = MakeBuffer(STORED_EVENT);
+  EventView event(&buffer[0]);
+  ASSERT_EQ(true, event.IsValid());
+  EXPECT_EQ(true, event.GetEventId() == StringView("fc6d8c0c43fc4630ad850ee518f1b9d0"));
+  EXPECT_EQ(true, event.GetLevel() == StringView("fatal"));
+  EXPECT_EQ(true, event.GetPlatform() == StringView("native"));
+  EXPECT_EQ(true, event.GetMessage() == StringView("Could not save \"drawing.dwg\""));
+
+  ASSERT_EQ(true, event.GetExceptionCount() == 1);
+  ExceptionView exception = event.GetException(0);
+  EXPECT_EQ(true, exception.GetType() == StringView("std::runtime_error"));
+  EXPECT_EQ(true, exception.GetValue() == StringView("Could not open the document"));
+  EXPECT_EQ(true, exception.GetModule() == StringView("app"));
+  EXPECT_EQ(1204, exception.GetThreadId());
+
+  StacktraceView stacktrace = exception.GetStacktrace();
+  ASSERT_EQ(true, stacktrace.GetFrameCount() == 2);
+  FrameView frame = stacktrace.GetFrame(1);
+  EXPECT_EQ(true, frame.GetFilename() == StringView("src/document_writer.cpp"));
+  EXPECT_EQ(true, frame.GetFunction() == StringView("DocumentWriter::Save"));
+  EXPECT_EQ(true, frame.GetInstructionAddr() == StringView("0x00007f3a12c4d0e8"));
+  EXPECT_EQ(true, frame.GetModule().empty());
+  EXPECT_EQ(210, frame.GetLineNumber());
+  EXPECT_EQ(true, frame.IsInApp());
+  EXPECT_EQ(true, stacktrace.GetFrame(2).IsEmpty());
+
+  ASSERT_EQ(true, event.GetThreadCount() == 2);
+  ThreadView crashed = event.GetThread(0);
+  EXPECT_EQ(1204, crashed.GetThreadID());
+  EXPECT_EQ(true, crashed.GetName() == StringView("main"));
+  EXPECT_EQ(true, crashed.IsCrashed());
+  EXPECT_EQ(true, crashed.IsCurrent());
+  EXPECT_EQ(true, crashed.GetStacktrace().GetFrameCount() == 1);
+  EXPECT_EQ(false, event.GetThread(1).IsCrashed());
+  EXPECT_EQ(true, event.GetThread(1).GetStacktrace().IsEmpty());
+}
+
+/*! @test Test converting views to the owning interfaces
+*/
+TEST(EventView, Convert) {
+  std::vector<char> buffer = MakeBuffer(STORED_EVENT);
+  EventView event(&buffer[0]);
+  ASSERT_EQ(true, event.IsValid());
+
+  Exception exception = event.GetException(0).ToException();
+  EXPECT_EQ(true, exception.GetType() == "std::runtime_error");
+  EXPECT_EQ(true, exception.GetValue() == "Could not open the document");
+  EXPECT_EQ(1204, exception.GetThreadId());
+  EXPECT_EQ(true, exception.GetStacktrace().GetFrames().size() == 2);
+
+  Stacktrace stacktrace = event.GetException(0).GetStacktrace().ToStacktrace();
+  EXPECT_EQ(true, stacktrace.GetFrames().size() == 2);
+
+  Frame frame = event.GetException(0).GetStacktrace().GetFrame(1).ToFrame();
+  EXPECT_EQ(true, frame.GetFunction() == "DocumentWriter::Save");
+  EXPECT_EQ(210, frame.GetLineNumber());
+  EXPECT_EQ(true, frame.IsInApp());
+
+  Thread thread = event.GetThread(0).ToThread();
+  EXPECT_EQ(1204, thread.GetThreadID());
+  EXPECT_EQ(true, thread.GetName() == "main");
+  EXPECT_EQ(true, thread.IsCrashed());
+
+  // The owning copies outlive the buffer
+  buffer.assign(buffer.size(), '\0');
+  EXPECT_EQ(true, exception.GetValue() == "Could not open the document");
+  EXPECT_EQ(true, frame.GetFilename() == "src/document_writer.cpp");
+}
\ No newline at end of file
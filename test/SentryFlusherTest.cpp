@@ -0,0 +1,71 @@
+/********************************************//**
+* @file SentryFlusherTest.cpp
+* @brief Testing for SentryFlusher.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryFlusher.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test flushing on an interval, stopping and starting again
+*/
+TEST(PeriodicFlusher, Base) {
+  std::atomic<int> flushes(0);
+  PeriodicFlusher flusher([&flushes]() { ++flushes; }, std::chrono::milliseconds(5));
+  EXPECT_EQ(false, flusher.IsRunning());
+  EXPECT_EQ(5, flusher.GetInterval().count());
+
+  flusher.Start();
+  EXPECT_EQ(true, flusher.IsRunning());
+  for (int i = 0; i < 200 && flushes.load() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  flusher.Stop();
+  EXPECT_EQ(false, flusher.IsRunning());
+  EXPECT_EQ(true, flushes.load() >= 2);
+
+  // Stopped means no more flushes
+  const int stopped = flushes.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(stopped, flushes.load());
+
+  flusher.Start();
+  for (int i = 0; i < 200 && flushes.load() == stopped; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  flusher.Stop();
+  EXPECT_EQ(true, flushes.load() > stopped);
+}
+
+/*! @test Test stopping from inside the flush
+*/
+TEST(PeriodicFlusher, StopFromFlush) {
+  std::atomic<int> flushes(0);
+  PeriodicFlusher *self = NULL;
+  PeriodicFlusher flusher([&flushes, &self]() {
+    ++flushes;
+    self->Stop();
+  }, std::chrono::milliseconds(1));
+  self = &flusher;
+
+  flusher.Start();
+  for (int i = 0; i < 200 && flusher.IsRunning(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(false, flusher.IsRunning());
+  EXPECT_EQ(1, flushes.load());
+
+  // Start joins the thread that stopped itself
+  flusher.Start();
+  EXPECT_EQ(true, flusher.IsRunning());
+  flusher.Stop();
+}
\ No newline at end of file
@@ -7,7 +7,7 @@
 * @copyright CadActive Technologies, LLC
 ***********************************************/
 #include "SentryFrame.h"
-#include <gtest\gtest.h>
+#include <gtest/gtest.h>
 
 using namespace sentry;
 using namespace rapidjson;
@@ -40,4 +40,22 @@ TEST(Frame, JSON) {
   Frame some_json(json);
   EXPECT_EQ(true, some_json.IsValid());
   EXPECT_EQ(true, some_json.GetFunction() == some.GetFunction());
+}
+
+/*! @test Test vars spilling out of the frame
+*/
+TEST(Frame, Vars) {
+  rapidjson::Document json;
+  json.Parse("{\"filename\":\"abcd\",\"function\":\"some_function\",\"vars\":{\"c\":\"3\",\"a\":\"1\",\"b\":\"2\"}}");
+  Frame some(json);
+  EXPECT_EQ(true, some.IsValid());
+
+  rapidjson::Document some_json;
+  some.ToJson(some_json);
+  ASSERT_EQ(true, some_json.HasMember(JSON_ELEM_VARS));
+  EXPECT_EQ(3u, some_json[JSON_ELEM_VARS].MemberCount());
+  EXPECT_EQ(true, std::string(some_json[JSON_ELEM_VARS]["b"].GetString()) == "2");
+
+  // Only one var is kept inline, so frames without vars stay small
+  EXPECT_EQ(true, sizeof(FrameVarMap) < sizeof(StringMap));
 }
\ No newline at end of file
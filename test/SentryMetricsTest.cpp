@@ -0,0 +1,203 @@
+/********************************************//**
+* @file SentryMetricsTest.cpp
+* @brief Testing for SentryMetrics.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryMetrics.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief The payload lines of a statsd envelope, in order
+*/
+static std::vector<std::string> GetLines(const std::string &envelope) {
+  std::vector<std::string> lines;
+  size_t start = envelope.find('\n', envelope.find('\n') + 1) + 1;
+  while (start < envelope.size()) {
+    size_t end = envelope.find('\n', start);
+    if (end == std::string::npos) { end = envelope.size(); }
+    lines.push_back(envelope.substr(start, end - start));
+    start = end + 1;
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+/*! @brief Exposes the series lookup to force keys to collide
+*/
+class CollidingMetrics : public MetricsAggregator {
+public:
+  CollidingMetrics() : MetricsAggregator(Sink()) {}
+  using MetricsAggregator::Find;
+};
+
+/*! @test Test counters and gauges from several threads
+*/
+TEST(Metrics, Base) {
+  std::vector<std::string> envelopes;
+  MetricsAggregator metrics([&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+
+  StringMap tags;
+  tags["route"] = "/api|v1";
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&metrics, &tags, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        metrics.Increment("requests", 1.0, "none", tags);
+        metrics.Gauge("queue depth", static_cast<double>(t * 1000 + i), "byte");
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+  EXPECT_EQ(2u, metrics.GetSeriesCount());
+  EXPECT_EQ(METRICS_CACHE_LINE, sizeof(MetricWriters));
+  EXPECT_EQ(true, MetricsAggregator::HashSeries(METRIC_COUNTER, "a", "none", StringMap()) != MetricsAggregator::HashSeries(METRIC_GAUGE, "a", "none", StringMap()));
+
+  EXPECT_EQ(2u, metrics.Flush());
+  ASSERT_EQ(1u, envelopes.size());
+  EXPECT_EQ(0, envelopes[0].find("{}\n{\"type\":\"statsd\",\"length\":"));
+
+  std::vector<std::string> lines = GetLines(envelopes[0]);
+  ASSERT_EQ(2u, lines.size());
+  EXPECT_EQ(0, lines[0].find("queue_depth@byte:"));
+  EXPECT_EQ(true, lines[0].find(":0:3999:7998000:4000|g|T") != std::string::npos);
+  EXPECT_EQ(0, lines[1].find("requests@none:4000|c|#route:/api_v1|T"));
+
+  // Nothing recorded since, so nothing is sent and the series are gone
+  EXPECT_EQ(0u, metrics.GetSeriesCount());
+  EXPECT_EQ(0u, metrics.Flush());
+  EXPECT_EQ(1u, envelopes.size());
+
+  metrics.Increment("requests", 2.5, "none", tags);
+  EXPECT_EQ(1u, metrics.Flush());
+  EXPECT_EQ(0, GetLines(envelopes[1])[0].find("requests@none:2.5|c"));
+}
+
+/*! @test Test distributions stay within the sketch's error
+*/
+TEST(Metrics, Distribution) {
+  DistributionSketch sketch;
+  for (int i = 1; i <= 1000; ++i) {
+    sketch.Add(static_cast<double>(i));
+  }
+  sketch.Add(0.0);
+  sketch.Add(-5.0);
+  EXPECT_EQ(1002u, sketch.GetCount());
+
+  std::vector<double> values;
+  sketch.TakeValues(values, 100);
+  ASSERT_EQ(100u, values.size());
+  EXPECT_EQ(0u, sketch.GetCount());
+  EXPECT_EQ(true, std::is_sorted(values.begin(), values.end()));
+  EXPECT_NEAR(500.0, values[50], 500.0 * (DISTRIBUTION_ACCURACY + 0.01));
+  EXPECT_NEAR(990.0, values[99], 990.0 * (DISTRIBUTION_ACCURACY + 0.01));
+
+  sketch.Add(-5.0);
+  sketch.Add(3.0);
+  sketch.Add(3.0);
+  values.clear();
+  sketch.TakeValues(values, 100);
+  ASSERT_EQ(3u, values.size());
+  EXPECT_NEAR(-5.0, values[0], 5.0 * DISTRIBUTION_ACCURACY);
+  EXPECT_NEAR(3.0, values[1], 3.0 * DISTRIBUTION_ACCURACY);
+  EXPECT_EQ(values[1], values[2]);
+
+  // Ten seconds in nanoseconds is inside the bins; values past them are kept exactly
+  sketch.Add(1e10);
+  sketch.Add(1e30);
+  sketch.Add(-1e25);
+  EXPECT_EQ(3u, sketch.GetCount());
+  values.clear();
+  EXPECT_EQ(true, sketch.TakeValues(values, 100));
+  ASSERT_EQ(3u, values.size());
+  EXPECT_EQ(-1e25, values[0]);
+  EXPECT_NEAR(1e10, values[1], 1e10 * DISTRIBUTION_ACCURACY);
+  EXPECT_EQ(1e30, values[2]);
+  EXPECT_EQ(0u, sketch.GetCount());
+
+  std::vector<std::string> envelopes;
+  MetricsAggregator metrics([&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+  for (int i = 0; i < 10; ++i) {
+    metrics.Distribution("latency", 12.0, "millisecond");
+  }
+  EXPECT_EQ(1u, metrics.Flush());
+  std::string line = GetLines(envelopes[0])[0];
+  EXPECT_EQ(0, line.find("latency@millisecond:"));
+  EXPECT_EQ(10, std::count(line.begin(), line.begin() + line.find('|'), ':'));
+
+  // Past the sample limit the exact count and sum go out as a gauge as well
+  for (int i = 1; i <= 1000; ++i) {
+    metrics.Distribution("latency", static_cast<double>(i), "millisecond");
+  }
+  EXPECT_EQ(1u, metrics.Flush());
+  std::vector<std::string> lines = GetLines(envelopes[1]);
+  ASSERT_EQ(2u, lines.size());
+  const size_t gauge = (lines[0].find("|g|T") != std::string::npos) ? 0 : 1;
+  EXPECT_EQ(0, lines[gauge].find("latency@millisecond:1000:1:1000:500500:1000|g|T"));
+  EXPECT_EQ(static_cast<long>(DISTRIBUTION_SAMPLES), static_cast<long>(std::count(lines[1 - gauge].begin(), lines[1 - gauge].begin() + lines[1 - gauge].find('|'), ':')));
+}
+
+/*! @test Test series whose keys collide stay apart
+*/
+TEST(Metrics, Collision) {
+  CollidingMetrics metrics;
+  MetricSeries *first = metrics.Find(0, 42, METRIC_COUNTER, "first", "none", StringMap());
+  MetricSeries *second = metrics.Find(0, 42, METRIC_COUNTER, "second", "none", StringMap());
+  ASSERT_EQ(true, first != NULL && second != NULL);
+  EXPECT_EQ(true, first != second);
+  EXPECT_EQ(true, first->name == "first");
+  EXPECT_EQ(true, second->name == "second");
+  EXPECT_EQ(true, metrics.Find(0, 42, METRIC_COUNTER, "first", "none", StringMap()) == first);
+  EXPECT_EQ(true, metrics.Find(0, 42, METRIC_GAUGE, "first", "none", StringMap()) != first);
+  EXPECT_EQ(3u, metrics.GetSeriesCount());
+}
+
+/*! @test Test distinct counts with HyperLogLog
+*/
+TEST(Metrics, Set) {
+  HyperLogLog small;
+  for (int i = 0; i < 10; ++i) {
+    small.Add(MetricsAggregator::HashString(std::to_string(i % 5)) * 0x9E3779B97F4A7C15ULL);
+  }
+  EXPECT_EQ(5u, small.TakeEstimate());
+  EXPECT_EQ(0u, small.TakeEstimate());
+
+  std::vector<std::string> envelopes;
+  MetricsAggregator metrics([&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+
+  // A set that fits the sample goes out as its members' hashes
+  for (int i = 0; i < 900; ++i) {
+    metrics.Set("users", std::to_string(i % 300));
+  }
+  EXPECT_EQ(1u, metrics.Flush());
+  std::vector<std::string> lines = GetLines(envelopes[0]);
+  ASSERT_EQ(1u, lines.size());
+  EXPECT_EQ(300, std::count(lines[0].begin(), lines[0].begin() + lines[0].find('|'), ':'));
+  EXPECT_EQ(true, lines[0].find("|s|T") != std::string::npos);
+  const uint64_t hash = MetricsAggregator::HashString("7");
+  EXPECT_EQ(true, lines[0].find(":" + std::to_string(static_cast<uint32_t>(hash ^ (hash >> 32))) + ":") != std::string::npos);
+
+  // A larger set sends a sample of real members and its estimate as a gauge
+  for (int i = 0; i < 20000; ++i) {
+    metrics.Set("users", std::to_string(i % 5000));
+  }
+  EXPECT_EQ(1u, metrics.Flush());
+  lines = GetLines(envelopes[1]);
+  ASSERT_EQ(2u, lines.size());
+  EXPECT_EQ(true, lines[0].find("|g|T") != std::string::npos);
+  EXPECT_NEAR(5000.0, atof(lines[0].substr(lines[0].find(':') + 1).c_str()), 5000 * 0.1);
+  EXPECT_EQ(true, lines[1].find("|s|T") != std::string::npos);
+  EXPECT_EQ(static_cast<long>(SET_SAMPLE_MEMBERS), static_cast<long>(std::count(lines[1].begin(), lines[1].begin() + lines[1].find('|'), ':')));
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+/********************************************//**
+* @file SentryPayloadBudgetTest.cpp
+* @brief Testing for SentryPayloadBudget.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryPayloadBudget.h"
+#include <gtest/gtest.h>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @brief Serialize a value the way events are sent
+*/
+static size_t SerializedSize(const rapidjson::Value &value) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  value.Accept(writer);
+  return buffer.GetSize();
+}
+
+/*! @brief An event with source context, vars, a long value and two threads
+*/
+static void MakeLargeEvent(rapidjson::Document &doc) {
+  std::string frame = "{\"function\":\"main\",\"context_line\":\"int main() {\",\"pre_context\":[";
+  for (int i = 0; i < 50; ++i) {
+    frame += (i > 0) ? ",\"// line\"" : "\"// line\"";
+  }
+  frame += "],\"vars\":{";
+  for (int i = 0; i < 40; ++i) {
+    frame += (i > 0) ? "," : "";
+    frame += "\"var" + std::to_string(100 + i) + "\":\"" + std::string(300, 'v') + "\"";
+  }
+  frame += "}}";
+
+  std::string json = "{\"event_id\":\"0123456789abcdef0123456789abcdef\",\"exception\":{\"values\":[{\"type\":\"error\",\"value\":\"";
+  for (int i = 0; i < 2000; ++i) {
+    json += "\xC3\xA9";  // Two-byte characters, so cuts must respect boundaries
+  }
+  json += "\",\"stacktrace\":{\"frames\":[" + frame + "," + frame + "]}}]},";
+  json += "\"threads\":{\"values\":[";
+  json += "{\"id\":1,\"crashed\":true,\"stacktrace\":{\"frames\":[{\"function\":\"crashed\"}]}},";
+  json += "{\"id\":2,\"crashed\":false,\"stacktrace\":{\"frames\":[" + frame + "]}}]}}";
+
+  doc.Parse(json.c_str());
+}
+
+/*! @test Test estimating and cutting strings
+*/
+TEST(PayloadBudget, Base) {
+  rapidjson::Document doc;
+  MakeLargeEvent(doc);
+  ASSERT_EQ(true, doc.IsObject());
+  EXPECT_EQ(true, PayloadBudget::Estimate(doc) >= SerializedSize(doc));
+
+  rapidjson::Document escaped;
+  escaped.Parse("{\"text\":\"quote \\\" tab \\t control \\u0001\",\"number\":-1234,\"list\":[1,2.5,true,null]}");
+  EXPECT_EQ(true, PayloadBudget::Estimate(escaped) >= SerializedSize(escaped));
+  EXPECT_EQ(true, PayloadBudget::EstimateString("a\"b", 3) == 6);
+
+  const char text[] = "ab\xC3\xA9";
+  EXPECT_EQ(4u, PayloadBudget::TruncateUTF8(text, 4, 10));
+  EXPECT_EQ(2u, PayloadBudget::TruncateUTF8(text, 4, 3));
+  EXPECT_EQ(2u, PayloadBudget::TruncateUTF8(text, 4, 2));
+
+  // Small events are left alone
+  EXPECT_EQ(PayloadBudget::TRIM_NONE, PayloadBudget().Apply(escaped, escaped.GetAllocator()));
+}
+
+/*! @test Test each trimming step in order
+*/
+TEST(PayloadBudget, Trim) {
+  const size_t budgets[] = { 42000, 20000, 7500, 3000 };
+  const PayloadBudget::TrimEnum expected[] = {
+    PayloadBudget::TRIM_SOURCE_CONTEXT,
+    PayloadBudget::TRIM_VARS,
+    PayloadBudget::TRIM_STRINGS,
+    PayloadBudget::TRIM_THREADS
+  };
+
+  for (size_t i = 0; i < 4; ++i) {
+    rapidjson::Document doc;
+    MakeLargeEvent(doc);
+
+    PayloadBudget budget(budgets[i]);
+    EXPECT_EQ(expected[i], budget.Apply(doc, doc.GetAllocator()));
+    EXPECT_EQ(true, SerializedSize(doc) <= budgets[i]);
+    EXPECT_EQ(true, PayloadBudget::Estimate(doc) <= budgets[i]);
+    EXPECT_EQ(false, doc["exception"]["values"][0]["stacktrace"]["frames"][0].HasMember(JSON_ELEM_PRE_CONTEXT));
+    EXPECT_EQ(true, doc["threads"]["values"][0].HasMember(JSON_ELEM_STACKTRACE));
+  }
+
+  rapidjson::Document doc;
+  MakeLargeEvent(doc);
+  EXPECT_EQ(PayloadBudget::TRIM_FAILED, PayloadBudget(100).Apply(doc, doc.GetAllocator()));
+
+  // Cut strings still end on whole characters
+  std::string value = doc["exception"]["values"][0]["value"].GetString();
+  EXPECT_EQ(true, value.size() < 4000);
+  EXPECT_EQ(true, value.substr(value.size() - 5) == "\xC3\xA9...");
+
+  // Identifiers are kept whole while free text is cut
+  const std::string function(300, 'f');
+  const std::string path = "/home/build/" + std::string(300, 'p') + "/main.cpp";
+  rapidjson::Document named;
+  named.Parse(("{\"message\":\"" + std::string(3000, 'm') + "\",\"exception\":{\"values\":[{\"type\":\"" + std::string(200, 't') + "\","
+    "\"stacktrace\":{\"frames\":[{\"function\":\"" + function + "\",\"abs_path\":\"" + path + "\"}]}}]}}").c_str());
+  ASSERT_EQ(true, named.IsObject());
+  EXPECT_EQ(PayloadBudget::TRIM_STRINGS, PayloadBudget(1500).Apply(named, named.GetAllocator()));
+  EXPECT_EQ(true, std::string(named["message"].GetString()).size() < 3000);
+  EXPECT_EQ(true, named["exception"]["values"][0]["type"].GetStringLength() == 200);
+  EXPECT_EQ(true, named["exception"]["values"][0]["stacktrace"]["frames"][0]["function"].GetString() == function);
+  EXPECT_EQ(true, named["exception"]["values"][0]["stacktrace"]["frames"][0]["abs_path"].GetString() == path);
+}
\ No newline at end of file
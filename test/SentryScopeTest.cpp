@@ -0,0 +1,79 @@
+/********************************************//**
+* @file SentryScopeTest.cpp
+* @brief Testing for SentryScope.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryScope.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test pushing and popping scopes
+*/
+TEST(Scope, Base) {
+  EXPECT_EQ(0u, Scope::GetDepth());
+  Scope::Pop();
+  EXPECT_EQ(0u, Scope::GetDepth());
+
+  Scope::Current().SetTag("layer", "thread");
+  {
+    LocalScope local;
+    EXPECT_EQ(1u, Scope::GetDepth());
+    Scope::Current().SetTag("layer", "local");
+    EXPECT_EQ(true, Scope::Current().GetNode()->GetTags().at("layer") == "local");
+  }
+  EXPECT_EQ(0u, Scope::GetDepth());
+  EXPECT_EQ(true, Scope::Current().GetNode()->GetTags().at("layer") == "thread");
+
+  // A snapshot keeps its view after later edits
+  ScopeSnapshot snapshot = Scope::Capture();
+  Scope::Current().SetTag("layer", "changed");
+  EXPECT_EQ(true, snapshot.GetLocal()->GetTags().at("layer") == "thread");
+
+  Scope::Current().Clear();
+  EXPECT_EQ(true, Scope::Current().GetNode()->GetTags().empty());
+}
+
+/*! @test Test merging the layers into JSON
+*/
+TEST(Scope, JSON) {
+  Scope::Global().SetTag("release", "1.0");
+  Scope::Global().SetTag("layer", "global");
+  Scope::Global().SetUser(User("42", "global@example.com", "global"));
+  Scope::Global().SetContext(std::make_shared<ContextRuntime>("sentry-cpp", "1"));
+
+  std::thread worker([]() {
+    // Other threads only see the global scope
+    Scope::Current().SetTag("layer", "worker");
+  });
+  worker.join();
+
+  LocalScope local;
+  Scope::Current().SetTag("layer", "local");
+  Scope::Current().SetExtra("request", "abc");
+  Scope::Current().SetContext(std::make_shared<ContextOS>("Linux", "4.4"));
+
+  rapidjson::Document json;
+  json.SetObject();
+  Scope::Capture().AddToJson(json);
+
+  ASSERT_EQ(true, json.HasMember(JSON_ELEM_TAGS));
+  EXPECT_EQ(true, std::string(json[JSON_ELEM_TAGS]["layer"].GetString()) == "local");
+  EXPECT_EQ(true, std::string(json[JSON_ELEM_TAGS]["release"].GetString()) == "1.0");
+  EXPECT_EQ(true, json[JSON_ELEM_EXTRA].HasMember("request"));
+  EXPECT_EQ(true, json[JSON_ELEM_USER].HasMember(JSON_ELEM_USER_EMAIL));
+  EXPECT_EQ(true, json[JSON_ELEM_CONTEXTS].HasMember(JSON_ELEM_CONTEXT_OS));
+  EXPECT_EQ(true, json[JSON_ELEM_CONTEXTS][JSON_ELEM_CONTEXT_OS].HasMember(JSON_ELEM_OS_VERSION));
+  EXPECT_EQ(true, json[JSON_ELEM_CONTEXTS].HasMember(JSON_ELEM_CONTEXT_RUNTIME));
+
+  Scope::Global().Clear();
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+/********************************************//**
+* @file SentrySessionsTest.cpp
+* @brief Testing for SentrySessions.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentrySessions.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test ending sessions from several threads and flushing them once
+*/
+TEST(Sessions, Base) {
+  std::vector<std::string> envelopes;
+  SessionTracker tracker(attributes::Release("app@1.0.0"), attributes::Environment("production"),
+    [&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+  EXPECT_EQ(true, tracker.IsValid());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&tracker]() {
+      for (int i = 0; i < 1000; ++i) {
+        Session session = tracker.StartSession();
+        if (i % 10 == 0) {
+          session.MarkErrored();
+        }
+        if (i % 100 == 0) {
+          session.End(SESSION_CRASHED);
+        }
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+
+  {
+    Session session = tracker.StartSession();
+    Session moved(std::move(session));
+    EXPECT_EQ(false, session.IsValid());
+    EXPECT_EQ(true, moved.IsValid());
+    moved.End(SESSION_ABNORMAL);
+    EXPECT_EQ(false, moved.IsValid());
+  }
+
+  EXPECT_EQ(true, tracker.Flush(true) >= 1u);
+  ASSERT_EQ(1u, envelopes.size());
+  EXPECT_EQ(0u, tracker.Flush(true));
+
+  const std::string &envelope = envelopes[0];
+  size_t header_end = envelope.find('\n');
+  size_t item_end = envelope.find('\n', header_end + 1);
+  ASSERT_EQ(true, item_end != std::string::npos);
+
+  Document item;
+  item.Parse(envelope.substr(header_end + 1, item_end - header_end - 1).c_str());
+  EXPECT_EQ(std::string(SESSION_ITEM_TYPE), item[JSON_ELEM_ENVELOPE_ITEM_TYPE].GetString());
+  std::string payload_str = envelope.substr(item_end + 1, envelope.size() - item_end - 2);
+  EXPECT_EQ(payload_str.size(), item[JSON_ELEM_ENVELOPE_ITEM_LENGTH].GetUint64());
+
+  Document payload;
+  payload.Parse(payload_str.c_str());
+  EXPECT_EQ(std::string("app@1.0.0"), payload[JSON_ELEM_SESSION_ATTRS][JSON_ELEM_RELEASE].GetString());
+  EXPECT_EQ(std::string("production"), payload[JSON_ELEM_SESSION_ATTRS][JSON_ELEM_ENVIRONMENT].GetString());
+
+  uint64_t totals[SESSION_STATUS_COUNT] = { 0 };
+  const char *names[SESSION_STATUS_COUNT] = { JSON_ELEM_SESSION_EXITED, JSON_ELEM_SESSION_ERRORED, JSON_ELEM_SESSION_CRASHED, JSON_ELEM_SESSION_ABNORMAL };
+  const rapidjson::Value &aggregates = payload[JSON_ELEM_SESSION_AGGREGATES];
+  for (SizeType i = 0; i < aggregates.Size(); ++i) {
+    EXPECT_EQ(false, aggregates[i].HasMember(JSON_ELEM_SESSION_DID));
+    EXPECT_EQ(20u, std::string(aggregates[i][JSON_ELEM_SESSION_STARTED].GetString()).size());
+    for (size_t j = 0; j < SESSION_STATUS_COUNT; ++j) {
+      if (aggregates[i].HasMember(names[j])) {
+        totals[j] += aggregates[i][names[j]].GetUint64();
+      }
+    }
+  }
+  EXPECT_EQ(3600u, totals[SESSION_EXITED]);
+  EXPECT_EQ(360u, totals[SESSION_ERRORED]);
+  EXPECT_EQ(40u, totals[SESSION_CRASHED]);
+  EXPECT_EQ(1u, totals[SESSION_ABNORMAL]);
+}
+
+/*! @test Test sessions with a user are kept apart by distinct id
+*/
+TEST(Sessions, User) {
+  std::vector<std::string> envelopes;
+  SessionTracker tracker(attributes::Release("app@1.0.0"), attributes::Environment(""),
+    [&envelopes](const std::string &envelope) { envelopes.push_back(envelope); });
+
+  User alice("1", "alice@example.com", "alice");
+  User bob("", "bob@example.com", "bob");
+  EXPECT_EQ(std::string("1"), SessionTracker::GetDistinctID(alice));
+  EXPECT_EQ(std::string("bob@example.com"), SessionTracker::GetDistinctID(bob));
+
+  const int64_t minute = SessionTracker::CurrentMinute() - 1;
+  tracker.Record(minute, SessionTracker::GetDistinctID(alice), SESSION_EXITED);
+  tracker.Record(minute, SessionTracker::GetDistinctID(alice), SESSION_EXITED);
+  tracker.Record(minute, SessionTracker::GetDistinctID(bob), SESSION_CRASHED);
+  tracker.Record(minute, std::string(), SESSION_EXITED);
+  tracker.Record(minute + 2, std::string(), SESSION_EXITED);
+
+  // Minutes not yet finished stay behind until forced
+  EXPECT_EQ(3u, tracker.Flush());
+  ASSERT_EQ(1u, envelopes.size());
+  EXPECT_EQ(1u, tracker.Flush(true));
+  ASSERT_EQ(2u, envelopes.size());
+
+  std::string payload_str = envelopes[0].substr(envelopes[0].find('\n', envelopes[0].find('\n') + 1) + 1);
+  Document payload;
+  payload.Parse(payload_str.c_str());
+  EXPECT_EQ(false, payload[JSON_ELEM_SESSION_ATTRS].HasMember(JSON_ELEM_ENVIRONMENT));
+
+  const rapidjson::Value &aggregates = payload[JSON_ELEM_SESSION_AGGREGATES];
+  ASSERT_EQ(3u, aggregates.Size());
+  EXPECT_EQ(false, aggregates[0].HasMember(JSON_ELEM_SESSION_DID));
+  EXPECT_EQ(std::string("1"), aggregates[1][JSON_ELEM_SESSION_DID].GetString());
+  EXPECT_EQ(2u, aggregates[1][JSON_ELEM_SESSION_EXITED].GetUint64());
+  EXPECT_EQ(std::string("bob@example.com"), aggregates[2][JSON_ELEM_SESSION_DID].GetString());
+  EXPECT_EQ(1u, aggregates[2][JSON_ELEM_SESSION_CRASHED].GetUint64());
+
+  // A crash of the previous run counts against the minute it happened in
+  tracker.RecordCrash(static_cast<std::time_t>(minute * 60 + 30), "carol");
+  EXPECT_EQ(1u, tracker.Flush());
+  ASSERT_EQ(3u, envelopes.size());
+  EXPECT_EQ(true, envelopes[2].find("\"did\":\"carol\",\"crashed\":1") != std::string::npos);
+  EXPECT_EQ(true, envelopes[2].find(attributes::Timestamp(static_cast<time_t>(minute * 60)).GetTimestampString()) != std::string::npos);
+
+  SessionTracker no_release(attributes::Release(""), attributes::Environment(""), SessionTracker::Sink());
+  EXPECT_EQ(false, no_release.IsValid());
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+/********************************************//**
+* @file SentrySmallMapTest.cpp
+* @brief Testing for SentrySmallMap.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentrySmallMap.h"
+#include <gtest/gtest.h>
+
+using namespace sentry;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test inserting, finding and erasing
+*/
+TEST(SmallMap, Base) {
+  StringMap map;
+  EXPECT_EQ(true, map.empty());
+  EXPECT_EQ(true, map.IsInline());
+
+  map["delta"] = "4";
+  map["alpha"] = "1";
+  map["charlie"] = "3";
+  EXPECT_EQ(false, map.insert("alpha", "changed").second);
+  EXPECT_EQ(true, map.insert("bravo", "2").second);
+  EXPECT_EQ(4u, map.size());
+  EXPECT_EQ(true, map.IsInline());
+
+  // Entries stay in key order
+  const char * const keys[] = { "alpha", "bravo", "charlie", "delta" };
+  size_t index = 0;
+  for (auto entry = map.cbegin(); entry != map.cend(); ++entry, ++index) {
+    EXPECT_EQ(true, entry->first == keys[index]);
+  }
+
+  // Lookups with a view into a longer buffer
+  const char buffer[] = "charlie-and-more";
+  EXPECT_EQ(true, map.find(StringView(buffer, 7))->second == "3");
+  EXPECT_EQ(true, map.find(StringView(buffer, 4)) == map.end());
+
+  // Growing past the inline capacity keeps every entry
+  map["echo"] = "5";
+  EXPECT_EQ(false, map.IsInline());
+  EXPECT_EQ(5u, map.size());
+  EXPECT_EQ(true, map["alpha"] == "1");
+
+  StringMap copy(map);
+  EXPECT_EQ(true, copy == map);
+  StringMap moved(std::move(copy));
+  EXPECT_EQ(true, moved == map);
+  EXPECT_EQ(true, copy.empty());
+
+  EXPECT_EQ(1u, map.erase("bravo"));
+  EXPECT_EQ(0u, map.erase("bravo"));
+  EXPECT_EQ(0u, map.count("bravo"));
+  EXPECT_EQ(true, map != moved);
+
+  // Small maps move their inline entries
+  StringMap small({ { "b", "2" }, { "a", "1" } });
+  EXPECT_EQ(true, small.begin()->first == "a");
+  StringMap target;
+  target = std::move(small);
+  EXPECT_EQ(2u, target.size());
+  EXPECT_EQ(true, target.IsInline());
+
+  std::map<std::string, std::string> tree;
+  tree["key"] = "value";
+  StringMap from_tree(tree);
+  EXPECT_EQ(true, from_tree["key"] == "value");
+
+  map.clear();
+  EXPECT_EQ(true, map.empty());
+}
\ No newline at end of file
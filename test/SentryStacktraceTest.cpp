@@ -7,7 +7,7 @@
 * @copyright CadActive Technologies, LLC
 ***********************************************/
 #include "SentryStacktrace.h"
-#include <gtest\gtest.h>
+#include <gtest/gtest.h>
 
 using namespace sentry;
 using namespace rapidjson;
@@ -48,4 +48,58 @@ TEST(Stacktrace, JSON) {
   const std::string& some_json_function = some_json.GetFrames().at(1).GetFunction();
   const std::string& some_function = some.GetFrames().at(1).GetFunction();
   EXPECT_EQ(true, some_function == some_json_function);
+}
+
+/*! @test Test truncating deep and recursive stacks
+*/
+TEST(Stacktrace, Truncate) {
+  std::vector<Frame> frames;
+  frames.push_back(Frame("main.cpp", "main"));
+  for (int i = 0; i < 10; ++i) {
+    frames.push_back(Frame("tree.cpp", "visit"));
+    frames.push_back(Frame("tree.cpp", "descend"));
+  }
+  frames.push_back(Frame("tree.cpp", "crash"));
+
+  // Recursion collapses to a single visit/descend cycle
+  Stacktrace recursive(frames);
+  EXPECT_EQ(true, recursive.Truncate(StacktraceTruncation(0, 0)) == 18);
+  EXPECT_EQ(true, recursive.GetFrames().size() == 4);
+  EXPECT_EQ(true, recursive.GetFrames().at(3).GetFunction() == "crash");
+  EXPECT_EQ(true, recursive.GetFramesOmitted() == Stacktrace::OmittedRange(0, 0));
+  EXPECT_EQ(true, recursive.IsTruncated());
+
+  // A truncated stack is not truncated again
+  EXPECT_EQ(true, recursive.Truncate(StacktraceTruncation(1, 1)) == 0);
+  EXPECT_EQ(true, recursive.GetFrames().size() == 4);
+
+  // Without collapsing, only the frames nearest the root and the crash are kept
+  Stacktrace deep(frames);
+  EXPECT_EQ(true, deep.Truncate(StacktraceTruncation(3, 2, false)) == 17);
+  ASSERT_EQ(true, deep.GetFrames().size() == 5);
+  EXPECT_EQ(true, deep.GetFrames().at(0).GetFunction() == "main");
+  EXPECT_EQ(true, deep.GetFrames().at(4).GetFunction() == "crash");
+  EXPECT_EQ(true, deep.GetFramesOmitted() == Stacktrace::OmittedRange(2, 19));
+
+  // With collapsing, the split range is still in the original indexes
+  Stacktrace both(frames);
+  EXPECT_EQ(true, both.Truncate(StacktraceTruncation(1, 2)) == 19);
+  ASSERT_EQ(true, both.GetFrames().size() == 3);
+  EXPECT_EQ(true, both.GetFrames().at(1).GetFunction() == "visit");
+  EXPECT_EQ(true, both.GetFramesOmitted() == Stacktrace::OmittedRange(2, 21));
+
+  // Short stacks are left alone
+  Stacktrace shallow(frames);
+  EXPECT_EQ(true, shallow.Truncate(StacktraceTruncation(50, 50, false)) == 0);
+  EXPECT_EQ(true, shallow.GetFramesOmitted() == Stacktrace::OmittedRange(0, 0));
+  EXPECT_EQ(false, shallow.IsTruncated());
+
+  rapidjson::Document json;
+  deep.ToJson(json);
+  ASSERT_EQ(true, json.HasMember(JSON_ELEM_FRAMES_OMITTED));
+  EXPECT_EQ(true, json[JSON_ELEM_FRAMES_OMITTED].Size() == 2);
+
+  Stacktrace deep_json(json);
+  EXPECT_EQ(true, deep_json.GetFramesOmitted() == deep.GetFramesOmitted());
+  EXPECT_EQ(true, deep_json.IsTruncated());
 }
\ No newline at end of file
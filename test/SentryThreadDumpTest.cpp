@@ -0,0 +1,155 @@
+/********************************************//**
+* @file SentryThreadDumpTest.cpp
+* @brief Testing for SentryThreadDump.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryThreadDump.h"
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test the calling thread
+*/
+TEST(ThreadDump, Current) {
+  Thread thread = ThreadDump::Current(true);
+  EXPECT_EQ(true, thread.IsValid());
+  EXPECT_EQ(true, thread.IsCurrent());
+  EXPECT_EQ(true, thread.IsCrashed());
+  EXPECT_EQ(ThreadRegistry::GetCurrentThreadID(), thread.GetThreadID());
+}
+
+#if defined(__linux__)
+/*! @test Test capturing every thread, each under its own id
+*/
+TEST(ThreadDump, CaptureAll) {
+  std::mutex mutex;
+  std::condition_variable released;
+  bool is_released = false;
+  std::set<int> worker_ids;
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < 8; ++i) {
+    workers.push_back(std::thread([&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      worker_ids.insert(ThreadRegistry::GetCurrentThreadID());
+      released.wait(lock, [&]() { return is_released; });
+    }));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  Threads threads = ThreadDump::CaptureAll(std::chrono::milliseconds(1000));
+  EXPECT_EQ(true, threads.IsValid());
+  EXPECT_EQ(0u, ThreadCapture::GetInstance().GetTimedOutCount());
+  EXPECT_EQ(true, threads.GetThreads().size() > workers.size());
+
+  size_t current = 0;
+  size_t stacktraces = 0;
+  std::set<int> seen;
+  for (auto thread = threads.GetThreads().cbegin(); thread != threads.GetThreads().cend(); ++thread) {
+    EXPECT_EQ(true, seen.insert(thread->GetThreadID()).second);
+    EXPECT_EQ(std::string::npos, thread->GetName().find("identical"));
+    stacktraces += thread->GetStacktrace().IsValid() ? 1 : 0;
+    if (thread->IsCurrent()) {
+      ++current;
+      EXPECT_EQ(ThreadCapture::GetCurrentThreadID(), thread->GetThreadID());
+      EXPECT_EQ(true, thread->GetStacktrace().IsValid());
+    }
+  }
+  EXPECT_EQ(1u, current);
+  // The workers wait in the same place, so they share one stacktrace
+  EXPECT_EQ(true, stacktraces <= threads.GetThreads().size() - workers.size() + 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto worker_id = worker_ids.cbegin(); worker_id != worker_ids.cend(); ++worker_id) {
+      EXPECT_EQ(1u, seen.count(*worker_id));
+    }
+    is_released = true;
+  }
+  released.notify_all();
+  for (auto worker = workers.begin(); worker != workers.end(); ++worker) {
+    worker->join();
+  }
+}
+
+/*! @brief The serialized threads of the process while count more threads wait in the same place
+*/
+static std::string CaptureWithIdleThreads(const size_t &count, size_t &thread_count, size_t &stacktrace_count) {
+  std::mutex mutex;
+  std::condition_variable released;
+  bool is_released = false;
+  size_t waiting = 0;
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < count; ++i) {
+    workers.push_back(std::thread([&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++waiting;
+      released.wait(lock, [&]() { return is_released; });
+    }));
+  }
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (waiting == count) { break; }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  Threads threads = ThreadDump::CaptureAll(std::chrono::milliseconds(1000));
+  thread_count = threads.GetThreads().size();
+  stacktrace_count = 0;
+  for (auto thread = threads.GetThreads().cbegin(); thread != threads.GetThreads().cend(); ++thread) {
+    stacktrace_count += thread->GetStacktrace().IsValid() ? 1 : 0;
+  }
+  Document doc;
+  doc.SetObject();
+  threads.AddToJson(doc);
+  StringBuffer buffer;
+  Writer<StringBuffer> writer(buffer);
+  doc.Accept(writer);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_released = true;
+  }
+  released.notify_all();
+  for (auto worker = workers.begin(); worker != workers.end(); ++worker) {
+    worker->join();
+  }
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+/*! @test Test that identical threads add their ids but not their stacks to the payload
+*/
+TEST(ThreadDump, Payload) {
+  size_t few_threads = 0;
+  size_t few_stacktraces = 0;
+  const std::string few = CaptureWithIdleThreads(4, few_threads, few_stacktraces);
+  size_t many_threads = 0;
+  size_t many_stacktraces = 0;
+  const std::string many = CaptureWithIdleThreads(64, many_threads, many_stacktraces);
+
+  ASSERT_EQ(true, many_threads >= few_threads + 60);
+  EXPECT_EQ(few_stacktraces, many_stacktraces);
+
+  // Each added thread costs its id, flags and name, not a stacktrace
+  const size_t per_thread = (many.size() - few.size()) / (many_threads - few_threads);
+  EXPECT_EQ(true, per_thread < 96);
+}
+#endif
\ No newline at end of file
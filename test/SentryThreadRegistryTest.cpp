@@ -0,0 +1,104 @@
+/********************************************//**
+* @file SentryThreadRegistryTest.cpp
+* @brief Testing for SentryThreadRegistry.h
+* @details
+* @author James Sullivan
+* @version
+* @copyright CadActive Technologies, LLC
+***********************************************/
+#include "SentryThreadDump.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#endif
+
+using namespace sentry;
+using namespace rapidjson;
+
+/***********************************************
+*	Functions
+***********************************************/
+/*! @test Test the registry's lookups
+*/
+TEST(ThreadRegistry, Base) {
+  std::string name;
+  EXPECT_EQ(false, ThreadRegistry::GetInstance().FindThreadName(0, name));
+  EXPECT_EQ(false, ThreadRegistry::GetInstance().FindThreadName(-1, name));
+}
+
+#if defined(__linux__)
+/*! @test Test renaming threads and filling Thread from the cache
+*/
+TEST(ThreadRegistry, Names) {
+  const size_t registered = ThreadRegistry::GetInstance().GetThreadCount();
+
+  std::thread worker([registered]() {
+    const int thread_id = ThreadRegistry::GetCurrentThreadID();
+    EXPECT_EQ(ThreadCapture::GetCurrentThreadID(), thread_id);
+
+    EXPECT_EQ(true, ThreadRegistry::SetCurrentThreadName("sentry-worker-with-long-name"));
+    EXPECT_EQ(true, ThreadRegistry::GetCurrentThreadName() == "sentry-worker-w");
+    EXPECT_EQ(true, ThreadCapture::ReadThreadName(thread_id) == "sentry-worker-w");
+
+    std::string name;
+    EXPECT_EQ(true, ThreadRegistry::GetInstance().FindThreadName(thread_id, name));
+    EXPECT_EQ(true, name == "sentry-worker-w");
+
+    Thread thread = ThreadDump::Current();
+    EXPECT_EQ(true, thread.IsValid());
+    EXPECT_EQ(true, thread.IsCurrent());
+    EXPECT_EQ(thread_id, thread.GetThreadID());
+    EXPECT_EQ(true, thread.GetName() == "sentry-worker-w");
+    EXPECT_EQ(registered + 1, ThreadRegistry::GetInstance().GetThreadCount());
+  });
+  worker.join();
+
+  // The worker's entry is released when it exits
+  EXPECT_EQ(registered, ThreadRegistry::GetInstance().GetThreadCount());
+}
+
+/*! @test Test that exited threads do not leave tombstones behind
+*/
+TEST(ThreadRegistry, Tombstones) {
+  const size_t registered = ThreadRegistry::GetInstance().GetThreadCount();
+  for (size_t i = 0; i < THREAD_REGISTRY_CAPACITY + 16; ++i) {
+    std::thread worker([]() {
+      ThreadRegistry::GetCurrentThreadID();
+    });
+    worker.join();
+  }
+  EXPECT_EQ(registered, ThreadRegistry::GetInstance().GetThreadCount());
+  EXPECT_EQ(true, ThreadRegistry::GetInstance().GetTombstoneCount() < 64);
+
+  std::string name;
+  EXPECT_EQ(false, ThreadRegistry::GetInstance().FindThreadName(1 << 30, name));
+}
+
+/*! @test Test the calling thread's id in a forked child
+*/
+TEST(ThreadRegistry, Fork) {
+  const int parent_id = ThreadRegistry::GetCurrentThreadID();
+  std::thread worker([]() {
+    ThreadRegistry::GetCurrentThreadID();
+  });
+
+  const pid_t child = fork();
+  if (child == 0) {
+    const int thread_id = ThreadRegistry::GetCurrentThreadID();
+    std::string name;
+    const bool is_ok = (thread_id == ThreadCapture::GetCurrentThreadID()) && (thread_id != parent_id) &&
+      ThreadRegistry::GetInstance().FindThreadName(thread_id, name) && (ThreadRegistry::GetInstance().GetThreadCount() == 1);
+    _exit(is_ok ? 0 : 1);
+  }
+  worker.join();
+  ASSERT_EQ(true, child > 0);
+
+  int status = 0;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  EXPECT_EQ(true, WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
+#endif
\ No newline at end of file
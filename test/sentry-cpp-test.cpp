@@ -13,7 +13,7 @@
 #include <Windows.h>
 
 // Google Test
-#include "gtest\gtest.h"
+#include "gtest/gtest.h"
 
 /***********************************************
 *	Functions